@@ -0,0 +1,61 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <benchmark/benchmark.h>
+#include <debug/async_log.h>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+using namespace cxk;
+
+/// 输出丢弃，只测写入端；队列足够大，后台线程每毫秒取一次
+static void DiscardSink()
+{
+    static bool installed = []{
+        AsyncLog::QueueCapacity() = 1 << 16;
+        AsyncLog::FlushInterval() = std::chrono::milliseconds(1);
+        AsyncLog::getInstance().SetSink([](LogLevel, const char*, std::size_t) {});
+        return true;
+    }();
+    (void)installed;
+}
+
+/// 写入本线程的SPSC队列：定长拷贝，不格式化、不加锁
+static void BM_AsyncLogWrite(benchmark::State& state)
+{
+    DiscardSink();
+    void* stack = &state;
+    for (auto _ : state)
+        CO_ASYNC_LOG(LogLevel::info, "Protected stack at %p with %d pages", stack, 1);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["dropped"] = (double)AsyncLog::getInstance().GetStats().dropped;
+}
+BENCHMARK(BM_AsyncLogWrite)->ThreadRange(1, 8)->UseRealTime();
+
+/// 级别过滤掉的日志只有一次比较
+static void BM_AsyncLogFiltered(benchmark::State& state)
+{
+    DiscardSink();
+    void* stack = &state;
+    for (auto _ : state)
+        CO_ASYNC_LOG(LogLevel::debug, "Protected stack at %p with %d pages", stack, 1);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AsyncLogFiltered);
+
+/// 对照：原RS_DBG的做法，全局互斥锁 + 同步格式化 + 每行fflush
+static void BM_SyncLogWrite(benchmark::State& state)
+{
+    static std::mutex mtx;
+    static FILE* out = fopen("/dev/null", "w");
+    void* stack = &state;
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(mtx);
+        fprintf(out, "Protected stack at %p with %d pages\n", stack, 1);
+        fflush(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SyncLogWrite)->ThreadRange(1, 8)->UseRealTime();
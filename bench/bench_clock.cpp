@@ -0,0 +1,65 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <benchmark/benchmark.h>
+#include <common/clock.h>
+#include <chrono>
+#include <thread>
+
+using namespace cxk;
+
+/// 启动校准线程并等待两个校准周期，使FastSteadyClock进入TSC快速路径
+static void StartCalibration()
+{
+    static bool started = []{
+        FastSteadyClock::StartCalibration();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return true;
+    }();
+    (void)started;
+}
+
+static void BM_FastSteadyClockNow(benchmark::State& state)
+{
+    StartCalibration();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(FastSteadyClock::now());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FastSteadyClockNow);
+
+static void BM_SteadyClockNow(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::chrono::steady_clock::now());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SteadyClockNow);
+
+static void BM_SystemClockNow(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::chrono::system_clock::now());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SystemClockNow);
+
+/// 多线程同时读时钟：FastSteadyClock读取共享的校准数据
+static void BM_FastSteadyClockNowThreads(benchmark::State& state)
+{
+    StartCalibration();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(FastSteadyClock::now());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FastSteadyClockNowThreads)->ThreadRange(1, 64)->UseRealTime();
+
+/// 协程调度循环每轮刷新一次的粗粒度时间，读取只是一次线程局部变量的加载
+static void BM_FastSteadyClockCoarseNow(benchmark::State& state)
+{
+    FastSteadyClock::UpdateCoarse();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(FastSteadyClock::coarse_now());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FastSteadyClockCoarseNow);
@@ -0,0 +1,156 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <benchmark/benchmark.h>
+#include <context/context.h>
+#include <context/stack_pool.h>
+#include <debug/async_log.h>
+#include <cstdlib>
+
+using namespace cxk;
+
+/// 主线程与协程各自保存的上下文
+struct JumpPair
+{
+    fcontext_t main_ = nullptr;
+    fcontext_t coro_ = nullptr;
+};
+
+/// 协程入口：每次被切入后立即切回主线程
+static void FCONTEXT_CALL JumpEntry(intptr_t vp)
+{
+    JumpPair* p = (JumpPair*)vp;
+    for (;;)
+        libgo_jump_fcontext(&p->coro_, p->main_, 0);
+}
+
+/// 裸libgo_jump_fcontext往返（两次切换）
+static void BM_JumpFcontext(benchmark::State& state)
+{
+    StackBlock* block = StackPool::getInstance().Allocate(0);
+    JumpPair p;
+    p.coro_ = libgo_make_fcontext(block->stack_ + block->stackSize_, block->stackSize_, &JumpEntry);
+    for (auto _ : state)
+        libgo_jump_fcontext(&p.main_, p.coro_, (intptr_t)&p);
+    state.SetItemsProcessed(state.iterations() * 2);
+    StackPool::getInstance().Free(block);   // 协程停在循环中，直接丢弃它的栈
+}
+BENCHMARK(BM_JumpFcontext);
+
+/// Context入口：vp指向保存Context指针的变量
+static void FCONTEXT_CALL SwapEntry(intptr_t vp)
+{
+    Context* ctx = *(Context**)vp;
+    for (;;)
+        ctx->SwapOut();
+}
+
+/// Context::SwapIn/SwapOut往返（调度器切换协程的路径，包含线程本地上下文的访问）
+static void BM_ContextSwap(benchmark::State& state)
+{
+    Context* holder = nullptr;
+    Context ctx(&SwapEntry, (intptr_t)&holder);
+    holder = &ctx;
+    for (auto _ : state)
+        ctx.SwapIn();
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_ContextSwap);
+
+static void FCONTEXT_CALL NopEntry(intptr_t) {}
+
+/// 临时修改保护页数量和栈池缓存参数，析构时恢复
+class StackConfigScope
+{
+public:
+    StackConfigScope(int guardPages, bool cache)
+        : guardPages_(StackTraits::GetProtectStackPageSize()),
+          threadCacheCount_(StackPool::ThreadCacheCount()),
+          maxCachedBytes_(StackPool::MaxCachedBytes())
+    {
+        StackTraits::GetProtectStackPageSize() = guardPages;
+        Flush();
+        if (!cache) {
+            StackPool::ThreadCacheCount() = 0;
+            StackPool::MaxCachedBytes() = 0;
+        }
+    }
+
+    ~StackConfigScope()
+    {
+        StackTraits::GetProtectStackPageSize() = guardPages_;
+        StackPool::ThreadCacheCount() = threadCacheCount_;
+        StackPool::MaxCachedBytes() = maxCachedBytes_;
+        Flush();
+    }
+
+private:
+    /// 清空线程缓存和全局链表，之后的栈按当前的保护页设置重新创建
+    static void Flush()
+    {
+        std::size_t count = StackPool::ThreadCacheCount();
+        StackPool::ThreadCacheCount() = 0;
+        StackPool::getInstance().Free(StackPool::getInstance().Allocate(0));
+        StackPool::ThreadCacheCount() = count;
+        StackPool::getInstance().Trim();
+    }
+
+    int guardPages_;
+    std::size_t threadCacheCount_;
+    std::size_t maxCachedBytes_;
+};
+
+/// 栈池命中：保护页只在栈块创建时设置一次，复用时不再mprotect
+static void BM_ContextCreatePooled(benchmark::State& state)
+{
+    StackConfigScope scope((int)state.range(0), true);
+    for (auto _ : state) {
+        Context ctx(&NopEntry, 0);
+        benchmark::DoNotOptimize(&ctx);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ContextCreatePooled)->ArgName("guard")->Arg(0)->Arg(1);
+
+/// 关闭栈池缓存：每次都mmap(+mprotect)/munmap，对应冷启动或缓存耗尽时的代价
+static void BM_ContextCreateUncached(benchmark::State& state)
+{
+    StackConfigScope scope((int)state.range(0), false);
+    for (auto _ : state) {
+        Context ctx(&NopEntry, 0);
+        benchmark::DoNotOptimize(&ctx);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ContextCreateUncached)->ArgName("guard")->Arg(0)->Arg(1);
+
+static void* PageAlignedMalloc(std::size_t size)
+{
+    void* p = nullptr;
+    return posix_memalign(&p, getpagesize(), size) == 0 ? p : nullptr;
+}
+
+/// 自定义分配器：不经过栈池，每次malloc/free，开启保护页时每次mprotect一对
+static void BM_ContextCreateCustomAlloc(benchmark::State& state)
+{
+    LogLevel level = AsyncLog::Level().load(std::memory_order_relaxed);
+    AsyncLog::Level().store(LogLevel::off, std::memory_order_relaxed);  // ProtectStack每次都会写一条日志，这里只测mprotect的开销
+    stack_malloc_fn_t mallocFn = StackTraits::MallocFunc();
+    stack_free_fn_t freeFn = StackTraits::FreeFunc();
+    int guardPages = StackTraits::GetProtectStackPageSize();
+    StackTraits::MallocFunc() = &PageAlignedMalloc;
+    StackTraits::FreeFunc() = &::std::free;
+    StackTraits::GetProtectStackPageSize() = (int)state.range(0);
+
+    for (auto _ : state) {
+        Context ctx(&NopEntry, 0);
+        benchmark::DoNotOptimize(&ctx);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    StackTraits::MallocFunc() = mallocFn;
+    StackTraits::FreeFunc() = freeFn;
+    StackTraits::GetProtectStackPageSize() = guardPages;
+    AsyncLog::Level().store(level, std::memory_order_relaxed);
+}
+BENCHMARK(BM_ContextCreateCustomAlloc)->ArgName("guard")->Arg(0)->Arg(1);
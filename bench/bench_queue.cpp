@@ -0,0 +1,90 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <benchmark/benchmark.h>
+#include <common/lock_free_ring_queue.h>
+#include <common/thread_safe_queue.h>
+#include <common/smart_ptr.h>
+#include <concurrentqueue/concurrentqueue.h>
+
+using namespace cxk;
+
+/*
+ * 每个线程每轮push一个元素再pop一个元素，队列长度保持在线程数以内，
+ * 测量的是多个线程同时读写同一个队列时单次操作的开销。
+ * 队列对象在所有线程之间共享，使用函数内静态变量，所有线程进入计时循环前已构造完成。
+ */
+
+/// 1 ~ 64个线程，按2的倍数递增
+#define QUEUE_BENCHMARK(fn) BENCHMARK(fn)->ThreadRange(1, 64)->UseRealTime()
+
+static void BM_LockFreeRingQueue(benchmark::State& state)
+{
+    static LockFreeRingQueue<int> queue(1 << 16);
+    int v = 0;
+    for (auto _ : state) {
+        queue.Push(1);
+        benchmark::DoNotOptimize(queue.Pop(v));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+QUEUE_BENCHMARK(BM_LockFreeRingQueue);
+
+/// 批量接口：一次原子操作占有一段区间
+static void BM_LockFreeRingQueueBatch(benchmark::State& state)
+{
+    static LockFreeRingQueue<int> queue(1 << 16);
+    int in[16] = {}, out[16];
+    for (auto _ : state) {
+        LockFreeBatchResult r = queue.PushBatch(in, 16);
+        benchmark::DoNotOptimize(queue.PopBatch(out, r.count));
+    }
+    state.SetItemsProcessed(state.iterations() * 32);
+}
+QUEUE_BENCHMARK(BM_LockFreeRingQueueBatch);
+
+struct QueueNode : public TSQueueHook, public RefObject
+{
+};
+
+static void BM_TSQueue(benchmark::State& state)
+{
+    static TSQueue<QueueNode> queue;
+    // 每个线程持有一个节点；push后队列中至少有本线程的一个元素，因此pop不会为空
+    QueueNode* node = new QueueNode;
+    node->AddRef();
+    for (auto _ : state) {
+        queue.push(node);
+        node = queue.pop();
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    node->DecRef();
+}
+QUEUE_BENCHMARK(BM_TSQueue);
+
+static void BM_ConcurrentQueue(benchmark::State& state)
+{
+    static moodycamel::ConcurrentQueue<int> queue;
+    int v = 0;
+    for (auto _ : state) {
+        queue.enqueue(1);
+        benchmark::DoNotOptimize(queue.try_dequeue(v));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+QUEUE_BENCHMARK(BM_ConcurrentQueue);
+
+/// 使用生产者/消费者token（moodycamel推荐的高并发用法）
+static void BM_ConcurrentQueueToken(benchmark::State& state)
+{
+    static moodycamel::ConcurrentQueue<int> queue;
+    moodycamel::ProducerToken ptok(queue);
+    moodycamel::ConsumerToken ctok(queue);
+    int v = 0;
+    for (auto _ : state) {
+        queue.enqueue(ptok, 1);
+        benchmark::DoNotOptimize(queue.try_dequeue(ctok, v));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+QUEUE_BENCHMARK(BM_ConcurrentQueueToken);
@@ -0,0 +1,76 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <benchmark/benchmark.h>
+#include <common/smart_ptr.h>
+#include <memory>
+
+using namespace cxk;
+
+struct BenchObject : public RefObject
+{
+    int value_ = 0;
+};
+
+struct BiasedBenchObject : public BiasedRefObject
+{
+    int value_ = 0;
+};
+
+/// 单线程拷贝构造+析构：一次AddRef和一次DecRef
+static void BM_IncursivePtrCopy(benchmark::State& state)
+{
+    IncursivePtr<BenchObject> ptr(new BenchObject);
+    for (auto _ : state) {
+        IncursivePtr<BenchObject> copy(ptr);
+        benchmark::DoNotOptimize(copy.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IncursivePtrCopy);
+
+/// 偏向计数：创建线程上的拷贝没有原子RMW
+static void BM_BiasedPtrCopy(benchmark::State& state)
+{
+    IncursivePtr<BiasedBenchObject> ptr(new BiasedBenchObject);
+    for (auto _ : state) {
+        IncursivePtr<BiasedBenchObject> copy(ptr);
+        benchmark::DoNotOptimize(copy.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BiasedPtrCopy);
+
+static void BM_SharedPtrCopy(benchmark::State& state)
+{
+    auto ptr = std::make_shared<BenchObject>();
+    for (auto _ : state) {
+        std::shared_ptr<BenchObject> copy(ptr);
+        benchmark::DoNotOptimize(copy.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedPtrCopy);
+
+/// 多个线程同时拷贝同一个对象的指针：引用计数所在缓存行在核间来回传递
+static void BM_IncursivePtrCopyShared(benchmark::State& state)
+{
+    static IncursivePtr<BenchObject> ptr(new BenchObject);
+    for (auto _ : state) {
+        IncursivePtr<BenchObject> copy(ptr);
+        benchmark::DoNotOptimize(copy.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IncursivePtrCopyShared)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_SharedPtrCopyShared(benchmark::State& state)
+{
+    static auto ptr = std::make_shared<BenchObject>();
+    for (auto _ : state) {
+        std::shared_ptr<BenchObject> copy(ptr);
+        benchmark::DoNotOptimize(copy.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedPtrCopyShared)->ThreadRange(1, 64)->UseRealTime();
@@ -0,0 +1,105 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "macro_bench.h"
+#include <concurrence/channel.h>
+#include <scheduler/scheduler.h>
+#include <algorithm>
+#include <cstdio>
+
+/*
+ * 通道流水线：source -> stage[0] -> ... -> stage[N-1] -> sink，相邻两级之间一个缓冲通道。
+ * 每条消息带发送时刻，sink记录端到端延迟；多条流水线互相独立，用于观察工作线程增加时的扩展性。
+ * source发送完后关闭第一个通道，每级读完上游后关闭下游，sink读完即结束。
+ */
+
+namespace cxk
+{
+namespace macro
+{
+
+namespace
+{
+
+struct Message
+{
+    int64_t sentNs_;
+    uint64_t seq_;
+};
+
+} // namespace
+
+int RunPipeline(Options const& opt)
+{
+    bool baseline = opt.Has("baseline");
+    int threads = (int)opt.GetInt("threads", 1);
+    int stages = (int)std::max(1LL, opt.GetInt("stages", 4));
+    int pipelines = (int)std::max(1LL, opt.GetInt("pipelines", threads));
+    uint64_t msgs = (uint64_t)std::max(1LL, opt.GetInt("msgs", 1000000));
+    std::size_t capacity = (std::size_t)std::max(0LL, opt.GetInt("capacity", 64));
+    uint64_t perPipeline = std::max<uint64_t>(1, msgs / (uint64_t)pipelines);
+
+    if (!baseline) Scheduler::getInstance().Start(threads);
+
+    LatencyHistogram* latency = new LatencyHistogram;
+    std::atomic<uint64_t> received{0}, errors{0};
+    std::vector<std::vector<Channel<Message>>> chans(pipelines);
+    for (auto& line : chans)
+        for (int k = 0; k <= stages; ++k)
+            line.emplace_back(capacity);
+
+    Runner runner(baseline);
+    Channel<int> gate;      // 全部单元启动后关闭，同时开始发送
+    for (auto& line : chans) {
+        std::vector<Channel<Message>>* lp = &line;
+        runner.Go([&, lp]{
+            Channel<Message> out = lp->front();
+            int dummy;
+            gate.Pop(dummy);
+            for (uint64_t i = 0; i < perPipeline; ++i)
+                out.Push(Message{NowNs(), i});
+            out.Close();
+        });
+        for (int k = 0; k < stages; ++k) {
+            runner.Go([lp, k]{
+                Channel<Message> in = (*lp)[k], out = (*lp)[k + 1];
+                Message m;
+                while (in.Pop(m))
+                    out.Push(m);
+                out.Close();
+            });
+        }
+        runner.Go([&, lp]{
+            Channel<Message> in = lp->back();
+            Message m;
+            uint64_t n = 0;
+            while (in.Pop(m)) {
+                latency->Record((uint64_t)(NowNs() - m.sentNs_));
+                if (m.seq_ != n) ++errors;      // 每条流水线内保持顺序
+                ++n;
+            }
+            received += n;
+        });
+    }
+    int64_t start = NowNs();
+    gate.Close();
+    runner.Join();
+    int64_t end = NowNs();
+
+    Result r;
+    r.workload_ = "pipeline";
+    r.baseline_ = baseline;
+    r.threads_ = baseline ? pipelines * (stages + 2) : threads;
+    r.params_ = "stages=" + std::to_string(stages) + " pipelines=" + std::to_string(pipelines) +
+            " capacity=" + std::to_string(capacity);
+    r.ops_ = received;
+    r.errors_ = errors + (perPipeline * (uint64_t)pipelines - received);
+    r.seconds_ = (double)(end - start) / 1e9;
+    r.latency_ = latency;
+    Report(r);
+    return 0;
+}
+
+} // macro
+} // cxk
@@ -0,0 +1,209 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "macro_bench.h"
+#include <concurrence/channel.h>
+#include <netio/hook.h>
+#include <scheduler/scheduler.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+/*
+ * TCP回显：每个客户端连接一个回显者，客户端发送定长消息并等待完整回显，记录往返延迟。
+ * 客户端和服务端在同一进程内，协程模式下都是协程（IO经Reactor挂起），baseline模式下每个连接两个线程。
+ * 同一目的端口的连接数受本地端口范围限制，每kConnsPerPort个连接使用一个监听端口。
+ */
+
+namespace cxk
+{
+namespace macro
+{
+
+namespace
+{
+
+const long kConnsPerPort = 20000;
+const std::size_t kMaxMsg = 4096;
+
+ssize_t ReadFull(int fd, char* buf, std::size_t n)
+{
+    std::size_t got = 0;
+    while (got < n) {
+        ssize_t r = co_recv(fd, buf + got, n - got, 0);
+        if (r <= 0) return r;
+        got += (std::size_t)r;
+    }
+    return (ssize_t)got;
+}
+
+int Listen(sockaddr_in& addr)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, 65535) != 0 ||
+        ::getsockname(fd, (sockaddr*)&addr, &len) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void Echo(int fd)
+{
+    char buf[kMaxMsg];
+    for (;;) {
+        ssize_t n = co_recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        if (co_send(fd, buf, (std::size_t)n, 0) != n) break;
+    }
+    co_close(fd);
+}
+
+} // namespace
+
+int RunEcho(Options const& opt)
+{
+    bool baseline = opt.Has("baseline");
+    int threads = (int)opt.GetInt("threads", 1);
+    long conns = std::max(1LL, opt.GetInt("conns", 10000));
+    std::size_t msg = (std::size_t)std::min<long long>(std::max(1LL, opt.GetInt("msg", 64)), (long long)kMaxMsg);
+    double seconds = opt.GetDouble("seconds", 5);
+
+    // 每个连接两个fd（客户端和服务端）
+    long fdLimit = RaiseFdLimit();
+    if (conns > (fdLimit - 64) / 2) {
+        fprintf(stderr, "echo: RLIMIT_NOFILE=%ld, conns clamped from %ld to %ld\n", fdLimit, conns, (fdLimit - 64) / 2);
+        conns = (fdLimit - 64) / 2;
+    }
+    int listeners = (int)((conns + kConnsPerPort - 1) / kConnsPerPort);
+    if (baseline) {
+        long maxThreads = std::max(8LL, opt.GetInt("max-threads", 4000));
+        if (conns > (maxThreads - listeners) / 2) {
+            fprintf(stderr, "echo: baseline uses two threads per connection, conns clamped from %ld to %ld "
+                            "(raise with --max-threads)\n", conns, (maxThreads - listeners) / 2);
+            conns = (maxThreads - listeners) / 2;
+        }
+    }
+
+    TaskAttr attr;
+    attr.stackSize_ = (std::size_t)opt.GetInt("stack", 64 * 1024);
+    attr.sharedStack_ = opt.Has("shared-stack");
+    if (!baseline) Scheduler::getInstance().Start(threads);
+
+    std::vector<int> listenFds;
+    std::vector<sockaddr_in> addrs(listeners);
+    for (int i = 0; i < listeners; ++i) {
+        int fd = Listen(addrs[i]);
+        if (fd < 0) {
+            perror("echo: listen");
+            return 1;
+        }
+        listenFds.push_back(fd);
+    }
+
+    Runner runner(baseline, attr);
+    std::atomic<bool> stopping{false};
+    std::atomic<long> accepted{0};
+    for (int fd : listenFds) {
+        runner.Go([&runner, &stopping, &accepted, fd]{
+            for (;;) {
+                int c = co_accept(fd, nullptr, nullptr);
+                if (c >= 0) {
+                    ++accepted;
+                    runner.Go([c]{ Echo(c); });
+                    continue;
+                }
+                if (stopping || (errno != EINTR && errno != ECONNABORTED)) break;
+            }
+        });
+    }
+
+    LatencyHistogram* latency = new LatencyHistogram;
+    Channel<int> gate;      // 关闭时放行全部客户端
+    std::atomic<long> connected{0};
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> ops{0}, errors{0};
+    for (long i = 0; i < conns; ++i) {
+        sockaddr_in addr = addrs[i % listeners];
+        runner.Go([&, addr]{
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0 || co_connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+                ++errors;
+                ++connected;
+                if (fd >= 0) co_close(fd);
+                return;
+            }
+            int on = 1;
+            co_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            ++connected;
+            int dummy;
+            gate.Pop(dummy);
+
+            char out[kMaxMsg], in[kMaxMsg];
+            memset(out, 'x', msg);
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int64_t start = NowNs();
+                if (co_send(fd, out, msg, 0) != (ssize_t)msg || ReadFull(fd, in, msg) != (ssize_t)msg) {
+                    ++errors;
+                    break;
+                }
+                latency->Record((uint64_t)(NowNs() - start));
+                ++n;
+            }
+            ops += n;
+            co_close(fd);
+        });
+    }
+
+    // 全部连接建立且被服务端接受后才开始计时（connect在进入监听队列时就返回）
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(120);
+    while ((connected < conns || accepted < conns - (long)errors) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (accepted < conns)
+        fprintf(stderr, "echo: only %ld of %ld connections accepted\n", accepted.load(), conns);
+
+    int64_t start = NowNs();
+    gate.Close();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    int64_t end = NowNs();
+    RssInfo rss = ReadRss();
+
+    // 客户端退出后回显者读到EOF退出；shutdown唤醒阻塞在accept上的线程
+    stopping = true;
+    for (int fd : listenFds) ::shutdown(fd, SHUT_RDWR);
+    runner.Join();
+    for (int fd : listenFds) co_close(fd);
+
+    Result r;
+    r.workload_ = "echo";
+    r.baseline_ = baseline;
+    r.threads_ = baseline ? (int)(2 * conns + listeners) : threads;
+    r.params_ = "conns=" + std::to_string(conns) + " msg=" + std::to_string(msg) +
+            " listeners=" + std::to_string(listeners) + (attr.sharedStack_ ? " shared_stack=1" : "");
+    r.ops_ = ops;
+    r.errors_ = errors;
+    r.seconds_ = (double)(end - start) / 1e9;
+    r.latency_ = latency;
+    r.rss_ = rss;
+    Report(r);
+    return 0;
+}
+
+} // macro
+} // cxk
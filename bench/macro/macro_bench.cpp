@@ -0,0 +1,278 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "macro_bench.h"
+#include <scheduler/scheduler.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace cxk
+{
+namespace macro
+{
+
+Options::Options(int argc, char** argv, int first)
+{
+    for (int i = first; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            fprintf(stderr, "ignored argument: %s\n", arg);
+            continue;
+        }
+        const char* eq = strchr(arg, '=');
+        if (eq)
+            values_[std::string(arg + 2, eq)] = eq + 1;
+        else
+            values_[arg + 2] = "";
+    }
+}
+
+void Options::Set(const char* key, std::string value)
+{
+    values_[key] = std::move(value);
+}
+
+bool Options::Has(const char* key) const
+{
+    return values_.count(key) != 0;
+}
+
+std::string Options::Get(const char* key, const char* def) const
+{
+    auto it = values_.find(key);
+    return it == values_.end() ? def : it->second;
+}
+
+long long Options::GetInt(const char* key, long long def) const
+{
+    auto it = values_.find(key);
+    return it == values_.end() || it->second.empty() ? def : atoll(it->second.c_str());
+}
+
+double Options::GetDouble(const char* key, double def) const
+{
+    auto it = values_.find(key);
+    return it == values_.end() || it->second.empty() ? def : atof(it->second.c_str());
+}
+
+std::vector<long long> Options::GetList(const char* key, const char* def) const
+{
+    std::vector<long long> list;
+    std::stringstream ss(Get(key, def));
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) list.push_back(atoll(item.c_str()));
+    return list;
+}
+
+int LatencyHistogram::BucketIndex(uint64_t ns)
+{
+    if (ns < (uint64_t)kSub) return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - kSubBits;
+    return (shift + 1) * kSub + (int)((ns >> shift) & (kSub - 1));
+}
+
+uint64_t LatencyHistogram::BucketUpper(int index)
+{
+    if (index < kSub) return (uint64_t)index;
+    int shift = index / kSub - 1;
+    uint64_t sub = (uint64_t)(index % kSub);
+    return ((kSub + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t ns)
+{
+    static std::atomic<unsigned> nextShard{0};
+    static thread_local unsigned shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    shards_[shard].buckets_[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> LatencyHistogram::Merge() const
+{
+    std::vector<uint64_t> merged(kBuckets, 0);
+    for (Shard const& s : shards_)
+        for (int i = 0; i < kBuckets; ++i)
+            merged[i] += s.buckets_[i].load(std::memory_order_relaxed);
+    return merged;
+}
+
+uint64_t LatencyHistogram::Count() const
+{
+    uint64_t n = 0;
+    for (uint64_t c : Merge()) n += c;
+    return n;
+}
+
+uint64_t LatencyHistogram::Percentile(double q) const
+{
+    std::vector<uint64_t> merged = Merge();
+    uint64_t total = 0;
+    for (uint64_t c : merged) total += c;
+    if (total == 0) return 0;
+
+    // 第rank个样本（从1开始）所在的桶
+    uint64_t rank = (uint64_t)(q * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += merged[i];
+        if (seen >= rank) return BucketUpper(i);
+    }
+    return BucketUpper(kBuckets - 1);
+}
+
+RssInfo ReadRss()
+{
+    RssInfo info;
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            info.current_ = atol(line.c_str() + 6);
+        else if (line.compare(0, 6, "VmHWM:") == 0)
+            info.peak_ = atol(line.c_str() + 6);
+    }
+    return info;
+}
+
+long RaiseFdLimit()
+{
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return 1024;
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        getrlimit(RLIMIT_NOFILE, &rl);
+    }
+    return rl.rlim_cur == RLIM_INFINITY ? (1L << 20) : (long)rl.rlim_cur;
+}
+
+void Runner::Go(TaskF const& fn)
+{
+    if (!baseline_) {
+        Scheduler::getInstance().CreateTask(fn, attr_);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    threads_.emplace_back(fn);
+}
+
+void Runner::Join()
+{
+    if (!baseline_) {
+        while (Scheduler::getInstance().TaskCount() != 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return;
+    }
+    for (;;) {
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            threads.swap(threads_);
+        }
+        if (threads.empty()) return;
+        for (std::thread& t : threads) t.join();
+    }
+}
+
+void Report(Result const& r)
+{
+    RssInfo rss = ReadRss();
+    if (r.rss_.current_) rss.current_ = r.rss_.current_;
+    rss.peak_ = std::max(rss.peak_, rss.current_);
+    double us = 1000.0;
+    printf("workload=%s mode=%s threads=%d %s ops=%llu errors=%llu secs=%.3f throughput=%.0f/s "
+           "p50=%.1fus p99=%.1fus p999=%.1fus rss=%.1fMB peak_rss=%.1fMB\n",
+           r.workload_, r.baseline_ ? "baseline" : "coroutine", r.threads_, r.params_.c_str(),
+           (unsigned long long)r.ops_, (unsigned long long)r.errors_, r.seconds_,
+           r.seconds_ > 0 ? (double)r.ops_ / r.seconds_ : 0.0,
+           r.latency_ ? (double)r.latency_->Percentile(0.50) / us : 0.0,
+           r.latency_ ? (double)r.latency_->Percentile(0.99) / us : 0.0,
+           r.latency_ ? (double)r.latency_->Percentile(0.999) / us : 0.0,
+           (double)rss.current_ / 1024.0, (double)rss.peak_ / 1024.0);
+    fflush(stdout);
+}
+
+} // macro
+} // cxk
+
+using namespace cxk::macro;
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s <echo|pipeline|mutex> [--baseline] [--threads=N[,N...]] [options]\n"
+            "  common:   --baseline  run on std::thread + PThreadSwitcher instead of coroutines\n"
+            "            --threads   worker threads (coroutine mode); a list runs each value in a fresh process\n"
+            "  echo:     --conns=10000 --msg=64 --seconds=5 --stack=65536 --shared-stack\n"
+            "            --max-threads=4000 (baseline: one thread per client and per server connection)\n"
+            "  pipeline: --stages=4 --pipelines=<threads> --msgs=1000000 --capacity=64\n"
+            "  mutex:    --tasks=64 (coroutines per thread) --seconds=3 --cs=100 --think=0\n",
+            prog);
+}
+
+/// 每个线程数在单独的进程中运行：Scheduler只能Start一次，RSS也互不影响
+static int Sweep(int argc, char** argv, std::vector<long long> const& threads)
+{
+    int status = 0;
+    for (long long n : threads) {
+        std::vector<std::string> args;
+        for (int i = 0; i < argc; ++i)
+            if (strncmp(argv[i], "--threads", 9) != 0) args.push_back(argv[i]);
+        args.push_back("--threads=" + std::to_string(n));
+        std::vector<char*> cargs;
+        for (std::string& s : args) cargs.push_back(&s[0]);
+        cargs.push_back(nullptr);
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            execv("/proc/self/exe", cargs.data());
+            perror("execv");
+            _exit(127);
+        }
+        int st = 0;
+        waitpid(pid, &st, 0);
+        if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) status = 1;
+    }
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    // mutex默认扫描1~64个工作线程，其他场景默认使用全部CPU
+    std::string workload = argv[1];
+    Options opt(argc, argv, 2);
+    std::string defThreads = workload == "mutex" ? "1,2,4,8,16,32,64"
+                                                  : std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<long long> threads = opt.GetList("threads", defThreads.c_str());
+    if (threads.size() > 1)
+        return Sweep(argc, argv, threads);
+    opt.Set("threads", std::to_string(threads.empty() ? 1 : std::max(1LL, threads[0])));
+
+    if (workload == "echo") return RunEcho(opt);
+    if (workload == "pipeline") return RunPipeline(opt);
+    if (workload == "mutex") return RunMutexStorm(opt);
+    Usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,155 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_MACRO_BENCH_H
+#define GOCOROUTINE_MACRO_BENCH_H
+
+#pragma once
+#include <task/task.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * @brief 端到端的扩展性基准测试（echo、pipeline、mutex）共用的部分
+ * 每个场景有两种模式：默认在Scheduler的协程上运行；--baseline时同样的代码跑在std::thread上，
+ * 同步原语经DefaultSyncPolicy退化为PThreadSwitcher（futex），IO接口退化为阻塞系统调用。
+ * 结果是一行key=value，便于脚本收集和跨版本对比。
+ */
+
+namespace cxk
+{
+namespace macro
+{
+
+/// @brief 命令行参数：--key=value或--flag
+class Options
+{
+public:
+    Options(int argc, char** argv, int first);
+
+    void Set(const char* key, std::string value);
+
+    bool Has(const char* key) const;
+
+    std::string Get(const char* key, const char* def) const;
+
+    long long GetInt(const char* key, long long def) const;
+
+    double GetDouble(const char* key, double def) const;
+
+    /// @brief 用逗号分隔的整数列表，如--threads=1,2,4
+    std::vector<long long> GetList(const char* key, const char* def) const;
+
+private:
+    std::map<std::string, std::string> values_;
+};
+
+/*
+ * @brief 延迟直方图：2的幂分段，每段16个子桶（相对误差约6%），纳秒为单位
+ * 按线程分片，Record是一次relaxed fetch_add；协程中调用时按当时所在的线程选分片。
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSub = 1 << kSubBits;
+    static constexpr int kBuckets = 64 * kSub;
+    static constexpr int kShards = 64;
+
+    void Record(uint64_t ns);
+
+    /// @brief q分位数（0 < q <= 1）所在桶的上界，没有样本时返回0
+    uint64_t Percentile(double q) const;
+
+    uint64_t Count() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> buckets_[kBuckets];
+    };
+
+    static int BucketIndex(uint64_t ns);
+
+    static uint64_t BucketUpper(int index);
+
+    std::vector<uint64_t> Merge() const;
+
+    Shard shards_[kShards] = {};
+};
+
+/// @brief 单调时钟的纳秒数，两种模式使用同一时钟
+inline int64_t NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief 当前和峰值驻留内存（KB，读/proc/self/status）
+struct RssInfo
+{
+    long current_ = 0;
+    long peak_ = 0;
+};
+
+RssInfo ReadRss();
+
+/// @brief 把RLIMIT_NOFILE提高到硬上限，返回提高后的软上限
+long RaiseFdLimit();
+
+/*
+ * @brief 按模式启动执行单元：协程模式下用attr创建协程，baseline模式下每次Go创建一个std::thread
+ * Go可以在执行单元中调用（如每接受一个连接启动一个处理者）。
+ */
+class Runner
+{
+public:
+    explicit Runner(bool baseline, TaskAttr const& attr = TaskAttr()) : baseline_(baseline), attr_(attr) {}
+
+    void Go(TaskF const& fn);
+
+    /// @brief 等待全部执行单元结束，包括执行期间新启动的
+    void Join();
+
+    bool Baseline() const { return baseline_; }
+
+private:
+    bool baseline_;
+    TaskAttr attr_;
+    std::mutex mtx_;
+    std::vector<std::thread> threads_;
+};
+
+/// @brief 一次运行的结果
+struct Result
+{
+    const char* workload_ = "";
+    bool baseline_ = false;
+    int threads_ = 0;
+    std::string params_;            ///< 场景自己的参数，如"conns=10000 msg=64"
+    uint64_t ops_ = 0;
+    uint64_t errors_ = 0;
+    double seconds_ = 0;
+    LatencyHistogram const* latency_ = nullptr;
+    RssInfo rss_;                   ///< 测量结束时的RSS，为0时在Report中读取
+};
+
+/// @brief 输出一行：吞吐、p50/p99/p999（微秒）和RSS
+void Report(Result const& r);
+
+/// 各场景入口，返回进程退出码
+int RunEcho(Options const& opt);
+int RunPipeline(Options const& opt);
+int RunMutexStorm(Options const& opt);
+
+} // macro
+} // cxk
+
+#endif //GOCOROUTINE_MACRO_BENCH_H
@@ -0,0 +1,100 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "macro_bench.h"
+#include <concurrence/channel.h>
+#include <concurrence/co_mutex.h>
+#include <scheduler/scheduler.h>
+#include <algorithm>
+#include <cstdio>
+
+/*
+ * co_mutex争用：所有执行单元反复争抢同一把锁，临界区内做cs次累加，锁外做think次空转。
+ * 延迟是从调用lock到获得锁的时间。协程模式下每个工作线程tasks个协程，baseline模式下每个线程一个执行单元，
+ * 两种模式用的是同一个co_mutex（线程中等待时经PThreadSwitcher在futex上休眠）。
+ */
+
+namespace cxk
+{
+namespace macro
+{
+
+namespace
+{
+
+/// 不会被优化掉的空转
+ALWAYS_INLINE void Spin(long n, uint64_t& acc)
+{
+    for (long i = 0; i < n; ++i)
+        acc = acc * 6364136223846793005ULL + 1442695040888963407ULL;
+}
+
+} // namespace
+
+int RunMutexStorm(Options const& opt)
+{
+    bool baseline = opt.Has("baseline");
+    int threads = (int)opt.GetInt("threads", 1);
+    int tasks = (int)std::max(1LL, opt.GetInt("tasks", 64));
+    double seconds = opt.GetDouble("seconds", 3);
+    long cs = (long)std::max(0LL, opt.GetInt("cs", 100));
+    long think = (long)std::max(0LL, opt.GetInt("think", 0));
+    int workers = baseline ? threads : threads * tasks;
+
+    if (!baseline) Scheduler::getInstance().Start(threads);
+
+    LatencyHistogram* latency = new LatencyHistogram;
+    co_mutex mtx;
+    uint64_t counter = 0;       ///< 由mtx保护
+    uint64_t shared = 0;        ///< 临界区内的累加结果，由mtx保护
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> ops{0}, sink{0};
+    Channel<int> gate;
+
+    Runner runner(baseline);
+    for (int i = 0; i < workers; ++i) {
+        runner.Go([&, i]{
+            int dummy;
+            gate.Pop(dummy);
+            uint64_t n = 0, acc = (uint64_t)i;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int64_t t0 = NowNs();
+                mtx.lock();
+                latency->Record((uint64_t)(NowNs() - t0));
+                ++counter;
+                Spin(cs, shared);
+                mtx.unlock();
+                ++n;
+                Spin(think, acc);
+                co_yield_if_preempted();    // 不争用时不会挂起，避免饿死同一线程上的其他协程
+            }
+            ops += n;
+            sink += acc;
+        });
+    }
+
+    int64_t start = NowNs();
+    gate.Close();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    int64_t end = NowNs();
+    RssInfo rss = ReadRss();
+    runner.Join();
+
+    Result r;
+    r.workload_ = "mutex";
+    r.baseline_ = baseline;
+    r.threads_ = threads;
+    r.params_ = "workers=" + std::to_string(workers) + " cs=" + std::to_string(cs) + " think=" + std::to_string(think);
+    r.ops_ = ops;
+    r.errors_ = counter == ops ? 0 : 1;    // 计数不一致说明互斥失效
+    r.seconds_ = (double)(end - start) / 1e9;
+    r.latency_ = latency;
+    r.rss_ = rss;
+    Report(r);
+    return 0;
+}
+
+} // macro
+} // cxk
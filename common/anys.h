@@ -5,6 +5,7 @@
 #ifndef ANYS_H
 #define ANYS_H
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -79,14 +80,15 @@ public:
         KeyInfo info;
         info.align = std::alignment_of<T>::value;       /// 类型对齐要求
         info.size = sizeof(T);                         /// 类型大小
-        info.offset = StorageLen();                    /// 内存偏移量，理论上的偏移
+        /// 内存偏移量：在当前总长度上按align向上取整（数据区起始地址按MaxAlign对齐）
+        info.offset = (StorageLen() + info.align - 1) & ~(std::size_t)(info.align - 1);
         info.constructor = constructor;                /// 自定义构造函数
         info.destructor = destructor;                  /// 自定义析构函数
         GetKeys().push_back(info);
 
         /// 更新全局存储总长度
-        /// 类型至少占用一个字节，确保加上填充可以使得向下区中为align的倍数
-        StorageLen() += (info.size + info.align - 1) & ~(info.align - 1);
+        StorageLen() = info.offset + info.size;
+        if ((std::size_t)info.align > MaxAlign()) MaxAlign() = info.align;
         Size()++;
         return GetKeys().size() - 1; /// 返回新注册类型的索引
     }
@@ -149,6 +151,13 @@ private:
         return obj;
     }
 
+    /// 获取已注册类型的最大对齐要求（数据区起始地址按它对齐）
+    static std::size_t & MaxAlign()
+    {
+        static std::size_t obj = alignof(std::max_align_t);
+        return obj;
+    }
+
     /// 获取全局类型数量（静态成员，记录注册的类型总数）
     static std::size_t & Size()
     {
@@ -176,6 +185,7 @@ private:
 
             char *p = storage_ + offsets_[i];
             keyInfo.constructor(p); /// 调用构造函数
+            inited_[i] = 1;
         }
     }
     /**
@@ -184,9 +194,11 @@ private:
      */
     void Deinit()
     {
-        if (!Size()) return;
-        for (std::size_t i = 0; i < Size(); i++)
+        if (!hold_) return;
+        for (std::size_t i = 0; i < *(std::size_t*)hold_; i++)
         {
+            if (!inited_[i]) continue; /// 跳过尚未构造的对象（延迟构造模式）
+            inited_[i] = 0;
             const auto& keyInfo = GetKeys()[i];
             if (!keyInfo.destructor) continue; /// 跳过无析构函数的类型
 
@@ -195,64 +207,120 @@ private:
         }
     }
 
-public:
-
-
-    Anys():hold_(nullptr),offsets_(nullptr),storage_(nullptr)
+    /**
+     * @brief 分配内存块并计算各类型的偏移，之后不允许再注册新类型
+     * 内存布局：[size_t(类型数量)] [offsets_数组] [inited_标记] [填充] [storage_数据区（按MaxAlign对齐）]
+     */
+    void Allocate()
     {
         GetInitGuard().try_lock(); /// 确保初始时互斥(数量可能会变)
-        if (!Size())
-        {
-            return; /// 如果没有注册类型，则不需要分配内存
-        }
-        const std::size_t header_size = sizeof(std::size_t) * (1+Size()); /// 计算头部大小类型数量头 + 偏移量数组
+        const std::size_t count = Size();
+        const std::size_t header_size = sizeof(std::size_t) * (1+count) + count; /// 类型数量头 + 偏移量数组 + 构造标记
+        const std::size_t total = header_size + MaxAlign() - 1 + StorageLen();
         try {
-            hold_ = new char[header_size + StorageLen()]; /// 分配连续内存
+            hold_ = new char[total]; /// 分配连续内存
         } catch (const std::bad_alloc&) {
             /// 再次尝试
-            hold_ = new char[header_size + StorageLen()];
+            hold_ = new char[total];
             if (!hold_) {
                 throw std::bad_alloc(); /// 如果分配失败，抛出异常
             }
         }catch (const std::exception& e) {
             throw std::runtime_error(std::string("Anys allocation failed: ") + e.what());
         }
-        storage_ = hold_ + header_size; /// 数据区起始位置，注意：并不强制要求连续存放，此处的指针只是一个相对位置，方便寻址
-        *(std::size_t*)hold_ = Size();   /// 存储类型数量,占据一个size_t的大小
+        *(std::size_t*)hold_ = count;   /// 存储类型数量,占据一个size_t的大小
         offsets_ = (std::size_t*)(hold_ + sizeof(std::size_t)); /// 偏移量数组起始位置
+        inited_ = (unsigned char*)(offsets_ + count);
+        /// 数据区起始位置按最大对齐要求向上取整，各类型的偏移在注册时已经对齐
+        uintptr_t base = (uintptr_t)(hold_ + header_size);
+        storage_ = (char*)((base + MaxAlign() - 1) & ~(uintptr_t)(MaxAlign() - 1));
         auto & keys = GetKeys();
-        /// 计算各类型的内存偏移（考虑内存对齐）
-        for (std::size_t i = 0; i < Size(); i++) {
-            const auto& keyInfo = GetKeys()[i];
-            std::size_t offset = keyInfo.offset;
-            const std::size_t align = keyInfo.align;
-            /// 执行内存对齐（模仿GCC的std::align实现）
-            /// alignedOffset = ((offset + align - 1) / align) * align;
-            std::size_t alignedOffset = (offset + align - 1) & ~(align - 1); /// 向上取整，清零余数(模运算)
-            /// 更新实际偏移量并记录到offsets_数组
-            offsets_[i] = alignedOffset;
+        for (std::size_t i = 0; i < count; i++) {
+            offsets_[i] = keys[i].offset;
+            inited_[i] = 0;
         }
+    }
+
+    /// 构造第index个对象（延迟构造模式下第一次访问时调用）
+    void Construct(std::size_t index)
+    {
+        const auto& keyInfo = GetKeys()[index];
+        if (keyInfo.constructor)
+            keyInfo.constructor(storage_ + offsets_[index]);
+        inited_[index] = 1;
+    }
+
+public:
+
+
+    /// 延迟构造标记，见Anys(lazy_t)
+    struct lazy_t {};
+
+    Anys():hold_(nullptr),offsets_(nullptr),inited_(nullptr),storage_(nullptr)
+    {
+        GetInitGuard().try_lock(); /// 确保初始时互斥(数量可能会变)
+        if (!Size())
+        {
+            return; /// 如果没有注册类型，则不需要分配内存
+        }
+        Allocate();
         Init(); /// 调用构造函数初始化所有对象
     }
+
+    /**
+     * @brief 延迟构造：创建时不分配内存、不调用任何构造函数，
+     * 第一次touch时才分配内存块，每个对象在第一次touch时才构造。
+     * 第一次分配之前仍然允许注册新类型。
+     */
+    explicit Anys(lazy_t):hold_(nullptr),offsets_(nullptr),inited_(nullptr),storage_(nullptr)
+    {
+    }
+
+    Anys(Anys const&) = delete;
+    Anys& operator=(Anys const&) = delete;
+
+    /**
+     * @brief 访问指定索引的对象，尚未构造时先构造（O(1)：一次分支加一次偏移寻址，不做类型校验）
+     * @tparam T 目标类型，必须与index注册时的类型一致
+     * @throw logic_error 索引越界
+     */
+    template <typename T>
+    ALWAYS_INLINE T& touch(std::size_t index)
+    {
+        if (__builtin_expect(!hold_, 0))
+            Allocate();
+        if (__builtin_expect(index >= *(std::size_t*)hold_, 0))
+            throw std::logic_error("Anys::touch overflow");
+        if (__builtin_expect(!inited_[index], 0))
+            Construct(index);
+        return *reinterpret_cast<T*>(storage_ + offsets_[index]);
+    }
+
+    /// @brief 销毁已构造的对象并释放内存块，之后仍可以touch（重新分配）
+    void Reset()
+    {
+        Deinit();
+        delete[] hold_;
+        hold_ = nullptr;
+        offsets_ = nullptr;
+        inited_ = nullptr;
+        storage_ = nullptr;
+    }
+
     /**
     * @brief 析构函数（销毁所有对象并释放内存）
     */
     ~Anys()
     {
-        Deinit(); /// 调用析构函数销毁所有对象
-        if (hold_) {
-            free(hold_);
-            hold_ = nullptr;
-            offsets_ = nullptr;
-            storage_ = nullptr;
-        }
+        Reset(); /// 调用析构函数销毁所有对象并释放内存
     }
 private:
     /// 内存布局：
     /// hold_ 指向一块连续内存，布局为：
-    /// [size_t(类型数量)] [offsets_数组] [storage_数据区]
+    /// [size_t(类型数量)] [offsets_数组] [inited_标记] [storage_数据区]
     char* hold_;           /// 内存块起始指针
     std::size_t* offsets_; /// 各类型数据的偏移量数组
+    unsigned char* inited_; /// 各对象是否已经构造
     char* storage_;        /// 数据存储区
 };
 
@@ -6,6 +6,7 @@
 #define CLOCK_H
 
 #pragma once
+#include <atomic>
 #include <ctime>
 #include <chrono>
 #include <thread>
@@ -15,6 +16,9 @@
 #include <utils/macro.h>
 
 #include "spinlock.h"
+#if defined(__x86_64__)
+# include <cpuid.h>
+#endif
 
 namespace cxk
 {
@@ -24,6 +28,12 @@ namespace cxk
  * 实现高精度时间测量，在x86_64 Unix系统上利用时间戳计数器（TSC）提升性能，
  * 并通过后台线程校准TSC与系统时钟的偏差，确保测量精度。
  * 非x86_64平台自动回退到标准库的std::chrono::steady_clock。
+ *
+ *  - CPUID报告invariant TSC（频率恒定、各核同步，不随节能状态停止）时才使用TSC，否则始终回退到标准时钟；
+ *  - 第一次调用now()时自动启动校准线程，校准完成之前使用标准时钟；
+ *  - 校准参数（检查点和定点乘数）由seqlock保护：校准线程写，读者无锁、检查序号一致后使用；
+ *  - 换算为一次64x64->128位整数乘法和移位：ns = ns0 + ((tsc - tsc0) * mult) >> 32；
+ *  - 新检查点不早于旧参数在同一时刻的外推值，时间不会因校准回退；超前的部分在下一个周期内通过减小mult追回。
  */
 
     /// 预处理阶段确定平台特性
@@ -46,89 +56,152 @@ public:
      */
     static steady_time_point now() noexcept {
         auto& data = self();
-        if (!data.fast_) { /// 未校准或校准失败时使用标准时钟
-            return base_clock_t::now(); /// 会由于cpu的频率发生变化以及切换导致 误差
+        if (__builtin_expect(!data.fast_.load(std::memory_order_acquire), 0)) {
+            /// 未校准或TSC不可用时使用标准时钟
+            StartCalibration();
+            return base_clock_t::now();
+        }
+
+        uint32_t seq;
+        uint64_t tsc0, mult;
+        int64_t ns0;
+        do {
+            seq = data.seq_.load(std::memory_order_acquire);
+            tsc0 = data.tsc0_.load(std::memory_order_relaxed);
+            ns0 = data.ns0_.load(std::memory_order_relaxed);
+            mult = data.mult_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (__builtin_expect((seq & 1) || seq != data.seq_.load(std::memory_order_relaxed), 0));
+
+        /// 其他核上的TSC可能略小于检查点（不同步的误差），按0计
+        int64_t dtsc = (int64_t)(rdtsc() - tsc0);
+        if (dtsc < 0) dtsc = 0;
+        return steady_time_point(duration(ns0 + Scale((uint64_t)dtsc, mult)));
+    }
+
+    /**
+     * @brief 当前工作线程在本次调度循环开始时缓存的时间（UpdateCoarse），没有缓存时等同于now()
+     * 只需要调度tick精度的场合使用（例如定时器入队），一次TLS读取
+     */
+    static steady_time_point coarse_now() noexcept {
+        steady_time_point tp = CoarseTls();
+        return tp.time_since_epoch().count() ? tp : now();
+    }
+
+    /// @brief 刷新当前线程的coarse_now()缓存，由Processor在每次调度循环开始时调用
+    static steady_time_point UpdateCoarse() noexcept {
+        return CoarseTls() = now();
+    }
+
+    /**
+     * @brief 原始计数（TSC周期数），用于只关心间隔的高频统计，比now()少一次换算
+     * @note 用TicksPerNanosecond()换算为纳秒；TSC不可用时为标准时钟的纳秒数
+     */
+    static uint64_t Ticks() noexcept {
+        if (__builtin_expect(!self().tsc_, 0))
+            return (uint64_t)base_clock_t::now().time_since_epoch().count();
+        return rdtsc();
+    }
+
+    /// @brief 每纳秒的计数，尚未校准时返回0
+    static double TicksPerNanosecond() noexcept {
+        auto& data = self();
+        if (!data.tsc_) return 1.0;
+        if (!data.fast_.load(std::memory_order_acquire)) return 0.0;
+        return (double)data.rate_.load(std::memory_order_relaxed) / 4294967296.0;
+    }
+
+    /// @brief 是否使用TSC（CPUID报告invariant TSC）
+    static bool IsTscReliable() noexcept {
+        return self().tsc_;
+    }
+
+    /// @brief 启动校准线程（重复调用直接返回），now()第一次调用时自动启动
+    static void StartCalibration() noexcept {
+        auto& data = self();
+        if (!data.tsc_ || data.started_.load(std::memory_order_relaxed)) return;
+        if (data.started_.exchange(true, std::memory_order_acq_rel)) return;
+        try {
+            std::thread(&FastSteadyClock::ThreadRun).detach();
+        } catch (...) {
+            data.started_.store(false, std::memory_order_relaxed); /// 下次再试，期间使用标准时钟
         }
-        /// 获取当前检查点（双缓冲机制）
-        auto& checkPoint = data.checkPoint_[data.switchIdx_];
-        uint64_t tsc_current = rdtsc();
-        uint64_t dtsc = tsc_current - checkPoint.tsc_; /// TSC差值
-        /// 计算时间差：校准时间点 + TSC差值 / 校准周期
-        long dur = checkPoint.tp_.time_since_epoch().count() +
-                   static_cast<long>(dtsc / data.cycle_);
-        return steady_time_point(duration(dur));
     }
 
     /**
      * @brief 后台校准线程函数（x86_64平台专用）
-     * @note 定期校准TSC与系统时钟的偏差，确保测量精度
+     * @note 定期校准TSC与系统时钟的偏差，确保测量精度；同时只有一个线程在校准
      */
     static void ThreadRun() {
         auto& data = self();
-        std::unique_lock<LFLock> lock(data.threadInit_, std::defer_lock);
+        if (!data.tsc_) return;
+        data.started_.store(true, std::memory_order_relaxed);
 
-        /// 初始化互斥锁，确保线程安全
+        std::unique_lock<LFLock> lock(data.threadInit_, std::defer_lock);
         if (!lock.try_lock()) {
-            return; /// 初始化失败（可能已存在其他线程）
+            return; /// 已有其他校准线程
         }
 
         /// 校准周期（20ms，可根据场景调整），校准的间隔越短越精准
         const auto calibration_interval = std::chrono::milliseconds(20);
 
+        int64_t lastNs;
+        uint64_t lastTsc;
+        Sample(lastNs, lastTsc);
+
         /// 无限循环校准
         while (true) {
             std::this_thread::sleep_for(calibration_interval);
 
-            /// 切换检查点索引（双缓冲机制：0 <-> 1）
-            int next_idx = !data.switchIdx_;
-            auto& current_checkpoint = data.checkPoint_[next_idx];
+            int64_t ns;
+            uint64_t tsc;
+            Sample(ns, tsc);
+            int64_t dur = ns - lastNs;
+            uint64_t dtsc = tsc - lastTsc;
+            if (dur <= 0 || (int64_t)dtsc <= 0)
+                continue;   /// 防止除零，保留上一次的参数
 
-            /// 记录标准时钟时间点和对应的TSC值
-            current_checkpoint.tp_ = base_clock_t::now();
-            current_checkpoint.tsc_ = rdtsc();
-
-            /// 获取上一次检查点
-            auto& last_checkpoint = data.checkPoint_[data.switchIdx_];
-
-            /// 跳过首次校准（无历史数据）
-            if (last_checkpoint.tsc_ == 0) {
-                data.switchIdx_ = next_idx;
-                continue;
+            /// 新检查点不早于旧参数的外推值（不回退）；超前err时下个周期只走dur - err，最多减半
+            int64_t base = ns;
+            if (data.fast_.load(std::memory_order_relaxed)) {
+                int64_t extrapolated = data.ns0_.load(std::memory_order_relaxed) +
+                        Scale(tsc - data.tsc0_.load(std::memory_order_relaxed), data.mult_.load(std::memory_order_relaxed));
+                if (extrapolated > base) base = extrapolated;
             }
+            int64_t err = base - ns;
+            int64_t target = dur > 2 * err ? dur - err : dur / 2;
+            uint64_t mult = (uint64_t)(((u128)target << 32) / dtsc);
+            uint64_t rate = (uint64_t)(((u128)dtsc << 32) / (uint64_t)dur);
 
-            /// 计算时间差（标准时钟）
-            auto dur = current_checkpoint.tp_ - last_checkpoint.tp_;
-            uint64_t dtsc = current_checkpoint.tsc_ - last_checkpoint.tsc_;
-
-            /// 防止除零和数值下溢
-            if (dur.count() == 0) {
-                data.switchIdx_ = next_idx;
-                continue;
-            }
+            /// seqlock写：序号为奇数期间读者重试
+            uint32_t seq = data.seq_.load(std::memory_order_relaxed);
+            data.seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            data.tsc0_.store(tsc, std::memory_order_relaxed);
+            data.ns0_.store(base, std::memory_order_relaxed);
+            data.mult_.store(mult, std::memory_order_relaxed);
+            data.rate_.store(rate, std::memory_order_relaxed);
+            data.seq_.store(seq + 2, std::memory_order_release);
+            data.fast_.store(true, std::memory_order_release); /// 标记校准完成
 
-            /// 计算TSC周期（单位：周期/秒）
-            float cycle = static_cast<float>(dtsc) / static_cast<float>(dur.count());
-            cycle = std::max(cycle, std::numeric_limits<float>::min()); /// 最小周期保护
-
-            /// 更新全局校准参数
-            data.cycle_ = cycle;
-            data.fast_ = true; /// 标记校准完成
-            data.switchIdx_ = next_idx; /// 切换索引
+            lastNs = ns;
+            lastTsc = tsc;
         }
     }
 
 private:
-    struct CheckPoint {
-        steady_time_point tp_;         ///< 标准时钟时间点（用于校准）
-        uint64_t tsc_ = 0;      ///< 对应时刻的TSC值（时间戳计数器）TSC是用于记录CPU时钟周期数
-    };
+    __extension__ typedef unsigned __int128 u128;  ///< 定点换算的128位中间结果，__extension__避免-Wpedantic警告
 
     struct Data {
-        LFLock threadInit_;     ///< 自旋锁（保护校准线程初始化）
-        bool fast_ = false;      ///< 校准状态（是否可用TSC快速计算）
-        float cycle_ = 1.0f;     ///< TSC周期（周期数/秒，用于换算时间）
-        CheckPoint checkPoint_[2]; ///< 双缓冲检查点（交替记录校准数据）
-        volatile int switchIdx_ = 0; ///< 检查点索引（volatile确保内存可见性）
+        LFLock threadInit_;                     ///< 自旋锁（保证只有一个校准线程）
+        const bool tsc_ = DetectInvariantTsc(); ///< CPU是否提供invariant TSC
+        std::atomic<bool> started_{false};      ///< 校准线程是否已启动
+        std::atomic<bool> fast_{false};         ///< 校准状态（是否可用TSC快速计算）
+        std::atomic<uint32_t> seq_{0};          ///< seqlock序号，奇数表示正在写
+        std::atomic<uint64_t> tsc0_{0};         ///< 检查点的TSC值
+        std::atomic<int64_t> ns0_{0};           ///< 检查点对应的时间（纳秒）
+        std::atomic<uint64_t> mult_{0};         ///< 每个TSC周期的纳秒数，32位定点小数
+        std::atomic<uint64_t> rate_{0};         ///< 每纳秒的TSC周期数，32位定点小数（仅用于TicksPerNanosecond）
     };
 
     /// 获取单例数据实例（线程安全的静态初始化）
@@ -137,6 +210,40 @@ private:
         return instance;
     }
 
+    static steady_time_point& CoarseTls() noexcept {
+        static thread_local steady_time_point tp;
+        return tp;
+    }
+
+    /// CPUID.80000007H:EDX[8]
+    static bool DetectInvariantTsc() noexcept {
+        unsigned eax, ebx, ecx, edx;
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) return false;
+        __cpuid(0x80000007, eax, ebx, ecx, edx);
+        return (edx >> 8) & 1;
+    }
+
+    static int64_t Scale(uint64_t dtsc, uint64_t mult) noexcept {
+        return (int64_t)(((u128)dtsc * mult) >> 32);
+    }
+
+    /// 读取一对（标准时钟, TSC），被抢占（两次TSC相差过大）时重试，TSC取两次读取的中点
+    static void Sample(int64_t& ns, uint64_t& tsc) {
+        uint64_t best = ~0ull;
+        ns = 0;
+        tsc = 0;
+        for (int i = 0; i < 5; ++i) {
+            uint64_t t1 = rdtsc();
+            int64_t n = base_clock_t::now().time_since_epoch().count();
+            uint64_t t2 = rdtsc();
+            if (t2 - t1 < best) {
+                best = t2 - t1;
+                ns = n;
+                tsc = t1 + (t2 - t1) / 2;
+            }
+        }
+    }
+
     /// 内联汇编获取TSC值（x86_64专用）
     static uint64_t rdtsc() {
         uint32_t high, low;
@@ -151,6 +258,29 @@ private:
 class FastSteadyClock : public std::chrono::steady_clock {
 public:
     static void ThreadRun() {} /// 空实现（非x86_64平台无需校准）
+    static void StartCalibration() noexcept {}
+    static bool IsTscReliable() noexcept { return false; }
+
+    static time_point coarse_now() noexcept {
+        time_point tp = CoarseTls();
+        return tp.time_since_epoch().count() ? tp : now();
+    }
+
+    static time_point UpdateCoarse() noexcept {
+        return CoarseTls() = now();
+    }
+
+    static uint64_t Ticks() noexcept {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now().time_since_epoch()).count();
+    }
+
+    static double TicksPerNanosecond() noexcept { return 1.0; }
+
+private:
+    static time_point& CoarseTls() noexcept {
+        static thread_local time_point tp;
+        return tp;
+    }
 };
 #endif
 
@@ -8,13 +8,188 @@
 #pragma once
 
 #include <deque>
+#include <utils/utils.h>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
 
 namespace cxk
 {
     template <typename T, typename Alloc = std::allocator<T>>
     using Deque = std::deque<T, Alloc>;
 
-    /// TODO: 实现多读一写线程安全的deque
+/**
+ * @brief 一写多读的无锁工作窃取双端队列（Chase-Lev）
+ * @tparam T 元素类型（要求可平凡拷贝，通常为指针）
+ *
+ * - 所有者线程在bottom端Push/Pop（LIFO），Pop在队列剩余元素多于一个时不需要任何RMW操作；
+ * - 其他线程在top端Steal（FIFO），通过一次CAS竞争top；
+ * - 环形缓冲区容量为2的幂，写满时由所有者扩容为两倍。旧缓冲区可能仍被窃取者读取，
+ *   因此延迟到析构时统一释放（总量不超过当前缓冲区大小）。
+ *
+ * 内存序参考: Lê, Pop, Cohen, Zappa Nardelli. "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP'13
+ */
+template <typename T>
+class WorkStealingDeque
+{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+    /// 环形缓冲区
+    struct Array
+    {
+        int64_t capacity_;
+        int64_t mask_;
+        std::atomic<T>* buffer_;
+
+        explicit Array(int64_t capacity)
+            : capacity_(capacity), mask_(capacity - 1), buffer_(new std::atomic<T>[capacity])
+        {}
+
+        ~Array() {
+            delete[] buffer_;
+        }
+
+        ALWAYS_INLINE void put(int64_t i, T x) {
+            buffer_[i & mask_].store(x, std::memory_order_relaxed);
+        }
+
+        ALWAYS_INLINE T get(int64_t i) {
+            return buffer_[i & mask_].load(std::memory_order_relaxed);
+        }
+
+        /// 拷贝[t, b)区间到两倍容量的新缓冲区
+        Array* grow(int64_t b, int64_t t) {
+            Array* a = new Array(capacity_ * 2);
+            for (int64_t i = t; i != b; ++i)
+                a->put(i, get(i));
+            return a;
+        }
+    };
+
+public:
+    /// @param capacity 初始容量，向上取整为2的幂
+    explicit WorkStealingDeque(int64_t capacity = 256)
+    {
+        int64_t c = 2;
+        while (c < capacity) c <<= 1;
+        array_.store(new Array(c), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque()
+    {
+        for (Array* a : garbage_)
+            delete a;
+        delete array_.load(std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(WorkStealingDeque const&) = delete;
+    WorkStealingDeque& operator=(WorkStealingDeque const&) = delete;
+
+    /// @brief 压入元素（仅所有者线程）
+    void Push(T x)
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if (b - t > a->capacity_ - 1) { // 已满，扩容
+            Array* bigger = a->grow(b, t);
+            garbage_.push_back(a);
+            array_.store(bigger, std::memory_order_release);
+            a = bigger;
+        }
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release); // 元素写入先于bottom对窃取者可见
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 从bottom端弹出元素（仅所有者线程）
+     * @return 队列为空或最后一个元素被窃取者抢走时返回false
+     */
+    bool Pop(T& out)
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // 先发布bottom再读取top，与Steal中的fence配对
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) { // 空队列，恢复bottom
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        out = a->get(b);
+        if (t == b) {
+            // 最后一个元素：与窃取者竞争top
+            bool won = top_.compare_exchange_strong(t, t + 1,
+                            std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true; // 快速路径：无RMW
+    }
+
+    /**
+     * @brief 从top端窃取元素（任意线程）
+     * @return 队列为空或与其他窃取者/所有者竞争失败时返回false
+     */
+    bool Steal(T& out)
+    {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return false;
+
+        Array* a = array_.load(std::memory_order_acquire);
+        T x = a->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+            return false; // 被其他线程抢先
+        out = x;
+        return true;
+    }
+
+    /**
+     * @brief 批量窃取最多n个元素（任意线程）
+     * Chase-Lev的top只能逐个推进：一次CAS跨越多个元素会与所有者无RMW的Pop快速路径冲突，
+     * 因此这里逐个Steal，竞争失败即停止。
+     * @return 实际窃取的数量
+     */
+    std::size_t StealBatch(T* out, std::size_t n)
+    {
+        std::size_t c = 0;
+        while (c < n && Steal(out[c]))
+            ++c;
+        return c;
+    }
+
+    /// @brief 元素数量（近似值）
+    std::size_t Size() const
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? (std::size_t)(b - t) : 0;
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    /// @brief 当前缓冲区容量
+    std::size_t Capacity() const
+    {
+        return (std::size_t)array_.load(std::memory_order_relaxed)->capacity_;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top_{0};       ///< 窃取端下标（窃取者CAS推进）
+    alignas(64) std::atomic<int64_t> bottom_{0};    ///< 所有者端下标（仅所有者写）
+    alignas(64) std::atomic<Array*> array_{nullptr};
+    std::vector<Array*> garbage_;                   ///< 扩容淘汰的旧缓冲区（仅所有者访问）
+};
 
 }
 
@@ -69,6 +69,12 @@ std::string co_error_category::message(int v) const
 
         case (int)eCoErrorCode::ec_disabled_multi_thread:
             return "Unsupport multiply threads. If you want use multiply threads, please cmake libgo without DISABLE_MULTI_THREAD option.";
+
+        case (int)eCoErrorCode::ec_reactor_init_failed:
+            return "io reactor init failed";
+
+        case (int)eCoErrorCode::ec_wait_group_negative:
+            return "co_wait_group negative counter";
     }
 
     return "";
@@ -25,6 +25,8 @@ namespace cxk
         ec_protect_stack_failed,
         ec_std_thread_link_error,
         ec_disabled_multi_thread,
+        ec_reactor_init_failed,
+        ec_wait_group_negative,
     };
 
     class co_error_category
@@ -9,6 +9,11 @@
 #include <atomic>
 #include <limits>
 #include <stdexcept>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <utils/macro.h>
 
 namespace cxk
 {
@@ -18,29 +23,163 @@ struct LockFreeResult {
     bool notify = false;
 };
 
-/// 无锁环形队列
-template<typename T, typename SizeType = std::size_t>
-class LockFreeRingQueue {
+/// 批量操作的结果
+struct LockFreeBatchResult {
+    std::size_t count = 0;   ///< 实际写入/读取的元素数量
+    bool notify = false;     ///< 同LockFreeResult::notify
+};
+
+/// 环形队列的并发策略，作为LockFreeRingQueue的第三个模板参数
+struct RingQueueMPMC {};    ///< 多生产者多消费者（默认）
+struct RingQueueMPSC {};    ///< 多生产者单消费者：消费端无CAS
+struct RingQueueSPSC {};    ///< 单生产者单消费者：只有load/store，无CAS
+
+/// 环形缓冲区与下标运算，各策略共用
+template<typename T, typename SizeType>
+class LockFreeRingQueueBase {
 public:
     typedef SizeType uint_t;
     typedef std::atomic<uint_t> atomic_t;
 
+    LockFreeRingQueueBase(LockFreeRingQueueBase const&) = delete;
+    LockFreeRingQueueBase& operator=(LockFreeRingQueueBase const&) = delete;
+
+    inline std::size_t capacity() const {
+        return capacity_-1; /// 环形队列多申请了一个空间, 便于判断full和empty.
+    }
+
+protected:
     /// 多申请一个typename T的空间, 便于判断full和empty.
-    explicit LockFreeRingQueue(uint_t capacity)
-            : capacity_(reCapacity(capacity)), readable_{0}, write_{0}, read_{0}, writable_{uint_t(capacity_ - 1)}
+    explicit LockFreeRingQueueBase(uint_t capacity)
+            : capacity_(reCapacity(capacity))
     {
         buffer_ = (T*) malloc(sizeof (T)*capacity_); /// malloc不会自动调用构造函数
     }
 
-    ~LockFreeRingQueue() {
-        /// destory elements.
-        uint_t read = consume(read_);
-        uint_t readable = consume(readable_);
-        for (; read < readable; ++read) {
+    ~LockFreeRingQueueBase() {
+        free(buffer_);
+    }
+
+    /// destory elements in [read, readable).
+    inline void destroy(uint_t read, uint_t readable) {
+        for (; read != readable; read = mod(read + 1)) {
             buffer_[read].~T();
         }
+    }
 
-        free(buffer_);
+    /// 从write开始写入n个元素（调用者已占有这段区间）
+    template<typename InputIt>
+    inline void construct(uint_t write, InputIt first, uint_t n) {
+        for (uint_t i = 0; i < n; ++i, ++first) {
+            new(buffer_ + mod(write + i)) T(*first);
+        }
+    }
+
+    /// 从read开始读出n个元素（调用者已占有这段区间）
+    template<typename OutputIt>
+    inline void take(uint_t read, OutputIt out, uint_t n) {
+        for (uint_t i = 0; i < n; ++i, ++out) {
+            uint_t pos = mod(read + i);
+            *out = std::move(buffer_[pos]);
+            buffer_[pos].~T();
+        }
+    }
+
+    inline uint_t relaxed(atomic_t &val)
+    {
+        return val.load(std::memory_order_relaxed);
+    }
+
+    inline uint_t acquire(atomic_t &val)
+    {
+        return val.load(std::memory_order_acquire);
+    }
+
+    inline uint_t consume(atomic_t &val) /// consume 内存序
+    {
+        return val.load(std::memory_order_consume);
+    }
+
+    /// 等待前面的占位者发布：先自旋，仍未轮到时让出CPU（占位者可能已被抢占，线程数超过核数时否则会空转整个时间片）
+    static inline void waitTurn(unsigned &spins)
+    {
+        if (++spins < 64)
+            CPU_RELAX();
+        else
+            std::this_thread::yield();
+    }
+
+    /// 优化后的位运算（仅适用于capacity_是2的幂）
+    inline uint_t mod(uint_t val) {
+        return val & (capacity_ - 1);
+    }
+
+    /// 区间[from, to)的元素个数
+    inline uint_t distance(uint_t from, uint_t to) {
+        return mod(to + capacity_ - from);
+    }
+
+    /// 将容量向上取整为2的幂（例如：7→8, 8→8, 9→16）
+    inline std::size_t reCapacity(uint_t capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Capacity must be positive");
+        }
+
+        /// 防止溢出
+        if (capacity >= (std::numeric_limits<uint_t>::max() / 2)) {
+            return std::numeric_limits<uint_t>::max() / 2;
+        }
+
+        /// 向上取整为2的幂
+        --capacity;
+        capacity |= capacity >> 1; /// 将最高位设置为1
+        capacity |= capacity >> 2; /// 将次高位设置为1
+        capacity |= capacity >> 4; /// 将更低位设置为1
+        capacity |= capacity >> 8;
+        capacity |= capacity >> 16;
+        return capacity + 1; /// 返回下一个2的幂
+    }
+
+    std::size_t capacity_;
+    T *buffer_;
+};
+
+/**
+ * @brief 无锁环形队列
+ * @tparam Policy 并发策略：RingQueueMPMC（默认）/ RingQueueMPSC / RingQueueSPSC，
+ *         在编译期选择对应的特化实现。使用比实际更宽松的策略（如两个线程同时Pop一个SPSC队列）是未定义行为。
+ *
+ * 所有特化的接口一致：
+ *  - Push/Pop: 单个元素，notify表示写入时队列为空/读取时队列已满；
+ *  - PushBatch/PopBatch: 用一次原子操作占有一段连续区间，返回实际处理的数量（可能少于请求的数量）。
+ * 各下标独占一个缓存行，避免生产者与消费者之间的伪共享。
+ */
+template<typename T, typename SizeType = std::size_t, typename Policy = RingQueueMPMC>
+class LockFreeRingQueue;
+
+/// 多生产者多消费者
+template<typename T, typename SizeType>
+class LockFreeRingQueue<T, SizeType, RingQueueMPMC> : public LockFreeRingQueueBase<T, SizeType> {
+    typedef LockFreeRingQueueBase<T, SizeType> base;
+    using base::capacity_;
+    using base::buffer_;
+    using base::relaxed;
+    using base::acquire;
+    using base::consume;
+    using base::mod;
+    using base::distance;
+
+public:
+    typedef typename base::uint_t uint_t;
+    typedef typename base::atomic_t atomic_t;
+
+    explicit LockFreeRingQueue(uint_t capacity)
+            : base(capacity), write_{0}, writable_{uint_t(capacity_ - 1)}, read_{0}, readable_{0}
+    {
+    }
+
+    ~LockFreeRingQueue() {
+        base::destroy(relaxed(read_), relaxed(readable_));
     }
 
     template<typename U>
@@ -62,12 +201,8 @@ public:
         /// 2.数据写入
         new(buffer_ + write) T(std::forward<U>(t));
 
-        /// 3.更新readable
-        uint_t readable;
-        do {
-            readable = relaxed(readable_);
-        } while (!readable_.compare_exchange_weak(write, mod(readable + 1),
-                                                  std::memory_order_acq_rel, std::memory_order_relaxed));
+        /// 3.更新readable，等待之前占位的生产者按顺序发布
+        publish(readable_, write, mod(write + 1));
 
         /// 4.检查写入时是否empty
         result.notify = (write == mod(writable + 1)); /// 如果写入时队列为空，则需要通知消费者，此时可读
@@ -94,75 +229,312 @@ public:
         t = std::move(buffer_[read]);
         buffer_[read].~T();
 
-
-        uint_t check = mod(read + capacity_ - 1);
-        while (!writable_.compare_exchange_weak(check, read,
-                                                std::memory_order_acq_rel, std::memory_order_relaxed));
+        /// 3.更新writable，等待之前占位的消费者按顺序释放
+        publish(writable_, mod(read + capacity_ - 1), read);
 
         /// 4.检查读取时是否full
-        result.notify = (read == mod(readable_ + 1));  /// 如果读取时队列已满，则需要通知生产者，此时可写
+        result.notify = (read == mod(readable + 1));  /// 如果读取时队列已满，则需要通知生产者，此时可写
         result.success = true;
         return result;
     }
-    inline std::size_t capacity() const {
-        return capacity_-1; /// 环形队列多申请了一个空间, 便于判断full和empty.
+
+    /// @brief 批量写入最多n个元素，一次CAS占有整段可写区间
+    template<typename InputIt>
+    LockFreeBatchResult PushBatch(InputIt first, std::size_t n)
+    {
+        LockFreeBatchResult result;
+        uint_t write, writable, count;
+        do {
+            write = relaxed(write_);
+            writable = consume(writable_);
+            count = (uint_t)std::min<std::size_t>(n, distance(write, writable));
+            if (count == 0)
+                return result;
+
+        } while (!write_.compare_exchange_weak(write, mod(write + count),
+                                               std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        base::construct(write, first, count);
+        publish(readable_, write, mod(write + count));
+
+        result.notify = (write == mod(writable + 1));
+        result.count = count;
+        return result;
     }
+
+    /// @brief 批量读取最多n个元素，一次CAS占有整段可读区间
+    template<typename OutputIt>
+    LockFreeBatchResult PopBatch(OutputIt out, std::size_t n)
+    {
+        LockFreeBatchResult result;
+        uint_t read, readable, count;
+        do {
+            read = relaxed(read_);
+            readable = consume(readable_);
+            count = (uint_t)std::min<std::size_t>(n, distance(read, readable));
+            if (count == 0)
+                return result;
+
+        } while (!read_.compare_exchange_weak(read, mod(read + count),
+                                              std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        base::take(read, out, count);
+        publish(writable_, mod(read + capacity_ - 1), mod(read + count - 1));
+
+        result.notify = (read == mod(readable + 1));
+        result.count = count;
+        return result;
+    }
+
 private:
-    inline uint_t relaxed(atomic_t &val)
+    /// 把val从from推进到to；val不等于from说明前面还有占位者未完成，等待它们
+    inline void publish(atomic_t &val, uint_t from, uint_t to)
     {
-        return val.load(std::memory_order_relaxed);
+        uint_t expected = from;
+        unsigned spins = 0;
+        while (!val.compare_exchange_weak(expected, to,
+                                          std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            expected = from;
+            base::waitTurn(spins);
+        }
     }
 
-    inline uint_t acquire(atomic_t &val)
+    /// [write_, writable_] 可写区间, write_ == writable_ is full.
+    /// read后更新writable
+    alignas(64) atomic_t write_;
+    alignas(64) atomic_t writable_;
+
+    /// [read_, readable_) 可读区间, read_ == readable_ is empty.
+    /// write后更新readable
+    alignas(64) atomic_t read_;
+    alignas(64) atomic_t readable_;
+};
+
+/// 多生产者单消费者：生产者之间与MPMC相同（CAS占位 + 按序发布），消费者直接读写read_
+template<typename T, typename SizeType>
+class LockFreeRingQueue<T, SizeType, RingQueueMPSC> : public LockFreeRingQueueBase<T, SizeType> {
+    typedef LockFreeRingQueueBase<T, SizeType> base;
+    using base::capacity_;
+    using base::buffer_;
+    using base::relaxed;
+    using base::acquire;
+    using base::mod;
+    using base::distance;
+
+public:
+    typedef typename base::uint_t uint_t;
+    typedef typename base::atomic_t atomic_t;
+
+    explicit LockFreeRingQueue(uint_t capacity)
+            : base(capacity), write_{0}, readable_{0}, read_{0}
     {
-        return val.load(std::memory_order_acquire);
     }
 
-    inline uint_t consume(atomic_t &val) /// consume 内存序
+    ~LockFreeRingQueue() {
+        base::destroy(relaxed(read_), relaxed(readable_));
+    }
+
+    template<typename U>
+    LockFreeResult Push(U &&t)
     {
-        return val.load(std::memory_order_consume);
+        LockFreeResult result;
+        uint_t write, read;
+        do {
+            write = relaxed(write_);
+            read = acquire(read_);
+            if (mod(write + 1) == read) /// 队列已满
+                return result;
+
+        } while (!write_.compare_exchange_weak(write, mod(write + 1),
+                                               std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        new(buffer_ + write) T(std::forward<U>(t));
+        publish(write, mod(write + 1));
+
+        result.notify = (write == read);
+        result.success = true;
+        return result;
     }
 
-    /// 优化后的位运算（仅适用于capacity_是2的幂）
-    inline uint_t mod(uint_t val) {
-        return val & (capacity_ - 1);
+    /// @brief 仅允许一个消费者线程调用
+    LockFreeResult Pop(T &t)
+    {
+        LockFreeResult result;
+        uint_t read = relaxed(read_);
+        uint_t readable = acquire(readable_);
+        if (read == readable)
+            return result;
+
+        t = std::move(buffer_[read]);
+        buffer_[read].~T();
+        read_.store(mod(read + 1), std::memory_order_release);
+
+        result.notify = (read == mod(readable + 1));
+        result.success = true;
+        return result;
     }
 
-    /// 将容量向上取整为2的幂（例如：7→8, 8→8, 9→16）
-    inline std::size_t reCapacity(uint_t capacity) {
-        if (capacity == 0) {
-            throw std::invalid_argument("Capacity must be positive");
-        }
+    template<typename InputIt>
+    LockFreeBatchResult PushBatch(InputIt first, std::size_t n)
+    {
+        LockFreeBatchResult result;
+        uint_t write, read, count;
+        do {
+            write = relaxed(write_);
+            read = acquire(read_);
+            count = (uint_t)std::min<std::size_t>(n, distance(write, mod(read + capacity_ - 1)));
+            if (count == 0)
+                return result;
 
-        /// 防止溢出
-        if (capacity >= (std::numeric_limits<uint_t>::max() / 2)) {
-            return std::numeric_limits<uint_t>::max() / 2;
-        }
+        } while (!write_.compare_exchange_weak(write, mod(write + count),
+                                               std::memory_order_acq_rel, std::memory_order_relaxed));
 
-        /// 向上取整为2的幂
-        --capacity;
-        capacity |= capacity >> 1; /// 将最高位设置为1
-        capacity |= capacity >> 2; /// 将次高位设置为1
-        capacity |= capacity >> 4; /// 将更低位设置为1
-        capacity |= capacity >> 8;
-        capacity |= capacity >> 16;
-        return capacity + 1; /// 返回下一个2的幂
+        base::construct(write, first, count);
+        publish(write, mod(write + count));
+
+        result.notify = (write == read);
+        result.count = count;
+        return result;
     }
 
+    /// @brief 仅允许一个消费者线程调用
+    template<typename OutputIt>
+    LockFreeBatchResult PopBatch(OutputIt out, std::size_t n)
+    {
+        LockFreeBatchResult result;
+        uint_t read = relaxed(read_);
+        uint_t readable = acquire(readable_);
+        uint_t count = (uint_t)std::min<std::size_t>(n, distance(read, readable));
+        if (count == 0)
+            return result;
+
+        base::take(read, out, count);
+        read_.store(mod(read + count), std::memory_order_release);
+
+        result.notify = (read == mod(readable + 1));
+        result.count = count;
+        return result;
+    }
 
 private:
-    std::size_t capacity_;
-    T *buffer_;
+    inline void publish(uint_t from, uint_t to)
+    {
+        uint_t expected = from;
+        unsigned spins = 0;
+        while (!readable_.compare_exchange_weak(expected, to,
+                                                std::memory_order_release, std::memory_order_relaxed)) {
+            expected = from;
+            base::waitTurn(spins);
+        }
+    }
 
-    /// [write_, writable_] 可写区间, write_ == writable_ is full.
-    /// read后更新writable
-    atomic_t write_;
-    atomic_t writable_;
+    /// 生产者占位下标
+    alignas(64) atomic_t write_;
+    /// [read_, readable_) 可读区间，生产者按序发布
+    alignas(64) atomic_t readable_;
+    /// 消费者下标（仅消费者写）
+    alignas(64) atomic_t read_;
+};
 
-    /// [read_, readable_) 可读区间, read_ == readable_ is empty.
-    /// write后更新readable
-    atomic_t read_;
-    atomic_t readable_;
+/// 单生产者单消费者：各自只写自己的下标，只读对方的下标
+template<typename T, typename SizeType>
+class LockFreeRingQueue<T, SizeType, RingQueueSPSC> : public LockFreeRingQueueBase<T, SizeType> {
+    typedef LockFreeRingQueueBase<T, SizeType> base;
+    using base::capacity_;
+    using base::buffer_;
+    using base::relaxed;
+    using base::acquire;
+    using base::mod;
+    using base::distance;
+
+public:
+    typedef typename base::uint_t uint_t;
+    typedef typename base::atomic_t atomic_t;
+
+    explicit LockFreeRingQueue(uint_t capacity)
+            : base(capacity), write_{0}, read_{0}
+    {
+    }
+
+    ~LockFreeRingQueue() {
+        base::destroy(relaxed(read_), relaxed(write_));
+    }
+
+    /// @brief 仅允许一个生产者线程调用
+    template<typename U>
+    LockFreeResult Push(U &&t)
+    {
+        LockFreeResult result;
+        uint_t write = relaxed(write_);
+        uint_t read = acquire(read_);
+        if (mod(write + 1) == read) /// 队列已满
+            return result;
+
+        new(buffer_ + write) T(std::forward<U>(t));
+        write_.store(mod(write + 1), std::memory_order_release);
+
+        result.notify = (write == read);
+        result.success = true;
+        return result;
+    }
+
+    /// @brief 仅允许一个消费者线程调用
+    LockFreeResult Pop(T &t)
+    {
+        LockFreeResult result;
+        uint_t read = relaxed(read_);
+        uint_t write = acquire(write_);
+        if (read == write)
+            return result;
+
+        t = std::move(buffer_[read]);
+        buffer_[read].~T();
+        read_.store(mod(read + 1), std::memory_order_release);
+
+        result.notify = (read == mod(write + 1));
+        result.success = true;
+        return result;
+    }
+
+    template<typename InputIt>
+    LockFreeBatchResult PushBatch(InputIt first, std::size_t n)
+    {
+        LockFreeBatchResult result;
+        uint_t write = relaxed(write_);
+        uint_t read = acquire(read_);
+        uint_t count = (uint_t)std::min<std::size_t>(n, distance(write, mod(read + capacity_ - 1)));
+        if (count == 0)
+            return result;
+
+        base::construct(write, first, count);
+        write_.store(mod(write + count), std::memory_order_release);
+
+        result.notify = (write == read);
+        result.count = count;
+        return result;
+    }
+
+    template<typename OutputIt>
+    LockFreeBatchResult PopBatch(OutputIt out, std::size_t n)
+    {
+        LockFreeBatchResult result;
+        uint_t read = relaxed(read_);
+        uint_t write = acquire(write_);
+        uint_t count = (uint_t)std::min<std::size_t>(n, distance(read, write));
+        if (count == 0)
+            return result;
+
+        base::take(read, out, count);
+        read_.store(mod(read + count), std::memory_order_release);
+
+        result.notify = (read == mod(write + 1));
+        result.count = count;
+        return result;
+    }
+
+private:
+    alignas(64) atomic_t write_;    ///< 生产者下标（仅生产者写）
+    alignas(64) atomic_t read_;     ///< 消费者下标（仅消费者写）
 };
 
 } /// namespace cxk
@@ -0,0 +1,155 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "numa.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+namespace cxk
+{
+
+namespace
+{
+
+bool ReadLine(std::string const& path, std::string& line)
+{
+    std::ifstream in(path);
+    return in && std::getline(in, line);
+}
+
+} // namespace
+
+NumaTopology& NumaTopology::getInstance()
+{
+    static NumaTopology obj;
+    return obj;
+}
+
+NumaTopology::NumaTopology()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) CPU_SET(cpu, &allowed);
+    }
+
+    std::string line;
+    if (ReadLine("/sys/devices/system/node/online", line)) {
+        for (int id : ParseCpuList(line)) {
+            std::string cpulist;
+            if (!ReadLine("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist", cpulist))
+                continue;
+            Node node{id, {}};
+            for (int cpu : ParseCpuList(cpulist))
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                    node.cpus_.push_back(cpu);
+            if (!node.cpus_.empty())
+                nodes_.push_back(std::move(node));
+        }
+    }
+
+    if (nodes_.empty()) {
+        Node node{0, {}};
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &allowed))
+                node.cpus_.push_back(cpu);
+        if (node.cpus_.empty()) node.cpus_.push_back(0);
+        nodes_.push_back(std::move(node));
+    }
+
+    for (std::size_t i = 0; i < nodes_.size(); ++i) {
+        for (int cpu : nodes_[i].cpus_) {
+            cpus_.push_back(cpu);
+            if ((std::size_t)cpu >= cpuNode_.size()) cpuNode_.resize(cpu + 1, -1);
+            cpuNode_[cpu] = (int)i;
+        }
+    }
+}
+
+int NumaTopology::NodeOfCpu(int cpu) const
+{
+    if (cpu < 0 || (std::size_t)cpu >= cpuNode_.size() || cpuNode_[cpu] < 0) return 0;
+    return cpuNode_[cpu];
+}
+
+std::vector<int> NumaTopology::ParseCpuList(std::string const& text)
+{
+    std::vector<int> cpus;
+    const char* p = text.c_str();
+    while (*p) {
+        char* end = nullptr;
+        long first = strtol(p, &end, 10);
+        if (end == p) { ++p; continue; }     // 跳过分隔符和换行
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1) last = first;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back((int)cpu);
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+bool& NumaTopology::Active()
+{
+    static bool obj = false;
+    return obj;
+}
+
+int& NumaTopology::Tls()
+{
+    static thread_local int obj = -1;
+    return obj;
+}
+
+int NumaTopology::CurrentNode()
+{
+    int node = Tls();
+    if (node >= 0) return node;
+    if (!Active()) return 0;
+    return getInstance().NodeOfCpu(sched_getcpu());
+}
+
+void NumaTopology::SetCurrentNode(int node)
+{
+    Tls() = node;
+}
+
+bool NumaTopology::BindMemory(void* addr, std::size_t len, std::size_t node) const
+{
+#if defined(SYS_mbind)
+    static constexpr std::size_t kMaskBits = 1024;
+    unsigned long mask[kMaskBits / (8 * sizeof(unsigned long))] = {};
+    std::size_t id = (std::size_t)NodeId(node);
+    if (id >= kMaskBits) return false;
+    mask[id / (8 * sizeof(unsigned long))] |= 1ul << (id % (8 * sizeof(unsigned long)));
+    // 内核把maxnode减一后作为位数
+    return syscall(SYS_mbind, addr, len, MPOL_PREFERRED, mask, kMaskBits + 1, 0) == 0;
+#else
+    (void)addr; (void)len; (void)node;
+    return false;
+#endif
+}
+
+bool NumaTopology::PinCurrentThread(std::vector<int> const& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+} // cxk
@@ -0,0 +1,86 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_NUMA_H
+#define GOCOROUTINE_NUMA_H
+
+#pragma once
+#include <utils/utils.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cxk
+{
+
+/*
+ * @brief CPU与NUMA节点拓扑，启动时从/sys/devices/system/node读取（不依赖libnuma/numactl）
+ * 只保留当前进程允许运行的CPU（sched_getaffinity），没有可用CPU的节点被忽略；
+ * 读取失败时（容器中没有挂载sysfs等）视为一个节点。
+ * 节点按编号排序后以下标0..NodeCount()-1表示，NodeId()是内核中的节点编号（可能不连续）。
+ */
+class NumaTopology
+{
+public:
+    static NumaTopology& getInstance();
+
+    ALWAYS_INLINE std::size_t NodeCount() const { return nodes_.size(); }
+
+    /// @brief 节点下标对应的内核节点编号
+    ALWAYS_INLINE int NodeId(std::size_t node) const { return nodes_[node].id_; }
+
+    /// @brief 节点上允许运行的CPU（升序）
+    ALWAYS_INLINE std::vector<int> const& NodeCpus(std::size_t node) const { return nodes_[node].cpus_; }
+
+    /// @brief 允许运行的全部CPU，按节点分组排列
+    ALWAYS_INLINE std::vector<int> const& Cpus() const { return cpus_; }
+
+    /// @brief CPU所在的节点下标，未知CPU返回0
+    int NodeOfCpu(int cpu) const;
+
+    /// @brief 解析内核的CPU列表格式，例如"0-3,8,10-11"
+    static std::vector<int> ParseCpuList(std::string const& text);
+
+    /**
+     * @brief 按节点分配内存：Scheduler::NumaAware()启动时打开
+     * 关闭时CurrentNode()总是返回0，栈池等只使用一组链表，行为与单节点相同
+     */
+    static bool& Active();
+
+    /**
+     * @brief 当前线程所在的节点下标
+     * 工作线程启动时由SetCurrentNode固定；其他线程在Active()时按当前运行的CPU查询，否则返回0
+     */
+    static int CurrentNode();
+
+    static void SetCurrentNode(int node);
+
+    /// @brief 把[addr, addr+len)的物理页优先分配在节点上（mbind MPOL_PREFERRED），addr需页对齐
+    bool BindMemory(void* addr, std::size_t len, std::size_t node) const;
+
+    /// @brief 把当前线程绑定到cpus上运行
+    static bool PinCurrentThread(std::vector<int> const& cpus);
+
+    NumaTopology(NumaTopology const&) = delete;
+    NumaTopology& operator=(NumaTopology const&) = delete;
+
+private:
+    struct Node
+    {
+        int id_;
+        std::vector<int> cpus_;
+    };
+
+    NumaTopology();
+
+    static int& Tls();
+
+    std::vector<Node> nodes_;
+    std::vector<int> cpus_;
+    std::vector<int> cpuNode_;      ///< CPU编号 -> 节点下标，-1表示不允许运行
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_NUMA_H
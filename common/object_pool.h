@@ -0,0 +1,255 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_OBJECT_POOL_H
+#define GOCOROUTINE_OBJECT_POOL_H
+
+#pragma once
+#include <utils/utils.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__SANITIZE_ADDRESS__)
+# define GOCOROUTINE_POOL_PASSTHROUGH 1
+#elif defined(__has_feature)
+# if __has_feature(address_sanitizer)
+#  define GOCOROUTINE_POOL_PASSTHROUGH 1
+# endif
+#endif
+
+namespace cxk
+{
+
+/*
+ * @brief 定长对象池（按类型），用于频繁创建/销毁的小对象（Task、挂起时的等待者节点、RefObjectImpl等）
+ *
+ * 内存按kSlabSize对齐的slab从系统申请，slab头部记录所属的线程缓存，slab不归还系统。
+ *  - 每个线程一个缓存：本地空闲链表（magazine）和一条无锁的归还链表；
+ *  - 分配只访问本线程的缓存：先取本地空闲链表，为空时一次exchange取走其他线程归还的全部对象，
+ *    都为空时从当前slab切出新对象，不加锁、不调用malloc；
+ *  - 在分配它的线程释放时放回本地空闲链表；在其他线程释放时压入所属缓存的归还链表
+ *    （多生产者、所属线程一次取走全部，没有ABA问题），对象回到分配它的线程，保持缓存热度。
+ * 线程退出后它的缓存（连同未取走的归还链表）由之后新建的线程接管；退出之后（其他thread_local对象的析构中）
+ * 本线程的分配改为持有全局锁使用一个共享缓存，释放按其他线程的方式压入所属缓存的归还链表。
+ * 每个slab至少容纳8个对象，对象大小（按对齐向上取整）不能超过约kSlabSize / 8（8KB），否则编译失败；
+ * 更大的对象应由使用者在池外分配（例如ParkLocal、co_offload中的大缓冲区改为持有指针）。
+ * AddressSanitizer构建中直接使用operator new/delete，保留越界和释放后使用检查。
+ */
+template <typename T>
+class ObjectPool
+{
+public:
+    static constexpr std::size_t kSlabSize = 64 * 1024;
+
+    /// @brief 分配并构造对象
+    template <typename... Args>
+    static T* New(Args&&... args)
+    {
+        void* p = Allocate();
+        try {
+            return new (p) T(std::forward<Args>(args)...);
+        } catch (...) {
+            Free(p);
+            throw;
+        }
+    }
+
+    /// @brief 析构并归还对象，可以在任意线程调用
+    static void Delete(T* obj)
+    {
+        obj->~T();
+        Free(obj);
+    }
+
+    /// @brief 分配一块未构造的内存
+    static void* Allocate()
+    {
+#if GOCOROUTINE_POOL_PASSTHROUGH
+        return ::operator new(kSlotSize);
+#else
+        Cache* cache = Tls();
+        if (__builtin_expect(!cache, 0)) {
+            cache = Attach();
+            if (!cache) return AllocateExited();
+        }
+        FreeBlock* block = cache->local_;
+        if (__builtin_expect(!block, 0)) {
+            block = cache->remote_.exchange(nullptr, std::memory_order_acquire);
+            if (!block)
+                return cache->Carve();
+        }
+        cache->local_ = block->next_;
+        return block;
+#endif
+    }
+
+    /// @brief 归还Allocate分配的内存
+    static void Free(void* p)
+    {
+#if GOCOROUTINE_POOL_PASSTHROUGH
+        ::operator delete(p);
+#else
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        Cache* owner = ((Slab*)((uintptr_t)p & ~(uintptr_t)(kSlabSize - 1)))->owner_;
+        if (owner == Tls()) {
+            block->next_ = owner->local_;
+            owner->local_ = block;
+            return;
+        }
+
+        FreeBlock* head = owner->remote_.load(std::memory_order_relaxed);
+        do {
+            block->next_ = head;
+        } while (!owner->remote_.compare_exchange_weak(head, block,
+                    std::memory_order_release, std::memory_order_relaxed));
+#endif
+    }
+
+    /// @brief 已向系统申请的slab数量（观测用）
+    static std::size_t SlabCount()
+    {
+        return Global().slabs_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next_;
+    };
+
+    static constexpr std::size_t kAlign = alignof(T) > alignof(FreeBlock) ? alignof(T) : alignof(FreeBlock);
+    static constexpr std::size_t kSlotSize =
+            ((sizeof(T) > sizeof(FreeBlock) ? sizeof(T) : sizeof(FreeBlock)) + kAlign - 1) & ~(kAlign - 1);
+
+    struct Cache;
+
+    /// slab头部，对象从头部之后按kSlotSize切分
+    struct Slab
+    {
+        Cache* owner_;
+    };
+
+    static constexpr std::size_t kSlabHeader = (sizeof(Slab) + kAlign - 1) & ~(kAlign - 1);
+    static_assert(kAlign <= alignof(std::max_align_t), "ObjectPool does not support over-aligned types");
+    /// 每个slab至少切出8个对象，sizeof(T)超过约kSlabSize / 8时编译失败（见类注释）
+    static_assert(kSlabHeader + kSlotSize * 8 <= kSlabSize, "ObjectPool type is too large for a slab");
+
+    struct Cache
+    {
+        FreeBlock* local_ = nullptr;            ///< 本地空闲链表，只由所属线程访问
+        atomic_t<FreeBlock*> remote_{nullptr};  ///< 其他线程归还的对象
+        char* bump_ = nullptr;                  ///< 当前slab中尚未切分的位置
+        char* end_ = nullptr;
+
+        /// 取一个对象：本地空闲链表、归还链表、切分slab依次尝试
+        void* Pop()
+        {
+            FreeBlock* block = local_;
+            if (!block) {
+                block = remote_.exchange(nullptr, std::memory_order_acquire);
+                if (!block)
+                    return Carve();
+            }
+            local_ = block->next_;
+            return block;
+        }
+
+        void* Carve()
+        {
+            if (bump_ + kSlotSize > end_) {
+                void* mem = nullptr;
+                if (posix_memalign(&mem, kSlabSize, kSlabSize) != 0)
+                    throw std::bad_alloc();
+                ((Slab*)mem)->owner_ = this;
+                bump_ = (char*)mem + kSlabHeader;
+                end_ = (char*)mem + kSlabSize;
+                Global().slabs_.fetch_add(1, std::memory_order_relaxed);
+            }
+            void* p = bump_;
+            bump_ += kSlotSize;
+            return p;
+        }
+    };
+
+    struct GlobalState
+    {
+        std::mutex mtx_;
+        std::vector<Cache*> orphans_;           ///< 所属线程已退出的缓存
+        Cache exited_;                          ///< 线程退出后的分配共用，持有mtx_访问
+        atomic_t<std::size_t> slabs_{0};
+    };
+
+    /// 不析构：线程退出和进程退出期间仍可能归还对象
+    static GlobalState& Global()
+    {
+        static GlobalState* obj = new GlobalState;
+        return *obj;
+    }
+
+    static Cache*& Tls()
+    {
+        static thread_local Cache* obj = nullptr;
+        return obj;
+    }
+
+    /// 本线程的ExitGuard已析构
+    static bool& Exited()
+    {
+        static thread_local bool obj = false;
+        return obj;
+    }
+
+    /// 线程退出之后的分配：不再接管新的缓存（否则没有ExitGuard交还，缓存泄漏）
+    static void* AllocateExited()
+    {
+        GlobalState& g = Global();
+        std::unique_lock<std::mutex> lock(g.mtx_);
+        return g.exited_.Pop();
+    }
+
+    /// 第一次使用时接管一个已退出线程的缓存，没有则新建；线程退出时交还。线程已退出时返回nullptr
+    static Cache* Attach()
+    {
+        if (Exited()) return nullptr;
+
+        struct ExitGuard
+        {
+            Cache* cache_ = nullptr;
+            ~ExitGuard()
+            {
+                Exited() = true;
+                if (!cache_) return;
+                // 之后本线程释放的对象按其他线程的方式归还
+                Tls() = nullptr;
+                GlobalState& g = Global();
+                std::unique_lock<std::mutex> lock(g.mtx_);
+                g.orphans_.push_back(cache_);
+            }
+        };
+        static thread_local ExitGuard guard;
+
+        Cache* cache = nullptr;
+        {
+            GlobalState& g = Global();
+            std::unique_lock<std::mutex> lock(g.mtx_);
+            if (!g.orphans_.empty()) {
+                cache = g.orphans_.back();
+                g.orphans_.pop_back();
+            }
+        }
+        if (!cache) cache = new Cache;
+        guard.cache_ = cache;
+        Tls() = cache;
+        return cache;
+    }
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_OBJECT_POOL_H
@@ -11,9 +11,16 @@
 #include <string>
 #include <atomic>
 #include <utils/types.h>
+#include <utils/macro.h>
+#include <common/object_pool.h>
+#include <cstddef>
 #include <cstring>
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
 
 namespace cxk
 {
@@ -126,8 +133,12 @@ struct Deleter
     }
 };
 
+class RefObject;
+struct BiasedRefCount;
+
 /**
  * @brief 此类的子类必须由智能指针管理
+ * 默认使用原子引用计数；继承BiasedRefObject则使用偏向引用计数（见BiasedRefCount）。
  */
 class RefObject
 {
@@ -157,36 +168,17 @@ public:
     }
 
     /** @brief 增加引用计数 */
-    void AddRef()
-    {
-        refCount_->fetch_add(1, std::memory_order_relaxed);
-    }
+    inline void AddRef();
 
     /**
-     * @brief 减少引用计数并检查是否需要释放对象（原子操作）
+     * @brief 减少引用计数并检查是否需要释放对象
+     * 一次fetch_sub同时完成减计数和是否释放的判断，减到0的线程负责释放
      * @return true：计数减为0并释放对象；false：计数未减为0
      */
-    virtual bool DecRef()
-    {
-        if (*(this->refCount_) == 0) {
-            return true;  /**< 如果引用计数为0，直接返回false */
-        }
-        if (--(*refCount_) == 0) {
-            if (deleter_.empty_) {
-                delete this;  /**< 如果没有自定义删除器，直接删除对象 */
-            } else {
-                deleter_(this);  /**< 调用删除器释放资源 */
-            }
-            return true;
-        }
-        return false;
-    }
+    virtual bool DecRef();
 
-    /** @brief 返回共享模式下的引用计数 */
-    long UseCount() const
-    {
-        return *refCount_;
-    }
+    /** @brief 返回引用计数（偏向模式下其他线程读取时为近似值） */
+    inline long UseCount() const;
 
     /** @brief 设置自定义删除器 */
     void SetDeleter(const Deleter& d) {
@@ -197,10 +189,261 @@ public:
     RefObject(RefObject const&) = delete;
     RefObject& operator=(RefObject const&) = delete;
 
+    /** @brief 计数归零：调用删除器或delete释放对象 */
+    void Destroy()
+    {
+        if (deleter_.empty_) {
+            delete this;  /**< 如果没有自定义删除器，直接删除对象 */
+        } else {
+            deleter_(this);  /**< 调用删除器释放资源 */
+        }
+    }
+
 public:
     atomic_t<long> *refCount_; /**< 引用计数指针(指向自身或者其他对象的引用计数) 共享模式则指向自身 */
     atomic_t<long> refCountValue_; /**< 非共享模式下的本地引用计数（默认初始化1） */
     Deleter deleter_; /**< 自定义删除器（用于资源释放） */
+    BiasedRefCount* biased_ = nullptr; /**< 偏向模式的计数（由BiasedRefObject设置），为空时使用refCount_ */
+};
+
+/**
+ * @brief 偏向引用计数的所有者线程上下文
+ * 其他线程把需要所有者合并计数的对象放入queue_，所有者线程在调度循环（Processor）或
+ * DrainCurrent()中处理。线程退出时处理剩余的对象并标记为已退出，此后由放入的线程自己合并。
+ * 尚未合并的对象保存所有者的指针，线程退出且这些对象都合并后才释放。
+ */
+struct BiasedRefOwner
+{
+    std::mutex mtx_;
+    std::vector<RefObject*> queue_;     ///< 待合并的对象，每个持有一个转交的引用
+    atomic_t<bool> pending_{false};     ///< queue_非空
+    bool alive_ = true;                 ///< 所有者线程是否还在运行，由mtx_保护
+    atomic_t<long> refs_{1};            ///< 未合并的对象数 + 所有者线程持有的一个
+
+    /// @brief 对象合并后或线程退出时调用，最后一个释放所有者上下文
+    void Release()
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    /// @brief 当前线程的所有者上下文，没有创建过偏向对象时返回nullptr
+    static BiasedRefOwner*& Tls()
+    {
+        static thread_local BiasedRefOwner* obj = nullptr;
+        return obj;
+    }
+
+    /// @brief 当前线程的所有者上下文，第一次调用时创建
+    static BiasedRefOwner* Current();
+
+    /// @brief 合并当前线程待处理的对象（所有者线程的安全点调用，没有待处理对象时只有一次load）
+    static void DrainCurrent()
+    {
+        BiasedRefOwner* owner = Tls();
+        if (owner && owner->pending_.load(std::memory_order_acquire))
+            owner->Drain();
+    }
+
+    /// @brief 其他线程放入待合并的对象；所有者已退出时由调用者直接合并
+    inline void Enqueue(RefObject* obj);
+
+    /// @brief 所有者线程处理待合并的对象
+    inline void Drain();
+};
+
+/**
+ * @brief 偏向引用计数（Biased Reference Counting）
+ * 大部分对象只在创建它的线程上增减引用：所有者线程操作biased_（一次load + store，没有lock前缀），
+ * 其他线程原子地操作shared_。真实计数为两者之和，释放的判断都是对shared_的一次RMW：
+ *  - 所有者的biased_减到0（或负数）时把biased_合并进shared_并置MERGED，此后所有线程都原子地操作shared_；
+ *  - 其他线程减计数可能使shared_的计数不大于0（引用在线程间转移），此时不减计数，
+ *    而是置QUEUED并把这次引用转交给所有者：所有者合并后再释放这一次引用。
+ * shared_的低两位为标志位，计数以4为单位。
+ */
+struct BiasedRefCount
+{
+    static constexpr int64_t kMerged = 1;
+    static constexpr int64_t kQueued = 2;
+    static constexpr int64_t kOne = 4;
+
+    BiasedRefOwner* owner_ = nullptr;   ///< 所有者线程（构造后不变）
+    atomic_t<long> biased_{0};          ///< 所有者线程的计数（合并前只由所有者写入）
+    atomic_t<int64_t> shared_{0};       ///< 其他线程的计数 << 2 | 标志位
+
+    /// MERGED只在所有者线程（或所有者退出后）置位，所有者自己读取不需要同步
+    ALWAYS_INLINE bool IsOwner() const
+    {
+        return owner_ == BiasedRefOwner::Tls() && !(shared_.load(std::memory_order_relaxed) & kMerged);
+    }
+
+    ALWAYS_INLINE void AddRef()
+    {
+        if (IsOwner())
+            biased_.store(biased_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        else
+            shared_.fetch_add(kOne, std::memory_order_relaxed);
+    }
+
+    /// @return true：计数归零，对象已释放
+    bool DecRef(RefObject* self)
+    {
+        if (IsOwner()) {
+            long biased = biased_.load(std::memory_order_relaxed) - 1;
+            biased_.store(biased, std::memory_order_relaxed);
+            if (biased > 0) return false;
+            return Merge(self);
+        }
+
+        int64_t old = shared_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (old & kMerged) {
+                if (shared_.fetch_sub(kOne, std::memory_order_acq_rel) >> 2 != 1) return false;
+                self->Destroy();
+                return true;
+            }
+            if (!(old & kQueued) && (old >> 2) <= 1) {
+                // 计数将不大于0：这次引用的计数可能在所有者的biased_中，转交给所有者合并后再释放
+                if (!shared_.compare_exchange_weak(old, old | kQueued,
+                            std::memory_order_acq_rel, std::memory_order_relaxed))
+                    continue;
+                owner_->Enqueue(self);
+                return false;
+            }
+            if (shared_.compare_exchange_weak(old, old - kOne,
+                        std::memory_order_acq_rel, std::memory_order_relaxed))
+                return false;
+        }
+    }
+
+    /// @brief 把biased_合并进shared_，只有第一次调用生效（所有者退出后可能有多个线程同时合并）
+    bool Merge(RefObject* self)
+    {
+        int64_t delta = (int64_t)biased_.load(std::memory_order_relaxed) * kOne + kMerged;
+        int64_t old = shared_.load(std::memory_order_relaxed);
+        do {
+            if (old & kMerged) return false;
+        } while (!shared_.compare_exchange_weak(old, old + delta,
+                    std::memory_order_acq_rel, std::memory_order_relaxed));
+        owner_->Release();      // 合并后不再访问owner_
+        if ((old + delta) >> 2 != 0) return false;
+        self->Destroy();
+        return true;
+    }
+
+    /// @brief 合并后释放转交给所有者的那一次引用（它仍计在shared_中，因此合并本身不会释放对象）
+    void MergeAndRelease(RefObject* self)
+    {
+        Merge(self);
+        if (shared_.fetch_sub(kOne, std::memory_order_acq_rel) >> 2 == 1)
+            self->Destroy();
+    }
+
+    long UseCount() const
+    {
+        int64_t shared = shared_.load(std::memory_order_relaxed);
+        if (shared & kMerged) return (long)(shared >> 2);
+        return biased_.load(std::memory_order_relaxed) + (long)(shared >> 2);
+    }
+};
+
+inline BiasedRefOwner* BiasedRefOwner::Current()
+{
+    BiasedRefOwner*& owner = Tls();
+    if (owner) return owner;
+
+    // 线程退出时处理剩余的对象，之后转交给它的对象由转交者自己合并
+    struct ExitGuard
+    {
+        BiasedRefOwner* owner_;
+        ~ExitGuard()
+        {
+            owner_->Drain();
+            // 之后本线程按非所有者操作计数，biased_不再变化，可以由其他线程合并
+            Tls() = nullptr;
+            std::unique_lock<std::mutex> lock(owner_->mtx_);
+            owner_->alive_ = false;
+            std::vector<RefObject*> rest;
+            rest.swap(owner_->queue_);
+            lock.unlock();
+            for (RefObject* obj : rest)
+                obj->biased_->MergeAndRelease(obj);
+            owner_->Release();
+        }
+    };
+    owner = new BiasedRefOwner;
+    static thread_local ExitGuard guard{owner};
+    return owner;
+}
+
+inline void BiasedRefOwner::Enqueue(RefObject* obj)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!alive_) {
+        // 所有者已退出，biased_不会再变化（由mtx_建立先后关系）
+        lock.unlock();
+        obj->biased_->MergeAndRelease(obj);
+        return;
+    }
+    queue_.push_back(obj);
+    pending_.store(true, std::memory_order_release);
+}
+
+inline void BiasedRefOwner::Drain()
+{
+    std::vector<RefObject*> objs;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        objs.swap(queue_);
+        pending_.store(false, std::memory_order_relaxed);
+    }
+    for (RefObject* obj : objs)
+        obj->biased_->MergeAndRelease(obj);
+}
+
+inline void RefObject::AddRef()
+{
+    if (__builtin_expect(biased_ != nullptr, 0)) {
+        biased_->AddRef();
+        return;
+    }
+    refCount_->fetch_add(1, std::memory_order_relaxed);
+}
+
+inline bool RefObject::DecRef()
+{
+    if (__builtin_expect(biased_ != nullptr, 0))
+        return biased_->DecRef(this);
+
+    if (refCount_->fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return false;
+    Destroy();
+    return true;
+}
+
+inline long RefObject::UseCount() const
+{
+    if (biased_) return biased_->UseCount();
+    return *refCount_;
+}
+
+/**
+ * @brief 使用偏向引用计数的对象基类
+ * 适合主要在创建线程上增减引用的对象（例如只在一个Processor上处理的请求对象）：
+ * 创建线程上的拷贝/释放没有原子RMW。不支持WeakPtr（弱引用需要原子的强引用计数）。
+ */
+class BiasedRefObject : public RefObject
+{
+public:
+    BiasedRefObject()
+    {
+        state_.owner_ = BiasedRefOwner::Current();
+        state_.owner_->refs_.fetch_add(1, std::memory_order_relaxed);
+        biased_ = &state_;
+    }
+
+private:
+    BiasedRefCount state_;
 };
 
 /**
@@ -208,6 +451,7 @@ public:
  * 分离强引用和弱引用计数，用于SharedRefObject和WeakPtr
  * 此处使用组合而非继承，避免侵入式设计，无实际作用，仅用于区分
  * 强引用计数通过RefObject的refCount_指针管理，弱引用计数通过RefObjectImpl的weak_成员管理
+ * 对象存活期间强引用整体持有一个弱引用，因此weak_减到0时对象一定已经销毁，由减到0的一方释放本对象。
  */
 class RefObjectImpl
 {
@@ -216,15 +460,16 @@ public:
     friend class SharedRefWrapper; /**< 允许SharedRefObject访问私有成员 */
 
     /**
-     * @brief 构造函数：初始化强/弱计数均为1（初始时被一个SharedRefObject持有）
+     * @brief 构造函数：强引用计数为0，弱引用计数为1（强引用整体持有的一个）
+     * @param block 与对象一起分配的内存块（见MakeSharedRef），为空表示单独分配
      */
-    explicit RefObjectImpl() noexcept : reference_(0), weak_(0)
+    explicit RefObjectImpl(void* block = nullptr) noexcept : reference_(0), weak_(1), block_(block)
     {}
 
     /** @brief 增加弱引用计数 */
     void AddWeakRef()
     {
-        ++weak_;
+        weak_.fetch_add(1, std::memory_order_relaxed);
     }
 
     /** @brief 返回强引用计数 */
@@ -234,19 +479,21 @@ public:
     }
 
     /**
-     * @brief 减少弱引用计数
+     * @brief 减少弱引用计数，减到0时释放本对象（与对象一起分配时释放整个内存块）
      * @return true：计数减为0；false：计数未减为0
      */
     bool DecWeakRef()
     {
-        if (weak_ == 0) {
-            return true; /**< 如果弱引用计数已经为0，直接返回false */
-        }
-        if (--weak_ == 0) { // fetch_s
-            delete this; /**< 弱引用计数减为0时删除对象 */
-            return true; /**< 弱引用计数减为0 */
+        if (weak_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return false; /**< 弱引用计数未减为0 */
+        if (block_) {
+            void* block = block_;
+            this->~RefObjectImpl();
+            ::operator delete(block);
+        } else {
+            ObjectPool<RefObjectImpl>::Delete(this); /**< 弱引用计数减为0时归还对象池 */
         }
-        return false; /**< 弱引用计数未减为0 */
+        return true;
     }
 
     /**
@@ -273,27 +520,37 @@ public:
         return reference_ > 0;
     }
 
-    /** @brief 返回弱引用计数（对象有效时返回实际值，否则返回0） */
+    /** @brief 返回弱引用计数（对象有效时返回WeakPtr的数量，否则返回0） */
     long GetWeakCount() const {
         if (IsValid()) {
-            return weak_; /**< 如果对象有效，返回弱引用计数 */
+            return weak_ - 1; /**< 不包括强引用整体持有的一个 */
         }
         return 0; /**< 如果对象无效，返回0 */
     }
 
+    /// @brief MakeSharedRef构造对象期间传递内存块中的RefObjectImpl（仅构造线程使用）
+    static RefObjectImpl*& Pending()
+    {
+        static thread_local RefObjectImpl* obj = nullptr;
+        return obj;
+    }
+
 private:
     atomic_t<long> reference_; /**< 强引用计数（关联IncursivePtr） */
     atomic_t<long> weak_; /**< 弱引用计数（关联WeakPtr） */
+    void* block_; /**< 与对象一起分配的内存块，为空表示RefObjectImpl单独分配 */
 };
 
 /**
  * @brief 共享模式对象包装类，并不是智能指针，而是一个共享对象的引用计数管理类
  * 继承RefObject，使用RefObjectImpl管理引用计数，支持弱引用
+ * 直接new时RefObjectImpl单独分配；用MakeSharedRef创建时与对象在同一块内存中，省一次堆分配。
  */
 class SharedRefWrapper : public RefObject
 {
 private:
     RefObjectImpl *impl_; /**< 引用计数实现对象指针 */
+    bool inlineImpl_ = false; /**< impl_与对象在同一块内存中 */
 
 public:
     /**
@@ -306,27 +563,17 @@ public:
     }
 
     /**
-     * @brief 构造函数：创建新的RefObjectImpl实例，进入共享模式
-     */
-    explicit SharedRefWrapper() : impl_(new RefObjectImpl)
-    {
-        this->refCount_ = &impl_->reference_; /**< 指向外部强引用计数 */
-    }
-
-    /**
-     * @brief 重写减少引用计数逻辑（处理弱引用计数释放）
-     * @return true：强引用减为0并释放弱引用块；false：强引用未减为0
+     * @brief 构造函数：创建新的RefObjectImpl实例（MakeSharedRef中使用同一块内存中的实例），进入共享模式
      */
-    bool DecRef() override
+    explicit SharedRefWrapper() : impl_(RefObjectImpl::Pending())
     {
-        if (!impl_) return false; /**< 如果实现对象为空，直接返回false */
-        if (this->refCount_ == nullptr) {
-            return false; /**< 如果引用计数为0，直接返回false */
-        }
-        if (RefObject::DecRef()) { /**< 先减少强引用计数，此处强引用绑定到了 impl_->reference_，源对象被消除 */
-            return true;
+        if (impl_) {
+            RefObjectImpl::Pending() = nullptr;
+            inlineImpl_ = true;
+        } else {
+            impl_ = ObjectPool<RefObjectImpl>::New();
         }
-        return false;
+        this->refCount_ = &impl_->reference_; /**< 指向外部强引用计数 */
     }
 
     /** @brief 返回引用计数实现对象指针 */
@@ -335,20 +582,66 @@ public:
         return impl_;
     }
 
-    /** @brief 析构函数：释放资源 */
+    /**
+     * @brief 析构函数：释放强引用整体持有的弱引用
+     * 与对象一起分配时内存块由MakeSharedRef的删除器在析构完成后释放
+     */
     ~SharedRefWrapper() override
     {
-        if (impl_) {
-            if (impl_->reference_ == 0) {
-                if (impl_->weak_ == 0) { // 没有弱引用计数
-                    delete impl_; /**< 如果强引用计数和弱引用计数都为0，删除实现对象 */
-                }
-            }
-            impl_ = nullptr; /**< 清空指针 */
+        if (impl_ && !inlineImpl_) {
+            impl_->DecWeakRef();
         }
+        impl_ = nullptr; /**< 清空指针 */
     }
 };
 
+/**
+ * @brief 创建共享对象，对象与RefObjectImpl在同一块内存中（类似make_shared，只有一次堆分配）
+ * 强引用归零时只析构对象，内存块在最后一个WeakPtr释放后才释放。
+ * @tparam T 对象类型（必须继承自SharedRefWrapper，并使用其默认构造函数）
+ */
+template <typename T, typename... Args>
+T* MakeSharedRef(Args&&... args)
+{
+    static_assert(std::is_base_of<SharedRefWrapper, T>::value, "MakeSharedRef requires a SharedRefWrapper");
+    constexpr std::size_t align = alignof(T) > alignof(RefObjectImpl) ? alignof(T) : alignof(RefObjectImpl);
+    static_assert(align <= alignof(std::max_align_t), "MakeSharedRef does not support over-aligned types");
+    constexpr std::size_t offset = (sizeof(RefObjectImpl) + align - 1) & ~(align - 1);
+
+    void* block = ::operator new(offset + sizeof(T));
+    RefObjectImpl* impl = new (block) RefObjectImpl(block);
+    RefObjectImpl::Pending() = impl;
+    T* obj;
+    try {
+        obj = new ((char*)block + offset) T(std::forward<Args>(args)...);
+    } catch (...) {
+        RefObjectImpl::Pending() = nullptr;
+        ::operator delete(block);
+        throw;
+    }
+    obj->SetDeleter(Deleter([](RefObject* p, void* arg) {
+        p->~RefObject();
+        static_cast<RefObjectImpl*>(arg)->DecWeakRef();
+    }, impl));
+    return obj;
+}
+
+/**
+ * @brief 从对象池（ObjectPool<T>）创建引用计数对象，计数归零时通过删除器归还对象池而不是delete
+ * 适合频繁创建/销毁的定长对象；对象可以在任意线程释放。
+ * @tparam T 对象类型（必须继承自RefObject，且不能再设置其他删除器）
+ */
+template <typename T, typename... Args>
+T* MakePooledRef(Args&&... args)
+{
+    static_assert(std::is_base_of<RefObject, T>::value, "MakePooledRef requires a RefObject");
+    T* obj = ObjectPool<T>::New(std::forward<Args>(args)...);
+    obj->SetDeleter(Deleter([](RefObject* p, void*) {
+        ObjectPool<T>::Delete(static_cast<T*>(p));
+    }, nullptr));
+    return obj;
+}
+
 /**
  * @brief 侵入式共享智能指针（RAII实现）
  * 管理继承自RefObject的对象，自动维护引用计数
@@ -386,7 +679,9 @@ public:
      */
     IncursivePtr(IncursivePtr const &other) : ptr_(other.ptr_)
     {
-        ptr_->AddRef(); /**< 增加引用计数 */
+        if (ptr_) {
+            ptr_->AddRef(); /**< 增加引用计数 */
+        }
     }
 
     /**
@@ -461,8 +756,7 @@ public:
     [[nodiscard]] long UseCount() const
     {
         if (!ptr_) return 0;
-        if (!ptr_->refCount_) return 0;
-        return ptr_->refCount_->load();
+        return ptr_->UseCount();
     }
 
     /** @brief 判断是否唯一持有对象 */
@@ -648,8 +942,13 @@ public:
             return;
         }
 
+        SharedRefWrapper* wrapper = dynamic_cast<SharedRefWrapper*>(ptr);
+        if (!wrapper) {
+            return;
+        }
+
         ptr_ = ptr; /**< 更新指针 */
-        impl_ = reinterpret_cast<SharedRefWrapper*>(ptr_)->getImpl();
+        impl_ = wrapper->getImpl();
         impl_->AddWeakRef(); /**< 增加弱引用计数 */
     }
 
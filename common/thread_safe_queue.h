@@ -146,6 +146,22 @@ public:
         other.stealed(); // 清空源链表
     }
 
+    /*@brief 在链表尾部追加一个元素（增加引用计数，与erase的减少对应）
+     * @param element 待追加的元素，不能在其他链表或队列中
+     */
+    void push_back(T* element)
+    {
+        TSQueueHook* hook = static_cast<TSQueueHook*>(element);
+        assert(hook->next == nullptr);
+        assert(hook->prev == nullptr);
+
+        if (empty()) head_ = element;
+        else tail_->link(hook);
+        tail_ = element;
+        ++count_;
+        AddRef(element);
+    }
+
     /*@brief 从链表头部切割出前n个元素
      * @param n 切割数量
      * @return 包含前n个元素的新链表
@@ -626,6 +642,109 @@ public:
     }
 };
 
+/*@brief 侵入式无锁多生产者单消费者队列（Vyukov），复用TSQueueHook::next作为链接指针
+ * - push（任意线程）是wait-free的：一次exchange加一次store，不加锁、不分配内存；与TSQueue一样增加引用计数；
+ * - pop_all只能由唯一的消费者调用，一次取出当前可见的全部元素，引用转移给返回的链表；
+ * - 生产者exchange之后、写入前驱的next之前被打断时，pop_all只能取到它之前的元素，
+ *   其余的留到下一次（此时emptyUnsafe返回false）。
+ * @tparam T 队列元素类型，必须继承自TSQueueHook
+ */
+template <typename T>
+class MPSCQueue
+{
+    static_assert((std::is_base_of<TSQueueHook, T>::value), "T must inherit TSQueueHook");
+
+public:
+    MPSCQueue() : head_(&stub_), tail_(&stub_) {}
+
+    /*@brief 析构时与TSQueue一致，不释放剩余元素的引用 */
+    ~MPSCQueue()
+    {
+        SList<T> rest = pop_all();
+        rest.stealed();
+    }
+
+    MPSCQueue(MPSCQueue const&) = delete;
+    MPSCQueue& operator=(MPSCQueue const&) = delete;
+
+    /*@brief 单元素入队（任意线程）
+     * @param element 待入队的元素，不能在其他链表或队列中
+     */
+    ALWAYS_INLINE void push(T* element)
+    {
+        TSQueueHook* hook = static_cast<TSQueueHook*>(element);
+        assert(hook->next == nullptr);
+        assert(hook->prev == nullptr);
+        AddRef(element);
+        pushHook(hook);
+    }
+
+    /*@brief 判断队列是否为空（任意线程，近似值）
+     * 生产者的exchange之后即为非空，配合seq_cst fence可以用于休眠前的检查
+     */
+    ALWAYS_INLINE bool emptyUnsafe() const
+    {
+        return head_.load(std::memory_order_relaxed) == &stub_;
+    }
+
+    /*@brief 弹出当前可见的全部元素（仅消费者）
+     * @return 按入队顺序排列的链表
+     */
+    SList<T> pop_all()
+    {
+        TSQueueHook* first = nullptr;
+        TSQueueHook* last = nullptr;
+        std::size_t c = 0;
+        while (TSQueueHook* hook = popHook()) {
+            hook->next = nullptr;   // 取出后不会再有生产者写它的next
+            if (last) last->link(hook);
+            else first = hook;
+            last = hook;
+            ++c;
+        }
+        return SList<T>(first, last, c);
+    }
+
+private:
+    ALWAYS_INLINE void pushHook(TSQueueHook* hook)
+    {
+        __atomic_store_n(&hook->next, (TSQueueHook*)nullptr, __ATOMIC_RELAXED);
+        TSQueueHook* prev = head_.exchange(hook, std::memory_order_acq_rel);
+        __atomic_store_n(&prev->next, hook, __ATOMIC_RELEASE);
+    }
+
+    /*@brief 取出一个元素，队列为空或下一个元素尚未链接完成时返回nullptr */
+    TSQueueHook* popHook()
+    {
+        TSQueueHook* tail = tail_;
+        TSQueueHook* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+        if (tail == &stub_) {
+            if (!next) return nullptr;
+            tail_ = next;
+            tail = next;
+            next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+        }
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+
+        // tail是最后一个已链接的元素：有生产者正在链接时等下一次，否则把stub_放回队尾后取出tail
+        if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+        pushHook(&stub_);
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+        if (next) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    alignas(64) std::atomic<TSQueueHook*> head_;    ///< 最近入队的元素（生产者写入）
+    alignas(64) TSQueueHook* tail_;                 ///< 下一个出队的位置（仅消费者访问）
+    TSQueueHook stub_;                              ///< 哨兵节点，队列为空时head_和tail_都指向它
+};
+
 } ///namespace cxk
 
 #endif ///GOCOROUTINE_THREAD_SAFE_QUEUE_H
@@ -6,7 +6,19 @@
 #define GOCOROUTINE_CHANNEL_H
 
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include <initializer_list>
+#include <type_traits>
 #include "debug.h"
+#include "linked_list.h"
+#include "rutex.h"
+#include "park_local.h"
+#include "timer.h"
 
 namespace cxk
 {
@@ -16,20 +28,664 @@ namespace cxk
  * 提供阻塞和非阻塞的发送和接收操作。
  */
 
+/*
+ * @brief Channel默认使用的环形缓冲区（非线程安全，由ChannelImpl加锁保护）
+ * 创建通道时一次性分配容量，之后push/pop不再分配内存。
+ */
+template <typename T>
+class ChannelRingQueue
+{
+public:
+    ChannelRingQueue() = default;
+
+    ~ChannelRingQueue()
+    {
+        while (size_) pop_front();
+        std::allocator<T>().deallocate(buf_, capacity_);
+    }
+
+    ChannelRingQueue(ChannelRingQueue const&) = delete;
+    ChannelRingQueue& operator=(ChannelRingQueue const&) = delete;
+
+    /// @brief 分配容量，只允许在空队列上调用
+    void reserve(std::size_t capacity)
+    {
+        if (capacity <= capacity_) return ;
+        std::allocator<T>().deallocate(buf_, capacity_);
+        buf_ = std::allocator<T>().allocate(capacity);
+        capacity_ = capacity;
+        head_ = 0;
+    }
+
+    template <typename U>
+    void push_back(U && u)
+    {
+        std::size_t pos = head_ + size_;
+        if (pos >= capacity_) pos -= capacity_;
+        new (buf_ + pos) T(std::forward<U>(u));
+        ++size_;
+    }
+
+    T& front() { return buf_[head_]; }
+
+    void pop_front()
+    {
+        buf_[head_].~T();
+        if (++head_ == capacity_) head_ = 0;
+        --size_;
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    T* buf_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+};
+
+/// 队列提供reserve时预分配容量（如ChannelRingQueue），否则按需增长（如std::deque）
+template <typename QueueT>
+inline auto channelQueueReserve(QueueT & q, std::size_t capacity, int) -> decltype(q.reserve(capacity), void())
+{
+    q.reserve(capacity);
+}
+
+template <typename QueueT>
+inline void channelQueueReserve(QueueT &, std::size_t, long) {}
+
+class ChannelImplBase;
+
+/// @brief select的一个分支，由Channel::CasePush/CasePop构造
+struct ChannelSelectCase
+{
+    ChannelImplBase* ch_;
+    void* slot_;    ///< push: 待发送的值(const T*)，pop: 接收值的位置(T*)
+    bool push_;
+};
+
+/*
+ * @brief Channel中与元素类型无关的部分：等待者管理、关闭、select
+ *
+ * 阻塞的发送者/接收者（以及select的每个分支）在自己的栈上构造WaitNode，挂入通道的等待链表后
+ * 在Waiter内置的rutex上挂起。对端在通道锁内从链表摘除节点，CAS认领Waiter（select的多个分支中
+ * 只有一个能被认领），直接完成值的交接，然后在锁内唤醒。
+ * 等待者醒来（或超时）后必须重新获取通道锁才能返回，因此对端访问栈上节点期间它们始终有效。
+ * 共享栈协程挂起期间栈会被覆盖，Waiter/WaitNode改为在堆上构造（ParkLocal），值也先换到堆上的副本里交接。
+ */
+class ChannelImplBase : public DebuggerId<ChannelImplBase>
+{
+public:
+    typedef RoutineSyncTimer::time_point time_point;
+
+    static constexpr int kInlineCases = 8;  ///< select分支数不超过该值时不分配内存（共享栈协程阻塞时除外）
+
+    virtual ~ChannelImplBase() {}
+
+    ChannelImplBase(ChannelImplBase const&) = delete;
+    ChannelImplBase& operator=(ChannelImplBase const&) = delete;
+
+    /// @brief 关闭通道：唤醒所有等待者，之后push失败，pop取完缓冲区剩余元素后失败
+    void close()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (closed_) return ;
+        closed_ = true;
+        RS_DBG(dbg_channel, "channel=%ld closed", id());
+
+        while (WaitNode* node = claimFront(popWaiters_, true))
+            node->waiter_->wake();
+        while (WaitNode* node = claimFront(pushWaiters_, true))
+            node->waiter_->wake();
+    }
+
+    bool closed()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return closed_;
+    }
+
+    /**
+     * @brief 多路选择，依次尝试所有分支，都未就绪时挂起直到有分支完成
+     * @param abstime 超时时刻，nullptr表示不超时
+     * @param block false: 没有就绪分支时立即返回（相当于Go的default分支）
+     * @param ok 可选，返回false表示分支因通道关闭而完成
+     * @return 完成的分支下标，超时或非阻塞时没有就绪分支返回-1
+     */
+    static int select(ChannelSelectCase const* cases, int n, time_point const* abstime, bool block, bool* ok)
+    {
+        if (ok) *ok = false;
+        if (n <= 0) return -1;
+
+        // 按地址顺序锁住所有涉及的通道，避免与其他select死锁；分支不多时放在栈上，不分配内存
+        ChannelImplBase* chanBuf[kInlineCases];
+        std::unique_ptr<ChannelImplBase*[]> chanHeap;
+        ChannelImplBase** chans = chanBuf;
+        if (n > kInlineCases) {
+            chanHeap.reset(new ChannelImplBase*[n]);
+            chans = chanHeap.get();
+        }
+        for (int i = 0; i < n; ++i)
+            chans[i] = cases[i].ch_;
+        std::sort(chans, chans + n);
+        int nchans = (int)(std::unique(chans, chans + n) - chans);
+
+        lockAll(chans, nchans);
+
+        // 从轮转的起点开始尝试，避免排在前面的分支总是优先
+        static thread_local unsigned int s_seed = 0;
+        int start = (int)(s_seed++ % (unsigned int)n);
+        for (int k = 0; k < n; ++k) {
+            int i = (start + k) % n;
+            ChannelSelectCase const& c = cases[i];
+            bool closed = false;
+            if (c.ch_->trySelectLocked(c, closed)) {
+                unlockAll(chans, nchans);
+                if (ok) *ok = !closed;
+                return i;
+            }
+        }
+
+        if (!block || (abstime && *abstime <= RoutineSyncTimer::clock_type::now())) {
+            unlockAll(chans, nchans);
+            return -1;
+        }
+
+        // 等待节点挂起期间由对端访问：共享栈协程或分支较多时放在堆上，否则放在栈上
+        bool offStack = ParkOffStack();
+        ParkLocal<Waiter> w(offStack);
+        WaitNode nodeBuf[kInlineCases];
+        std::unique_ptr<WaitNode[]> nodeHeap;
+        WaitNode* nodes = nodeBuf;
+        if (offStack || n > kInlineCases) {
+            nodeHeap.reset(new WaitNode[n]);
+            nodes = nodeHeap.get();
+        }
+        for (int i = 0; i < n; ++i) {
+            ChannelSelectCase const& c = cases[i];
+            if (offStack)
+                nodes[i].init(w.get(), i, c.ch_->bounceSlot(c.slot_, c.push_, false), c.push_, c.ch_);
+            else
+                nodes[i].init(w.get(), i, c.slot_, false, c.ch_);
+            (c.push_ ? c.ch_->pushWaiters_ : c.ch_->popWaiters_).push(&nodes[i]);
+        }
+        unlockAll(chans, nchans);
+
+        w->wait(abstime);
+
+        lockAll(chans, nchans);
+        for (int i = 0; i < n; ++i)
+            nodes[i].ch_->unlinkLocked(&nodes[i], cases[i].push_);
+        int code = w->code();
+        unlockAll(chans, nchans);
+
+        if (offStack) {
+            for (int i = 0; i < n; ++i)
+                cases[i].ch_->unbounceSlot(nodes[i].slot_, cases[i].slot_, cases[i].push_, false, code == i + 1);
+        }
+
+        if (code == 0) return -1;   // 超时
+        if (ok) *ok = code > 0;
+        return (code > 0 ? code : -code) - 1;
+    }
+
+protected:
+    ChannelImplBase() = default;
+
+    /// @brief 等待者，select的所有分支共享同一个
+    struct Waiter
+    {
+        /// 0: 等待中；index+1: 第index个分支完成；-(index+1): 第index个分支因关闭而完成
+        Rutex<int> rutex_;
+
+        bool claim(int code)
+        {
+            int expected = 0;
+            return rutex_.value()->compare_exchange_strong(expected, code,
+                    std::memory_order_acq_rel, std::memory_order_relaxed);
+        }
+
+        int code()
+        {
+            return rutex_.value()->load(std::memory_order_acquire);
+        }
+
+        /// 挂起直到被认领或超时
+        void wait(time_point const* abstime)
+        {
+            while (code() == 0) {
+                RutexBase::rutex_wait_return ret = abstime ? rutex_.wait_until(0, *abstime) : rutex_.wait(0);
+                if (ret == RutexBase::rutex_wait_return_etimeout) break;
+            }
+        }
+
+        /// 只能在持有通道锁时调用，保证被唤醒者返回前唤醒已经完成
+        void wake()
+        {
+            rutex_.wake_one();
+        }
+    };
+
+    /// @brief 挂在通道等待链表上的节点
+    struct WaitNode : public LinkedNode
+    {
+        Waiter* waiter_ = nullptr;
+        int index_ = 0;
+        void* slot_ = nullptr;              ///< 发送者: 源值，接收者: 目标位置
+        bool move_ = false;                 ///< 发送者的源值是否可以move
+        ChannelImplBase* ch_ = nullptr;     ///< 所属通道
+        bool linked_ = false;               ///< 是否仍在等待链表中，仅在持有通道锁时访问
+
+        void init(Waiter* w, int index, void* slot, bool move, ChannelImplBase* ch)
+        {
+            waiter_ = w;
+            index_ = index;
+            slot_ = slot;
+            move_ = move;
+            ch_ = ch;
+            linked_ = true;
+        }
+    };
+
+    /**
+     * @brief 从等待链表头部摘除并认领第一个仍在等待的节点（锁内调用）
+     * 属于已完成的select的节点被直接丢弃。
+     * @param closed 是否以"通道关闭"认领
+     */
+    WaitNode* claimFront(LinkedList & list, bool closed)
+    {
+        while (LinkedNode* front = list.front()) {
+            list.unlink(front);
+            WaitNode* node = static_cast<WaitNode*>(front);
+            node->linked_ = false;
+            int code = closed ? -(node->index_ + 1) : node->index_ + 1;
+            if (node->waiter_->claim(code))
+                return node;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 单个push/pop阻塞等待（锁内调用，返回时仍持有锁）
+     * @return true: 操作由对端完成；false: 超时或通道关闭
+     */
+    bool parkLocked(std::unique_lock<std::mutex> & lock, bool push, void* slot, bool move, time_point const* abstime)
+    {
+        if (abstime && *abstime <= RoutineSyncTimer::clock_type::now())
+            return false;
+
+        bool offStack = ParkOffStack();
+        ParkLocal<Waiter> w(offStack);
+        ParkLocal<WaitNode> node(offStack);
+        if (offStack)
+            node->init(w.get(), 0, bounceSlot(slot, push, move), push, this);   // 副本可以直接move
+        else
+            node->init(w.get(), 0, slot, move, this);
+        (push ? pushWaiters_ : popWaiters_).push(node.get());
+        RS_DBG(dbg_channel, "channel=%ld %s wait", id(), push ? "push" : "pop");
+        lock.unlock();
+
+        w->wait(abstime);
+
+        lock.lock();
+        unlinkLocked(node.get(), push);
+        bool done = w->code() > 0;
+        if (offStack)
+            unbounceSlot(node->slot_, slot, push, move, done);
+        return done;
+    }
+
+    void unlinkLocked(WaitNode* node, bool push)
+    {
+        if (!node->linked_) return ;
+        (push ? pushWaiters_ : popWaiters_).unlink(node);
+        node->linked_ = false;
+    }
+
+    /**
+     * @brief 尝试完成select的一个分支（锁内调用）
+     * @param closed 返回分支是否因通道关闭而完成
+     */
+    virtual bool trySelectLocked(ChannelSelectCase const& c, bool & closed) = 0;
+
+    /**
+     * @brief 共享栈协程挂起前把slot换成堆上的副本，挂起期间对端只访问副本
+     * push: 源值的拷贝（move为true时移动）；pop: 目标当前值的拷贝，作为接收位置
+     */
+    virtual void* bounceSlot(void* slot, bool push, bool move) = 0;
+
+    /**
+     * @brief 对端已不再访问副本时释放它
+     * @param done 分支是否由对端完成：pop完成时把值移回目标；move的push未完成时把源值移回
+     */
+    virtual void unbounceSlot(void* bounce, void* slot, bool push, bool move, bool done) = 0;
+
+    static void lockAll(ChannelImplBase* const* chans, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            chans[i]->mtx_.lock();
+    }
+
+    static void unlockAll(ChannelImplBase* const* chans, int n)
+    {
+        for (int i = n - 1; i >= 0; --i)
+            chans[i]->mtx_.unlock();
+    }
+
+    std::mutex mtx_;
+    LinkedList pushWaiters_;    ///< 阻塞的发送者（缓冲区已满或无缓冲通道没有接收者）
+    LinkedList popWaiters_;     ///< 阻塞的接收者（此时缓冲区一定为空）
+    bool closed_ = false;
+};
+
 /*
  * ChannelImpl是Channel的实现类，提供了具体的发送和接收逻辑。
+ * capacity为0时是无缓冲通道（发送者与接收者直接交接）；否则缓冲区满时发送者阻塞。
+ * 非竞争路径只有一次加解锁和一次队列操作，不分配内存。
  */
 template<
         typename T,
         typename QueueT
 >
-class ChannelImpl;
+class ChannelImpl final : public ChannelImplBase
+{
+public:
+    explicit ChannelImpl(std::size_t capacity) : capacity_(capacity)
+    {
+        channelQueueReserve(q_, capacity, 0);
+    }
+
+    /**
+     * @param move 是否可以move源值
+     * @param block 无法立即完成时是否阻塞
+     * @param abstime 阻塞的超时时刻，nullptr表示不超时
+     */
+    bool push(T* src, bool move, bool block, time_point const* abstime)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (closed_) return false;
+        if (tryPushLocked(src, move)) return true;
+        if (!block) return false;
+        return parkLocked(lock, true, src, move, abstime);
+    }
+
+    bool pop(T* dst, bool block, time_point const* abstime)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (tryPopLocked(dst)) return true;
+        if (closed_ || !block) return false;
+        return parkLocked(lock, false, dst, false, abstime);
+    }
+
+    std::size_t size()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return q_.size();
+    }
+
+    std::size_t capacity() const
+    {
+        return capacity_;
+    }
+
+protected:
+    bool trySelectLocked(ChannelSelectCase const& c, bool & closed) override
+    {
+        if (c.push_) {
+            if (closed_) {
+                closed = true;
+                return true;
+            }
+            return tryPushLocked(static_cast<T*>(c.slot_), false);
+        }
+
+        if (tryPopLocked(static_cast<T*>(c.slot_))) return true;
+        closed = closed_;
+        return closed_;
+    }
+
+    void* bounceSlot(void* slot, bool push, bool move) override
+    {
+        T* t = static_cast<T*>(slot);
+        if (push && move)
+            return new T(std::move(*t));
+        return new T(*t);
+    }
+
+    void unbounceSlot(void* bounce, void* slot, bool push, bool move, bool done) override
+    {
+        T* b = static_cast<T*>(bounce);
+        if (push ? (move && !done) : done)
+            *static_cast<T*>(slot) = std::move(*b);
+        delete b;
+    }
+
+private:
+    static void assign(T* dst, T* src, bool move)
+    {
+        if (move)
+            *dst = std::move(*src);
+        else
+            *dst = *src;
+    }
+
+    void enqueue(T* src, bool move)
+    {
+        if (move)
+            q_.push_back(std::move(*src));
+        else
+            q_.push_back(*src);
+    }
 
+    bool tryPushLocked(T* src, bool move)
+    {
+        // 有接收者在等待时缓冲区一定为空，直接交给它
+        if (WaitNode* node = claimFront(popWaiters_, false)) {
+            assign(static_cast<T*>(node->slot_), src, move);
+            node->waiter_->wake();
+            return true;
+        }
+
+        if (q_.size() < capacity_) {
+            enqueue(src, move);
+            return true;
+        }
+        return false;
+    }
+
+    bool tryPopLocked(T* dst)
+    {
+        if (!q_.empty()) {
+            *dst = std::move(q_.front());
+            q_.pop_front();
+
+            // 腾出了空位，接收一个阻塞的发送者
+            if (WaitNode* node = claimFront(pushWaiters_, false)) {
+                enqueue(static_cast<T*>(node->slot_), node->move_);
+                node->waiter_->wake();
+            }
+            return true;
+        }
+
+        // 无缓冲通道：直接从发送者手中取值
+        if (WaitNode* node = claimFront(pushWaiters_, false)) {
+            assign(dst, static_cast<T*>(node->slot_), node->move_);
+            node->waiter_->wake();
+            return true;
+        }
+        return false;
+    }
+
+    std::size_t capacity_;
+    QueueT q_;
+};
+
+/*
+ * @brief Go风格的通道
+ * 可拷贝的句柄，所有拷贝共享同一个通道。阻塞时在协程中只挂起当前协程，在线程中阻塞当前线程。
+ *
+ *   Channel<int> ch(10);     // 缓冲区容量为10，默认0为无缓冲通道
+ *   ch << 1;                 // 阻塞发送
+ *   int v; ch >> v;          // 阻塞接收
+ *   int idx = Select({ch.CasePop(v), other.CasePush(2)}, std::chrono::milliseconds(10));
+ */
 template<
         typename T,
-        typename QueueT = std::deque<T>
+        typename QueueT = ChannelRingQueue<T>
 >
-class Channel;
+class Channel
+{
+public:
+    typedef ChannelImpl<T, QueueT> impl_type;
+
+    explicit Channel(std::size_t capacity = 0)
+        : impl_(std::make_shared<impl_type>(capacity))
+    {}
+
+    /// @brief 阻塞发送，通道已关闭时返回false
+    bool Push(T const& t) const
+    {
+        return impl_->push(const_cast<T*>(&t), false, true, nullptr);
+    }
+
+    bool Push(T && t) const
+    {
+        return impl_->push(&t, true, true, nullptr);
+    }
+
+    /// @brief 阻塞接收，通道已关闭且缓冲区为空时返回false
+    bool Pop(T & t) const
+    {
+        return impl_->pop(&t, true, nullptr);
+    }
+
+    /// @brief 非阻塞发送
+    bool TryPush(T const& t) const
+    {
+        return impl_->push(const_cast<T*>(&t), false, false, nullptr);
+    }
+
+    bool TryPush(T && t) const
+    {
+        return impl_->push(&t, true, false, nullptr);
+    }
+
+    /// @brief 非阻塞接收
+    bool TryPop(T & t) const
+    {
+        return impl_->pop(&t, false, nullptr);
+    }
+
+    /// @brief 带超时的发送，超时或通道已关闭返回false
+    template <typename Rep, typename Period>
+    bool TimedPush(T const& t, std::chrono::duration<Rep, Period> const& timeout) const
+    {
+        auto abstime = deadline(timeout);
+        return impl_->push(const_cast<T*>(&t), false, true, &abstime);
+    }
+
+    template <typename Rep, typename Period>
+    bool TimedPush(T && t, std::chrono::duration<Rep, Period> const& timeout) const
+    {
+        auto abstime = deadline(timeout);
+        return impl_->push(&t, true, true, &abstime);
+    }
+
+    /// @brief 带超时的接收，超时或通道已关闭且缓冲区为空返回false
+    template <typename Rep, typename Period>
+    bool TimedPop(T & t, std::chrono::duration<Rep, Period> const& timeout) const
+    {
+        auto abstime = deadline(timeout);
+        return impl_->pop(&t, true, &abstime);
+    }
+
+    Channel const& operator<<(T t) const
+    {
+        Push(std::move(t));
+        return *this;
+    }
+
+    Channel const& operator>>(T & t) const
+    {
+        Pop(t);
+        return *this;
+    }
+
+    /// @brief select分支：发送t的拷贝（t在Select返回前必须有效）
+    ChannelSelectCase CasePush(T const& t) const
+    {
+        return ChannelSelectCase{impl_.get(), const_cast<T*>(&t), true};
+    }
+
+    /// @brief select分支：接收到t
+    ChannelSelectCase CasePop(T & t) const
+    {
+        return ChannelSelectCase{impl_.get(), &t, false};
+    }
+
+    void Close() const
+    {
+        impl_->close();
+    }
+
+    bool IsClosed() const
+    {
+        return impl_->closed();
+    }
+
+    /// @brief 缓冲区中的元素数量
+    std::size_t Size() const
+    {
+        return impl_->size();
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    std::size_t Capacity() const
+    {
+        return impl_->capacity();
+    }
+
+private:
+    template <typename Rep, typename Period>
+    static RoutineSyncTimer::time_point deadline(std::chrono::duration<Rep, Period> const& timeout)
+    {
+        return RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(timeout);
+    }
+
+    std::shared_ptr<impl_type> impl_;
+};
+
+/**
+ * @brief 阻塞直到某个分支完成
+ * @param ok 可选，返回false表示该分支因通道关闭而完成（接收方没有得到值）
+ * @return 完成的分支下标
+ */
+inline int Select(std::initializer_list<ChannelSelectCase> cases, bool* ok = nullptr)
+{
+    return ChannelImplBase::select(cases.begin(), (int)cases.size(), nullptr, true, ok);
+}
+
+/// @brief 带超时的select，超时返回-1
+template <typename Rep, typename Period>
+inline int Select(std::initializer_list<ChannelSelectCase> cases,
+                  std::chrono::duration<Rep, Period> const& timeout, bool* ok = nullptr)
+{
+    auto abstime = RoutineSyncTimer::clock_type::now() +
+            std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(timeout);
+    return ChannelImplBase::select(cases.begin(), (int)cases.size(), &abstime, true, ok);
+}
+
+/// @brief 非阻塞select（相当于带default分支），没有就绪分支返回-1
+inline int TrySelect(std::initializer_list<ChannelSelectCase> cases, bool* ok = nullptr)
+{
+    return ChannelImplBase::select(cases.begin(), (int)cases.size(), nullptr, false, ok);
+}
 
 /*
  * @brief 基于信号的Channel实现类，兼容stl风格的api实现
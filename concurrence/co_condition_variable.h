@@ -0,0 +1,109 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_CO_CONDITION_VARIABLE_H
+#define GOCOROUTINE_CO_CONDITION_VARIABLE_H
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <utils/utils.h>
+#include "co_mutex.h"
+#include "rutex.h"
+
+namespace cxk
+{
+
+/*
+ * @brief 协程条件变量，协程与线程中均可使用
+ * 可以配合任意满足BasicLockable的锁（co_mutex、std::mutex等），与std::condition_variable_any语义一致，
+ * 允许虚假唤醒。
+ *
+ * 实现为序号rutex：wait在持有锁时记下序号再解锁挂起，notify递增序号后唤醒，
+ * 因此解锁与挂起之间的notify不会丢失。
+ */
+class co_condition_variable
+{
+public:
+    co_condition_variable() = default;
+    co_condition_variable(co_condition_variable const&) = delete;
+    co_condition_variable& operator=(co_condition_variable const&) = delete;
+
+    void notify_one()
+    {
+        seq()->fetch_add(1, std::memory_order_release);
+        rutex_.wake_one();
+    }
+
+    void notify_all()
+    {
+        seq()->fetch_add(1, std::memory_order_release);
+        rutex_.wake_all();
+    }
+
+    template <typename Lock>
+    void wait(Lock & lock)
+    {
+        wait_impl(lock, nullptr);
+    }
+
+    template <typename Lock, typename Predicate>
+    void wait(Lock & lock, Predicate pred)
+    {
+        while (!pred())
+            wait(lock);
+    }
+
+    template <typename Lock, typename Clock, typename Duration>
+    std::cv_status wait_until(Lock & lock, std::chrono::time_point<Clock, Duration> const& abstime)
+    {
+        auto steadyTime = RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(abstime - Clock::now());
+        return wait_impl(lock, &steadyTime);
+    }
+
+    template <typename Lock, typename Clock, typename Duration, typename Predicate>
+    bool wait_until(Lock & lock, std::chrono::time_point<Clock, Duration> const& abstime, Predicate pred)
+    {
+        while (!pred()) {
+            if (wait_until(lock, abstime) == std::cv_status::timeout)
+                return pred();
+        }
+        return true;
+    }
+
+    template <typename Lock, typename Rep, typename Period>
+    std::cv_status wait_for(Lock & lock, std::chrono::duration<Rep, Period> const& timeout)
+    {
+        return wait_until(lock, RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(timeout));
+    }
+
+    template <typename Lock, typename Rep, typename Period, typename Predicate>
+    bool wait_for(Lock & lock, std::chrono::duration<Rep, Period> const& timeout, Predicate pred)
+    {
+        return wait_until(lock, RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(timeout), std::move(pred));
+    }
+
+private:
+    ALWAYS_INLINE std::atomic<uint32_t>* seq() { return rutex_.value(); }
+
+    template <typename Lock>
+    std::cv_status wait_impl(Lock & lock, RoutineSyncTimer::time_point const* abstime)
+    {
+        uint32_t s = seq()->load(std::memory_order_relaxed);
+        lock.unlock();
+        RutexBase::rutex_wait_return ret = abstime ? rutex_.wait_until(s, *abstime) : rutex_.wait(s);
+        lock.lock();
+        return ret == RutexBase::rutex_wait_return_etimeout ? std::cv_status::timeout : std::cv_status::no_timeout;
+    }
+
+    Rutex<uint32_t> rutex_;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_CO_CONDITION_VARIABLE_H
@@ -0,0 +1,68 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_CO_LOCAL_H
+#define GOCOROUTINE_CO_LOCAL_H
+
+#pragma once
+#include <utils/utils.h>
+#include <common/anys.h>
+#include <scheduler/processor.h>
+#include <task/task.h>
+
+namespace cxk
+{
+
+/// @brief 当前执行流的协程本地存储：协程中为协程自己的，否则为当前线程的
+inline TaskAnys& GetCoLocalStorage()
+{
+    Task* tk = Processor::GetCurrentTask();
+    if (tk) return tk->cls_;
+    static thread_local TaskAnys local{TaskAnys::lazy_t()};
+    return local;
+}
+
+/*
+ * @brief 协程本地变量，协程中每个协程一份，协程外每个线程一份
+ *
+ * 每个co_local<T>构造时在Anys<TaskGroup>中注册一个槽位；每个Task持有一块延迟分配的Anys，
+ * 访问时按"索引 + 基址"直接寻址。第一次访问时才分配内存块、构造对象，创建协程时不会调用任何构造函数；
+ * 构造过的对象在协程函数返回后、仍在协程中时析构。协程切换时不需要保存/恢复任何状态。
+ *
+ * 注册必须发生在第一块存储分配之前，co_local应当定义为全局或命名空间作用域的变量：
+ * 函数内的static在第一次调用时才注册，此时如果已有协程访问过co_local会抛出logic_error。
+ *
+ *   static co_local<RequestContext> g_ctx;
+ *   g_ctx->traceId_ = ...;      // 只影响当前协程
+ */
+template <typename T>
+class co_local
+{
+public:
+    co_local() : index_(TaskAnys::Register<T>()) {}
+
+    co_local(co_local const&) = delete;
+    co_local& operator=(co_local const&) = delete;
+
+    /// @brief 当前协程（或线程）的对象，第一次访问时默认构造
+    ALWAYS_INLINE T& get() {
+        return GetCoLocalStorage().template touch<T>(index_);
+    }
+
+    ALWAYS_INLINE T& operator*() { return get(); }
+
+    ALWAYS_INLINE T* operator->() { return &get(); }
+
+    co_local& operator=(T const& value) {
+        get() = value;
+        return *this;
+    }
+
+private:
+    std::size_t index_;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_CO_LOCAL_H
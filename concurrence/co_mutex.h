@@ -0,0 +1,117 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_CO_MUTEX_H
+#define GOCOROUTINE_CO_MUTEX_H
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <utils/utils.h>
+#include <common/error.h>
+#include "rutex.h"
+#include "sync_policy.h"
+
+namespace cxk
+{
+
+/*
+ * @brief 协程互斥锁，协程与线程中均可使用
+ * 竞争时先自旋，仍拿不到锁再挂起在rutex上：协程中只挂起当前协程，不阻塞工作线程。
+ * 持有LFLock切换协程会让等同一把锁的工作线程空转，跨越切换点加锁应使用co_mutex。
+ *
+ * 状态（rutex值）: 0: 未加锁；1: 已加锁，无等待者；2: 已加锁，可能有等待者。
+ * 解锁时只有状态为2才需要唤醒，无竞争时加解锁各一次原子操作。
+ */
+class co_mutex
+{
+public:
+    co_mutex() = default;
+    co_mutex(co_mutex const&) = delete;
+    co_mutex& operator=(co_mutex const&) = delete;
+
+    ALWAYS_INLINE void lock()
+    {
+        int c = 0;
+        if (state()->compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            return;
+        lock_slow(nullptr);
+    }
+
+    ALWAYS_INLINE bool try_lock()
+    {
+        int c = 0;
+        return state()->compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    template <typename Rep, typename Period>
+    bool try_lock_for(std::chrono::duration<Rep, Period> const& timeout)
+    {
+        auto abstime = RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(timeout);
+        return try_lock() || lock_slow(&abstime);
+    }
+
+    template <typename Clock, typename Duration>
+    bool try_lock_until(std::chrono::time_point<Clock, Duration> const& abstime)
+    {
+        auto steadyTime = RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(abstime - Clock::now());
+        return try_lock() || lock_slow(&steadyTime);
+    }
+
+    ALWAYS_INLINE void unlock()
+    {
+        int c = state()->exchange(0, std::memory_order_release);
+        if (c == 2) {
+            rutex_.wake_one();
+        } else if (c == 0) {
+            ThrowError(eCoErrorCode::ec_mutex_double_unlock);
+        }
+    }
+
+    /// @brief 是否已被加锁（近似值，仅用于调试和断言）
+    ALWAYS_INLINE bool is_lock() const
+    {
+        return rutex_.value()->load(std::memory_order_relaxed) != 0;
+    }
+
+    /// @brief 自旋次数：线程中挂起代价高，多自旋一些；协程中自旋会阻塞同线程的其他协程，少自旋
+    static constexpr int kThreadSpin = 256;
+    static constexpr int kRoutineSpin = 32;
+
+private:
+    ALWAYS_INLINE std::atomic<int>* state() { return rutex_.value(); }
+
+    /// @return false: 超时
+    bool lock_slow(RoutineSyncTimer::time_point const* abstime)
+    {
+        // 已有等待者时持有者大概率不会很快释放，直接挂起
+        int spin = DefaultSyncPolicy::IsInPThread() ? kThreadSpin : kRoutineSpin;
+        for (int i = 0; i < spin; ++i) {
+            int c = state()->load(std::memory_order_relaxed);
+            if (c == 2) break;
+            if (c == 0 && state()->compare_exchange_weak(c, 1,
+                        std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+            CPU_RELAX();
+        }
+
+        // 挂起前把状态置为2，保证解锁者会唤醒；被唤醒后同样以2加锁，因为可能还有其他等待者
+        while (state()->exchange(2, std::memory_order_acquire) != 0) {
+            RutexBase::rutex_wait_return ret = abstime ? rutex_.wait_until(2, *abstime) : rutex_.wait(2);
+            if (ret == RutexBase::rutex_wait_return_etimeout) {
+                int c = 0;
+                return state()->compare_exchange_strong(c, 2, std::memory_order_acquire, std::memory_order_relaxed);
+            }
+        }
+        return true;
+    }
+
+    mutable Rutex<int> rutex_;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_CO_MUTEX_H
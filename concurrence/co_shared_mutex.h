@@ -0,0 +1,122 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_CO_SHARED_MUTEX_H
+#define GOCOROUTINE_CO_SHARED_MUTEX_H
+
+#pragma once
+#include <atomic>
+#include <utils/utils.h>
+#include <common/error.h>
+#include "co_mutex.h"
+#include "rutex.h"
+#include "sync_policy.h"
+
+namespace cxk
+{
+
+/*
+ * @brief 协程读写锁（写优先），协程与线程中均可使用，满足SharedMutex要求
+ * 有写者等待时新的读者不再进入，避免写者饿死。
+ *
+ * state_: 最高位为写锁标记，低位为持有读锁的数量。
+ * 读者与写者分别挂起在各自的序号rutex上：等待前记下序号再检查state_，释放方修改state_后递增序号再唤醒，
+ * 因此检查与挂起之间的释放不会丢失。
+ */
+class co_shared_mutex
+{
+public:
+    co_shared_mutex() = default;
+    co_shared_mutex(co_shared_mutex const&) = delete;
+    co_shared_mutex& operator=(co_shared_mutex const&) = delete;
+
+    void lock()
+    {
+        if (try_lock()) return;
+
+        writersWaiting_.fetch_add(1, std::memory_order_seq_cst);
+        int spin = DefaultSyncPolicy::IsInPThread() ? co_mutex::kThreadSpin : co_mutex::kRoutineSpin;
+        for (int i = 0; ; ++i) {
+            uint32_t seq = writerSeq_.value()->load(std::memory_order_seq_cst);
+            if (try_lock()) break;
+            if (i < spin) {
+                CPU_RELAX();
+                continue;
+            }
+            writerSeq_.wait(seq);
+        }
+        writersWaiting_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    ALWAYS_INLINE bool try_lock()
+    {
+        uint32_t s = 0;
+        return state_.compare_exchange_strong(s, kWriter, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        uint32_t s = state_.fetch_and(~kWriter, std::memory_order_seq_cst);
+        if (!(s & kWriter))
+            ThrowError(eCoErrorCode::ec_mutex_double_unlock);
+
+        // 写者优先：有写者等待时只唤醒一个写者，读者仍会被拦住
+        if (writersWaiting_.load(std::memory_order_seq_cst) > 0) {
+            writerSeq_.value()->fetch_add(1, std::memory_order_seq_cst);
+            writerSeq_.wake_one();
+        }
+        readerSeq_.value()->fetch_add(1, std::memory_order_seq_cst);
+        readerSeq_.wake_all();
+    }
+
+    void lock_shared()
+    {
+        if (try_lock_shared()) return;
+
+        int spin = DefaultSyncPolicy::IsInPThread() ? co_mutex::kThreadSpin : co_mutex::kRoutineSpin;
+        for (int i = 0; ; ++i) {
+            uint32_t seq = readerSeq_.value()->load(std::memory_order_seq_cst);
+            if (try_lock_shared()) return;
+            if (i < spin) {
+                CPU_RELAX();
+                continue;
+            }
+            readerSeq_.wait(seq);
+        }
+    }
+
+    ALWAYS_INLINE bool try_lock_shared()
+    {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        while (!(s & kWriter) && writersWaiting_.load(std::memory_order_seq_cst) == 0) {
+            if (state_.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    void unlock_shared()
+    {
+        uint32_t s = state_.fetch_sub(1, std::memory_order_seq_cst);
+        if ((s & ~kWriter) == 0)
+            ThrowError(eCoErrorCode::ec_mutex_double_unlock);
+
+        if (s == 1 && writersWaiting_.load(std::memory_order_seq_cst) > 0) {
+            writerSeq_.value()->fetch_add(1, std::memory_order_seq_cst);
+            writerSeq_.wake_one();
+        }
+    }
+
+private:
+    static constexpr uint32_t kWriter = 1u << 31;
+
+    std::atomic<uint32_t> state_{0};
+    std::atomic<int> writersWaiting_{0};
+    Rutex<uint32_t> writerSeq_;
+    Rutex<uint32_t> readerSeq_;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_CO_SHARED_MUTEX_H
@@ -0,0 +1,84 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_CO_WAIT_GROUP_H
+#define GOCOROUTINE_CO_WAIT_GROUP_H
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <utils/utils.h>
+#include <common/error.h>
+#include "rutex.h"
+
+namespace cxk
+{
+
+/*
+ * @brief 等待一组任务完成（Go的sync.WaitGroup），协程与线程中均可使用
+ * Add增加计数，Done减少计数，Wait挂起直到计数归零。计数小于0时抛出ec_wait_group_negative。
+ */
+class co_wait_group
+{
+public:
+    explicit co_wait_group(int count = 0)
+    {
+        counter()->store(count, std::memory_order_relaxed);
+    }
+
+    co_wait_group(co_wait_group const&) = delete;
+    co_wait_group& operator=(co_wait_group const&) = delete;
+
+    void Add(int delta = 1)
+    {
+        int c = counter()->fetch_add(delta, std::memory_order_acq_rel) + delta;
+        if (c < 0)
+            ThrowError(eCoErrorCode::ec_wait_group_negative);
+        if (c == 0)
+            rutex_.wake_all();
+    }
+
+    ALWAYS_INLINE void Done()
+    {
+        Add(-1);
+    }
+
+    void Wait()
+    {
+        for (;;) {
+            int c = counter()->load(std::memory_order_acquire);
+            if (c == 0) return;
+            rutex_.wait(c);
+        }
+    }
+
+    /// @return true: 计数已归零；false: 超时
+    template <typename Rep, typename Period>
+    bool WaitFor(std::chrono::duration<Rep, Period> const& timeout)
+    {
+        auto abstime = RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(timeout);
+        for (;;) {
+            int c = counter()->load(std::memory_order_acquire);
+            if (c == 0) return true;
+            if (rutex_.wait_until(c, abstime) == RutexBase::rutex_wait_return_etimeout)
+                return counter()->load(std::memory_order_acquire) == 0;
+        }
+    }
+
+    /// @brief 当前计数（近似值）
+    ALWAYS_INLINE int Count() const
+    {
+        return rutex_.value()->load(std::memory_order_relaxed);
+    }
+
+private:
+    ALWAYS_INLINE std::atomic<int>* counter() { return rutex_.value(); }
+
+    mutable Rutex<int> rutex_;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_CO_WAIT_GROUP_H
@@ -0,0 +1,67 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_PARK_LOCAL_H
+#define GOCOROUTINE_PARK_LOCAL_H
+
+#pragma once
+#include "sync_policy.h"
+#include <common/object_pool.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cxk
+{
+
+/*
+ * @brief 挂起期间需要被其他线程访问的局部对象（等待者节点、定时器元素、交接缓冲区等）
+ * 普通协程和线程直接构造在自己的栈上；共享栈协程（RoutineSwitcherI::parkOffStack()）切出后，
+ * 栈上的内容会被同一块共享栈上的其他协程覆盖，这时改为在对象池（ObjectPool<T>）中构造。
+ * 持有者本身仍在栈上，只有挂起者自己通过它访问对象。
+ * 无论是否在栈上构造都会实例化ObjectPool<T>，sizeof(T)不能超过约ObjectPool::kSlabSize / 8（8KB），
+ * 否则编译失败（"ObjectPool type is too large for a slab"）；大缓冲区应放在T之外，T只持有指针。
+ */
+template <typename T>
+class ParkLocal
+{
+public:
+    template <typename... Args>
+    explicit ParkLocal(bool offStack, Args&&... args)
+    {
+        if (offStack)
+            ptr_ = ObjectPool<T>::New(std::forward<Args>(args)...);
+        else
+            ptr_ = new (&storage_) T(std::forward<Args>(args)...);
+    }
+
+    ~ParkLocal()
+    {
+        if ((void*)ptr_ == (void*)&storage_)
+            ptr_->~T();
+        else
+            ObjectPool<T>::Delete(ptr_);
+    }
+
+    ParkLocal(ParkLocal const&) = delete;
+    ParkLocal& operator=(ParkLocal const&) = delete;
+
+    ALWAYS_INLINE T* get() const { return ptr_; }
+    ALWAYS_INLINE T* operator->() const { return ptr_; }
+    ALWAYS_INLINE T& operator*() const { return *ptr_; }
+
+private:
+    T* ptr_;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+};
+
+/// @brief 当前routine挂起时是否必须把等待者对象放在堆上
+ALWAYS_INLINE bool ParkOffStack()
+{
+    return DefaultSyncPolicy::ClsRef().parkOffStack();
+}
+
+} // cxk
+
+#endif //GOCOROUTINE_PARK_LOCAL_H
@@ -5,9 +5,15 @@
 #ifndef GOCOROUTINE_RUTEX_H
 #define GOCOROUTINE_RUTEX_H
 #include <atomic>
+#include <limits>
+#include <chrono>
 #include "linked_list.h"
 #include <mutex>
 #include "debug.h"
+#include "switcher.h"
+#include "sync_policy.h"
+#include "park_local.h"
+#include "timer.h"
 /*
  * @brief POSIX Futex（快速用户空间互斥锁）
  * Futex 的核心思想是：先在用户空间尝试操作，只有当锁确实被占用时才进入内核态等待。
@@ -68,20 +74,184 @@ public:
 #undef __SWITCH_CASE_ETOS
     }
 
+    /// @brief 当前等待者数量（近似值）
+    inline int waiter_count() const {
+        return waiterCount_.load(std::memory_order_relaxed);
+    }
+
 protected:
     friend struct RutexWaiter;
     LinkedList waiters_; ///< 等待者链表，存储等待此锁的协程
     std::mutex mtx_; ///< 互斥锁，用于保护等待者链表的访问
+    std::atomic<int> waiterCount_{0}; ///< 等待者数量，唤醒时为0则不加锁直接返回
 };
 
 /*
  * @brief 等待者结构体
+ * 位于等待者自己的栈上（共享栈协程放在堆上，见ParkLocal）；从rutex链表中成功摘除它的一方（唤醒者或定时器）负责唤醒，
+ * 因此一次等待只会被唤醒一次。
  */
 struct RutexWaiter : public LinkedNode, public DebuggerId<RutexWaiter>
 {
+    explicit RutexWaiter(RoutineSwitcherI & sw) : switcher_(&sw) {}
+
+    /// @brief 从所属rutex的等待链表中摘除（线程安全）
+    /// @return true: 由调用者摘除，调用者负责唤醒；false: 已被其他人摘除
+    inline bool safe_unlink()
+    {
+        RutexBase* owner = owner_.load(std::memory_order_acquire);
+        if (!owner) return false;
+
+        std::unique_lock<std::mutex> lock(owner->mtx_);
+        if (owner_.load(std::memory_order_relaxed) != owner) return false;
+        owner->waiters_.unlink(this);
+        owner->waiterCount_.fetch_sub(1, std::memory_order_relaxed);
+        owner_.store(nullptr, std::memory_order_relaxed);
+        return true;
+    }
 
+    RoutineSwitcherI* switcher_;
+    std::atomic<RutexBase*> owner_{nullptr}; ///< 所属rutex，仅在持有其mtx_时修改
+    bool timeout_ = false; ///< 是否由定时器唤醒
+    RoutineSyncTimer::TimerElement timer_;
 };
 
+/*
+ * @brief rutex: 协程/线程通用的futex
+ * wait(expected)原子地检查值是否等于expected，相等则挂起当前routine（协程中切出，不阻塞线程），
+ * wake_one/wake_all唤醒等待者。
+ * 快速路径：值已不等于expected时wait不加锁直接返回ewouldblock；没有等待者时wake不加锁直接返回。
+ * @tparam IntValueType 整数类型
+ * @tparam Reference true: 引用外部的原子变量（通过ref绑定）；false: 使用内置的原子变量
+ * @tparam Policy 切换器策略，默认编译期绑定TaskSwitcher（见sync_policy.h）
+ */
+template <typename IntValueType = int, bool Reference = false, typename Policy = DefaultSyncPolicy>
+class Rutex : public RutexBase, public IntValue<IntValueType, Reference>
+{
+public:
+    typedef IntValue<IntValueType, Reference> value_base;
+    using value_base::value;
+
+    /// @brief 值等于expected时挂起，直到被唤醒
+    inline rutex_wait_return wait(IntValueType expected)
+    {
+        return wait_until_impl(expected, (RoutineSyncTimer::time_point*)nullptr);
+    }
+
+    /// @brief 值等于expected时挂起，直到被唤醒或超时
+    template <typename Rep, typename Period>
+    inline rutex_wait_return wait(IntValueType expected, std::chrono::duration<Rep, Period> const& timeout)
+    {
+        auto abstime = RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(timeout);
+        return wait_until_impl(expected, &abstime);
+    }
+
+    /// @brief 值等于expected时挂起，直到被唤醒或到达abstime
+    template <typename Clock, typename Duration>
+    inline rutex_wait_return wait_until(IntValueType expected, std::chrono::time_point<Clock, Duration> const& abstime)
+    {
+        auto steadyTime = RoutineSyncTimer::clock_type::now() +
+                std::chrono::duration_cast<RoutineSyncTimer::clock_type::duration>(abstime - Clock::now());
+        return wait_until_impl(expected, &steadyTime);
+    }
+
+    /// @brief 唤醒一个等待者，返回实际唤醒数量
+    inline int wake_one()
+    {
+        return wake(1);
+    }
+
+    /// @brief 唤醒所有等待者，返回实际唤醒数量
+    inline int wake_all()
+    {
+        return wake(std::numeric_limits<int>::max());
+    }
+
+    /// @brief 唤醒最多n个等待者，返回实际唤醒数量
+    inline int wake(int n)
+    {
+        // 与wait中的fence配对：要么这里看到等待者，要么等待者看到调用方修改后的值
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiterCount_.load(std::memory_order_relaxed) == 0)
+            return 0;
+
+        // 在锁内摘除，在锁外唤醒：被唤醒者可能立即在其他线程恢复执行
+        LinkedList woken;
+        int c = 0;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            while (c < n) {
+                LinkedNode* node = waiters_.front();
+                if (!node) break;
+
+                waiters_.unlink(node);
+                RutexWaiter* w = static_cast<RutexWaiter*>(node);
+                w->owner_.store(nullptr, std::memory_order_relaxed);
+                waiterCount_.fetch_sub(1, std::memory_order_relaxed);
+                woken.push(node);
+                ++c;
+            }
+        }
+
+        LinkedNode* node = woken.front();
+        while (node) {
+            LinkedNode* next = node->next;
+            node->prev = node->next = nullptr;
+            RS_DBG(dbg_rutex, "wake waiter=%ld", static_cast<RutexWaiter*>(node)->id());
+            Policy::Wake(*static_cast<RutexWaiter*>(node)->switcher_); // 之后node可能已失效
+            node = next;
+        }
+        return c;
+    }
+
+private:
+    inline rutex_wait_return wait_until_impl(IntValueType expected, RoutineSyncTimer::time_point const* abstime)
+    {
+        // 快速路径：值已改变，不加锁
+        if (value()->load(std::memory_order_acquire) != expected)
+            return rutex_wait_return_ewouldblock;
+
+        if (abstime && *abstime <= RoutineSyncTimer::clock_type::now())
+            return rutex_wait_return_etimeout;
+
+        RoutineSwitcherI & sw = Policy::ClsRef();
+        ParkLocal<RutexWaiter> w(sw.parkOffStack(), sw);
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            waiterCount_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (value()->load(std::memory_order_relaxed) != expected) {
+                waiterCount_.fetch_sub(1, std::memory_order_relaxed);
+                return rutex_wait_return_ewouldblock;
+            }
+
+            waiters_.push(w.get());
+            w->owner_.store(this, std::memory_order_relaxed);
+            Policy::Mark(sw);
+        }
+
+        if (abstime) {
+            RutexWaiter* pw = w.get();
+            RoutineSyncTimer::getInstance().schedule(w->timer_, *abstime, [pw]{
+                if (pw->safe_unlink()) {
+                    pw->timeout_ = true;
+                    Policy::Wake(*pw->switcher_);
+                }
+            });
+        }
+
+        RS_DBG(dbg_rutex, "waiter=%ld sleep", w->id());
+        Policy::Sleep(sw);
+
+        if (abstime) {
+            // 确保定时器回调不再访问w
+            RoutineSyncTimer::getInstance().join_unschedule(w->timer_);
+        }
+
+        return w->timeout_ ? rutex_wait_return_etimeout : rutex_wait_return_success;
+    }
+};
 
 }
 
@@ -8,6 +8,13 @@
 #include <condition_variable>
 #include <functional>
 #include <atomic>
+#include <type_traits>
+#include <utils/macro.h>
+#if defined(LIBGO_SYS_Linux)
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
 namespace cxk
 {
     extern void routine_sync_init_callback();  /// 注册默认的协程切换器
@@ -19,6 +26,11 @@ namespace cxk
     struct RoutineSwitcherI
     {
     public:
+        /// @param pthread 是否为PThreadSwitcher，供编译期策略不经虚函数分派
+        /// @param parkOffStack 挂起期间栈内容可能被覆盖（共享栈协程），见parkOffStack()
+        explicit RoutineSwitcherI(bool pthread = false, bool parkOffStack = false)
+            : pthread_(pthread), parkOffStack_(parkOffStack) {}
+
         virtual ~RoutineSwitcherI() {
             valid_ = false;
         }
@@ -46,15 +58,31 @@ namespace cxk
 
     private:
         bool valid_ = true;
+        bool pthread_;
+        bool parkOffStack_;
 
     public:
         inline bool valid() const { return valid_; }
+        inline bool isPThread() const { return pthread_; }
+
+        /// @brief 挂起期间其他线程会访问的等待者对象（链表节点、定时器等）是否必须放在堆上
+        /// 共享栈协程切出后，栈上的内容会被同一块栈上的其他协程覆盖（见ParkLocal）
+        inline bool parkOffStack() const { return parkOffStack_; }
     };
 
-class PThreadSwitcher : public RoutineSwitcherI
+/*
+ * @brief 普通线程使用的切换器
+ * Linux上为无锁状态机 + futex：
+ *  - mark: idle -> marked；
+ *  - sleep: 先有限自旋等待wake，仍未被唤醒则 marked -> parked 后FUTEX_WAIT；
+ *  - wake: marked/parked -> idle，只有对方已经parked才需要FUTEX_WAKE系统调用。
+ * mark -> wake -> sleep 顺序下wake把状态改回idle，sleep直接返回；
+ * 同一次mark只有一次wake能完成状态转换，其余wake返回false且没有副作用。
+ */
+class PThreadSwitcher final : public RoutineSwitcherI
 {
 public:
-    PThreadSwitcher() {
+    PThreadSwitcher() : RoutineSwitcherI(true) {
         // printf("PThreadSwitcher threadid=%d\n", (int)syscall(SYS_gettid));
     }
 
@@ -62,6 +90,40 @@ public:
         // printf("~PThreadSwitcher threadid=%d\n", (int)syscall(SYS_gettid));
     }
 
+#if defined(LIBGO_SYS_Linux)
+    virtual void mark() override
+    {
+        state_.store(kMarked, std::memory_order_release);
+    }
+
+    virtual void sleep() override
+    {
+        // 唤醒通常紧随其后（如通道的另一端正在运行），自旋一小段时间可以省掉两次系统调用
+        for (int i = 0; i < kSpin; ++i) {
+            if (state_.load(std::memory_order_acquire) == kIdle) return;
+            CPU_RELAX();
+        }
+
+        int s = kMarked;
+        if (!state_.compare_exchange_strong(s, kParked, std::memory_order_acq_rel, std::memory_order_acquire))
+            return;     // 自旋结束时恰好被唤醒
+
+        while (state_.load(std::memory_order_acquire) == kParked)
+            futex_wait(kParked);
+    }
+
+    virtual bool wake() override
+    {
+        int s = state_.load(std::memory_order_acquire);
+        while (s != kIdle) {
+            if (state_.compare_exchange_weak(s, kIdle, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                if (s == kParked) futex_wake();
+                return true;
+            }
+        }
+        return false;
+    }
+#else
     virtual void mark()override
     {
         std::unique_lock<std::mutex> lock(mtx_);
@@ -70,8 +132,7 @@ public:
     virtual void sleep() override
     {
         std::unique_lock<std::mutex> lock(mtx_);
-        waiting_ = true; // 标记为等待状态
-        // 如果回调函数返回值为tru取消等待
+        // waiting_已由mark设置；如果wake发生在sleep之前，这里直接返回
         cv_.wait(lock, [this] { return !waiting_; }); // 等待被唤醒
     }
     virtual bool wake() override
@@ -84,6 +145,7 @@ public:
         cv_.notify_one(); // 唤醒一个等待的线程
         return true; // 返回唤醒成功
     }
+#endif
 
     static bool isInRoutine() { return true; }  // 判断是否在协程中
     static RoutineSwitcherI & clsRef()
@@ -93,15 +155,36 @@ public:
         return static_cast<RoutineSwitcherI &>(pts); // 每个线程都有自己的PThreadSwitcher的引用实例
     }
 
+    /// @brief 进入futex等待前的自旋次数
+    static constexpr int kSpin = 128;
 
 private:
+#if defined(LIBGO_SYS_Linux)
+    enum { kIdle = 0, kMarked = 1, kParked = 2 };
+
+    void futex_wait(int expected)
+    {
+        ::syscall(SYS_futex, reinterpret_cast<int*>(&state_), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    void futex_wake()
+    {
+        ::syscall(SYS_futex, reinterpret_cast<int*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    std::atomic<int> state_{kIdle};
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex requires a plain int");
+#else
     std::mutex mtx_;
     std::condition_variable cv_;
     std::atomic_bool waiting_{false}; // 是否处于等待状态
+#endif
 };
 
 /*
  * @brief RoutineSyncPolicy 类是一个策略模式的实现，用于在不同的协程 / 线程环境中选择合适的上下文切换器
+ * 运行期注册：切换器通过RegisterSwitcher注册，ClsRef/IsInPThread经函数指针分派，mark/sleep/wake为虚函数调用。
+ * 函数指针初始指向引导函数，第一次调用时执行routine_sync_init_callback，之后热路径上不再有初始化检查。
  */
 
 class RoutineSyncPolicy
@@ -114,42 +197,68 @@ public:
             return false;
 
         refOverlappedLevel() = overlappedLevel; // 设置当前协程切换器的优先级
-        clsRefFunction() = &RoutineSyncPolicy::clsRef_T<Switchers...>;
-        isInPThreadFunction() = &RoutineSyncPolicy::isInPThread_T<Switchers...>;
+        clsRefFunction().store(&RoutineSyncPolicy::clsRef_T<Switchers...>, std::memory_order_release);
+        isInPThreadFunction().store(&RoutineSyncPolicy::isInPThread_T<Switchers...>, std::memory_order_release);
         return true;
     }
     static RoutineSwitcherI& ClsRef()
     {
-        static bool dummy = (routine_sync_init_callback(), true);
-        (void)dummy;
-        return clsRefFunction()();
+        return clsRefFunction().load(std::memory_order_acquire)();
     }
     static bool IsInPThread()
     {
-        static bool dummy = (routine_sync_init_callback(), true);  // 确保初始化回调函数被调用并且只执行一次
-        (void)dummy;
-        return isInPThreadFunction()();
+        return isInPThreadFunction().load(std::memory_order_acquire)();
     }
 
+    ALWAYS_INLINE static void Mark(RoutineSwitcherI & sw) { sw.mark(); }
+    ALWAYS_INLINE static void Sleep(RoutineSwitcherI & sw) { sw.sleep(); }
+    ALWAYS_INLINE static bool Wake(RoutineSwitcherI & sw) { return sw.wake(); }
+
 private:
-    typedef std::function<RoutineSwitcherI& ()> ClsRefFunction;  // 获取当前协程的切换器引用函数类型
-    typedef std::function<bool()> IsInPThreadFunction; // 判断当前是否在协程中的函数类型
+    typedef RoutineSwitcherI& (*ClsRefFunction)();  // 获取当前协程的切换器引用函数类型
+    typedef bool (*IsInPThreadFunction)(); // 判断当前是否在协程中的函数类型
 
     static int& refOverlappedLevel() {
         static int lv = -1;
         return lv;
     }
 
-    static ClsRefFunction & clsRefFunction() {
-        static ClsRefFunction fn;
+    // 常量初始化，不需要线程安全的局部静态变量检查
+    static std::atomic<ClsRefFunction> & clsRefFunction() {
+        static std::atomic<ClsRefFunction> fn{&RoutineSyncPolicy::bootstrapClsRef};
         return fn;
     }
 
-    static IsInPThreadFunction & isInPThreadFunction() {
-        static IsInPThreadFunction fn;
+    static std::atomic<IsInPThreadFunction> & isInPThreadFunction() {
+        static std::atomic<IsInPThreadFunction> fn{&RoutineSyncPolicy::bootstrapIsInPThread};
         return fn;
     }
 
+    /// 只执行一次：由初始化回调注册协程切换器，没有注册时退回PThreadSwitcher
+    static void init() {
+        static bool dummy = (routine_sync_init_callback(), fallback(), true);
+        (void)dummy;
+    }
+
+    static void fallback() {
+        ClsRefFunction clsRef = &RoutineSyncPolicy::bootstrapClsRef;
+        clsRefFunction().compare_exchange_strong(clsRef, &PThreadSwitcher::clsRef, std::memory_order_acq_rel);
+        IsInPThreadFunction inPThread = &RoutineSyncPolicy::bootstrapIsInPThread;
+        isInPThreadFunction().compare_exchange_strong(inPThread, &RoutineSyncPolicy::alwaysInPThread, std::memory_order_acq_rel);
+    }
+
+    static RoutineSwitcherI& bootstrapClsRef() {
+        init();
+        return clsRefFunction().load(std::memory_order_acquire)();
+    }
+
+    static bool bootstrapIsInPThread() {
+        init();
+        return isInPThreadFunction().load(std::memory_order_acquire)();
+    }
+
+    static bool alwaysInPThread() { return true; }
+
     template <typename S1, typename S2, typename ... Switchers>
     inline static RoutineSwitcherI& clsRef_T() {
         if (S1::isInRoutine()) {  // 如果S1的切换器在协程中
@@ -188,6 +297,52 @@ private:
 
 };
 
+/*
+ * @brief 编译期绑定切换器类型的同步策略
+ * 热路径上没有初始化检查、std::function和虚函数：ClsRef是一次S::current()直接调用，
+ * mark/sleep/wake按isPThread()分派到S或PThreadSwitcher的非虚调用。
+ * @tparam S final切换器类型，提供static S* current()：在S的routine中返回其切换器，否则返回nullptr
+ */
+template <typename S>
+struct StaticRoutineSyncPolicy
+{
+    static_assert(std::is_final<S>::value, "switcher must be final to be dispatched statically");
+
+    ALWAYS_INLINE static RoutineSwitcherI& ClsRef()
+    {
+        S* sw = S::current();
+        return sw ? static_cast<RoutineSwitcherI&>(*sw) : PThreadSwitcher::clsRef();
+    }
+
+    ALWAYS_INLINE static bool IsInPThread()
+    {
+        return !S::current();
+    }
+
+    ALWAYS_INLINE static void Mark(RoutineSwitcherI & sw)
+    {
+        if (sw.isPThread())
+            static_cast<PThreadSwitcher&>(sw).PThreadSwitcher::mark();
+        else
+            static_cast<S&>(sw).S::mark();
+    }
+
+    ALWAYS_INLINE static void Sleep(RoutineSwitcherI & sw)
+    {
+        if (sw.isPThread())
+            static_cast<PThreadSwitcher&>(sw).PThreadSwitcher::sleep();
+        else
+            static_cast<S&>(sw).S::sleep();
+    }
+
+    ALWAYS_INLINE static bool Wake(RoutineSwitcherI & sw)
+    {
+        if (sw.isPThread())
+            return static_cast<PThreadSwitcher&>(sw).PThreadSwitcher::wake();
+        return static_cast<S&>(sw).S::wake();
+    }
+};
+
 }
 
 #endif //GOCOROUTINE_SWITCHER_H
@@ -0,0 +1,28 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_SYNC_POLICY_H
+#define GOCOROUTINE_SYNC_POLICY_H
+
+#pragma once
+#include "switcher.h"
+#include <task/task_switcher.h>
+
+namespace cxk
+{
+
+/*
+ * @brief 同步原语（rutex及其上层）默认使用的切换器策略
+ * 默认在编译期绑定调度器的TaskSwitcher；需要通过RoutineSyncPolicy::RegisterSwitcher接入其他协程库时，
+ * 定义ROUTINE_SYNC_DYNAMIC_POLICY改为运行期分派。
+ */
+#if defined(ROUTINE_SYNC_DYNAMIC_POLICY)
+typedef RoutineSyncPolicy DefaultSyncPolicy;
+#else
+typedef StaticRoutineSyncPolicy<TaskSwitcher> DefaultSyncPolicy;
+#endif
+
+} // cxk
+
+#endif //GOCOROUTINE_SYNC_POLICY_H
@@ -0,0 +1,95 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_TIMER_H
+#define GOCOROUTINE_TIMER_H
+#pragma once
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <common/clock.h>
+#include "timer_wheel.h"
+
+namespace cxk
+{
+
+/*
+ * @brief 同步原语使用的定时器，用于rutex等原语的超时唤醒
+ * 在Processor线程中（协程内）使用该Processor的TimerWheel，由调度循环驱动；
+ * 其他线程使用一个由后台线程驱动的共享TimerWheel。
+ * 时间统一通过FastSteadyClock读取。回调在驱动线程中执行，必须足够轻量。
+ */
+class RoutineSyncTimer
+{
+public:
+    typedef FastSteadyClock clock_type;
+    typedef TimerWheel::time_point time_point;
+    typedef TimerWheel::func_type func_type;
+    typedef TimerWheel::Element TimerElement;
+
+    static RoutineSyncTimer& getInstance()
+    {
+        // 不析构：进程退出时可能仍有等待者
+        static RoutineSyncTimer* obj = new RoutineSyncTimer;
+        return *obj;
+    }
+
+    /// @brief 在abstime时刻执行fn
+    void schedule(TimerElement& element, time_point abstime, func_type const& fn)
+    {
+        TimerWheel* wheel = TimerWheel::Local();
+        if (wheel) {
+            wheel->Schedule(element, abstime, fn);
+            return ;
+        }
+
+        wheel_.Schedule(element, abstime, fn);
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            ++seq_;
+        }
+        cv_.notify_one();
+    }
+
+    /**
+     * @brief 取消定时任务，如果回调正在执行则等待其执行完毕
+     * @return true: 取消成功，回调不会执行；false: 回调已经执行
+     */
+    bool join_unschedule(TimerElement& element)
+    {
+        return TimerWheel::Cancel(element);
+    }
+
+private:
+    RoutineSyncTimer()
+    {
+        FastSteadyClock::StartCalibration();
+        std::thread([this]{ this->run(); }).detach();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        for (;;) {
+            uint64_t seq = seq_;
+            lock.unlock();
+            wheel_.Advance(clock_type::now());
+            std::chrono::nanoseconds timeout = std::min<std::chrono::nanoseconds>(
+                    wheel_.NextTimeout(), std::chrono::seconds(1));
+            lock.lock();
+            cv_.wait_for(lock, timeout, [&]{ return seq_ != seq; });
+        }
+    }
+
+    TimerWheel wheel_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    uint64_t seq_ = 0;   ///< 每次schedule递增，驱动线程据此判断是否需要重新计算休眠时间
+};
+
+} // namespace cxk
+
+#endif //GOCOROUTINE_TIMER_H
@@ -0,0 +1,267 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_TIMER_WHEEL_H
+#define GOCOROUTINE_TIMER_WHEEL_H
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <common/clock.h>
+#include "linked_list.h"
+#include "spinlock.h"
+
+namespace cxk
+{
+
+/*
+ * @brief 分层时间轮（4层：256 + 64 * 3个槽，每个tick 1ms，单层跨度约18.6小时，更远的定时器逐层重新下沉）
+ *
+ * 插入/取消都是O(1)的链表操作，不分配内存，适合"几乎每次RPC都设置超时、且绝大多数不会触发"的场景。
+ * 每个Processor持有一个实例，由所属线程在调度循环中Advance驱动（通过Local()找到当前线程的实例）；
+ * Schedule/Cancel可以在任意线程调用，但驱动线程只在自己的调度循环中检查到期，
+ * 因此其他线程向它Schedule时需要自行唤醒驱动线程。
+ * 回调在驱动线程中、锁外执行，必须足够轻量。同一个Element在回调执行或Cancel之前不能再次Schedule。
+ */
+class TimerWheel
+{
+public:
+    typedef std::chrono::steady_clock::time_point time_point;
+    typedef std::function<void()> func_type;
+
+    static constexpr int64_t kTickNs = 1000 * 1000;     ///< tick精度 1ms
+    static constexpr int kRootBits = 8;
+    static constexpr int kLevelBits = 6;
+    static constexpr int kLevels = 4;
+    static constexpr int64_t kRootSize = 1 << kRootBits;
+    static constexpr int64_t kLevelSize = 1 << kLevelBits;
+    static constexpr int64_t kMaxDelta = ((int64_t)1 << (kRootBits + kLevelBits * (kLevels - 1))) - 1;
+
+    /// @brief 定时任务节点，由调用者持有（通常位于等待者的栈上）
+    struct Element : public LinkedNode
+    {
+        enum { idle, pending, firing };
+
+        func_type fn_;
+        int64_t expire_ = 0;                ///< 到期tick
+        LinkedList* slot_ = nullptr;        ///< 所在槽
+        TimerWheel* wheel_ = nullptr;       ///< 最近一次Schedule的时间轮
+        std::atomic<int> state_{idle};
+    };
+
+    TimerWheel() = default;
+    TimerWheel(TimerWheel const&) = delete;
+    TimerWheel& operator=(TimerWheel const&) = delete;
+
+    /// @brief 当前线程驱动的时间轮，不在Processor中为nullptr
+    static TimerWheel* & Local()
+    {
+        static thread_local TimerWheel* wheel = nullptr;
+        return wheel;
+    }
+
+    /// @brief 在abstime时刻执行fn
+    void Schedule(Element & element, time_point abstime, func_type const& fn)
+    {
+        std::unique_lock<LFLock> lock(lock_);
+        if (count_.load(std::memory_order_relaxed) == 0) {
+            // 空闲期间没有推进，直接跳到当前时刻（调度tick精度即可），避免Advance逐tick追赶
+            int64_t now = FloorTick(FastSteadyClock::coarse_now());
+            if (now > current_) current_ = now;
+        }
+
+        element.fn_ = fn;
+        element.expire_ = CeilTick(abstime);
+        element.wheel_ = this;
+        element.state_.store(Element::pending, std::memory_order_relaxed);
+        Insert(&element);
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 取消定时任务，如果回调正在执行则等待其执行完毕
+     * @return true: 取消成功，回调不会执行；false: 回调已经执行（或从未Schedule）
+     */
+    static bool Cancel(Element & element)
+    {
+        TimerWheel* wheel = element.wheel_;
+        if (!wheel) return false;
+
+        {
+            std::unique_lock<LFLock> lock(wheel->lock_);
+            if (element.state_.load(std::memory_order_relaxed) == Element::pending) {
+                element.slot_->unlink(&element);
+                element.slot_ = nullptr;
+                element.state_.store(Element::idle, std::memory_order_relaxed);
+                element.fn_ = func_type();
+                wheel->count_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        while (element.state_.load(std::memory_order_acquire) == Element::firing)
+            std::this_thread::yield();
+        return false;
+    }
+
+    /**
+     * @brief 推进到now，执行所有到期的回调（仅驱动线程）
+     * @return 执行的回调数量
+     */
+    std::size_t Advance(time_point now)
+    {
+        if (Empty()) return 0;
+
+        int64_t target = FloorTick(now);
+        LinkedList expired;
+        {
+            std::unique_lock<LFLock> lock(lock_);
+            while (current_ < target && count_.load(std::memory_order_relaxed) != 0) {
+                ++current_;
+                int64_t idx = current_ & (kRootSize - 1);
+                if (idx == 0) Cascade(1);
+                Drain(root_[idx], expired);
+            }
+            if (count_.load(std::memory_order_relaxed) == 0 && current_ < target)
+                current_ = target;
+        }
+
+        std::size_t c = 0;
+        LinkedNode* node = expired.front();
+        while (node) {
+            Element* element = static_cast<Element*>(node);
+            LinkedNode* next = node->next;
+            node->prev = node->next = nullptr;
+
+            func_type fn;
+            fn.swap(element->fn_);
+            fn();
+            element->state_.store(Element::idle, std::memory_order_release); // 之后element可能已失效
+            ++c;
+            node = next;
+        }
+        return c;
+    }
+
+    /// @brief 距离下一次需要Advance的时间（驱动线程用来决定休眠多久），没有定时器时返回max
+    std::chrono::nanoseconds NextTimeout()
+    {
+        std::unique_lock<LFLock> lock(lock_);
+        if (count_.load(std::memory_order_relaxed) == 0)
+            return std::chrono::nanoseconds::max();
+
+        // 只扫描根层到本轮结束；更高层的定时器在根层回绕时下沉，届时再计算
+        int64_t end = (current_ | (kRootSize - 1)) + 1;
+        int64_t tick = current_ + 1;
+        for (; tick < end; ++tick) {
+            if (root_[tick & (kRootSize - 1)].front())
+                break;
+        }
+
+        int64_t deadline = tick * kTickNs;
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                FastSteadyClock::now().time_since_epoch()).count();
+        return std::chrono::nanoseconds(deadline > now ? deadline - now : 0);
+    }
+
+    ALWAYS_INLINE bool Empty() const
+    {
+        return count_.load(std::memory_order_relaxed) == 0;
+    }
+
+    ALWAYS_INLINE std::size_t Size() const
+    {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static int64_t FloorTick(time_point tp)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count() / kTickNs;
+    }
+
+    /// 向上取整，保证不会提前触发
+    static int64_t CeilTick(time_point tp)
+    {
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+        return (ns + kTickNs - 1) / kTickNs;
+    }
+
+    /// 按到期时间放入对应层的槽（锁内）
+    void Insert(Element* element)
+    {
+        int64_t delta = element->expire_ - current_;
+        int64_t expire = element->expire_;
+        if (delta <= 0) {
+            expire = current_ + 1;  // 已经到期，下一个tick触发
+            delta = 1;
+        } else if (delta > kMaxDelta) {
+            expire = current_ + kMaxDelta;  // 超出范围，先放在最高层，下沉时按真实时间重新插入
+            delta = kMaxDelta;
+        }
+
+        LinkedList* slot;
+        if (delta < kRootSize) {
+            slot = &root_[expire & (kRootSize - 1)];
+        } else {
+            int level = 1;
+            while (level < kLevels - 1 && delta >= ((int64_t)1 << (kRootBits + kLevelBits * level)))
+                ++level;
+            int shift = kRootBits + kLevelBits * (level - 1);
+            slot = &levels_[level - 1][(expire >> shift) & (kLevelSize - 1)];
+        }
+        slot->push(element);
+        element->slot_ = slot;
+    }
+
+    /// 根层回绕：把第level层当前槽的定时器重新插入到更低的层（锁内）
+    void Cascade(int level)
+    {
+        int shift = kRootBits + kLevelBits * (level - 1);
+        int64_t idx = (current_ >> shift) & (kLevelSize - 1);
+        if (idx == 0 && level < kLevels - 1)
+            Cascade(level + 1);
+
+        LinkedList & slot = levels_[level - 1][idx];
+        LinkedNode* node = slot.front();
+        slot.clear();
+        while (node) {
+            LinkedNode* next = node->next;
+            Insert(static_cast<Element*>(node));
+            node = next;
+        }
+    }
+
+    /// 把槽中到期的定时器移到expired（锁内）
+    void Drain(LinkedList & slot, LinkedList & expired)
+    {
+        LinkedNode* node = slot.front();
+        slot.clear();
+        while (node) {
+            LinkedNode* next = node->next;
+            Element* element = static_cast<Element*>(node);
+            if (element->expire_ <= current_) {
+                element->slot_ = nullptr;
+                element->state_.store(Element::firing, std::memory_order_relaxed);
+                count_.fetch_sub(1, std::memory_order_relaxed);
+                expired.push(element);
+            } else {
+                Insert(element);    // 超出范围的远期定时器
+            }
+            node = next;
+        }
+    }
+
+    LFLock lock_;
+    int64_t current_ = 0;                       ///< 已经处理到的tick
+    std::atomic<std::size_t> count_{0};
+    LinkedList root_[kRootSize];
+    LinkedList levels_[kLevels - 1][kLevelSize];
+};
+
+} // namespace cxk
+
+#endif //GOCOROUTINE_TIMER_WHEEL_H
@@ -6,27 +6,63 @@
 #define GOCOROUTINE_CONTEXT_H
 #include <utils/utils.h>
 #include "fcontext.h"
+#include "stack_pool.h"
+#include "shared_stack.h"
+#include <cassert>
+#include <cstdlib>
+#include <unistd.h>
 
 namespace cxk
 {
 
+/*
+ * @brief 协程上下文
+ * 默认持有一块私有栈；sharedStack为true时不分配栈，第一次运行前由Processor绑定到一块共享栈上
+ * （BindSharedStack），切出期间栈的活跃部分保存在按需大小的堆缓冲区里（见SharedStack）。
+ */
 class Context
 {
 public:
-    explicit Context(fn_t fn, intptr_t vp, uint32_t stackSize = 0)
-        : fn_(fn), vp_(vp), stackSize_(stackSize)
+    explicit Context(fn_t fn, intptr_t vp, uint32_t stackSize = 0, bool sharedStack = false)
+        : fn_(fn), vp_(vp), stackSize_(stackSize ? stackSize : (uint32_t)StackPool::DefaultStackSize()),
+          sharedMode_(sharedStack)
     {
-        stack_ = static_cast<char*>(StackTraits::MallocFunc()(stackSize_));
+        if (sharedMode_) {
+            // 共享栈模式：栈和初始上下文在绑定并第一次切入时才建立
+            stackSize_ = 0;
+            return ;
+        }
+
+        if (StackTraits::MallocFunc() == &::std::malloc) {
+            // 默认分配器：从栈池获取（mmap分配，保护页在栈创建时已设置并随栈复用）
+            block_ = StackPool::getInstance().Allocate(stackSize_);
+            stack_ = block_->stack_;
+            stackSize_ = (uint32_t)block_->stackSize_;
+        } else {
+            // 用户自定义了分配函数：保持原有的逐个分配 + mprotect行为
+            stack_ = static_cast<char*>(StackTraits::MallocFunc()(stackSize_));
+            int protectPage = StackTraits::GetProtectStackPageSize();
+            if (protectPage>0) {  // 如果保护页大小大于0，则保护栈
+                StackTraits::ProtectStack(stack_, stackSize_, protectPage); // 使用时从高地址向低地址增长，保护栈的前protectPage个字节
+                protectPage_ = protectPage;
+            }
+        }
         // 创建协程上下文（栈顶位于高地址，栈向下增长）返回低地址内容
         ctx_ = libgo_make_fcontext(stack_ + stackSize_, stackSize_, fn_);
-        int protectPage = StackTraits::GetProtectStackPageSize();
-        if (protectPage>0) {  // 如果保护页大小大于0，则保护栈
-            StackTraits::ProtectStack(stack_, stackSize_, protectPage); // 使用时从高地址向低地址增长，保护栈的前protectPage个字节
-            protectPage_ = protectPage;
-        }
     }
     ~Context() {
-        if (stack_) {
+        if (saved_) {
+            std::free(saved_);
+            saved_ = nullptr;
+        }
+        if (sharedMode_) {
+            // 共享栈归Processor所有
+            stack_ = nullptr;
+        } else if (block_) {
+            StackPool::getInstance().Free(block_);
+            block_ = nullptr;
+            stack_ = nullptr;
+        } else if (stack_) {
             // 1. 取消栈保护
             if (protectPage_) {
                 StackTraits::UnprotectStack(stack_, protectPage_);
@@ -38,10 +74,13 @@ public:
     }
 
     ALWAYS_INLINE void SwapIn() {
+        if (shared_) shared_->Acquire(this);  // 在调度栈上完成共享栈内容的换入换出
         libgo_jump_fcontext(&GetTlsContext(), ctx_, vp_);
     }
 
+    /// @brief 直接切换到other（两者都不能使用共享栈：切换发生在协程栈上，无法换入换出）
     ALWAYS_INLINE void SwapTo(Context & other) {
+        assert(!sharedMode_ && !other.sharedMode_);
         libgo_jump_fcontext(&ctx_, other.ctx_, other.vp_);
     }
 
@@ -54,13 +93,94 @@ public:
         return tls_context;
     }
 
+    /// @brief 是否使用共享栈
+    ALWAYS_INLINE bool IsSharedStack() const { return sharedMode_; }
+
+    /// @brief 使用共享栈但尚未绑定（还没有运行过），可以在任意Processor上开始运行
+    ALWAYS_INLINE bool NeedBindStack() const { return sharedMode_ && !shared_; }
+
+    /// @brief 已绑定的共享栈，私有栈或尚未绑定时返回nullptr
+    ALWAYS_INLINE SharedStack* GetSharedStack() const { return shared_; }
+
+    /// @brief 绑定共享栈，第一次SwapIn之前由运行它的Processor调用
+    ALWAYS_INLINE void BindSharedStack(SharedStack* stack) {
+        assert(NeedBindStack());
+        shared_ = stack;
+        stack_ = stack->Base();
+        stackSize_ = (uint32_t)stack->Size();
+    }
+
+    /// @brief 协程执行完毕，放弃共享栈的占用（其内容不再需要保存）
+    ALWAYS_INLINE void ReleaseSharedStack() {
+        if (shared_) shared_->Release(this);
+    }
+
+    /// @brief 切出期间保存栈内容的堆缓冲区大小（字节）
+    ALWAYS_INLINE std::size_t SavedStackCapacity() const { return savedCap_; }
+
+    /// @brief 栈容量（共享栈模式为绑定的共享栈大小，未绑定时为0）
+    ALWAYS_INLINE std::size_t StackCapacity() const { return stackSize_; }
+
+    /// @brief 栈的低地址端（共享栈模式为绑定的共享栈，未绑定时为nullptr）
+    ALWAYS_INLINE char* StackLow() const { return stack_; }
+
+    /// @brief 栈的高地址端（栈底），未绑定共享栈时为nullptr
+    ALWAYS_INLINE char* StackHigh() const { return stack_ ? stack_ + stackSize_ : nullptr; }
+
+    /// @brief 切出时的栈深度：栈顶到保存的栈指针，只能在切出状态下调用
+    ALWAYS_INLINE std::size_t SwitchDepth() const {
+        return stack_ ? (std::size_t)(stack_ + stackSize_ - (char*)ctx_) : 0;
+    }
+
+    /**
+     * @brief 用花纹填充私有栈中初始栈指针以下的部分，之后ScanStackUsage找出最深的写入位置
+     * 只能在第一次SwapIn之前调用。会让整块栈提交物理内存，只用于采样的协程。
+     */
+    __attribute__((no_sanitize_address)) void FillStackPattern() {
+        if (sharedMode_ || !stack_) return;
+        char* low = stack_;
+        if (protectPage_)   // 自定义分配器：跳过可能被保护的低地址页
+            low += (protectPage_ + 1) * getpagesize();
+        char* high = (char*)ctx_;
+        low = (char*)(((uintptr_t)low + 7) & ~(uintptr_t)7);
+        high = (char*)((uintptr_t)high & ~(uintptr_t)7);
+        if (low >= high) return;
+        for (uint64_t* p = (uint64_t*)low; p < (uint64_t*)high; ++p)
+            *p = kStackPattern;
+        probeLow_ = low;
+    }
+
+    /// @brief 最大栈使用量（字节），FillStackPattern之后有效，否则返回0
+    __attribute__((no_sanitize_address)) std::size_t ScanStackUsage() const {
+        if (!probeLow_) return 0;
+        uint64_t const* p = (uint64_t const*)probeLow_;
+        uint64_t const* high = (uint64_t const*)(stack_ + stackSize_);
+        while (p < high && *p == kStackPattern)
+            ++p;
+        return (std::size_t)(stack_ + stackSize_ - (char const*)p);
+    }
+
 private:
+    friend class SharedStack;   ///< 换入换出时直接读写栈指针和保存缓冲区
+
+    static constexpr uint64_t kStackPattern = 0xC5A5C5A5C5A5C5A5ull;   ///< 栈使用量探测的填充花纹
+
     fcontext_t ctx_;
     fn_t fn_;
     intptr_t vp_;
     char *stack_ = nullptr;
+    StackBlock *block_ = nullptr;   ///< 栈池分配的栈块（自定义分配器时为空）
     uint32_t stackSize_ = 0;
     int protectPage_ = 0;
+
+    bool sharedMode_ = false;       ///< 使用共享栈
+    bool started_ = false;          ///< 共享栈模式：是否已在栈上建立初始上下文
+    SharedStack* shared_ = nullptr; ///< 绑定的共享栈
+    char* saved_ = nullptr;         ///< 切出期间保存的栈内容
+    std::size_t savedSize_ = 0;
+    std::size_t savedCap_ = 0;
+
+    char* probeLow_ = nullptr;      ///< 栈使用量探测：填充区域的低地址，未填充为nullptr
 };
 
 }
@@ -3,10 +3,12 @@
 //
 
 #include "fcontext.h"
+#include <debug/async_log.h>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 #include <sys/mman.h>
-#include <spdlog/spdlog.h>
 
 #define PAGE_SIZE 0x1000 // 4096 bytes, typical page size on Linux
 
@@ -61,10 +63,10 @@ bool cxk::StackTraits::ProtectStack(void *stack, std::size_t size, int pageNum)
 #define PROT_EXEC	0x4		*//* Page can be executed.  *//*
 #define PROT_NONE	0x0		*//* Page can not be accessed.  */
     if (mprotect(protect_page_addr, pageNum * PAGE_SIZE, PROT_NONE) == -1) {
-        spdlog::error("Failed to protect stack at {}: {}", protect_page_addr, strerror(errno));
+        CO_ASYNC_LOG(cxk::LogLevel::error, "Failed to protect stack at %p: %s", protect_page_addr, strerror(errno));
         return false; // 如果保护失败，返回false
     }else {
-        spdlog::info("Protected stack at {} with {} pages", protect_page_addr, pageNum);
+        CO_ASYNC_LOG(cxk::LogLevel::info, "Protected stack at %p with %d pages", protect_page_addr, pageNum);
         return true; // 如果保护成功，返回true
     }
     return false;
@@ -82,9 +84,9 @@ void cxk::StackTraits::UnprotectStack(void *stack, int pageNum)
                               stack; // 对齐地址：直接使用
 
     if (mprotect(protect_page_addr, pageNum * PAGE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC) == -1) {
-        spdlog::error("Failed to unprotect stack at {}: {}", protect_page_addr, strerror(errno));
+        CO_ASYNC_LOG(cxk::LogLevel::error, "Failed to unprotect stack at %p: %s", protect_page_addr, strerror(errno));
     } else {
-        spdlog::info("Unprotected stack at {} with {} pages", protect_page_addr, pageNum);
+        CO_ASYNC_LOG(cxk::LogLevel::info, "Unprotected stack at %p with %d pages", protect_page_addr, pageNum);
     }
 
 }
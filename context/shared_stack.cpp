@@ -0,0 +1,120 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "shared_stack.h"
+#include "context.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__)
+# define SHARED_STACK_ASAN 1
+#elif defined(__has_feature)
+# if __has_feature(address_sanitizer)
+#  define SHARED_STACK_ASAN 1
+# endif
+#endif
+
+#if defined(SHARED_STACK_ASAN)
+# include <sanitizer/asan_interface.h>
+#endif
+
+namespace cxk
+{
+
+SharedStack::SharedStack(std::size_t size)
+    : block_(StackPool::getInstance().Allocate(size))
+{
+}
+
+SharedStack::~SharedStack()
+{
+    StackPool::getInstance().Free(block_);
+}
+
+std::size_t& SharedStack::DefaultStackSize()
+{
+    static std::size_t size = 1024 * 1024;
+    return size;
+}
+
+std::size_t& SharedStack::StacksPerProcessor()
+{
+    static std::size_t count = 4;
+    return count;
+}
+
+namespace
+{
+
+/// 缩小保存缓冲区的容差，避免栈深度小幅抖动时反复分配
+constexpr std::size_t kSavedSlack = 512;
+
+#if defined(SHARED_STACK_ASAN)
+/// 栈上有其他帧留下的redzone标记，ASan下不能用被拦截的memcpy整段拷贝
+__attribute__((no_sanitize_address)) void CopyStack(char* dst, char const* src, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        dst[i] = src[i];
+}
+#else
+ALWAYS_INLINE void CopyStack(char* dst, char const* src, std::size_t n)
+{
+    memcpy(dst, src, n);
+}
+#endif
+
+} // namespace
+
+void SharedStack::Switch(Context* ctx)
+{
+    // 先换出占用者再建立/恢复ctx的内容：两者可能覆盖栈上的同一段地址
+    if (occupant_) {
+        // 活跃部分: [栈指针, 栈顶)；缓冲区按需大小，不够或者大出一倍以上时重新分配
+        Context* old = occupant_;
+        std::size_t size = (std::size_t)(Top() - (char*)old->ctx_);
+        if (size > old->savedCap_ || old->savedCap_ > 2 * size + kSavedSlack) {
+            char* buf = static_cast<char*>(std::malloc(size));
+            if (!buf) throw std::bad_alloc();
+            std::free(old->saved_);
+            old->saved_ = buf;
+            old->savedCap_ = size;
+        }
+        CopyStack(old->saved_, (char*)old->ctx_, size);
+        old->savedSize_ = size;
+    }
+    occupant_ = ctx;
+
+#if defined(SHARED_STACK_ASAN)
+    // 影子内存属于上一个占用者的栈帧，清掉以免误报
+    ASAN_UNPOISON_MEMORY_REGION(Base(), Size());
+#endif
+
+    if (!ctx->started_) {
+        // 第一次运行：在栈顶建立初始上下文
+        ctx->ctx_ = libgo_make_fcontext(Top(), Size(), ctx->fn_);
+        ctx->started_ = true;
+        return ;
+    }
+    CopyStack(Top() - ctx->savedSize_, ctx->saved_, ctx->savedSize_);
+}
+
+SharedStackGroup::~SharedStackGroup()
+{
+    for (SharedStack* stack : stacks_)
+        delete stack;
+}
+
+SharedStack* SharedStackGroup::Next()
+{
+    std::size_t count = std::max<std::size_t>(SharedStack::StacksPerProcessor(), 1);
+    if (stacks_.size() < count) {
+        stacks_.push_back(new SharedStack(SharedStack::DefaultStackSize()));
+        return stacks_.back();
+    }
+    return stacks_[next_++ % stacks_.size()];
+}
+
+} // namespace cxk
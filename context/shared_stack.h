@@ -0,0 +1,85 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_SHARED_STACK_H
+#define GOCOROUTINE_SHARED_STACK_H
+#pragma once
+#include <utils/utils.h>
+#include "stack_pool.h"
+#include <cstddef>
+#include <vector>
+
+namespace cxk
+{
+
+class Context;
+
+/*
+ * @brief 共享栈（copy-stack）
+ * 一组协程轮流运行在同一块大栈上。切入的协程不是当前占用者时，先把占用者的活跃部分
+ * （保存的栈指针到栈顶）拷贝到占用者自己的按需大小的堆缓冲区，再把切入协程保存的内容拷回原地址。
+ * 协程在同一块栈的同一地址上恢复，因此栈上对象的地址在切换前后保持不变。
+ *
+ * 只由所属Processor的工作线程在调度栈上访问，不加锁；绑定后协程只能在这个Processor上运行。
+ */
+class SharedStack
+{
+public:
+    explicit SharedStack(std::size_t size);
+    ~SharedStack();
+
+    SharedStack(SharedStack const&) = delete;
+    SharedStack& operator=(SharedStack const&) = delete;
+
+    ALWAYS_INLINE char* Base() const { return block_->stack_; }
+    ALWAYS_INLINE char* Top() const { return block_->stack_ + block_->stackSize_; }
+    ALWAYS_INLINE std::size_t Size() const { return block_->stackSize_; }
+
+    /// @brief 让ctx占用本栈（切入ctx之前调用）
+    ALWAYS_INLINE void Acquire(Context* ctx) {
+        if (occupant_ != ctx) Switch(ctx);
+    }
+
+    /// @brief ctx执行完毕，放弃占用（不再保存它的栈内容）
+    ALWAYS_INLINE void Release(Context* ctx) {
+        if (occupant_ == ctx) occupant_ = nullptr;
+    }
+
+    /// @brief 共享栈大小，默认1MB
+    static std::size_t& DefaultStackSize();
+
+    /// @brief 每个Processor的共享栈数量，默认4
+    static std::size_t& StacksPerProcessor();
+
+private:
+    void Switch(Context* ctx);
+
+    StackBlock* block_;
+    Context* occupant_ = nullptr;   ///< 栈上当前保存着谁的内容
+};
+
+/*
+ * @brief 一个Processor的共享栈组
+ * 第一次使用时才分配；新协程轮流绑定到组内的栈上，减少同一块栈上的换入换出。
+ */
+class SharedStackGroup
+{
+public:
+    SharedStackGroup() = default;
+    ~SharedStackGroup();
+
+    SharedStackGroup(SharedStackGroup const&) = delete;
+    SharedStackGroup& operator=(SharedStackGroup const&) = delete;
+
+    /// @brief 选择一块供新协程绑定的共享栈
+    SharedStack* Next();
+
+private:
+    std::vector<SharedStack*> stacks_;
+    std::size_t next_ = 0;
+};
+
+} // namespace cxk
+
+#endif //GOCOROUTINE_SHARED_STACK_H
@@ -0,0 +1,336 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+
+#include "stack_pool.h"
+#include "fcontext.h"
+#include <common/numa.h>
+#include <new>
+#include <mutex>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <spdlog/spdlog.h>
+
+namespace cxk
+{
+
+/*
+ * @brief 线程本地栈缓存，每个尺寸等级一个单链表
+ * 线程退出时把缓存的栈全部归还到全局链表
+ */
+struct StackPool::ThreadCache
+{
+    StackBlock* heads_[kSizeClasses] = {};
+    std::size_t counts_[kSizeClasses] = {};
+
+    ~ThreadCache()
+    {
+        for (int i = 0; i < kSizeClasses; ++i) {
+            if (heads_[i]) {
+                StackPool::getInstance().PushGlobal(i, heads_[i]);
+                heads_[i] = nullptr;
+                counts_[i] = 0;
+            }
+        }
+    }
+};
+
+StackPool& StackPool::getInstance()
+{
+    // 不析构：进程退出时线程缓存的析构和仍在运行的线程还会归还栈
+    static StackPool* obj = new StackPool;
+    return *obj;
+}
+
+StackPool::StackPool()
+    : nodes_((int)NumaTopology::getInstance().NodeCount()),
+      globals_(new GlobalList[NumaTopology::getInstance().NodeCount() * kSizeClasses])
+{
+}
+
+StackPool::ThreadCache& StackPool::GetThreadCache()
+{
+    static thread_local ThreadCache tc;
+    return tc;
+}
+
+std::size_t& StackPool::DefaultStackSize()
+{
+    static std::size_t size = 128 * 1024;
+    return size;
+}
+
+std::size_t& StackPool::HighWaterBytes()
+{
+    static std::size_t bytes = 64 * 1024 * 1024;
+    return bytes;
+}
+
+std::size_t& StackPool::MaxCachedBytes()
+{
+    static std::size_t bytes = 1024 * 1024 * 1024;
+    return bytes;
+}
+
+std::size_t& StackPool::ThreadCacheCount()
+{
+    static std::size_t count = 16;
+    return count;
+}
+
+int StackPool::SizeClass(std::size_t size)
+{
+    int c = 0;
+    std::size_t classSize = kMinClassSize;
+    while (classSize < size) {
+        classSize <<= 1;
+        if (++c >= kSizeClasses)
+            return -1;
+    }
+    return c;
+}
+
+StackBlock* StackPool::Allocate(std::size_t size)
+{
+    if (size == 0) size = DefaultStackSize();
+
+    int c = SizeClass(size);
+    int node = CurrentNode();
+    if (c < 0) {
+        return Create(size, -1, node); // 超大栈不入池
+    }
+
+    // 1. 线程本地缓存：一次指针弹出
+    ThreadCache& tc = GetThreadCache();
+    StackBlock* block = tc.heads_[c];
+    if (block) {
+        tc.heads_[c] = block->next_;
+        --tc.counts_[c];
+        block->next_ = nullptr;
+        return block;
+    }
+
+    // 2. 全局链表：批量取回一半的缓存上限，减少锁竞争
+    std::size_t batch = ThreadCacheCount() / 2;
+    if (batch == 0) batch = 1;
+    std::size_t got = 0;
+    block = PopGlobal(node, c, batch, got);
+    if (block) {
+        tc.heads_[c] = block->next_;
+        tc.counts_[c] = got - 1;
+        block->next_ = nullptr;
+        return block;
+    }
+
+    // 3. mmap新建
+    return Create(ClassSize(c), c, node);
+}
+
+void StackPool::Free(StackBlock* block)
+{
+    if (!block) return;
+
+    int c = block->sizeClass_;
+    if (c < 0) {
+        Destroy(block);
+        return;
+    }
+
+    // 其他节点创建的栈（协程被窃取到本节点后结束）直接回到所属节点
+    if (nodes_ > 1 && block->node_ != CurrentNode()) {
+        block->next_ = nullptr;
+        PushGlobal(c, block);
+        return;
+    }
+
+    ThreadCache& tc = GetThreadCache();
+    block->next_ = tc.heads_[c];
+    tc.heads_[c] = block;
+    if (++tc.counts_[c] <= ThreadCacheCount())
+        return;
+
+    // 线程缓存溢出：保留一半，其余整体归还全局链表
+    std::size_t keep = ThreadCacheCount() / 2;
+    if (keep == 0) {
+        tc.heads_[c] = nullptr;
+        tc.counts_[c] = 0;
+        PushGlobal(c, block);
+        return;
+    }
+
+    StackBlock* pos = tc.heads_[c];
+    for (std::size_t i = 1; i < keep; ++i)
+        pos = pos->next_;
+    StackBlock* overflow = pos->next_;
+    pos->next_ = nullptr;
+    tc.counts_[c] = keep;
+    PushGlobal(c, overflow);
+}
+
+int StackPool::CurrentNode() const
+{
+    if (nodes_ == 1 || !NumaTopology::Active()) return 0;
+    int node = NumaTopology::CurrentNode();
+    return node < nodes_ ? node : 0;
+}
+
+StackBlock* StackPool::PopGlobal(int node, int sizeClass, std::size_t n, std::size_t& got)
+{
+    got = 0;
+    GlobalList& gl = Global(node, sizeClass);
+    if (!gl.head_.load(std::memory_order_relaxed)) return nullptr;  // 无锁预检查，避免空链表时抢锁
+
+    std::unique_lock<LFLock> lock(gl.lock_);
+    StackBlock* head = gl.head_.load(std::memory_order_relaxed);
+    if (!head) return nullptr;
+
+    StackBlock* tail = head;
+    std::size_t bytes = 0, residentBytes = 0;
+    for (;;) {
+        ++got;
+        bytes += tail->stackSize_;
+        if (tail->resident_) residentBytes += tail->stackSize_;
+        tail->resident_ = true;  // madvise过的栈在首次访问时由内核重新补页
+        if (got >= n || !tail->next_) break;
+        tail = tail->next_;
+    }
+    gl.head_.store(tail->next_, std::memory_order_relaxed);
+    gl.count_ -= got;
+    tail->next_ = nullptr;
+    lock.unlock();
+
+    cachedBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    residentCachedBytes_.fetch_sub(residentBytes, std::memory_order_relaxed);
+    return head;
+}
+
+void StackPool::PushGlobal(int sizeClass, StackBlock* head)
+{
+    // 在锁外完成madvise/munmap等系统调用，只把最终入池的栈串成链表；
+    // 链表中连续的同一节点的栈一起挂到该节点的链表上
+    StackBlock* keepHead = nullptr;
+    StackBlock* keepTail = nullptr;
+    std::size_t keepCount = 0;
+    int keepNode = 0;
+
+    while (head) {
+        StackBlock* block = head;
+        head = head->next_;
+        block->next_ = nullptr;
+
+        if (keepHead && block->node_ != keepNode) {
+            Link(keepNode, sizeClass, keepHead, keepTail, keepCount);
+            keepHead = keepTail = nullptr;
+            keepCount = 0;
+        }
+
+        std::size_t bytes = block->stackSize_;
+        if (cachedBytes_.load(std::memory_order_relaxed) + bytes > MaxCachedBytes()) {
+            Destroy(block);
+            continue;
+        }
+
+        if (residentCachedBytes_.load(std::memory_order_relaxed) + bytes > HighWaterBytes()) {
+            // 超过高水位：保留映射与保护页，仅归还物理内存
+            if (madvise(block->stack_, block->stackSize_, MADV_DONTNEED) == 0) {
+                block->resident_ = false;
+            }
+        }
+
+        cachedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+        if (block->resident_)
+            residentCachedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+
+        if (keepTail) keepTail->next_ = block;
+        else keepHead = block;
+        keepTail = block;
+        keepNode = block->node_;
+        ++keepCount;
+    }
+
+    if (keepHead)
+        Link(keepNode, sizeClass, keepHead, keepTail, keepCount);
+}
+
+void StackPool::Link(int node, int sizeClass, StackBlock* head, StackBlock* tail, std::size_t count)
+{
+    GlobalList& gl = Global(node, sizeClass);
+    std::unique_lock<LFLock> lock(gl.lock_);
+    tail->next_ = gl.head_.load(std::memory_order_relaxed);
+    gl.head_.store(head, std::memory_order_relaxed);
+    gl.count_ += count;
+}
+
+StackBlock* StackPool::Create(std::size_t size, int sizeClass, int node)
+{
+    const std::size_t pageSize = getpagesize();
+    size = (size + pageSize - 1) & ~(pageSize - 1);  // 可用栈大小按页向上取整
+
+    int guardPages = StackTraits::GetProtectStackPageSize();
+    if (guardPages < 0) guardPages = 0;
+
+    // MAP_NORESERVE：不预留交换空间，物理页在第一次访问时才分配，
+    // 没有用到的栈深度只占虚拟地址空间（overcommit严格模式下也不计入提交量）
+    std::size_t mapSize = size + guardPages * pageSize;
+    void* p = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        spdlog::error("Failed to mmap coroutine stack of {} bytes: {}", mapSize, strerror(errno));
+        throw std::bad_alloc();
+    }
+
+    // 物理页优先分配在创建线程所在的节点上，之后无论在哪个线程第一次访问
+    if (NumaTopology::Active())
+        NumaTopology::getInstance().BindMemory(p, mapSize, node);
+
+    // 保护页位于低地址端（栈向下增长），只在创建时设置一次
+    if (guardPages > 0 && mprotect(p, guardPages * pageSize, PROT_NONE) == -1) {
+        spdlog::error("Failed to protect stack at {}: {}", p, strerror(errno));
+    }
+
+    StackBlock* block = new StackBlock;
+    block->mapBase_ = static_cast<char*>(p);
+    block->mapSize_ = mapSize;
+    block->stack_ = block->mapBase_ + guardPages * pageSize;
+    block->stackSize_ = size;
+    block->guardPages_ = guardPages;
+    block->sizeClass_ = sizeClass;
+    block->node_ = node;
+    mappedBytes_.fetch_add(mapSize, std::memory_order_relaxed);
+    return block;
+}
+
+void StackPool::Destroy(StackBlock* block)
+{
+    // munmap同时解除保护页，无需额外mprotect
+    munmap(block->mapBase_, block->mapSize_);
+    mappedBytes_.fetch_sub(block->mapSize_, std::memory_order_relaxed);
+    delete block;
+}
+
+StackPool::Stats StackPool::GetStats() const
+{
+    Stats s;
+    s.cachedBytes = cachedBytes_.load(std::memory_order_relaxed);
+    s.residentCachedBytes = residentCachedBytes_.load(std::memory_order_relaxed);
+    s.mappedBytes = mappedBytes_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void StackPool::Trim()
+{
+    for (int node = 0; node < nodes_; ++node) {
+        for (int i = 0; i < kSizeClasses; ++i) {
+            std::size_t got = 0;
+            StackBlock* head = PopGlobal(node, i, (std::size_t)-1, got);
+            while (head) {
+                StackBlock* next = head->next_;
+                Destroy(head);
+                head = next;
+            }
+        }
+    }
+}
+
+} // namespace cxk
@@ -0,0 +1,141 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+
+#ifndef GOCOROUTINE_STACK_POOL_H
+#define GOCOROUTINE_STACK_POOL_H
+#pragma once
+#include <utils/utils.h>
+#include <concurrence/spinlock.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace cxk
+{
+
+/*
+ * @brief 协程栈内存块（mmap(MAP_NORESERVE)分配，页对齐，物理页按需补）
+ * 内存布局（低地址 -> 高地址）: [保护页 guardPages_ 页][可用栈 stackSize_ 字节]
+ * 保护页只在创建时mprotect一次，复用时保持不变；元数据与栈内存分离，
+ * 因此对栈内存执行madvise(MADV_DONTNEED)不会破坏空闲链表。
+ */
+struct StackBlock
+{
+    StackBlock* next_ = nullptr;    ///< 空闲链表指针
+    char* mapBase_ = nullptr;       ///< mmap返回的起始地址（包含保护页）
+    std::size_t mapSize_ = 0;       ///< mmap映射的总大小
+    char* stack_ = nullptr;         ///< 可用栈区低地址（保护页之上）
+    std::size_t stackSize_ = 0;     ///< 可用栈大小
+    int guardPages_ = 0;            ///< 保护页数量
+    int sizeClass_ = -1;            ///< 尺寸等级，-1表示超大栈不入池
+    int node_ = 0;                  ///< 创建时所在的NUMA节点下标（见NumaTopology），归还到该节点的全局链表
+    bool resident_ = true;          ///< 物理内存是否仍驻留（false表示已madvise归还）
+};
+
+/*
+ * @brief 协程栈池
+ * 按尺寸等级(2的幂)维护空闲链表：线程本地缓存 -> 全局溢出链表 -> mmap新建。
+ * 线程缓存命中时分配/释放仅为一次链表指针操作；全局链表缓存的驻留内存超过高水位后，
+ * 新归还的栈会通过madvise(MADV_DONTNEED)把物理页还给操作系统，缓存总量超过上限时直接munmap。
+ * NumaTopology::Active()时全局链表按NUMA节点划分：新建的栈优先从创建线程所在节点分配物理页，
+ * 在其他节点的线程上归还时不进入该线程的缓存，直接回到所属节点的全局链表。
+ */
+class StackPool
+{
+public:
+    static constexpr int kSizeClasses = 12;             ///< 尺寸等级数量: 8KB ~ 16MB
+    static constexpr std::size_t kMinClassSize = 8 * 1024; ///< 最小尺寸等级
+
+    static StackPool& getInstance();
+
+    /**
+     * @brief 分配一个可用大小不小于size的栈
+     * @param size 请求的栈大小（0表示使用DefaultStackSize()）
+     * @throw std::bad_alloc mmap失败
+     */
+    StackBlock* Allocate(std::size_t size);
+
+    /// @brief 归还栈，优先放入线程本地缓存
+    void Free(StackBlock* block);
+
+    /// @brief 默认栈大小（Context构造时stackSize为0则使用该值）
+    static std::size_t& DefaultStackSize();
+
+    /// @brief 全局链表驻留内存高水位（字节），超过后归还的栈会被madvise
+    static std::size_t& HighWaterBytes();
+
+    /// @brief 全局链表缓存总量上限（字节，含已madvise的栈），超过后直接munmap
+    static std::size_t& MaxCachedBytes();
+
+    /// @brief 每个尺寸等级的线程本地缓存数量上限
+    static std::size_t& ThreadCacheCount();
+
+    /// @brief 将尺寸映射到尺寸等级，超过最大等级返回-1
+    static int SizeClass(std::size_t size);
+
+    /// @brief 尺寸等级对应的栈大小
+    static std::size_t ClassSize(int sizeClass) {
+        return kMinClassSize << sizeClass;
+    }
+
+    /// @brief 统计信息（近似值，仅用于观测）
+    struct Stats
+    {
+        std::size_t cachedBytes = 0;       ///< 全局链表缓存的栈字节数
+        std::size_t residentCachedBytes = 0; ///< 全局链表中仍驻留物理内存的字节数
+        std::size_t mappedBytes = 0;       ///< 当前mmap的总字节数（含保护页）
+    };
+    Stats GetStats() const;
+
+    /// @brief 释放全局链表中缓存的所有栈（munmap）
+    void Trim();
+
+    StackPool(StackPool const&) = delete;
+    StackPool& operator=(StackPool const&) = delete;
+
+private:
+    struct ThreadCache;
+    friend struct ThreadCache;
+
+    /// 全局溢出链表（每个尺寸等级一个）
+    struct GlobalList
+    {
+        LFLock lock_;
+        atomic_t<StackBlock*> head_{nullptr};  ///< 在lock_下修改，PopGlobal的预检查在锁外读取
+        std::size_t count_ = 0;
+    };
+
+    StackPool();
+
+    static ThreadCache& GetThreadCache();
+
+    StackBlock* Create(std::size_t size, int sizeClass, int node);
+    void Destroy(StackBlock* block);
+
+    /// 当前线程所在的节点下标（NUMA关闭时为0）
+    int CurrentNode() const;
+
+    ALWAYS_INLINE GlobalList& Global(int node, int sizeClass) {
+        return globals_[node * kSizeClasses + sizeClass];
+    }
+
+    /// 从节点的全局链表批量取出最多n个栈，返回链表头
+    StackBlock* PopGlobal(int node, int sizeClass, std::size_t n, std::size_t& got);
+
+    /// 将链表[head, ...]归还到各个栈所属节点的全局链表
+    void PushGlobal(int sizeClass, StackBlock* head);
+
+    /// 把同一节点的链表[head, tail]挂到该节点的全局链表上
+    void Link(int node, int sizeClass, StackBlock* head, StackBlock* tail, std::size_t count);
+
+    int nodes_ = 1;
+    std::unique_ptr<GlobalList[]> globals_;     ///< nodes_ * kSizeClasses个链表
+    atomic_t<std::size_t> cachedBytes_{0};
+    atomic_t<std::size_t> residentCachedBytes_{0};
+    atomic_t<std::size_t> mappedBytes_{0};
+};
+
+} // namespace cxk
+
+#endif //GOCOROUTINE_STACK_POOL_H
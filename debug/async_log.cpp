@@ -0,0 +1,383 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "async_log.h"
+#include <common/clock.h>
+#include <common/lock_free_ring_queue.h>
+#include <scheduler/processor.h>
+#include <scheduler/processor_stats.h>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace cxk
+{
+
+namespace
+{
+
+const char* BaseName(const char* file)
+{
+    const char* p = file ? strrchr(file, '/') : nullptr;
+    return p ? p + 1 : (file ? file : "");
+}
+
+/// 本线程的Producer已随thread_local析构标记为退出，之后不再注册新的队列
+bool& ThreadExited()
+{
+    static thread_local bool obj = false;
+    return obj;
+}
+
+/// c是否是set中的字符
+bool OneOf(char c, const char* set)
+{
+    return c && strchr(set, c);
+}
+
+} // namespace
+
+const char* GetLogLevelName(LogLevel level)
+{
+    switch (level) {
+        case LogLevel::debug:
+            return "debug";
+        case LogLevel::info:
+            return "info";
+        case LogLevel::warn:
+            return "warn";
+        case LogLevel::error:
+            return "error";
+        case LogLevel::off:
+            return "off";
+    }
+    return "unknown";
+}
+
+void LogRecord::AddText(const char* s, std::size_t len)
+{
+    std::size_t room = textLen_ < kTextBytes - 1 ? kTextBytes - 1 - textLen_ : 0;
+    if (len > room) len = room;
+    types_[argc_] = kString;
+    if (len == 0) {
+        args_[argc_++].u = kTextBytes - 1;
+        return;
+    }
+    args_[argc_++].u = textLen_;
+    memcpy(text_ + textLen_, s, len);
+    text_[textLen_ + len] = '\0';
+    textLen_ = (uint8_t)std::min<std::size_t>(textLen_ + len + 1, kTextBytes);
+}
+
+std::size_t LogRecord::Format(char* out, std::size_t cap) const
+{
+    if (cap == 0) return 0;
+    std::size_t n = 0;
+    auto put = [&](const char* s, std::size_t len) {
+        len = std::min(len, cap - 1 - n);
+        memcpy(out + n, s, len);
+        n += len;
+    };
+
+    int argi = 0;
+    for (const char* p = fmt_; *p && n < cap - 1; ) {
+        if (*p != '%') {
+            const char* q = strchr(p, '%');
+            std::size_t len = q ? (std::size_t)(q - p) : strlen(p);
+            put(p, len);
+            p += len;
+            continue;
+        }
+        if (p[1] == '%') {
+            put("%", 1);
+            p += 2;
+            continue;
+        }
+
+        // 转换说明：标志、宽度、精度照搬，长度修饰符按参数的实际类型重新生成
+        const char* start = p++;
+        std::string flags, width, precision;
+        while (OneOf(*p, "-+ #0")) flags += *p++;
+        while (*p >= '0' && *p <= '9') width += *p++;
+        if (*p == '.') {
+            precision += *p++;
+            while (*p >= '0' && *p <= '9') precision += *p++;
+        }
+        while (OneOf(*p, "hlLqjzt")) ++p;
+        char conv = *p;
+        if (!conv) {
+            put(start, (std::size_t)(p - start));
+            break;
+        }
+        ++p;
+        if (argi >= argc_ || width.size() > 8 || precision.size() > 8) {    // 参数不足时原样输出
+            put(start, (std::size_t)(p - start));
+            continue;
+        }
+
+        // 按记录时的类型选择转换符，避免与格式串不符时的未定义行为
+        ArgType type = types_[argi];
+        Arg const& arg = args_[argi++];
+        std::string allowed;
+        std::string length;
+        switch (type) {
+            case kString:
+                conv = 's';
+                break;
+            case kPointer:
+                conv = 'p';
+                break;
+            case kDouble:
+                if (!OneOf(conv, "eEfFgGaA")) conv = 'g';
+                break;
+            case kInt:
+            case kUint:
+                if (!OneOf(conv, "diuoxXc")) conv = type == kInt ? 'd' : 'u';
+                if (conv != 'c') length = "ll";
+                break;
+        }
+        if (OneOf(conv, "di")) allowed = "-+ 0";
+        else if (OneOf(conv, "uoxX")) allowed = "-#0";
+        else if (OneOf(conv, "eEfFgGaA")) allowed = "-+ #0";
+        else allowed = "-";
+        if (OneOf(conv, "cp")) precision.clear();
+
+        std::string spec = "%";
+        for (char f : flags)
+            if (allowed.find(f) != std::string::npos) spec += f;
+        spec += width + precision + length + conv;
+
+        char buf[256];
+        int len = 0;
+        switch (conv) {
+            case 's':
+                len = snprintf(buf, sizeof(buf), spec.c_str(), text_ + std::min<uint64_t>(arg.u, kTextBytes - 1));
+                break;
+            case 'p':
+                len = snprintf(buf, sizeof(buf), spec.c_str(), arg.p);
+                break;
+            case 'c':
+                len = snprintf(buf, sizeof(buf), spec.c_str(), (int)arg.i);
+                break;
+            case 'd': case 'i':
+                len = snprintf(buf, sizeof(buf), spec.c_str(), (long long)arg.i);
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                len = snprintf(buf, sizeof(buf), spec.c_str(), (unsigned long long)arg.u);
+                break;
+            default:
+                len = snprintf(buf, sizeof(buf), spec.c_str(), arg.d);
+                break;
+        }
+        if (len > 0) put(buf, std::min<std::size_t>((std::size_t)len, sizeof(buf) - 1));
+    }
+    out[n] = '\0';
+    return n;
+}
+
+/// 一个写日志线程的队列：只由该线程Push，由持有drainMtx_的消费者Pop
+struct AsyncLog::Producer
+{
+    explicit Producer(std::size_t capacity) : queue_(capacity) {}
+
+    LockFreeRingQueue<LogRecord, std::size_t, RingQueueSPSC> queue_;
+    StatCounter dropped_;               ///< 仅所属线程写入
+    atomic_t<bool> exited_{false};      ///< 所属线程已退出，取完后释放
+    int tid_ = 0;
+};
+
+atomic_t<LogLevel>& AsyncLog::Level()
+{
+    static atomic_t<LogLevel> obj{LogLevel::info};
+    return obj;
+}
+
+std::size_t& AsyncLog::QueueCapacity()
+{
+    static std::size_t obj = 1024;
+    return obj;
+}
+
+std::chrono::milliseconds& AsyncLog::FlushInterval()
+{
+    static std::chrono::milliseconds obj(5);
+    return obj;
+}
+
+AsyncLog& AsyncLog::getInstance()
+{
+    // 不析构：进程退出时其他线程可能仍在写日志
+    static AsyncLog* obj = new AsyncLog;
+    return *obj;
+}
+
+AsyncLog::AsyncLog()
+{
+    baseTicks_ = FastSteadyClock::Ticks();
+    baseWallNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    atexit([]{ AsyncLog::getInstance().Flush(); });
+}
+
+void AsyncLog::Commit(LogRecord& rec)
+{
+    rec.tsc_ = FastSteadyClock::Ticks();
+    Task* tk = Processor::GetCurrentTask();
+    rec.taskId_ = tk ? tk->id_ : 0;
+
+    Producer* p = Local();
+    if (!p) {
+        if (ThreadExited()) WriteNow(rec);
+        return;
+    }
+    if (!p->queue_.Push(rec).success)
+        p->dropped_.Add();
+}
+
+AsyncLog::Producer* AsyncLog::Local()
+{
+    struct Holder
+    {
+        Producer* p_ = nullptr;
+
+        ~Holder() {
+            ThreadExited() = true;
+            if (p_) p_->exited_.store(true, std::memory_order_release);
+            p_ = nullptr;
+        }
+    };
+    // holder析构后不再访问它：再注册的队列没有人标记退出，永远不会释放
+    if (ThreadExited()) return nullptr;
+    static thread_local Holder holder;
+    if (holder.p_) return holder.p_;
+
+    // 每个线程只在第一次写日志时走到这里
+    try {
+        Producer* p = new Producer(std::max<std::size_t>(QueueCapacity(), 2));
+        p->tid_ = (int)syscall(SYS_gettid);
+        {
+            std::lock_guard<std::mutex> lock(regMtx_);
+            producers_.push_back(p);
+        }
+        holder.p_ = p;
+        if (!running_.exchange(true, std::memory_order_acq_rel)) {
+            try {
+                std::thread([this]{ Run(); }).detach();
+            } catch (...) {
+                running_.store(false, std::memory_order_relaxed);   // 下次注册时再试，期间只能由Flush输出
+            }
+        }
+        return p;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void AsyncLog::WriteNow(LogRecord const& rec)
+{
+    std::lock_guard<std::mutex> lock(drainMtx_);
+    Drain();
+    Output((int)syscall(SYS_gettid), rec);
+    if (!sink_) fflush(stderr);
+    written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLog::Run()
+{
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(drainMtx_);
+            Drain();
+        }
+        std::this_thread::sleep_for(FlushInterval());
+    }
+}
+
+void AsyncLog::Flush()
+{
+    std::lock_guard<std::mutex> lock(drainMtx_);
+    Drain();
+}
+
+std::size_t AsyncLog::Drain()
+{
+    {
+        std::lock_guard<std::mutex> lock(regMtx_);
+        snapshot_.assign(producers_.begin(), producers_.end());
+    }
+
+    std::size_t count = 0;
+    LogRecord rec;
+    for (Producer* p : snapshot_) {
+        // 先读退出标记再取：标记之前写入的记录都能取到，之后该线程不会再写
+        bool exited = p->exited_.load(std::memory_order_acquire);
+        while (p->queue_.Pop(rec).success) {
+            Output(p->tid_, rec);
+            ++count;
+        }
+        if (exited) {
+            std::lock_guard<std::mutex> lock(regMtx_);
+            producers_.erase(std::find(producers_.begin(), producers_.end(), p));
+            retiredDropped_.fetch_add(p->dropped_.Load(), std::memory_order_relaxed);
+            delete p;
+        }
+    }
+    if (count && !sink_) fflush(stderr);
+    written_.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+void AsyncLog::Output(int tid, LogRecord const& rec)
+{
+    // TSC换算为日历时间；时钟尚在校准时使用输出时刻
+    int64_t ns;
+    double rate = FastSteadyClock::TicksPerNanosecond();
+    if (rate > 0)
+        ns = baseWallNs_ + (int64_t)((double)(int64_t)(rec.tsc_ - baseTicks_) / rate);
+    else
+        ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    time_t sec = (time_t)(ns / 1000000000);
+    struct tm local;
+    localtime_r(&sec, &local);
+
+    char line[1024];
+    int n = snprintf(line, sizeof(line), "[%04d-%02d-%02d %02d:%02d:%02d.%06d] [%s] [tid:%d] [co:%llu] %s:%u ",
+            local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec,
+            (int)(ns % 1000000000 / 1000), GetLogLevelName(rec.level_), tid,
+            (unsigned long long)rec.taskId_, BaseName(rec.file_), rec.line_);
+    std::size_t len = n > 0 ? std::min<std::size_t>((std::size_t)n, sizeof(line) - 2) : 0;
+    len += rec.Format(line + len, sizeof(line) - 1 - len);    // 留一个字节给换行
+
+    if (sink_) {
+        sink_(rec.level_, line, len);
+    } else {
+        line[len++] = '\n';
+        fwrite(line, 1, len, stderr);
+    }
+}
+
+void AsyncLog::SetSink(Sink sink)
+{
+    std::lock_guard<std::mutex> lock(drainMtx_);
+    sink_ = std::move(sink);
+}
+
+AsyncLog::Stats AsyncLog::GetStats()
+{
+    Stats stats;
+    std::lock_guard<std::mutex> lock(regMtx_);
+    for (Producer* p : producers_) {
+        stats.dropped += p->dropped_.Load();
+        if (!p->exited_.load(std::memory_order_relaxed)) ++stats.producers;
+    }
+    stats.dropped += retiredDropped_.load(std::memory_order_relaxed);
+    stats.written = written_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // cxk
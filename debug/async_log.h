@@ -0,0 +1,222 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_ASYNC_LOG_H
+#define GOCOROUTINE_ASYNC_LOG_H
+
+#pragma once
+#include <utils/utils.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cxk
+{
+
+enum class LogLevel : uint8_t
+{
+    debug,
+    info,
+    warn,
+    error,
+    off,        ///< 只用于AsyncLog::Level()，关闭全部输出
+};
+
+const char* GetLogLevelName(LogLevel level);
+
+/*
+ * @brief 一条日志：printf格式串和参数的原始值，格式化推迟到后台线程
+ * 格式串和文件名必须是静态字符串（字面量），只保存指针；字符串参数拷贝到text_中（超出时截断）。
+ * 整个记录是平凡类型，写入环形队列就是一次定长拷贝，不分配内存。
+ */
+struct LogRecord
+{
+    static constexpr int kMaxArgs = 8;          ///< 参数个数上限（编译期检查）
+    static constexpr int kTextBytes = 80;       ///< 字符串参数的总长度上限（含结尾的'\0'）
+
+    enum ArgType : uint8_t
+    {
+        kInt,
+        kUint,
+        kDouble,
+        kPointer,
+        kString,    ///< 值是text_中的偏移
+    };
+
+    union Arg
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void* p;
+    };
+
+    uint64_t tsc_;              ///< 写入时刻，FastSteadyClock::Ticks()
+    uint64_t taskId_;           ///< 写入时所在的协程ID，0表示不在协程中
+    const char* fmt_;
+    const char* file_;
+    uint32_t line_;
+    LogLevel level_;
+    uint8_t argc_;
+    uint8_t textLen_;
+    ArgType types_[kMaxArgs];
+    Arg args_[kMaxArgs];
+    char text_[kTextBytes];
+
+    template <typename T>
+    ALWAYS_INLINE void Add(T const& v) {
+        typedef typename std::decay<T>::type D;
+        Arg& a = args_[argc_];
+        if constexpr (std::is_same<D, bool>::value) {
+            types_[argc_] = kInt;
+            a.i = v ? 1 : 0;
+        } else if constexpr (std::is_integral<D>::value && std::is_signed<D>::value) {
+            types_[argc_] = kInt;
+            a.i = (int64_t)v;
+        } else if constexpr (std::is_integral<D>::value || std::is_enum<D>::value) {
+            types_[argc_] = kUint;
+            a.u = (uint64_t)v;
+        } else if constexpr (std::is_floating_point<D>::value) {
+            types_[argc_] = kDouble;
+            a.d = (double)v;
+        } else {
+            static_assert(std::is_arithmetic<D>::value, "unsupported log argument type");
+        }
+        ++argc_;
+    }
+
+    ALWAYS_INLINE void Add(const char* s) { AddText(s ? s : "(null)", s ? strnlen(s, kTextBytes) : 6); }
+    ALWAYS_INLINE void Add(char* s) { Add((const char*)s); }
+    ALWAYS_INLINE void Add(std::string const& s) { AddText(s.data(), s.size()); }
+
+    template <typename T>
+    ALWAYS_INLINE void Add(T* p) {
+        types_[argc_] = kPointer;
+        args_[argc_].p = (const void*)p;
+        ++argc_;
+    }
+
+    /// 字符串参数拷贝到text_（截断），最后一个字节总是'\0'，没有空间时指向它
+    void AddText(const char* s, std::size_t len);
+
+    /// 格式化正文（不含前缀），返回写入的长度
+    std::size_t Format(char* out, std::size_t cap) const;
+};
+
+/*
+ * @brief 运行时的异步日志：热路径（如保护页的创建和撤销、RS_DBG）只把记录写入本线程的队列
+ *
+ *  - 每个写日志的线程第一次写入时注册一个单生产者单消费者的LockFreeRingQueue（RingQueueSPSC），
+ *    写入只有一次定长拷贝和两次原子load/store，不加锁、不分配内存、不做系统调用；
+ *  - 记录带写入时刻（TSC）和协程ID，由后台线程每FlushInterval()轮询一次全部队列，格式化后写入Sink；
+ *  - 队列满时丢弃新记录并计数（GetStats().dropped），不阻塞调用者；
+ *  - 线程退出后它的队列由后台线程取完再释放；进程正常退出时（atexit）最后取一次；
+ *    线程退出之后（其他thread_local对象的析构中）写入的日志不再注册队列，持有drainMtx_同步输出。
+ * 格式串是printf风格，参数类型在写入时记录，格式化时按实际类型输出，类型与转换符不符时不会产生未定义行为。
+ */
+class AsyncLog
+{
+public:
+    /// @brief 一行格式化后的日志（不含换行），默认写到stderr
+    typedef std::function<void(LogLevel, const char* line, std::size_t len)> Sink;
+
+    struct Stats
+    {
+        uint64_t written = 0;       ///< 已格式化写入Sink的记录数
+        uint64_t dropped = 0;       ///< 队列满时丢弃的记录数
+        std::size_t producers = 0;  ///< 注册了队列、尚未退出的线程数
+    };
+
+    /// @brief 输出级别，低于它的记录在调用处直接跳过（不求值参数）；默认info，可以在任意线程修改
+    static atomic_t<LogLevel>& Level();
+
+    /// @brief 每个线程的队列容量（向上取2的幂），线程第一次写入之前设置
+    static std::size_t& QueueCapacity();
+
+    /// @brief 后台线程的轮询间隔
+    static std::chrono::milliseconds& FlushInterval();
+
+    static AsyncLog& getInstance();
+
+    /// @brief 写入一条日志，通常通过CO_ASYNC_LOG调用
+    template <typename... Args>
+    static void Write(LogLevel level, const char* file, int line, const char* fmt, Args const&... args)
+    {
+        static_assert(sizeof...(Args) <= LogRecord::kMaxArgs, "too many log arguments");
+        LogRecord rec;
+        rec.fmt_ = fmt;
+        rec.file_ = file;
+        rec.line_ = (uint32_t)line;
+        rec.level_ = level;
+        rec.argc_ = 0;
+        rec.textLen_ = 0;
+        rec.text_[LogRecord::kTextBytes - 1] = '\0';
+        int expand[] = {0, (rec.Add(args), 0)...};
+        (void)expand;
+        getInstance().Commit(rec);
+    }
+
+    /// @brief 替换输出目标，nullptr恢复为stderr
+    void SetSink(Sink sink);
+
+    /// @brief 立即取出并输出所有线程已写入的记录（阻塞到输出完毕）
+    void Flush();
+
+    Stats GetStats();
+
+    AsyncLog(AsyncLog const&) = delete;
+    AsyncLog& operator=(AsyncLog const&) = delete;
+
+private:
+    struct Producer;
+
+    AsyncLog();
+
+    /// 补上时刻和协程ID后写入本线程的队列
+    void Commit(LogRecord& rec);
+
+    /// 本线程的队列，第一次调用时注册；线程已退出或注册失败时返回nullptr
+    Producer* Local();
+
+    /// 线程退出之后的写入：先取出已写入的记录，再直接输出这一条
+    void WriteNow(LogRecord const& rec);
+
+    /// 后台线程入口
+    void Run();
+
+    /// 取出并输出所有队列中的记录，释放已退出线程的队列；调用者持有drainMtx_
+    std::size_t Drain();
+
+    /// 格式化一条记录并写入Sink，tid为写入的线程
+    void Output(int tid, LogRecord const& rec);
+
+    std::mutex regMtx_;                     ///< 保护producers_
+    std::vector<Producer*> producers_;
+    std::mutex drainMtx_;                   ///< 同一时刻只有一个消费者（后台线程或Flush）
+    std::vector<Producer*> snapshot_;       ///< Drain时producers_的拷贝，由drainMtx_保护
+    Sink sink_;                             ///< 由drainMtx_保护
+    uint64_t baseTicks_;                    ///< 启动时刻的Ticks()和系统时间，用于把记录的TSC换算为日历时间
+    int64_t baseWallNs_;
+    atomic_t<uint64_t> written_{0};
+    atomic_t<uint64_t> retiredDropped_{0};  ///< 已释放的队列丢弃的记录数
+    atomic_t<bool> running_{false};
+};
+
+} // cxk
+
+/// @brief 异步写一条printf风格的日志，例如CO_ASYNC_LOG(::cxk::LogLevel::info, "stack %p", p)
+/// 格式串并入__VA_ARGS__：没有参数时也不依赖GNU的##__VA_ARGS__（-Wpedantic）
+#define CO_ASYNC_LOG(level, ...) \
+    do { \
+        if ((level) >= ::cxk::AsyncLog::Level().load(std::memory_order_relaxed)) \
+            ::cxk::AsyncLog::Write((level), __FILE__, __LINE__, __VA_ARGS__); \
+    } while (0)
+
+#endif //GOCOROUTINE_ASYNC_LOG_H
@@ -0,0 +1,128 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_DEBUG_REGISTRY_H
+#define GOCOROUTINE_DEBUG_REGISTRY_H
+
+#pragma once
+#include "concurrence/linked_list.h"
+#include "concurrence/spinlock.h"
+#include "utils/utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace cxk
+{
+
+/// @brief 当前线程的分片号：线程第一次使用时轮转分配，之后固定不变
+inline std::size_t DebugRegistryThreadIndex()
+{
+    static atomic_t<std::size_t> seq{0};
+    static thread_local std::size_t idx = seq.fetch_add(1, std::memory_order_relaxed);
+    return idx;
+}
+
+/*
+ * @brief 分片的侵入式对象登记表（调试用）
+ * 对象按创建线程落到kShards个分片之一，每个分片是一把自旋锁加一个LinkedList，独占缓存行。
+ * 登记/注销只锁对象所在的分片：线程数不超过分片数时各线程互不争用，
+ * 跨线程析构的对象只与其创建线程所在的分片争用一次。
+ *
+ * 遍历（ForEach）逐个分片加锁，同一时刻只持有一把锁，不会阻塞其他分片上的创建与析构。
+ * 每次遍历推进一次纪元，对象登记时记下当时的纪元，遍历跳过比自己新的对象：
+ * 结果是遍历开始前已登记、且在访问到其分片时仍然存活的对象集合，不会被遍历期间的新对象撑大。
+ */
+template <typename T>
+class DebugRegistry
+{
+public:
+    static constexpr std::size_t kShards = 32;    ///< 2的幂
+
+    /// @brief 嵌入到被登记对象中的节点
+    struct Node : public LinkedNode
+    {
+        T* owner_ = nullptr;        ///< 已登记时非空
+        uint64_t epoch_ = 0;        ///< 登记时的纪元
+        uint32_t shard_ = 0;
+    };
+
+    /// @brief 登记到当前线程的分片
+    static void Register(Node* node, T* owner) {
+        uint32_t idx = (uint32_t)(DebugRegistryThreadIndex() & (kShards - 1));
+        Shard& shard = Shards()[idx];
+        node->shard_ = idx;
+        node->epoch_ = Epoch().load(std::memory_order_relaxed);
+        std::unique_lock<LFLock> lock(shard.lock_);
+        node->owner_ = owner;
+        shard.list_.push(node);
+        ++shard.size_;
+    }
+
+    /// @brief 从登记时的分片注销，可重复调用
+    static void Unregister(Node* node) {
+        Shard& shard = Shards()[node->shard_];
+        std::unique_lock<LFLock> lock(shard.lock_);
+        if (!node->owner_) return;
+        node->owner_ = nullptr;
+        shard.list_.unlink(node);
+        --shard.size_;
+    }
+
+    /**
+     * @brief 遍历开始前已登记、仍然存活的对象，返回访问的数量
+     * fn在持有对象所在分片的锁时调用：期间对象不会完成注销，但fn应当尽快返回，
+     * 并且不能在当前线程创建或销毁同类型的对象（可能落到同一分片而死锁）。
+     */
+    template <typename Fn>
+    static std::size_t ForEach(Fn const& fn) {
+        uint64_t epoch = Epoch().fetch_add(1, std::memory_order_relaxed);
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < kShards; ++i) {
+            Shard& shard = Shards()[i];
+            std::unique_lock<LFLock> lock(shard.lock_);
+            for (LinkedNode* pos = shard.list_.front(); pos; pos = pos->next) {
+                Node* node = static_cast<Node*>(pos);
+                if (node->epoch_ > epoch) continue;
+                fn(node->owner_);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    /// @brief 已登记的对象数量（逐个分片读取，并发修改时是近似值）
+    static std::size_t Size() {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < kShards; ++i) {
+            Shard& shard = Shards()[i];
+            std::unique_lock<LFLock> lock(shard.lock_);
+            n += shard.size_;
+        }
+        return n;
+    }
+
+private:
+    struct alignas(64) Shard
+    {
+        LFLock lock_;
+        LinkedList list_;
+        std::size_t size_ = 0;
+    };
+
+    /// 分片与纪元都是平凡析构的，进程退出时晚于它们析构的对象仍可安全注销
+    static Shard* Shards() {
+        static Shard obj[kShards];
+        return obj;
+    }
+
+    static atomic_t<uint64_t>& Epoch() {
+        static atomic_t<uint64_t> obj{0};
+        return obj;
+    }
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_DEBUG_REGISTRY_H
@@ -3,7 +3,347 @@
 //
 
 #include "debugger.h"
+#include <context/stack_pool.h>
+#include <scheduler/scheduler.h>
+#include <scheduler/offload.h>
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 namespace cxk
 {
-} // cxk
\ No newline at end of file
+
+namespace
+{
+
+/// 把src的计数累加到dst（汇总所有Processor）
+void MergeMetrics(CoDebugger::ProcessorMetrics& dst, CoDebugger::ProcessorMetrics const& src)
+{
+    dst.switches_ += src.switches_;
+    dst.handoffs_ += src.handoffs_;
+    dst.yields_ += src.yields_;
+    dst.parks_ += src.parks_;
+    dst.wakes_ += src.wakes_;
+    dst.steals_ += src.steals_;
+    dst.stolenTasks_ += src.stolenTasks_;
+    dst.remoteSteals_ += src.remoteSteals_;
+    dst.tasksDone_ += src.tasksDone_;
+    dst.preempts_ += src.preempts_;
+    dst.retakenTasks_ += src.retakenTasks_;
+    dst.runQueueDepth_ += src.runQueueDepth_;
+    dst.stackBytes_ += src.stackBytes_;
+
+    CoDebugger::LatencyHistogram& h = dst.runnableLatency_;
+    CoDebugger::LatencyHistogram const& o = src.runnableLatency_;
+    if (o.counts_.empty()) return;
+    if (h.counts_.empty()) {
+        h = o;
+        return;
+    }
+    for (std::size_t i = 0; i < h.counts_.size() && i < o.counts_.size(); ++i)
+        h.counts_[i] += o.counts_[i];
+    h.count_ += o.count_;
+    h.sumNs_ += o.sumNs_;
+}
+
+/// Prometheus文本格式：一个指标族的HELP/TYPE头
+void AppendFamily(std::string& out, const char* name, const char* type, const char* help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void AppendSample(std::string& out, const char* name, const char* labels, double value)
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s%s %.17g\n", name, labels, value);
+    out += buf;
+}
+
+} // namespace
+
+CoDebugger& CoDebugger::getInstance()
+{
+    static CoDebugger obj;
+    return obj;
+}
+
+std::string CoDebugger::GetAllInfo()
+{
+    SchedulerMetrics m = GetMetrics();
+    StackPool::Stats pool = StackPool::getInstance().GetStats();
+
+    std::string info;
+    char line[256];
+    snprintf(line, sizeof(line), "tasks: %u, processors: %lu\n",
+             m.taskCount_, (unsigned long)m.processors_.size());
+    info += line;
+    snprintf(line, sizeof(line), "stack pool: mapped %lu, cached %lu (resident %lu), in use by tasks %ld\n",
+             (unsigned long)pool.mappedBytes, (unsigned long)pool.cachedBytes,
+             (unsigned long)pool.residentCachedBytes, (long)m.total_.stackBytes_);
+    info += line;
+
+    info += "processor (switches / handoffs / yields / parks / wakes / steals(tasks) / done / queue):\n";
+    for (ProcessorMetrics const& p : m.processors_) {
+        snprintf(line, sizeof(line), "  [%d] %lu / %lu / %lu / %lu / %lu / %lu(%lu) / %lu / %lu\n", p.id_,
+                 (unsigned long)p.switches_, (unsigned long)p.handoffs_, (unsigned long)p.yields_,
+                 (unsigned long)p.parks_, (unsigned long)p.wakes_, (unsigned long)p.steals_,
+                 (unsigned long)p.stolenTasks_, (unsigned long)p.tasksDone_, (unsigned long)p.runQueueDepth_);
+        info += line;
+    }
+
+    LatencyHistogram const& h = m.total_.runnableLatency_;
+    if (h.count_) {
+        snprintf(line, sizeof(line), "runnable latency: samples %lu, avg %.0fns\n",
+                 (unsigned long)h.count_, h.sumNs_ / h.count_);
+        info += line;
+    }
+
+#if ENABLE_DEBUGGER
+    // 逐个分片遍历存活的协程，只读取标量字段（协程可能正在其他线程上运行）
+    info += "task (id / state / yields):\n";
+    Task::ForEach([&](Task* tk) {
+        snprintf(line, sizeof(line), "  %lu / %s / %lu\n", (unsigned long)tk->id_,
+                 GetTaskStateName(tk->state_), (unsigned long)tk->yieldCount_);
+        info += line;
+    });
+#endif
+
+    if (GetStackProbeRate())
+        info += GetStackUsageInfo();
+    return info;
+}
+
+int CoDebugger::TaskCount()
+{
+    return (int)Scheduler::getInstance().TaskCount();
+}
+
+unsigned long CoDebugger::GetCurrentTaskID()
+{
+    Task* tk = Processor::GetCurrentTask();
+    return tk ? (unsigned long)tk->id_ : 0;
+}
+
+unsigned long CoDebugger::GetCurrentTaskYieldCount()
+{
+    Task* tk = Processor::GetCurrentTask();
+    return tk ? (unsigned long)tk->yieldCount_ : 0;
+}
+
+void CoDebugger::SetCurrentTaskDebugInfo(std::string const& info)
+{
+    Task* tk = Processor::GetCurrentTask();
+    if (!tk) return;
+    tk->debugInfo_ = info;
+    Profiler::Relabel(tk);
+}
+
+const char* CoDebugger::GetCurrentTaskDebugInfo()
+{
+    Task* tk = Processor::GetCurrentTask();
+    return tk ? tk->DebugInfo() : "";
+}
+
+CoDebugger::SchedulerMetrics CoDebugger::GetMetrics()
+{
+    SchedulerMetrics m;
+    m.timestampNs_ = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    Scheduler& scheduler = Scheduler::getInstance();
+    m.taskCount_ = scheduler.TaskCount();
+    std::size_t count = scheduler.ProcessorCount();
+    m.processors_.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        Processor* proc = scheduler.GetProcessor(i);
+        if (!proc) continue;
+        proc->CollectMetrics(m.processors_[i]);
+        MergeMetrics(m.total_, m.processors_[i]);
+    }
+
+    StackPool::Stats pool = StackPool::getInstance().GetStats();
+    m.stackMappedBytes_ = pool.mappedBytes;
+    m.stackCachedBytes_ = pool.cachedBytes;
+
+    OffloadPool::Stats offload = OffloadPool::getInstance().GetStats();
+    m.offloadQueueDepth_ = offload.queueDepth;
+    m.offloadThreads_ = offload.threads;
+    m.offloadIdleThreads_ = offload.idleThreads;
+    m.offloadCompleted_ = offload.completed;
+    return m;
+}
+
+std::string CoDebugger::GetMetricsText()
+{
+    SchedulerMetrics m = GetMetrics();
+    std::string out;
+    char labels[96];
+
+    struct Counter
+    {
+        const char* name_;
+        const char* help_;
+        uint64_t ProcessorMetrics::* field_;
+    };
+    static const Counter counters[] = {
+        {"gocoroutine_switches_total", "Coroutine switch-ins, including direct handoffs.", &ProcessorMetrics::switches_},
+        {"gocoroutine_handoffs_total", "Direct switches to the runnext coroutine.", &ProcessorMetrics::handoffs_},
+        {"gocoroutine_yields_total", "Coroutines requeued after yielding.", &ProcessorMetrics::yields_},
+        {"gocoroutine_parks_total", "Coroutines suspended.", &ProcessorMetrics::parks_},
+        {"gocoroutine_wakes_total", "Woken coroutines delivered to the processor.", &ProcessorMetrics::wakes_},
+        {"gocoroutine_steals_total", "Successful steals from other processors.", &ProcessorMetrics::steals_},
+        {"gocoroutine_stolen_tasks_total", "Coroutines taken by steals.", &ProcessorMetrics::stolenTasks_},
+        {"gocoroutine_remote_steals_total", "Successful steals from processors on another NUMA node.", &ProcessorMetrics::remoteSteals_},
+        {"gocoroutine_tasks_done_total", "Coroutines finished.", &ProcessorMetrics::tasksDone_},
+        {"gocoroutine_preempts_total", "Coroutines yielding at a safe point after exceeding the time slice.", &ProcessorMetrics::preempts_},
+        {"gocoroutine_retaken_tasks_total", "Queued coroutines moved away from a stuck processor by sysmon.", &ProcessorMetrics::retakenTasks_},
+    };
+    for (Counter const& c : counters) {
+        AppendFamily(out, c.name_, "counter", c.help_);
+        for (ProcessorMetrics const& p : m.processors_) {
+            snprintf(labels, sizeof(labels), "{processor=\"%d\"}", p.id_);
+            AppendSample(out, c.name_, labels, (double)(p.*c.field_));
+        }
+    }
+
+    AppendFamily(out, "gocoroutine_run_queue_depth", "gauge", "Runnable coroutines waiting in the processor run queues; woken coroutines still in the wakeup inbox are not counted.");
+    for (ProcessorMetrics const& p : m.processors_) {
+        snprintf(labels, sizeof(labels), "{processor=\"%d\"}", p.id_);
+        AppendSample(out, "gocoroutine_run_queue_depth", labels, (double)p.runQueueDepth_);
+    }
+
+    const char* latency = "gocoroutine_runnable_latency_seconds";
+    AppendFamily(out, latency, "histogram", "Sampled time from becoming runnable to running.");
+    for (ProcessorMetrics const& p : m.processors_) {
+        LatencyHistogram const& h = p.runnableLatency_;
+        if (h.counts_.empty()) continue;
+        uint64_t cumulative = 0;
+        std::string bucket = std::string(latency) + "_bucket";
+        for (std::size_t i = 0; i < h.counts_.size(); ++i) {
+            cumulative += h.counts_[i];
+            if (i < h.boundsNs_.size())
+                snprintf(labels, sizeof(labels), "{processor=\"%d\",le=\"%.9g\"}", p.id_, h.boundsNs_[i] / 1e9);
+            else
+                snprintf(labels, sizeof(labels), "{processor=\"%d\",le=\"+Inf\"}", p.id_);
+            AppendSample(out, bucket.c_str(), labels, (double)cumulative);
+        }
+        snprintf(labels, sizeof(labels), "{processor=\"%d\"}", p.id_);
+        AppendSample(out, (std::string(latency) + "_sum").c_str(), labels, h.sumNs_ / 1e9);
+        AppendSample(out, (std::string(latency) + "_count").c_str(), labels, (double)h.count_);
+    }
+
+    AppendFamily(out, "gocoroutine_tasks", "gauge", "Coroutines not finished yet.");
+    AppendSample(out, "gocoroutine_tasks", "", (double)m.taskCount_);
+    AppendFamily(out, "gocoroutine_task_stack_bytes", "gauge", "Private stack bytes held by started, unfinished coroutines.");
+    AppendSample(out, "gocoroutine_task_stack_bytes", "", (double)m.total_.stackBytes_);
+    AppendFamily(out, "gocoroutine_stack_pool_mapped_bytes", "gauge", "Bytes mapped by the stack pool, including cached stacks and guard pages.");
+    AppendSample(out, "gocoroutine_stack_pool_mapped_bytes", "", (double)m.stackMappedBytes_);
+    AppendFamily(out, "gocoroutine_stack_pool_cached_bytes", "gauge", "Stack bytes cached in the global free lists of the stack pool.");
+    AppendSample(out, "gocoroutine_stack_pool_cached_bytes", "", (double)m.stackCachedBytes_);
+    AppendFamily(out, "gocoroutine_offload_queue_depth", "gauge", "Blocking calls submitted to the offload pool and not started yet.");
+    AppendSample(out, "gocoroutine_offload_queue_depth", "", (double)m.offloadQueueDepth_);
+    AppendFamily(out, "gocoroutine_offload_threads", "gauge", "Offload pool threads by state.");
+    AppendSample(out, "gocoroutine_offload_threads", "{state=\"busy\"}",
+            (double)(m.offloadThreads_ > m.offloadIdleThreads_ ? m.offloadThreads_ - m.offloadIdleThreads_ : 0));
+    AppendSample(out, "gocoroutine_offload_threads", "{state=\"idle\"}", (double)m.offloadIdleThreads_);
+    AppendFamily(out, "gocoroutine_offload_completed_total", "counter", "Blocking calls finished by the offload pool.");
+    AppendSample(out, "gocoroutine_offload_completed_total", "", (double)m.offloadCompleted_);
+    return out;
+}
+
+void CoDebugger::SetStackProbeRate(uint32_t rate)
+{
+    stackProbeRate_.store(rate, std::memory_order_relaxed);
+}
+
+void CoDebugger::RecordStackUsage(const void* site, const char* name, std::size_t used, std::size_t stackSize)
+{
+    char key[32];
+    if (!name) snprintf(key, sizeof(key), "%p", site);
+
+    std::unique_lock<std::mutex> lock(stackUsageMtx_);
+    auto it = stackUsage_.find(name ? name : key);
+    if (it == stackUsage_.end()) {
+        it = stackUsage_.emplace(name ? name : key, StackUsage()).first;
+        it->second.site_ = name ? std::string(name) : Profiler::Symbolize(site, true);
+    }
+
+    StackUsage& usage = it->second;
+    ++usage.samples_;
+    usage.maxBytes_ = std::max(usage.maxBytes_, used);
+    usage.totalBytes_ += used;
+    usage.stackSize_ = stackSize;
+}
+
+std::vector<CoDebugger::StackUsage> CoDebugger::GetStackUsage()
+{
+    std::vector<StackUsage> result;
+    std::unique_lock<std::mutex> lock(stackUsageMtx_);
+    result.reserve(stackUsage_.size());
+    for (auto const& kv : stackUsage_)
+        result.push_back(kv.second);
+    return result;
+}
+
+std::string CoDebugger::GetStackUsageInfo()
+{
+    std::vector<StackUsage> usages = GetStackUsage();
+    std::sort(usages.begin(), usages.end(), [](StackUsage const& a, StackUsage const& b){
+        return a.maxBytes_ > b.maxBytes_;
+    });
+
+    std::string info = "stack usage (samples / max / avg / stack / suggest):\n";
+    char line[128];
+    for (StackUsage const& u : usages) {
+        int sizeClass = StackPool::SizeClass(u.maxBytes_ * 2);
+        std::size_t suggest = sizeClass < 0 ? u.stackSize_ : StackPool::ClassSize(sizeClass);
+        snprintf(line, sizeof(line), "  %lu / %lu / %lu / %lu / %lu  ",
+                 (unsigned long)u.samples_, (unsigned long)u.maxBytes_,
+                 (unsigned long)(u.totalBytes_ / u.samples_), (unsigned long)u.stackSize_,
+                 (unsigned long)suggest);
+        info += line + u.site_ + "\n";
+    }
+    return info;
+}
+
+void CoDebugger::ResetStackUsage()
+{
+    std::unique_lock<std::mutex> lock(stackUsageMtx_);
+    stackUsage_.clear();
+}
+
+bool CoDebugger::StartProfiler(int hz)
+{
+    return Profiler::getInstance().Start(hz);
+}
+
+void CoDebugger::StopProfiler()
+{
+    Profiler::getInstance().Stop();
+}
+
+std::vector<CoDebugger::RoutineProfile> CoDebugger::GetProfile()
+{
+    return Profiler::getInstance().GetProfile();
+}
+
+std::string CoDebugger::GetProfileFolded()
+{
+    return Profiler::getInstance().GetFolded();
+}
+
+void CoDebugger::ResetProfile()
+{
+    Profiler::getInstance().Reset();
+}
+
+} // cxk
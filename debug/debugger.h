@@ -7,12 +7,15 @@
 
 #pragma once
 #include "concurrence/spinlock.h"
+#include "debug/debug_registry.h"
 #include "utils/utils.h"
+#include <atomic>
+#include <cstdint>
 #include <deque>
 #include <mutex>
 #include <map>
+#include <string>
 #include <vector>
-#include <unordered_set>
 
 #if defined(__GNUC__)
 #include <cxxabi.h>
@@ -31,43 +34,49 @@ public:
     template <typename T>
     class DebuggerBase
 #if ENABLE_DEBUGGER
-        : public ObjectCounter<T>
     {
     public:
         typedef DebuggerBase<T> this_type;
-        typedef std::unordered_set<this_type*> DbgMap;
+        typedef DebugRegistry<this_type> Registry;
 
     protected:
         DebuggerBase() {
-            std::unique_lock<std::mutex> lock(GetLock());
-            GetDbgMap().insert(this);
+            Registry::Register(&dbgNode_, this);
         }
 
         virtual ~DebuggerBase() {
-            std::unique_lock<std::mutex> lock(GetLock());
-            GetDbgMap().erase(this);
+            Registry::Unregister(&dbgNode_);
         }
 
-        static DbgMap& GetDbgMap() {
-            static DbgMap obj;
-            return obj;
+        /// @brief 派生类在析构开始时调用，之后遍历不会再访问到正在析构的派生部分
+        ALWAYS_INLINE void UnregisterDebugger() {
+            Registry::Unregister(&dbgNode_);
         }
 
-        static std::mutex& GetLock() {
-            static std::mutex obj;
-            return obj;
+    public:
+        /// @brief 当前存活的对象数量（近似值）
+        static long getCount() {
+            return (long)Registry::Size();
         }
 
-    public:
-        static std::shared_ptr<DbgMap> SafeGetDbgMap() {
-            GetLock().lock();
-            return std::shared_ptr<DbgMap>(&GetDbgMap(), [](DbgMap*){
-                        GetLock().unlock();
-                    });
+        /**
+         * @brief 遍历当前存活的对象，返回访问的数量
+         * 逐个分片加锁，不阻塞其他分片上的创建与析构，限制见DebugRegistry::ForEach
+         */
+        template <typename Fn>
+        static std::size_t ForEach(Fn const& fn) {
+            return Registry::ForEach([&](this_type* obj){ fn(static_cast<T*>(obj)); });
         }
+
+    private:
+        typename Registry::Node dbgNode_;
     };
 #else
     {
+    protected:
+        ALWAYS_INLINE void UnregisterDebugger() {}
+
+    public:
         ALWAYS_INLINE void Initialize() {}
     };
 #endif
@@ -93,11 +102,130 @@ public:
     // 获取当前协程的调试信息, 返回的内容包括用户自定义的信息和协程ID
     const char* GetCurrentTaskDebugInfo();
 
+    /// @brief 一个创建位置的栈使用量统计
+    struct StackUsage
+    {
+        std::string site_;              ///< 创建位置：TaskAttr::site_，或CreateTask调用者的符号
+        uint64_t samples_ = 0;          ///< 采样的协程数量
+        std::size_t maxBytes_ = 0;      ///< 最大栈使用量
+        std::size_t totalBytes_ = 0;    ///< 累计栈使用量，除以samples_为平均值
+        std::size_t stackSize_ = 0;     ///< 最近一次采样的栈容量
+    };
+
+    /**
+     * @brief 栈使用量采样：每rate个新协程采样一个，0表示关闭（默认）
+     * 私有栈协程创建时用花纹填充栈，结束时扫描最深的写入位置（精确，但采样的栈会提交全部物理内存）；
+     * 共享栈协程记录每次切出时的栈深度（只能看到切换点，是近似值）。
+     */
+    void SetStackProbeRate(uint32_t rate);
+
+    ALWAYS_INLINE uint32_t GetStackProbeRate() const {
+        return stackProbeRate_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief 记录一次采样（采样的协程结束时由Processor调用）
+    void RecordStackUsage(const void* site, const char* name, std::size_t used, std::size_t stackSize);
+
+    /// @brief 按创建位置聚合的栈使用量
+    std::vector<StackUsage> GetStackUsage();
+
+    /// @brief 栈使用量报告，每个创建位置一行，附带建议的栈大小（最大使用量的两倍向上取整到栈池尺寸等级）
+    std::string GetStackUsageInfo();
+
+    /// @brief 清空栈使用量统计
+    void ResetStackUsage();
+
+    /// @brief 运行队列等待时间直方图（从变为可运行到开始运行，按2的幂分桶）
+    struct LatencyHistogram
+    {
+        std::vector<double> boundsNs_;  ///< 各桶上界（纳秒，固定为2的幂），最后一个桶没有上界，不在其中
+        std::vector<uint64_t> counts_;  ///< 各桶的样本数（不累加），比boundsNs_多一个
+        uint64_t count_ = 0;            ///< 样本总数
+        double sumNs_ = 0;              ///< 样本总和（纳秒）
+    };
+
+    /// @brief 一个Processor的运行时指标，计数器自启动以来单调递增
+    struct ProcessorMetrics
+    {
+        int id_ = -1;                   ///< Processor编号，汇总项为-1
+        uint64_t switches_ = 0;         ///< 协程切入次数（包括直接切换）
+        uint64_t handoffs_ = 0;         ///< 不经过调度循环直接切换到runnext协程的次数
+        uint64_t yields_ = 0;           ///< 主动让出后重新排队的次数
+        uint64_t parks_ = 0;            ///< 挂起次数
+        uint64_t wakes_ = 0;            ///< 被唤醒后投递到本Processor的次数
+        uint64_t steals_ = 0;           ///< 成功窃取的次数
+        uint64_t stolenTasks_ = 0;      ///< 窃取到的任务数量
+        uint64_t remoteSteals_ = 0;     ///< 跨NUMA节点窃取成功的次数（包含在steals_中）
+        uint64_t tasksDone_ = 0;        ///< 执行完毕的协程数量
+        uint64_t preempts_ = 0;         ///< 运行超过时间片后在安全点让出的次数
+        uint64_t retakenTasks_ = 0;     ///< 运行超时或阻塞期间被Sysmon转移到其他Processor的任务数量
+        std::size_t runQueueDepth_ = 0; ///< 采集时运行队列的长度（近似值，不含尚未合并的唤醒队列）
+        int64_t stackBytes_ = 0;        ///< 在本Processor上开始运行、尚未结束的协程的私有栈字节数（结束在其他Processor时单项可能为负，汇总值准确）
+        LatencyHistogram runnableLatency_;  ///< 运行队列等待时间（抽样）
+    };
+
+    /// @brief 调度器指标快照
+    struct SchedulerMetrics
+    {
+        uint64_t timestampNs_ = 0;      ///< 采集时刻（steady_clock），两次快照的计数差除以时间差即为速率
+        uint32_t taskCount_ = 0;        ///< 未执行完毕的协程数量
+        std::vector<ProcessorMetrics> processors_;
+        ProcessorMetrics total_;        ///< 所有Processor的汇总
+        std::size_t stackMappedBytes_ = 0;  ///< 栈池当前mmap的总字节数（含缓存）
+        std::size_t stackCachedBytes_ = 0;  ///< 栈池全局链表缓存的字节数
+        std::size_t offloadQueueDepth_ = 0; ///< 卸载线程池中已提交、尚未开始执行的阻塞调用数量（见OffloadPool）
+        std::size_t offloadThreads_ = 0;    ///< 卸载线程数量
+        std::size_t offloadIdleThreads_ = 0;    ///< 空闲的卸载线程数量
+        uint64_t offloadCompleted_ = 0;     ///< 卸载线程执行完毕的调用总数
+    };
+
+    /**
+     * @brief 采集调度器指标
+     * 每个Processor的计数器只由它的工作线程写入（一次load+store，无原子RMW），
+     * 这里只做无锁读取与汇总，可以在任意线程周期性调用。
+     */
+    SchedulerMetrics GetMetrics();
+
+    /// @brief 按Prometheus文本格式输出指标，供exporter直接返回
+    std::string GetMetricsText();
+
+    /// @brief 一个标签（调试信息或创建位置）的协程分析结果
+    struct RoutineProfile
+    {
+        std::string label_;             ///< SetCurrentTaskDebugInfo设置的信息，或TaskAttr::site_，或CreateTask调用者的符号
+        uint64_t cpuNs_ = 0;            ///< 累计运行时间（纳秒）
+        uint64_t switches_ = 0;         ///< 切入次数
+        uint64_t samples_ = 0;          ///< 栈采样次数
+    };
+
+    /**
+     * @brief 开始协程分析（默认关闭），已经开始或hz不在[0, Profiler::kMaxHz]范围内时返回false
+     * 每次切换记录协程的运行时间；hz不为0时用SIGPROF每秒（进程CPU时间）采样hz次正在运行的协程的调用栈。
+     * 实现与限制见Profiler。
+     */
+    bool StartProfiler(int hz = 99);
+
+    /// @brief 停止协程分析，已收集的数据保留
+    void StopProfiler();
+
+    /// @brief 各标签的运行时间和采样次数，按运行时间从大到小排序
+    std::vector<RoutineProfile> GetProfile();
+
+    /// @brief 栈采样结果，folded stack格式（每行"标签;外层函数;...;内层函数 次数"），可直接交给flamegraph.pl
+    std::string GetProfileFolded();
+
+    /// @brief 清空协程分析数据
+    void ResetProfile();
+
 private:
     CoDebugger() = default;
     ~CoDebugger() = default;
     CoDebugger(CoDebugger const&) = delete;
     CoDebugger& operator=(CoDebugger const&) = delete;
+
+    std::atomic<uint32_t> stackProbeRate_{0};
+    std::mutex stackUsageMtx_;
+    std::map<std::string, StackUsage> stackUsage_;  ///< 创建位置 -> 统计，采样频率低，加锁即可
 };
 
 template <typename T>
@@ -0,0 +1,320 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "profiler.h"
+#include <scheduler/scheduler.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <dlfcn.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+namespace cxk
+{
+
+namespace
+{
+
+/// 一次栈采样，pcs_[0]为被中断的指令，之后由内向外为调用点（返回地址-1）
+struct ProfileSample
+{
+    ProfileEntry* entry_;
+    uint32_t depth_;
+    const void* pcs_[Profiler::kMaxDepth];
+};
+
+/// 单生产者（所属工作线程上的信号处理函数）单消费者（持有Profiler::mtx_的线程）的环形缓冲区
+struct ProfileRing
+{
+    alignas(64) atomic_t<uint64_t> head_{0};
+    alignas(64) atomic_t<uint64_t> tail_{0};
+    ProfileSample samples_[Profiler::kRingSize];
+};
+
+/// 按Processor编号索引，分配后不释放：信号处理函数随时可能访问
+atomic_t<ProfileRing*> g_rings[Profiler::kMaxRings];
+
+/// 沿帧指针回溯[sp, high)范围内的栈帧，只读取该范围内的地址
+__attribute__((no_sanitize_address))
+uint32_t WalkFrames(uintptr_t pc, uintptr_t fp, uintptr_t sp, uintptr_t high, const void** pcs)
+{
+    uint32_t depth = 0;
+    pcs[depth++] = (const void*)pc;
+    while (depth < (uint32_t)Profiler::kMaxDepth) {
+        if (fp < sp || fp + 2 * sizeof(uintptr_t) > high || (fp & (sizeof(uintptr_t) - 1)))
+            break;
+        uintptr_t next = ((uintptr_t*)fp)[0];
+        uintptr_t ret = ((uintptr_t*)fp)[1];
+        if (!ret) break;
+        pcs[depth++] = (const void*)(ret - 1);
+        if (next <= fp) break;  // 栈向低地址增长，外层帧一定在更高的地址
+        fp = next;
+    }
+    return depth;
+}
+
+/// 标签中的';'是folded格式的分隔符，换行会破坏行格式
+std::string FoldedLabel(std::string label)
+{
+    for (char& c : label) {
+        if (c == ';') c = ':';
+        else if (c == '\n' || c == '\r') c = ' ';
+    }
+    return label;
+}
+
+} // namespace
+
+Profiler& Profiler::getInstance()
+{
+    // 不析构：工作线程可能在进程退出时仍在记录
+    static Profiler* obj = new Profiler;
+    return *obj;
+}
+
+void Profiler::CpuClock::Switch(Task* next)
+{
+    uint64_t now = FastSteadyClock::Ticks();
+    if (task_) {
+        ProfileEntry* entry = task_->profEntry_;
+        if (!entry) entry = task_->profEntry_ = getInstance().Lookup(task_);
+        if (now > tick_) entry->ticks_.fetch_add(now - tick_, std::memory_order_relaxed);
+    }
+
+    task_ = IsEnabled() ? next : nullptr;
+    tick_ = now;
+    if (task_) {
+        if (!task_->profEntry_) task_->profEntry_ = getInstance().Lookup(task_);
+        task_->profEntry_->switches_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool Profiler::Start(int hz)
+{
+    if (hz < 0 || hz > kMaxHz) return false;
+
+    std::unique_lock<std::mutex> ctl(ctlMtx_);
+    if (IsEnabled()) return false;
+
+    // 工作线程数量可能在Start之后才确定，按CPU数量预留
+    std::size_t count = std::max<std::size_t>(Scheduler::getInstance().ProcessorCount(),
+                                              std::thread::hardware_concurrency());
+    count = std::min<std::size_t>(count, kMaxRings);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!g_rings[i].load(std::memory_order_relaxed))
+            g_rings[i].store(new ProfileRing, std::memory_order_release);
+    }
+
+    if (hz > 0 && !signalInstalled_) {
+        struct sigaction sa = {};
+        sa.sa_sigaction = &Profiler::OnSignal;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(SIGPROF, &sa, nullptr) != 0) return false;
+        signalInstalled_ = true;
+    }
+
+    Enabled().store(true, std::memory_order_release);
+
+    if (hz > 0) {
+        // tv_usec必须小于1000000，否则setitimer返回EINVAL（hz为1时间隔正好1秒）
+        struct itimerval tv = {};
+        tv.it_interval.tv_sec = 1 / hz;
+        tv.it_interval.tv_usec = (1000000 / hz) % 1000000;
+        tv.it_value = tv.it_interval;
+        if (setitimer(ITIMER_PROF, &tv, nullptr) != 0) {
+            Enabled().store(false, std::memory_order_release);
+            return false;
+        }
+    }
+
+    drainer_ = std::thread(&Profiler::DrainThread, this);
+    return true;
+}
+
+void Profiler::Stop()
+{
+    std::unique_lock<std::mutex> ctl(ctlMtx_);
+    if (!IsEnabled()) return;
+
+    struct itimerval tv = {};
+    setitimer(ITIMER_PROF, &tv, nullptr);
+    Enabled().store(false, std::memory_order_release);
+    if (drainer_.joinable()) drainer_.join();
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    DrainLocked();
+}
+
+void Profiler::Reset()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    DrainLocked();
+    folded_.clear();
+    for (auto& kv : entries_) {
+        ProfileEntry& entry = *kv.second;
+        entry.ticks_.store(0, std::memory_order_relaxed);
+        entry.switches_.store(0, std::memory_order_relaxed);
+        entry.samples_.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::Relabel(Task* tk)
+{
+    tk->profEntry_ = IsEnabled() ? getInstance().Lookup(tk) : nullptr;
+}
+
+ProfileEntry* Profiler::Lookup(Task* tk)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto entry = [&](std::string const& label) {
+        std::unique_ptr<ProfileEntry>& e = entries_[label];
+        if (!e) {
+            e.reset(new ProfileEntry);
+            e->label_ = label;
+        }
+        return e.get();
+    };
+
+    if (!tk->debugInfo_.empty())
+        return entry(tk->debugInfo_);
+
+    auto key = std::make_pair(tk->site_, (const char*)tk->siteName_);
+    auto it = sites_.find(key);
+    if (it != sites_.end()) return it->second;
+
+    ProfileEntry* e = entry(tk->siteName_ ? std::string(tk->siteName_) : Symbolize(tk->site_, true));
+    sites_.emplace(key, e);
+    return e;
+}
+
+std::vector<CoDebugger::RoutineProfile> Profiler::GetProfile()
+{
+    double ticksPerNs = FastSteadyClock::TicksPerNanosecond();
+    std::vector<CoDebugger::RoutineProfile> result;
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (auto const& kv : entries_) {
+        ProfileEntry const& entry = *kv.second;
+        CoDebugger::RoutineProfile p;
+        p.label_ = entry.label_;
+        uint64_t ticks = entry.ticks_.load(std::memory_order_relaxed);
+        p.cpuNs_ = ticksPerNs > 0 ? (uint64_t)((double)ticks / ticksPerNs) : 0;
+        p.switches_ = entry.switches_.load(std::memory_order_relaxed);
+        p.samples_ = entry.samples_.load(std::memory_order_relaxed);
+        if (p.switches_ || p.samples_)
+            result.push_back(std::move(p));
+    }
+    lock.unlock();
+
+    std::sort(result.begin(), result.end(), [](CoDebugger::RoutineProfile const& a, CoDebugger::RoutineProfile const& b) {
+        return a.cpuNs_ > b.cpuNs_;
+    });
+    return result;
+}
+
+std::string Profiler::GetFolded()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    DrainLocked();
+
+    std::string out;
+    for (auto const& kv : folded_) {
+        out += kv.first;
+        out += ' ';
+        out += std::to_string(kv.second);
+        out += '\n';
+    }
+    return out;
+}
+
+std::string Profiler::Symbolize(const void* pc, bool withOffset)
+{
+    char buf[64];
+    Dl_info info;
+    if (pc && dladdr(pc, &info) && info.dli_sname) {
+        std::string name = info.dli_sname;
+#if defined(__GNUC__)
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        if (demangled) {
+            if (status == 0) name = demangled;
+            free(demangled);
+        }
+#endif
+        if (!withOffset) return name;
+        snprintf(buf, sizeof(buf), "+0x%lx", (unsigned long)((const char*)pc - (const char*)info.dli_saddr));
+        return name + buf;
+    }
+    snprintf(buf, sizeof(buf), "%p", pc);
+    return buf;
+}
+
+void Profiler::DrainLocked()
+{
+    for (int i = 0; i < kMaxRings; ++i) {
+        ProfileRing* ring = g_rings[i].load(std::memory_order_acquire);
+        if (!ring) break;
+
+        uint64_t tail = ring->tail_.load(std::memory_order_relaxed);
+        uint64_t head = ring->head_.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            ProfileSample const& sample = ring->samples_[tail & (kRingSize - 1)];
+            std::string key = FoldedLabel(sample.entry_->label_);
+            for (uint32_t d = sample.depth_; d > 0; --d) {
+                const void* pc = sample.pcs_[d - 1];
+                auto it = symbols_.find(pc);
+                if (it == symbols_.end())
+                    it = symbols_.emplace(pc, FoldedLabel(Symbolize(pc, false))).first;
+                key += ';';
+                key += it->second;
+            }
+            ++folded_[key];
+        }
+        ring->tail_.store(tail, std::memory_order_release);
+    }
+}
+
+void Profiler::DrainThread()
+{
+    while (IsEnabled()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::unique_lock<std::mutex> lock(mtx_);
+        DrainLocked();
+    }
+}
+
+void Profiler::OnSignal(int, siginfo_t*, void* ucontext)
+{
+#if defined(__x86_64__) && defined(__linux__)
+    if (!IsEnabled()) return;
+    int savedErrno = errno;
+
+    Processor* proc = Processor::GetCurrentProcessor();
+    Task* tk = proc ? Processor::GetCurrentTask() : nullptr;
+    ProfileRing* ring = proc && proc->Id() < kMaxRings ? g_rings[proc->Id()].load(std::memory_order_acquire) : nullptr;
+    if (tk && ring && tk->profEntry_) {
+        mcontext_t const& mc = ((ucontext_t*)ucontext)->uc_mcontext;
+        uintptr_t sp = (uintptr_t)mc.gregs[REG_RSP];
+        uintptr_t low = (uintptr_t)tk->ctx_.StackLow();
+        uintptr_t high = (uintptr_t)tk->ctx_.StackHigh();
+        // 只记录落在协程栈上的样本：切入前/切出后的调度代码运行在线程栈上
+        uint64_t head = ring->head_.load(std::memory_order_relaxed);
+        if (sp >= low && sp < high && head - ring->tail_.load(std::memory_order_acquire) < (uint64_t)kRingSize) {
+            ProfileSample& sample = ring->samples_[head & (kRingSize - 1)];
+            sample.entry_ = tk->profEntry_;
+            sample.depth_ = WalkFrames((uintptr_t)mc.gregs[REG_RIP], (uintptr_t)mc.gregs[REG_RBP], sp, high, sample.pcs_);
+            ring->head_.store(head + 1, std::memory_order_release);
+            tk->profEntry_->samples_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    errno = savedErrno;
+#else
+    (void)ucontext;
+#endif
+}
+
+} // cxk
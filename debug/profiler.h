@@ -0,0 +1,134 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_PROFILER_H
+#define GOCOROUTINE_PROFILER_H
+
+#pragma once
+#include "debug/debugger.h"
+#include "utils/utils.h"
+#include <csignal>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cxk
+{
+
+struct Task;
+
+/// @brief 一个标签的累计数据：创建后不释放（Reset只清零），协程缓存指向它的指针
+struct ProfileEntry
+{
+    std::string label_;
+    atomic_t<uint64_t> ticks_{0};       ///< 运行时间（FastSteadyClock::Ticks()）
+    atomic_t<uint64_t> switches_{0};    ///< 切入次数
+    atomic_t<uint64_t> samples_{0};     ///< SIGPROF采样次数
+};
+
+/*
+ * @brief 协程采样分析器，默认关闭（见CoDebugger::StartProfiler）
+ *
+ * 两部分数据，都记到协程的标签上：SetCurrentTaskDebugInfo设置的信息，其次TaskAttr::site_，
+ * 最后是CreateTask调用者的符号。
+ *  - CPU时间：Processor每次切换读一次FastSteadyClock::Ticks()，把上一段运行时间记给切出的协程；
+ *  - 调用栈：SIGPROF按进程CPU时间周期触发，落在正在运行协程的工作线程上时，从信号上下文的
+ *    帧指针沿协程栈回溯（只访问协程栈范围内的地址，异步信号安全），写入该Processor的无锁环形缓冲区。
+ *    后台线程定期取出样本、解析符号，聚合为folded stack格式（flamegraph.pl直接可用）。
+ *
+ * 回溯依赖帧指针，完整的调用栈需要用-fno-omit-frame-pointer编译（CMake选项ENABLE_FRAME_POINTERS）。
+ * SIGPROF和ITIMER_PROF是进程级的，不能与其他使用它们的工具（如gperftools）同时使用；
+ * 信号处理函数安装后不再卸载，避免停止时仍在途的信号按默认行为终止进程。
+ */
+class Profiler
+{
+public:
+    static constexpr int kMaxDepth = 32;        ///< 每个样本最多记录的栈帧数
+    static constexpr int kRingSize = 512;       ///< 每个Processor的样本缓冲区容量（2的幂）
+    static constexpr int kMaxRings = 256;       ///< 支持采样的Processor数量上限
+    static constexpr int kMaxHz = 1000000;      ///< 采样频率上限：间隔最短1微秒（setitimer的精度）
+
+    /// @brief Processor的计时状态（仅所属工作线程访问）
+    struct CpuClock
+    {
+        Task* task_ = nullptr;      ///< 正在计时的协程
+        uint64_t tick_ = 0;         ///< 开始计时的时刻
+
+        /// @brief 结算task_的运行时间，开始给next计时（nullptr表示回到调度循环）
+        void Switch(Task* next);
+    };
+
+    static Profiler& getInstance();
+
+    ALWAYS_INLINE static bool IsEnabled() {
+        return Enabled().load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 开始分析
+     * @param hz 每秒（进程CPU时间）的栈采样次数，0表示只统计CPU时间
+     * @return 已经开始、hz不在[0, kMaxHz]范围内或设置定时器失败时返回false
+     */
+    bool Start(int hz);
+
+    /// @brief 停止分析，已收集的数据保留
+    void Stop();
+
+    /// @brief 清空已收集的数据
+    void Reset();
+
+    /// @brief 当前协程的标签变化（SetCurrentTaskDebugInfo）后重新查找统计项
+    static void Relabel(Task* tk);
+
+    /// @brief 各标签的统计，按CPU时间从大到小排序
+    std::vector<CoDebugger::RoutineProfile> GetProfile();
+
+    /// @brief folded stack格式的采样结果：每行"标签;最外层函数;...;最内层函数 次数"
+    std::string GetFolded();
+
+    /// @brief 把地址解析为函数名（可选附带偏移），没有符号时返回地址本身
+    static std::string Symbolize(const void* pc, bool withOffset);
+
+private:
+    Profiler() = default;
+    ~Profiler() = default;
+    Profiler(Profiler const&) = delete;
+    Profiler& operator=(Profiler const&) = delete;
+
+    static atomic_t<bool>& Enabled() {
+        static atomic_t<bool> obj{false};
+        return obj;
+    }
+
+    /// 查找（或创建）协程当前标签的统计项
+    ProfileEntry* Lookup(Task* tk);
+
+    /// 取出所有缓冲区中的样本并聚合，调用者持有mtx_
+    void DrainLocked();
+
+    /// 后台线程：定期取出样本，避免缓冲区写满后丢弃
+    void DrainThread();
+
+    static void OnSignal(int sig, siginfo_t* info, void* ucontext);
+
+    std::mutex mtx_;
+    std::map<std::string, std::unique_ptr<ProfileEntry>> entries_;      ///< 标签 -> 统计项
+    std::map<std::pair<const void*, const char*>, ProfileEntry*> sites_;  ///< 创建位置 -> 统计项，避免每个协程都解析符号
+    std::map<std::string, uint64_t> folded_;                            ///< 调用栈 -> 采样次数
+    std::unordered_map<const void*, std::string> symbols_;              ///< 地址 -> 函数名
+
+    std::mutex ctlMtx_;         ///< 串行化Start/Stop
+    std::thread drainer_;
+    bool signalInstalled_ = false;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_PROFILER_H
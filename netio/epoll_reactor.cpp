@@ -0,0 +1,96 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "epoll_reactor.h"
+#include "fd_context.h"
+#include <common/error.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace cxk
+{
+
+EpollReactor::EpollReactor(Processor* owner)
+    : Reactor(owner)
+{
+    epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    eventFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd_ < 0 || eventFd_ < 0) {
+        ThrowError(eCoErrorCode::ec_reactor_init_failed);
+        return;
+    }
+
+    epoll_event ev;
+    ev.events = EPOLLIN;   // 水平触发，Poll中读空
+    ev.data.ptr = nullptr;
+    if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, eventFd_, &ev) < 0)
+        ThrowError(eCoErrorCode::ec_reactor_init_failed);
+}
+
+EpollReactor::~EpollReactor()
+{
+    if (eventFd_ >= 0) ::close(eventFd_);
+    if (epfd_ >= 0) ::close(epfd_);
+}
+
+bool EpollReactor::Add(int fd, FdContext* ctx)
+{
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = ctx;
+    if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == 0)
+        return true;
+
+    // fd被直接close后复用，内核中的注册已经随之删除；这里只处理dup出的fd仍在集合中的情况
+    return errno == EEXIST && ::epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EpollReactor::Del(int fd, FdContext* ctx)
+{
+    (void)ctx;
+    epoll_event ev;
+    ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, &ev);
+}
+
+int EpollReactor::Poll(std::chrono::nanoseconds timeout)
+{
+    int ms;
+    if (timeout == std::chrono::nanoseconds::max()) {
+        ms = -1;
+    } else if (timeout.count() <= 0) {
+        ms = 0;
+    } else {
+        ms = (int)std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+    }
+
+    int n = ::epoll_wait(epfd_, events_, kMaxEvents, ms);
+    if (n <= 0) return 0;
+
+    int c = 0;
+    for (int i = 0; i < n; ++i) {
+        epoll_event & ev = events_[i];
+        if (!ev.data.ptr) {
+            uint64_t v;
+            while (::read(eventFd_, &v, sizeof(v)) > 0) ;
+            continue;
+        }
+
+        FdContext* ctx = static_cast<FdContext*>(ev.data.ptr);
+        bool error = ev.events & (EPOLLERR | EPOLLHUP);
+        ctx->OnEvent(error || (ev.events & (EPOLLIN | EPOLLRDHUP | EPOLLPRI)),
+                     error || (ev.events & EPOLLOUT));
+        ++c;
+    }
+    return c;
+}
+
+void EpollReactor::Notify()
+{
+    uint64_t one = 1;
+    ssize_t ret = ::write(eventFd_, &one, sizeof(one));
+    (void)ret;
+}
+
+} // cxk
@@ -0,0 +1,42 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_EPOLL_REACTOR_H
+#define GOCOROUTINE_EPOLL_REACTOR_H
+
+#pragma once
+#include "reactor.h"
+#include <sys/epoll.h>
+
+namespace cxk
+{
+
+/*
+ * @brief 基于epoll的Reactor（边沿触发）
+ * 额外注册一个eventfd（水平触发）用于Notify打断epoll_wait。
+ */
+class EpollReactor : public Reactor
+{
+public:
+    explicit EpollReactor(Processor* owner);
+    ~EpollReactor() override;
+
+    Backend GetBackend() const override { return kEpoll; }
+
+    bool Add(int fd, FdContext* ctx) override;
+    void Del(int fd, FdContext* ctx) override;
+    int Poll(std::chrono::nanoseconds timeout) override;
+    void Notify() override;
+
+private:
+    static constexpr int kMaxEvents = 128;
+
+    int epfd_ = -1;
+    int eventFd_ = -1;
+    epoll_event events_[kMaxEvents];
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_EPOLL_REACTOR_H
@@ -0,0 +1,157 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "fd_context.h"
+#include "reactor.h"
+#include <fcntl.h>
+
+namespace cxk
+{
+
+bool FdContext::Prepare(int fd)
+{
+    int state = state_.load(std::memory_order_acquire);
+    if (state != kInit) return state == kManaged;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    state = state_.load(std::memory_order_relaxed);
+    if (state != kInit) return state == kManaged;
+
+    Reactor* reactor = Reactor::Select(fd);
+    if (!reactor) return false;     // 调度器未启动，之后还可以再尝试
+
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0) return false;    // 非法fd
+
+    if (flags & O_NONBLOCK) {
+        // 用户自己要求非阻塞语义，保持原样
+        state_.store(kUnmanaged, std::memory_order_release);
+        return false;
+    }
+
+    if (::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        state_.store(kUnmanaged, std::memory_order_release);
+        return false;
+    }
+
+    if (!reactor->Add(fd, this)) {
+        // 普通文件等不支持epoll的fd
+        ::fcntl(fd, F_SETFL, flags);
+        state_.store(kUnmanaged, std::memory_order_release);
+        return false;
+    }
+
+    fd_ = fd;
+    reactor_ = reactor;
+    state_.store(kManaged, std::memory_order_release);
+    return true;
+}
+
+bool FdContext::Wait(int dir, uint64_t seq, time_point const* deadline)
+{
+    ParkLocal<IoWaiter> w(ParkOffStack());
+    Reactor* reactor;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (state_.load(std::memory_order_relaxed) != kManaged) return true;   // 已被co_close
+        if (seq_[dir].load(std::memory_order_relaxed) != seq) return true;     // 期间已经就绪
+
+        waiters_[dir].push(w.get());
+        w->linked_ = true;
+        reactor = reactor_;
+        if (!armed_[dir]) {
+            armed_[dir] = true;
+            reactor->Arm(fd_, this, dir);
+        }
+    }
+
+    reactor->AddWaiter();
+    while (w->rutex_.value()->load(std::memory_order_acquire) == 0) {
+        RutexBase::rutex_wait_return ret = deadline ? w->rutex_.wait_until(0, *deadline) : w->rutex_.wait(0);
+        if (ret == RutexBase::rutex_wait_return_etimeout) break;
+    }
+    reactor->RemoveWaiter();
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (w->linked_) {
+        waiters_[dir].unlink(w.get());
+        w->linked_ = false;
+    }
+    return w->rutex_.value()->load(std::memory_order_relaxed) != 0;
+}
+
+void FdContext::OnEvent(bool readable, bool writable)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (readable) {
+        armed_[kRead] = false;
+        WakeAllLocked(kRead);
+    }
+    if (writable) {
+        armed_[kWrite] = false;
+        WakeAllLocked(kWrite);
+    }
+}
+
+void FdContext::Reset()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (state_.load(std::memory_order_relaxed) == kManaged) {
+        reactor_->Del(fd_, this);
+        WakeAllLocked(kRead);
+        WakeAllLocked(kWrite);
+    }
+    fd_ = -1;
+    reactor_ = nullptr;
+    armed_[kRead] = armed_[kWrite] = false;
+    timeout_[kRead].store(0, std::memory_order_relaxed);
+    timeout_[kWrite].store(0, std::memory_order_relaxed);
+    state_.store(kInit, std::memory_order_release);
+}
+
+void FdContext::WakeAllLocked(int dir)
+{
+    seq_[dir].fetch_add(1, std::memory_order_acq_rel);
+    while (LinkedNode* node = waiters_[dir].front()) {
+        waiters_[dir].unlink(node);
+        IoWaiter* w = static_cast<IoWaiter*>(node);
+        w->linked_ = false;
+        w->rutex_.value()->store(1, std::memory_order_release);
+        w->rutex_.wake_one();
+    }
+}
+
+FdTable& FdTable::getInstance()
+{
+    // 不析构：进程退出时Reactor中可能仍有事件指向FdContext
+    static FdTable* obj = new FdTable;
+    return *obj;
+}
+
+FdContext* FdTable::Get(int fd)
+{
+    if (fd < 0 || fd >= kChunkSize * kChunkCount) return nullptr;
+
+    std::atomic<FdContext*> & slot = chunks_[fd >> kChunkBits];
+    FdContext* chunk = slot.load(std::memory_order_acquire);
+    if (!chunk) {
+        FdContext* fresh = new FdContext[kChunkSize];
+        if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            chunk = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return &chunk[fd & (kChunkSize - 1)];
+}
+
+FdContext* FdTable::Find(int fd)
+{
+    if (fd < 0 || fd >= kChunkSize * kChunkCount) return nullptr;
+
+    FdContext* chunk = chunks_[fd >> kChunkBits].load(std::memory_order_acquire);
+    return chunk ? &chunk[fd & (kChunkSize - 1)] : nullptr;
+}
+
+} // cxk
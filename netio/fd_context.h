@@ -0,0 +1,127 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_FD_CONTEXT_H
+#define GOCOROUTINE_FD_CONTEXT_H
+
+#pragma once
+#include <utils/utils.h>
+#include <concurrence/linked_list.h>
+#include <concurrence/rutex.h>
+#include <concurrence/park_local.h>
+#include <concurrence/timer.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace cxk
+{
+
+class Reactor;
+
+/// @brief 等待fd事件的协程（位于等待者栈上，共享栈协程放在堆上）
+struct IoWaiter : public LinkedNode
+{
+    Rutex<int> rutex_;      ///< 0: 等待中；1: 就绪（由Reactor或co_close设置）
+    bool linked_ = false;   ///< 是否仍在等待链表中，仅在持有FdContext锁时访问
+};
+
+/*
+ * @brief fd的协程IO状态
+ * 第一次在协程中使用时把fd设置为O_NONBLOCK，并以边沿触发方式注册到fd对应的Reactor，
+ * 之后一直保持注册，直到co_close。
+ *
+ * 边沿触发只在状态变化时通知一次，因此每个方向维护一个事件序号：IO操作前记下序号，
+ * 遇到EAGAIN准备挂起时在锁内比较序号，变化说明期间已经就绪，直接重试而不挂起。
+ */
+class FdContext
+{
+public:
+    enum { kRead = 0, kWrite = 1 };
+
+    typedef RoutineSyncTimer::time_point time_point;
+
+    /**
+     * @brief 确保fd由协程IO管理（线程安全，只初始化一次）
+     * @return false: fd不能注册到Reactor（普通文件等），或用户自己设置了O_NONBLOCK，应直接调用系统调用
+     */
+    bool Prepare(int fd);
+
+    /// @brief 是否已由协程IO管理（fd被设置为了O_NONBLOCK）
+    ALWAYS_INLINE bool IsManaged() const {
+        return state_.load(std::memory_order_acquire) == kManaged;
+    }
+
+    ALWAYS_INLINE uint64_t Seq(int dir) const {
+        return seq_[dir].load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 挂起当前协程，直到dir方向就绪、超时或co_close
+     * @param seq IO操作前的事件序号
+     * @param deadline 超时时刻，nullptr表示不超时
+     * @return true: 可以重试IO操作；false: 超时
+     */
+    bool Wait(int dir, uint64_t seq, time_point const* deadline);
+
+    /// @brief Reactor回调：fd上有事件到达，唤醒对应方向的所有等待者
+    void OnEvent(bool readable, bool writable);
+
+    /// @brief co_close时调用：唤醒所有等待者，从Reactor注销并复位状态
+    void Reset();
+
+    /// @brief SO_RCVTIMEO/SO_SNDTIMEO，0表示不超时
+    ALWAYS_INLINE std::chrono::nanoseconds GetTimeout(int dir) const {
+        return std::chrono::nanoseconds(timeout_[dir].load(std::memory_order_relaxed));
+    }
+
+    ALWAYS_INLINE void SetTimeout(int dir, std::chrono::nanoseconds timeout) {
+        timeout_[dir].store(timeout.count(), std::memory_order_relaxed);
+    }
+
+private:
+    enum { kInit, kManaged, kUnmanaged };
+
+    /// 锁内唤醒：等待者返回前必须重新获取锁，保证唤醒期间栈上的IoWaiter有效
+    void WakeAllLocked(int dir);
+
+    std::mutex mtx_;
+    std::atomic<int> state_{kInit};
+    int fd_ = -1;
+    Reactor* reactor_ = nullptr;
+    LinkedList waiters_[2];
+    bool armed_[2] = {false, false};    ///< 已通过Reactor::Arm注册了单次事件，尚未触发
+    std::atomic<uint64_t> seq_[2] = {{0}, {0}};
+    std::atomic<int64_t> timeout_[2] = {{0}, {0}};
+};
+
+/*
+ * @brief fd -> FdContext映射表
+ * 两级数组，按需分配整块，FdContext一旦分配就不再释放（Reactor中可能还有指向它的未处理事件），
+ * fd复用时由co_close复位。
+ */
+class FdTable
+{
+public:
+    static FdTable& getInstance();
+
+    /// @brief 获取fd的上下文，不存在时创建；fd非法时返回nullptr
+    FdContext* Get(int fd);
+
+    /// @brief 获取fd的上下文，不存在时返回nullptr
+    FdContext* Find(int fd);
+
+private:
+    static constexpr int kChunkBits = 12;
+    static constexpr int kChunkSize = 1 << kChunkBits;
+    static constexpr int kChunkCount = 1024;
+
+    FdTable() = default;
+
+    std::atomic<FdContext*> chunks_[kChunkCount] = {};
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_FD_CONTEXT_H
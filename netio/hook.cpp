@@ -0,0 +1,375 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "hook.h"
+#include "fd_context.h"
+#include "uring_reactor.h"
+#include <scheduler/scheduler.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+
+namespace cxk
+{
+
+namespace
+{
+
+typedef FdContext::time_point time_point;
+
+/// 协程中可以托管的fd返回其上下文；否则返回nullptr，由调用者直接执行系统调用
+FdContext* CoroutineFd(int fd)
+{
+    if (!Processor::IsCoroutine()) return nullptr;
+    FdContext* ctx = FdTable::getInstance().Get(fd);
+    return ctx && ctx->Prepare(fd) ? ctx : nullptr;
+}
+
+/// 普通线程中使用已被托管（已设置为O_NONBLOCK）的fd时，用poll模拟阻塞
+FdContext* ManagedFd(int fd)
+{
+    FdContext* ctx = FdTable::getInstance().Find(fd);
+    return ctx && ctx->IsManaged() ? ctx : nullptr;
+}
+
+int ToPollTimeout(std::chrono::nanoseconds timeout)
+{
+    if (timeout.count() <= 0) return -1;
+    return (int)std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+}
+
+/// @return true: 就绪；false: 超时
+bool ThreadWait(int fd, int dir, std::chrono::nanoseconds timeout)
+{
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = dir == FdContext::kRead ? POLLIN : POLLOUT;
+    pfd.revents = 0;
+    int ret;
+    do {
+        ret = ::poll(&pfd, 1, ToPollTimeout(timeout));
+    } while (ret < 0 && errno == EINTR);
+    return ret != 0;
+}
+
+time_point* MakeDeadline(FdContext* ctx, int dir, time_point & deadline)
+{
+    std::chrono::nanoseconds timeout = ctx->GetTimeout(dir);
+    if (timeout.count() <= 0) return nullptr;
+    deadline = RoutineSyncTimer::clock_type::now() +
+            std::chrono::duration_cast<time_point::duration>(timeout);
+    return &deadline;
+}
+
+ALWAYS_INLINE bool IsAgain()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+/**
+ * 协程中：遇到EAGAIN挂起等待dir方向就绪后重试；
+ * 线程中：fd已被托管时用poll等待后重试，否则就是普通的阻塞调用
+ */
+template <typename F>
+ssize_t DoIo(int fd, int dir, F const& fn)
+{
+    if (FdContext* ctx = CoroutineFd(fd)) {
+        Processor::CheckPreempt();  // 一直有数据可读写时不会挂起，这里是运行超时后让出的安全点
+        time_point deadline;
+        time_point* pdeadline = MakeDeadline(ctx, dir, deadline);
+        for (;;) {
+            uint64_t seq = ctx->Seq(dir);
+            ssize_t n = fn();
+            if (n >= 0) return n;
+            if (errno == EINTR) continue;
+            if (!IsAgain()) return n;
+            if (!ctx->Wait(dir, seq, pdeadline)) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+    }
+
+    for (;;) {
+        ssize_t n = fn();
+        if (n >= 0 || !IsAgain()) return n;
+
+        FdContext* ctx = ManagedFd(fd);
+        if (!ctx) return n;
+        if (!ThreadWait(fd, dir, ctx->GetTimeout(dir))) {
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+}
+
+/// 非阻塞connect已发起，检查是否已经完成（成功或失败）
+bool ConnectFinished(int fd)
+{
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    return ::poll(&pfd, 1, 0) > 0;
+}
+
+int ConnectResult(int fd)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        return -1;
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+/// 当前协程所在Processor的io_uring，不可用时返回nullptr
+UringReactor* CurrentUring()
+{
+    if (!Processor::IsCoroutine()) return nullptr;
+    Reactor* reactor = Processor::GetCurrentProcessor()->GetReactor();
+    return reactor->GetBackend() == Reactor::kUring ? static_cast<UringReactor*>(reactor) : nullptr;
+}
+
+ssize_t UringIoImpl(bool write, int fd, void* buf, size_t count, off_t offset, UringIoOptions const* opt)
+{
+    UringReactor* uring = CurrentUring();
+    bool fixedFile = opt && opt->fixedFile;
+    if (!uring) {
+        if (fixedFile) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (offset < 0)
+            return write ? co_write(fd, buf, count) : co_read(fd, buf, count);
+        return write ? ::pwrite(fd, buf, count, offset) : ::pread(fd, buf, count, offset);
+    }
+
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    bool fixedBuf = opt && opt->bufIndex >= 0;
+    if (fixedBuf) {
+        sqe.opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe.buf_index = (uint16_t)opt->bufIndex;
+    } else {
+        sqe.opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+    if (fixedFile) sqe.flags |= IOSQE_FIXED_FILE;
+    sqe.fd = fd;
+    sqe.addr = (uint64_t)(uintptr_t)buf;
+    sqe.len = (uint32_t)count;
+    sqe.off = offset < 0 ? (uint64_t)-1 : (uint64_t)offset;
+
+    int dir = write ? FdContext::kWrite : FdContext::kRead;
+    time_point deadline;
+    time_point* pdeadline = nullptr;
+    FdContext* ctx = fixedFile ? nullptr : FdTable::getInstance().Find(fd);
+    if (ctx) pdeadline = MakeDeadline(ctx, dir, deadline);
+
+    for (;;) {
+        int32_t res = uring->Submit(sqe, pdeadline);
+        if (res >= 0) return res;
+
+        if (res == -EAGAIN && ctx && ctx->IsManaged() && offset < 0 && !fixedBuf) {
+            // io_uring对O_NONBLOCK的fd同样返回EAGAIN：已被就绪通知接管的fd走co_read/co_write
+            return write ? co_write(fd, buf, count) : co_read(fd, buf, count);
+        }
+        if (res == -EINTR && !pdeadline) continue;
+        if ((res == -ECANCELED || res == -EINTR) && pdeadline) {
+            errno = EAGAIN;     // 超时被取消
+            return -1;
+        }
+        errno = -res;
+        return -1;
+    }
+}
+
+/// buf是否位于当前协程绑定的共享栈上
+bool OnSharedStack(void const* buf, size_t count)
+{
+    Task* tk = Processor::GetCurrentTask();
+    SharedStack* stack = tk ? tk->ctx_.GetSharedStack() : nullptr;
+    if (!stack) return false;
+    char const* p = static_cast<char const*>(buf);
+    return p < stack->Top() && p + count > stack->Base();
+}
+
+ssize_t UringIo(bool write, int fd, void* buf, size_t count, off_t offset, UringIoOptions const* opt)
+{
+    bool fixedBuf = opt && opt->bufIndex >= 0;
+    if (fixedBuf || !OnSharedStack(buf, count))
+        return UringIoImpl(write, fd, buf, count, offset, opt);
+
+    // 共享栈协程挂起期间栈会被覆盖，内核不能直接读写栈上的缓冲区：经堆上的副本中转
+    std::unique_ptr<char[]> bounce(new char[count]);
+    if (write) memcpy(bounce.get(), buf, count);
+    ssize_t res = UringIoImpl(write, fd, bounce.get(), count, offset, opt);
+    if (!write && res > 0) memcpy(buf, bounce.get(), (size_t)res);
+    return res;
+}
+
+template <typename F>
+int ForEachUring(F const& fn)
+{
+    Scheduler& scheduler = Scheduler::getInstance();
+    std::size_t count = scheduler.ProcessorCount();
+    if (count == 0) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        Reactor* reactor = scheduler.GetProcessor(i)->GetReactor();
+        if (reactor->GetBackend() != Reactor::kUring) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        int ret = fn(static_cast<UringReactor*>(reactor));
+        if (ret < 0) {
+            errno = -ret;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int co_connect(int fd, const struct sockaddr* addr, socklen_t addrlen)
+{
+    FdContext* ctx = CoroutineFd(fd);
+    if (!ctx) {
+        int ret = ::connect(fd, addr, addrlen);
+        if (ret == 0 || errno != EINPROGRESS) return ret;
+
+        FdContext* managed = ManagedFd(fd);
+        if (!managed) return ret;
+        if (!ThreadWait(fd, FdContext::kWrite, managed->GetTimeout(FdContext::kWrite))) {
+            errno = EINPROGRESS;
+            return -1;
+        }
+        return ConnectResult(fd);
+    }
+
+    time_point deadline;
+    time_point* pdeadline = MakeDeadline(ctx, FdContext::kWrite, deadline);
+    uint64_t seq = ctx->Seq(FdContext::kWrite);
+    int ret = ::connect(fd, addr, addrlen);
+    if (ret == 0 || errno != EINPROGRESS) return ret;
+
+    while (!ConnectFinished(fd)) {
+        if (!ctx->Wait(FdContext::kWrite, seq, pdeadline)) {
+            errno = EINPROGRESS;
+            return -1;
+        }
+        seq = ctx->Seq(FdContext::kWrite);
+    }
+    return ConnectResult(fd);
+}
+
+int co_accept(int fd, struct sockaddr* addr, socklen_t* addrlen)
+{
+    return (int)DoIo(fd, FdContext::kRead, [&]{ return (ssize_t)::accept(fd, addr, addrlen); });
+}
+
+ssize_t co_read(int fd, void* buf, size_t count)
+{
+    return DoIo(fd, FdContext::kRead, [&]{ return ::read(fd, buf, count); });
+}
+
+ssize_t co_write(int fd, const void* buf, size_t count)
+{
+    return DoIo(fd, FdContext::kWrite, [&]{ return ::write(fd, buf, count); });
+}
+
+ssize_t co_recv(int fd, void* buf, size_t len, int flags)
+{
+    return DoIo(fd, FdContext::kRead, [&]{ return ::recv(fd, buf, len, flags); });
+}
+
+ssize_t co_send(int fd, const void* buf, size_t len, int flags)
+{
+    return DoIo(fd, FdContext::kWrite, [&]{ return ::send(fd, buf, len, flags); });
+}
+
+ssize_t co_recvfrom(int fd, void* buf, size_t len, int flags, struct sockaddr* src_addr, socklen_t* addrlen)
+{
+    return DoIo(fd, FdContext::kRead, [&]{ return ::recvfrom(fd, buf, len, flags, src_addr, addrlen); });
+}
+
+ssize_t co_sendto(int fd, const void* buf, size_t len, int flags, const struct sockaddr* dest_addr, socklen_t addrlen)
+{
+    return DoIo(fd, FdContext::kWrite, [&]{ return ::sendto(fd, buf, len, flags, dest_addr, addrlen); });
+}
+
+int co_setsockopt(int fd, int level, int optname, const void* optval, socklen_t optlen)
+{
+    if (level == SOL_SOCKET && (optname == SO_RCVTIMEO || optname == SO_SNDTIMEO)
+            && optval && optlen >= (socklen_t)sizeof(timeval)) {
+        if (FdContext* ctx = FdTable::getInstance().Get(fd)) {
+            const timeval* tv = static_cast<const timeval*>(optval);
+            std::chrono::nanoseconds timeout = std::chrono::seconds(tv->tv_sec) + std::chrono::microseconds(tv->tv_usec);
+            ctx->SetTimeout(optname == SO_RCVTIMEO ? FdContext::kRead : FdContext::kWrite, timeout);
+        }
+    }
+    return ::setsockopt(fd, level, optname, optval, optlen);
+}
+
+int co_close(int fd)
+{
+    if (FdContext* ctx = FdTable::getInstance().Find(fd))
+        ctx->Reset();
+    return ::close(fd);
+}
+
+int co_wait_fd(int fd, short events, int timeoutMs)
+{
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    FdContext* ctx = CoroutineFd(fd);
+    if (!ctx) return ::poll(&pfd, 1, timeoutMs);
+
+    // 只等待一个方向：同时指定时等待可读
+    int dir = (events & POLLIN) ? FdContext::kRead : FdContext::kWrite;
+    time_point deadline = RoutineSyncTimer::clock_type::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        uint64_t seq = ctx->Seq(dir);
+        int ret = ::poll(&pfd, 1, 0);
+        if (ret != 0) return ret;
+        if (timeoutMs == 0) return 0;
+        if (!ctx->Wait(dir, seq, timeoutMs > 0 ? &deadline : nullptr))
+            return 0;
+    }
+}
+
+ssize_t co_uring_read(int fd, void* buf, size_t count, off_t offset, UringIoOptions const* opt)
+{
+    return UringIo(false, fd, buf, count, offset, opt);
+}
+
+ssize_t co_uring_write(int fd, const void* buf, size_t count, off_t offset, UringIoOptions const* opt)
+{
+    return UringIo(true, fd, const_cast<void*>(buf), count, offset, opt);
+}
+
+int co_uring_register_buffers(const struct iovec* iov, unsigned count)
+{
+    return ForEachUring([&](UringReactor* uring){ return uring->RegisterBuffers(iov, count); });
+}
+
+int co_uring_register_files(const int* fds, unsigned count)
+{
+    return ForEachUring([&](UringReactor* uring){ return uring->RegisterFiles(fds, count); });
+}
+
+} // cxk
@@ -0,0 +1,85 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_HOOK_H
+#define GOCOROUTINE_HOOK_H
+
+#pragma once
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+
+/*
+ * @brief 阻塞风格的协程IO接口
+ * 与同名系统调用语义一致：在协程中遇到EAGAIN时只挂起当前协程，fd就绪后在原处恢复；
+ * 在普通线程中按阻塞方式执行。
+ *
+ * - 第一次在协程中使用的fd会被设置为O_NONBLOCK并注册到Reactor，之后必须用co_close关闭；
+ * - 用户自己设置了O_NONBLOCK的fd保持非阻塞语义，直接返回EAGAIN；
+ * - 通过co_setsockopt设置的SO_RCVTIMEO/SO_SNDTIMEO在协程中同样生效：
+ *   读写超时返回-1且errno为EAGAIN，connect超时errno为EINPROGRESS。
+ */
+
+namespace cxk
+{
+
+int co_connect(int fd, const struct sockaddr* addr, socklen_t addrlen);
+
+int co_accept(int fd, struct sockaddr* addr, socklen_t* addrlen);
+
+ssize_t co_read(int fd, void* buf, size_t count);
+
+ssize_t co_write(int fd, const void* buf, size_t count);
+
+ssize_t co_recv(int fd, void* buf, size_t len, int flags);
+
+ssize_t co_send(int fd, const void* buf, size_t len, int flags);
+
+ssize_t co_recvfrom(int fd, void* buf, size_t len, int flags, struct sockaddr* src_addr, socklen_t* addrlen);
+
+ssize_t co_sendto(int fd, const void* buf, size_t len, int flags, const struct sockaddr* dest_addr, socklen_t addrlen);
+
+/// @brief 记录SO_RCVTIMEO/SO_SNDTIMEO供协程使用，并透传给setsockopt
+int co_setsockopt(int fd, int level, int optname, const void* optval, socklen_t optlen);
+
+/// @brief 唤醒挂起在fd上的协程，从Reactor注销，然后关闭fd
+int co_close(int fd);
+
+/**
+ * @brief 等待单个fd就绪
+ * @param events POLLIN和/或POLLOUT
+ * @param timeoutMs <0表示不超时
+ * @return 1: 就绪；0: 超时；-1: 出错
+ */
+int co_wait_fd(int fd, short events, int timeoutMs);
+
+/*
+ * 完成式IO：需要在Scheduler::Start之前调用Reactor::SetBackend(Reactor::kUring)，且内核支持io_uring。
+ * 请求提交给当前Processor的io_uring，内核把数据直接读写到buf后唤醒协程，每个调度周期批量提交一次。
+ * 不在协程中或后端不是io_uring时退化为co_read/co_write（offset < 0）或pread/pwrite。
+ * 读写超时同样使用co_setsockopt设置的SO_RCVTIMEO/SO_SNDTIMEO。
+ */
+struct UringIoOptions
+{
+    int bufIndex = -1;          ///< >= 0: buf位于co_uring_register_buffers注册的第bufIndex个缓冲区内
+    bool fixedFile = false;     ///< fd是co_uring_register_files注册的文件表下标（退化时返回ENOTSUP）
+};
+
+/// @param offset <0: 使用并推进文件当前偏移（与read/write一致）
+ssize_t co_uring_read(int fd, void* buf, size_t count, off_t offset = -1, UringIoOptions const* opt = nullptr);
+
+ssize_t co_uring_write(int fd, const void* buf, size_t count, off_t offset = -1, UringIoOptions const* opt = nullptr);
+
+/**
+ * @brief 在所有Processor的io_uring上注册固定缓冲区/文件（每个io_uring只能注册一次）
+ * @return 0: 成功；-1: 失败，后端不是io_uring时errno为ENOTSUP
+ */
+int co_uring_register_buffers(const struct iovec* iov, unsigned count);
+
+int co_uring_register_files(const int* fds, unsigned count);
+
+} // cxk
+
+#endif //GOCOROUTINE_HOOK_H
@@ -0,0 +1,52 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "reactor.h"
+#include "epoll_reactor.h"
+#include "uring_reactor.h"
+#include <scheduler/scheduler.h>
+
+namespace cxk
+{
+
+namespace
+{
+std::atomic<int> g_backend{Reactor::kEpoll};
+} // namespace
+
+void Reactor::SetBackend(Backend backend)
+{
+    g_backend.store(backend, std::memory_order_relaxed);
+}
+
+Reactor::Backend Reactor::GetDefaultBackend()
+{
+    return (Backend)g_backend.load(std::memory_order_relaxed);
+}
+
+Reactor* Reactor::Create(Processor* owner)
+{
+    if (GetDefaultBackend() == kUring && UringReactor::Available())
+        return new UringReactor(owner);
+    return new EpollReactor(owner);
+}
+
+Reactor* Reactor::Select(int fd)
+{
+    Scheduler& scheduler = Scheduler::getInstance();
+    std::size_t count = scheduler.ProcessorCount();
+    if (count == 0 || fd < 0) return nullptr;
+
+    Processor* proc = scheduler.GetProcessor((std::size_t)fd % count);
+    return proc ? proc->GetReactor() : nullptr;
+}
+
+void Reactor::AddWaiter()
+{
+    waiters_.fetch_add(1, std::memory_order_relaxed);
+    if (owner_ != Processor::GetCurrentProcessor())
+        owner_->NotifyCondition();
+}
+
+} // cxk
@@ -0,0 +1,101 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_REACTOR_H
+#define GOCOROUTINE_REACTOR_H
+
+#pragma once
+#include <utils/utils.h>
+#include <atomic>
+#include <chrono>
+
+namespace cxk
+{
+
+class Processor;
+class FdContext;
+
+/*
+ * @brief IO事件多路复用器，每个Processor持有一个
+ * 由所属Processor的工作线程驱动：忙碌时周期性地非阻塞Poll，空闲时阻塞在Poll上代替条件变量。
+ * 同一个fd固定注册到 fd % Processor数量 对应的Reactor，避免重复注册。
+ */
+class Reactor
+{
+public:
+    enum Backend { kEpoll, kUring };
+
+    /**
+     * @brief 选择之后创建的Reactor后端，必须在Scheduler::Start之前调用
+     * 内核不支持io_uring时自动退回epoll
+     */
+    static void SetBackend(Backend backend);
+
+    static Backend GetDefaultBackend();
+
+    /// @brief 按SetBackend的选择创建Reactor（默认epoll）
+    static Reactor* Create(Processor* owner);
+
+    /// @brief fd对应的Reactor，调度器未启动时返回nullptr
+    static Reactor* Select(int fd);
+
+    explicit Reactor(Processor* owner) : owner_(owner) {}
+    virtual ~Reactor() {}
+
+    virtual Backend GetBackend() const = 0;
+
+    Reactor(Reactor const&) = delete;
+    Reactor& operator=(Reactor const&) = delete;
+
+    /// @brief 以边沿触发方式注册fd（读写两个方向）
+    virtual bool Add(int fd, FdContext* ctx) = 0;
+
+    /// @brief 注销fd
+    virtual void Del(int fd, FdContext* ctx) = 0;
+
+    /**
+     * @brief 协程即将在fd的dir方向上挂起（持有FdContext锁调用，任意线程）
+     * 边沿触发的后端无需处理；单次触发的后端（io_uring）在这里按需注册一次事件
+     */
+    virtual void Arm(int fd, FdContext* ctx, int dir) { (void)fd; (void)ctx; (void)dir; }
+
+    /**
+     * @brief 等待并派发事件（只能由所属Processor的工作线程调用）
+     * @param timeout 0: 非阻塞；nanoseconds::max(): 一直等待直到有事件或Notify
+     * @return 派发的事件数量
+     */
+    virtual int Poll(std::chrono::nanoseconds timeout) = 0;
+
+    /// @brief 打断阻塞中的Poll（任意线程）
+    virtual void Notify() = 0;
+
+    /// @brief 是否有缓存的请求尚未交给内核（批量提交的后端），调度循环每次派发前检查
+    ALWAYS_INLINE bool NeedFlush() const {
+        return needFlush_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief 把缓存的请求交给内核，不等待事件（只能由所属Processor的工作线程调用）
+    virtual void Flush() {}
+
+    /// @brief 挂起在本Reactor上的协程数量
+    ALWAYS_INLINE int Waiters() const {
+        return waiters_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief 有协程挂起在本Reactor上：所属Processor如果在条件变量上休眠，需要唤醒它改为Poll
+    void AddWaiter();
+
+    ALWAYS_INLINE void RemoveWaiter() {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+protected:
+    Processor* owner_;
+    std::atomic<int> waiters_{0};
+    std::atomic<bool> needFlush_{false};
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_REACTOR_H
@@ -0,0 +1,361 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "uring_reactor.h"
+#include "fd_context.h"
+#include <common/error.h>
+#include <scheduler/processor.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <thread>
+
+namespace cxk
+{
+
+namespace
+{
+
+int UringSetup(unsigned entries, io_uring_params* params)
+{
+    return (int)::syscall(__NR_io_uring_setup, entries, params);
+}
+
+int UringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return (int)::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+int UringRegister(int fd, unsigned opcode, const void* arg, unsigned count)
+{
+    int ret = (int)::syscall(__NR_io_uring_register, fd, opcode, arg, count);
+    return ret < 0 ? -errno : ret;
+}
+
+template <typename T>
+ALWAYS_INLINE T* RingPtr(void* base, uint32_t offset)
+{
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+bool UringReactor::Available()
+{
+    static const bool available = []{
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = UringSetup(2, &params);
+        if (fd < 0) return false;
+        ::close(fd);
+        // IORING_OP_READ/WRITE与当前偏移读写需要5.6+
+        unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+        return (params.features & required) == required;
+    }();
+    return available;
+}
+
+UringReactor::UringReactor(Processor* owner)
+    : Reactor(owner)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd_ = UringSetup(kEntries, &params);
+    if (ringFd_ < 0) {
+        ThrowError(eCoErrorCode::ec_reactor_init_failed);
+        return;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        ThrowError(eCoErrorCode::ec_reactor_init_failed);
+        return;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            cqRing_ = nullptr;
+            ThrowError(eCoErrorCode::ec_reactor_init_failed);
+            return;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        ThrowError(eCoErrorCode::ec_reactor_init_failed);
+        return;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sqHead_ = RingPtr<unsigned>(sqRing_, params.sq_off.head);
+    sqTail_ = RingPtr<unsigned>(sqRing_, params.sq_off.tail);
+    sqMask_ = *RingPtr<unsigned>(sqRing_, params.sq_off.ring_mask);
+    sqEntries_ = *RingPtr<unsigned>(sqRing_, params.sq_off.ring_entries);
+    sqArray_ = RingPtr<unsigned>(sqRing_, params.sq_off.array);
+    sqFlags_ = RingPtr<unsigned>(sqRing_, params.sq_off.flags);
+    cqHead_ = RingPtr<unsigned>(cqRing_, params.cq_off.head);
+    cqTail_ = RingPtr<unsigned>(cqRing_, params.cq_off.tail);
+    cqMask_ = *RingPtr<unsigned>(cqRing_, params.cq_off.ring_mask);
+    cqes_ = RingPtr<io_uring_cqe>(cqRing_, params.cq_off.cqes);
+
+    // SQE下标与提交队列槽位一一对应，之后不再修改
+    for (unsigned i = 0; i < sqEntries_; ++i)
+        sqArray_[i] = i;
+}
+
+UringReactor::~UringReactor()
+{
+    if (sqes_) ::munmap(sqes_, sqesSize_);
+    if (cqRing_ && cqRing_ != sqRing_) ::munmap(cqRing_, cqRingSize_);
+    if (sqRing_) ::munmap(sqRing_, sqRingSize_);
+    if (ringFd_ >= 0) ::close(ringFd_);
+}
+
+bool UringReactor::Add(int fd, FdContext* ctx)
+{
+    (void)ctx;
+    // 与epoll一致：普通文件、目录、块设备总是就绪，不做就绪通知
+    struct stat st;
+    if (::fstat(fd, &st) < 0) return false;
+    return !S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode) && !S_ISBLK(st.st_mode);
+}
+
+void UringReactor::Del(int fd, FdContext* ctx)
+{
+    (void)fd;
+    // 挂起的POLL_ADD持有文件引用，必须立即移除，否则close后对端收不到EOF
+    std::lock_guard<std::mutex> lock(sqMutex_);
+    for (uint64_t tag : {(uint64_t)kTagRead, (uint64_t)kTagWrite}) {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_POLL_REMOVE;
+        sqe.fd = -1;
+        sqe.addr = (uint64_t)(uintptr_t)ctx | tag;
+        sqe.user_data = kTagInternal;
+        PushLocked(sqe);
+    }
+    SubmitLocked();
+}
+
+void UringReactor::Arm(int fd, FdContext* ctx, int dir)
+{
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = fd;
+    sqe.poll32_events = dir == FdContext::kRead ? (POLLIN | POLLRDHUP | POLLPRI) : POLLOUT;
+    sqe.user_data = (uint64_t)(uintptr_t)ctx | (dir == FdContext::kRead ? kTagRead : kTagWrite);
+
+    // 由随后的AddWaiter唤醒所属Processor提交
+    std::lock_guard<std::mutex> lock(sqMutex_);
+    PushLocked(sqe);
+}
+
+int UringReactor::Poll(std::chrono::nanoseconds timeout)
+{
+    {
+        std::lock_guard<std::mutex> lock(sqMutex_);
+        SubmitLocked();
+    }
+
+    int c = Reap();
+    if (__atomic_load_n(sqFlags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+        // 完成队列溢出的事件暂存在内核中，需要GETEVENTS才会刷回
+        UringEnter(ringFd_, 0, 0, IORING_ENTER_GETEVENTS);
+        c += Reap();
+    }
+    if (c > 0 || timeout.count() <= 0) return c;
+
+    if (timeout != std::chrono::nanoseconds::max()) {
+        // 任意一个完成事件或超时到达时结束等待；timespec在提交时被内核复制
+        __kernel_timespec ts;
+        ts.tv_sec = timeout.count() / 1000000000;
+        ts.tv_nsec = timeout.count() % 1000000000;
+
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_TIMEOUT;
+        sqe.fd = -1;
+        sqe.addr = (uint64_t)(uintptr_t)&ts;
+        sqe.len = 1;
+        sqe.off = 1;
+        sqe.user_data = kTagInternal;
+
+        std::lock_guard<std::mutex> lock(sqMutex_);
+        PushLocked(sqe);
+        SubmitLocked();
+    }
+
+    UringEnter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS);
+    return Reap();
+}
+
+void UringReactor::Notify()
+{
+    // 提交一个NOP：完成事件会唤醒阻塞在io_uring_enter中的Poll
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_NOP;
+    sqe.fd = -1;
+    sqe.user_data = kTagInternal;
+
+    std::lock_guard<std::mutex> lock(sqMutex_);
+    PushLocked(sqe);
+    SubmitLocked();
+}
+
+void UringReactor::Flush()
+{
+    std::lock_guard<std::mutex> lock(sqMutex_);
+    SubmitLocked();
+}
+
+int32_t UringReactor::Submit(io_uring_sqe const& sqe, time_point const* deadline)
+{
+    ParkLocal<UringRequest> req(ParkOffStack());
+    io_uring_sqe s = sqe;
+    s.user_data = (uint64_t)(uintptr_t)req.get();
+    {
+        std::lock_guard<std::mutex> lock(sqMutex_);
+        PushLocked(s);
+    }
+    AddWaiter();
+
+    bool canceled = false;
+    while (req->rutex_.value()->load(std::memory_order_acquire) == 0) {
+        if (!deadline || canceled) {
+            req->rutex_.wait(0);
+            continue;
+        }
+
+        if (req->rutex_.wait_until(0, *deadline) != RutexBase::rutex_wait_return_etimeout)
+            continue;
+
+        // 超时：取消请求，但内核确认之前缓冲区仍可能被写入，必须继续等待完成事件
+        io_uring_sqe cancel;
+        memset(&cancel, 0, sizeof(cancel));
+        cancel.opcode = IORING_OP_ASYNC_CANCEL;
+        cancel.fd = -1;
+        cancel.addr = s.user_data;
+        cancel.user_data = kTagInternal;
+        {
+            std::lock_guard<std::mutex> lock(sqMutex_);
+            PushLocked(cancel);
+        }
+        Kick();
+        canceled = true;
+    }
+    RemoveWaiter();
+
+    std::lock_guard<std::mutex> lock(doneMtx_);
+    return req->res_;
+}
+
+int UringReactor::RegisterBuffers(iovec const* iov, unsigned count)
+{
+    return UringRegister(ringFd_, IORING_REGISTER_BUFFERS, iov, count);
+}
+
+int UringReactor::RegisterFiles(int const* fds, unsigned count)
+{
+    return UringRegister(ringFd_, IORING_REGISTER_FILES, fds, count);
+}
+
+void UringReactor::PushLocked(io_uring_sqe const& sqe)
+{
+    for (;;) {
+        unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        unsigned tail = *sqTail_;
+        if (tail - head < sqEntries_) {
+            sqes_[tail & sqMask_] = sqe;
+            __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+            ++pending_;
+            needFlush_.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        // 提交队列已满：立即提交
+        SubmitLocked();
+        if (__atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) == head)
+            std::this_thread::yield();
+    }
+}
+
+void UringReactor::SubmitLocked()
+{
+    while (pending_ > 0) {
+        int ret = UringEnter(ringFd_, pending_, 0, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            break;      // EAGAIN/EBUSY: 下一次Flush或Poll收割完成事件后重试
+        }
+        if (ret == 0) break;
+        pending_ -= (unsigned)ret;
+    }
+    needFlush_.store(pending_ > 0, std::memory_order_relaxed);
+}
+
+int UringReactor::Reap()
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    if (head == tail) return 0;
+
+    int c = 0;
+    std::unique_lock<std::mutex> lock(doneMtx_, std::defer_lock);
+    for (; head != tail; ++head) {
+        io_uring_cqe const& cqe = cqes_[head & cqMask_];
+        uint64_t data = cqe.user_data;
+        switch (data & kTagMask) {
+            case kTagRequest: {
+                if (!lock.owns_lock()) lock.lock();
+                UringRequest* req = reinterpret_cast<UringRequest*>((uintptr_t)data);
+                req->res_ = cqe.res;
+                req->rutex_.value()->store(1, std::memory_order_release);
+                req->rutex_.wake_one();
+                ++c;
+                break;
+            }
+
+            case kTagRead:
+            case kTagWrite: {
+                // 失败（如POLL_REMOVE取消）同样唤醒等待者，由其重试IO操作
+                FdContext* ctx = reinterpret_cast<FdContext*>((uintptr_t)(data & ~(uint64_t)kTagMask));
+                ctx->OnEvent((data & kTagMask) == kTagRead, (data & kTagMask) == kTagWrite);
+                ++c;
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return c;
+}
+
+void UringReactor::Kick()
+{
+    if (owner_ != Processor::GetCurrentProcessor())
+        owner_->NotifyCondition();
+}
+
+} // cxk
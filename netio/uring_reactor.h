@@ -0,0 +1,112 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_URING_REACTOR_H
+#define GOCOROUTINE_URING_REACTOR_H
+
+#pragma once
+#include "reactor.h"
+#include <concurrence/rutex.h>
+#include <concurrence/timer.h>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <mutex>
+
+namespace cxk
+{
+
+/// @brief 完成式IO请求，位于发起协程的栈上（共享栈协程放在堆上），完成后由Reactor在锁内唤醒
+struct UringRequest
+{
+    Rutex<int> rutex_;      ///< 0: 进行中；1: 已完成
+    int32_t res_ = 0;       ///< cqe->res，失败时为-errno
+};
+
+/*
+ * @brief 基于io_uring的Reactor（Linux 5.6+），直接使用系统调用，不依赖liburing
+ *
+ * 两种用法：
+ *  - 就绪通知：与epoll后端语义一致，协程挂起前通过Arm按需提交单次IORING_OP_POLL_ADD；
+ *  - 完成式IO：Submit把读写请求直接提交给内核，数据读写到协程自己的缓冲区，完成后唤醒协程，
+ *    省去"等待就绪 -> 再调用read"的第二次系统调用。
+ *
+ * SQE只写入提交队列，不立即io_uring_enter：所属Processor每次派发协程前通过Flush一次性批量提交
+ * （NeedFlush只读一个原子标志），完成事件在Poll中收割（忙碌时每kPollInterval次派发一次，空闲时阻塞等待）。
+ * 提交队列由sqMutex_保护，任意线程都可以提交；完成队列只由所属Processor的工作线程收割。
+ */
+class UringReactor : public Reactor
+{
+public:
+    typedef RoutineSyncTimer::time_point time_point;
+
+    /// @brief 内核是否支持io_uring（只探测一次）
+    static bool Available();
+
+    explicit UringReactor(Processor* owner);
+    ~UringReactor() override;
+
+    Backend GetBackend() const override { return kUring; }
+
+    bool Add(int fd, FdContext* ctx) override;
+    void Del(int fd, FdContext* ctx) override;
+    void Arm(int fd, FdContext* ctx, int dir) override;
+    int Poll(std::chrono::nanoseconds timeout) override;
+    void Notify() override;
+    void Flush() override;
+
+    /**
+     * @brief 提交一个IO请求并挂起当前协程（或线程）直到完成
+     * @param sqe 请求内容，user_data由本函数填写
+     * @param deadline 超时时刻，nullptr表示不超时；超时后取消请求，并等待内核确认不再访问缓冲区
+     * @return cqe->res：成功时为非负结果，失败时为-errno，超时取消为-ECANCELED
+     */
+    int32_t Submit(io_uring_sqe const& sqe, time_point const* deadline);
+
+    /// @brief 注册固定缓冲区（IORING_OP_READ_FIXED/WRITE_FIXED使用），失败返回-errno
+    int RegisterBuffers(iovec const* iov, unsigned count);
+
+    /// @brief 注册固定文件（IOSQE_FIXED_FILE使用），失败返回-errno
+    int RegisterFiles(int const* fds, unsigned count);
+
+private:
+    static constexpr unsigned kEntries = 256;
+
+    /// user_data低2位：0: UringRequest*；1/2: FdContext*的读/写就绪事件；3: 内部请求，完成时忽略
+    enum { kTagRequest = 0, kTagRead = 1, kTagWrite = 2, kTagInternal = 3, kTagMask = 3 };
+
+    void PushLocked(io_uring_sqe const& sqe);
+    void SubmitLocked();
+    int Reap();
+
+    /// 提交者不在所属Processor上时唤醒它，尽快提交
+    void Kick();
+
+    int ringFd_ = -1;
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    std::size_t sqRingSize_ = 0;
+    std::size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqesSize_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* sqArray_ = nullptr;
+    unsigned* sqFlags_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::mutex sqMutex_;
+    unsigned pending_ = 0;      ///< 已写入提交队列但尚未提交给内核的SQE数量，由sqMutex_保护；非0时置needFlush_
+
+    std::mutex doneMtx_;        ///< 锁内唤醒UringRequest，等待者返回前重新获取
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_URING_REACTOR_H
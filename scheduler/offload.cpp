@@ -0,0 +1,160 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "offload.h"
+#include <system_error>
+#include <thread>
+
+namespace cxk
+{
+
+std::size_t& OffloadPool::MaxThreads()
+{
+    static std::size_t obj = 64;
+    return obj;
+}
+
+std::chrono::milliseconds& OffloadPool::IdleTimeout()
+{
+    static std::chrono::milliseconds obj(10000);
+    return obj;
+}
+
+std::size_t& OffloadPool::QueueCapacity()
+{
+    static std::size_t obj = 1024;
+    return obj;
+}
+
+OffloadPool& OffloadPool::getInstance()
+{
+    // 不析构：进程退出时卸载线程可能仍在执行调用
+    static OffloadPool* obj = new OffloadPool;
+    return *obj;
+}
+
+OffloadPool::OffloadPool()
+    : queue_(QueueCapacity())
+{
+}
+
+void OffloadPool::Submit(OffloadJob* job)
+{
+    // 一个卸载线程都没有时在入队之前新建，创建失败的异常可以直接抛给调用者
+    if (threads_.load(std::memory_order_acquire) == 0) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (threads_.load(std::memory_order_relaxed) == 0)
+            Spawn();
+    }
+
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    for (;;) {
+        // 先挂起再入队：调用可能在本协程切出之前就执行完毕并唤醒它
+        job->entry_ = Processor::Suspend();
+        if (queue_.Push(job).success) break;
+
+        // 队列已满：撤销挂起，让出一次后重试
+        queueFull_.fetch_add(1, std::memory_order_relaxed);
+        Processor::Wakeup(job->entry_);
+        Processor::StaticCoYield();
+    }
+    Notify();
+    Processor::StaticCoYield();
+}
+
+OffloadPool::Stats OffloadPool::GetStats() const
+{
+    Stats s;
+    uint64_t started = started_.load(std::memory_order_relaxed);
+    uint64_t submitted = submitted_.load(std::memory_order_relaxed);
+    s.queueDepth = submitted > started ? (std::size_t)(submitted - started) : 0;
+    s.threads = threads_.load(std::memory_order_relaxed);
+    s.idleThreads = idle_.load(std::memory_order_relaxed);
+    s.submitted = submitted;
+    s.completed = completed_.load(std::memory_order_relaxed);
+    s.queueFull = queueFull_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void OffloadPool::Run()
+{
+    OffloadJob* job = nullptr;
+    std::unique_lock<std::mutex> lock(mtx_, std::defer_lock);
+    for (;;) {
+        if (queue_.Pop(job).success) {
+            Execute(job);
+            continue;
+        }
+
+        lock.lock();
+        // 与Notify配对：先登记空闲再检查队列，提交者先入队再检查空闲，二者至少有一方看到对方
+        idle_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool got = false;
+        for (;;) {
+            if ((got = queue_.Pop(job).success)) break;
+            if (cv_.wait_for(lock, IdleTimeout()) == std::cv_status::timeout) {
+                got = queue_.Pop(job).success;
+                break;
+            }
+        }
+        idle_.fetch_sub(1, std::memory_order_relaxed);
+        if (!got) {
+            // 在锁内退出：之后的提交者看到空闲数和线程数都已减少，会新建线程
+            threads_.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+        lock.unlock();
+        Execute(job);
+    }
+}
+
+void OffloadPool::Execute(OffloadJob* job)
+{
+    started_.fetch_add(1, std::memory_order_relaxed);
+    job->Run();
+    completed_.fetch_add(1, std::memory_order_relaxed);
+
+    // 唤醒后调用者可能立即在其他线程恢复并销毁job，先取出挂起凭证
+    Processor::SuspendEntry entry = std::move(job->entry_);
+    Processor::Wakeup(entry);
+}
+
+void OffloadPool::Notify()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::size_t max = MaxThreads();
+    if (idle_.load(std::memory_order_relaxed) == 0 && threads_.load(std::memory_order_relaxed) >= max)
+        return;     // 全部线程都在执行，执行完毕后会继续取队列
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    std::size_t idle = idle_.load(std::memory_order_relaxed);
+    if (idle > 0)
+        cv_.notify_one();
+
+    // 排队的调用比空闲线程多时扩容（并发提交时一个空闲线程只能接走一个）
+    uint64_t started = started_.load(std::memory_order_relaxed);
+    uint64_t submitted = submitted_.load(std::memory_order_relaxed);
+    uint64_t pending = submitted > started ? submitted - started : 0;
+    if (pending > idle && threads_.load(std::memory_order_relaxed) < max) {
+        try {
+            Spawn();
+        } catch (std::system_error const&) {
+            // 已有的卸载线程执行完手上的调用后会继续取队列
+        }
+    }
+}
+
+void OffloadPool::Spawn()
+{
+    threads_.fetch_add(1, std::memory_order_relaxed);
+    try {
+        std::thread(&OffloadPool::Run, this).detach();
+    } catch (...) {
+        threads_.fetch_sub(1, std::memory_order_relaxed);
+        throw;
+    }
+}
+
+} // cxk
@@ -0,0 +1,185 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_OFFLOAD_H
+#define GOCOROUTINE_OFFLOAD_H
+
+#pragma once
+#include <utils/utils.h>
+#include <common/lock_free_ring_queue.h>
+#include <concurrence/park_local.h>
+#include "processor.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace cxk
+{
+
+/// @brief 提交给OffloadPool的一次调用，由co_offload构造在挂起的协程上（共享栈协程在对象池中）
+struct OffloadJob
+{
+    virtual ~OffloadJob() = default;
+
+    /// 在卸载线程上执行，结果和异常保存在对象中
+    virtual void Run() = 0;
+
+    Processor::SuspendEntry entry_;   ///< 挂起的调用者，执行完毕后唤醒
+};
+
+/*
+ * @brief 阻塞调用卸载线程池：getaddrinfo、文件read/fsync、第三方的阻塞客户端等无法交给Reactor的调用
+ * 在独立的线程上执行，调用者协程挂起等待，Processor的工作线程继续运行其他协程。
+ *
+ *  - 提交：多生产者多消费者的LockFreeRingQueue，不加锁；队列满时调用者让出后重试；
+ *  - 弹性伸缩：提交时没有空闲线程则新建一个（最多MaxThreads()个），空闲超过IdleTimeout()的线程退出；
+ *  - 完成：执行完毕立即用Processor::Wakeup唤醒调用者，被唤醒的协程进入它所在Processor的唤醒队列（TSQueue），
+ *    由该Processor一次pop_all成批合并到运行队列。不在卸载线程上攒批：
+ *    已经完成的调用排在另一次阻塞调用之后才唤醒，会把后者的耗时加到前者的延迟上。
+ */
+class OffloadPool
+{
+public:
+    /// @brief 运行时统计（近似值，任意线程读取）
+    struct Stats
+    {
+        std::size_t queueDepth = 0;     ///< 已提交、尚未开始执行的调用数量
+        std::size_t threads = 0;        ///< 卸载线程数量
+        std::size_t idleThreads = 0;    ///< 空闲等待中的卸载线程数量
+        uint64_t submitted = 0;         ///< 提交的调用总数
+        uint64_t completed = 0;         ///< 执行完毕的调用总数
+        uint64_t queueFull = 0;         ///< 提交时队列已满、调用者让出后重试的次数
+    };
+
+    /// @brief 卸载线程数量上限；第一次提交之前设置
+    static std::size_t& MaxThreads();
+
+    /// @brief 空闲线程的退出时间；第一次提交之前设置
+    static std::chrono::milliseconds& IdleTimeout();
+
+    /// @brief 提交队列容量（向上取2的幂）；第一次提交之前设置
+    static std::size_t& QueueCapacity();
+
+    static OffloadPool& getInstance();
+
+    /**
+     * @brief 提交调用并挂起当前协程，执行完毕后返回（只能在协程中调用）
+     * 队列满时当前协程让出一次后重试，不会阻塞工作线程
+     */
+    void Submit(OffloadJob* job);
+
+    Stats GetStats() const;
+
+    OffloadPool(OffloadPool const&) = delete;
+    OffloadPool& operator=(OffloadPool const&) = delete;
+
+private:
+    OffloadPool();
+
+    /// 卸载线程入口
+    void Run();
+
+    /// 执行调用并唤醒调用者
+    void Execute(OffloadJob* job);
+
+    /// 提交之后：有空闲线程则唤醒一个，否则在上限内新建线程
+    void Notify();
+
+    /// 新建一个卸载线程，调用者持有mtx_；失败时抛出std::system_error
+    void Spawn();
+
+    LockFreeRingQueue<OffloadJob*, std::size_t, RingQueueMPMC> queue_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    atomic_t<std::size_t> threads_{0};      ///< 由mtx_保护写入
+    atomic_t<std::size_t> idle_{0};         ///< 由mtx_保护写入
+
+    atomic_t<uint64_t> submitted_{0};
+    atomic_t<uint64_t> started_{0};
+    atomic_t<uint64_t> completed_{0};
+    atomic_t<uint64_t> queueFull_{0};
+};
+
+namespace offload_detail
+{
+
+template <typename F, typename R>
+struct Call final : public OffloadJob
+{
+    explicit Call(F&& fn) : fn_(std::forward<F>(fn)) {}
+
+    void Run() override
+    {
+        try {
+            result_.emplace(fn_());
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+
+    R Take()
+    {
+        if (error_) std::rethrow_exception(error_);
+        return std::move(*result_);
+    }
+
+    typename std::decay<F>::type fn_;
+    std::optional<R> result_;
+    std::exception_ptr error_;
+};
+
+template <typename F>
+struct Call<F, void> final : public OffloadJob
+{
+    explicit Call(F&& fn) : fn_(std::forward<F>(fn)) {}
+
+    void Run() override
+    {
+        try {
+            fn_();
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+
+    void Take()
+    {
+        if (error_) std::rethrow_exception(error_);
+    }
+
+    typename std::decay<F>::type fn_;
+    std::exception_ptr error_;
+};
+
+} // namespace offload_detail
+
+/**
+ * @brief 在卸载线程池中执行阻塞调用fn，返回它的结果（异常原样抛出）
+ * 协程中挂起当前协程直到fn执行完毕；不在协程中时直接在当前线程执行（阻塞的只是调用者自己）。
+ * fn被移动（或拷贝）到挂起期间的调用对象中，结果按值返回。
+ * 调用对象（fn的捕获 + 结果R）通过ParkLocal可能在ObjectPool中构造，大小不能超过约8KB（见ObjectPool），
+ * 超过时编译失败；按值捕获大数组或返回大对象时改为捕获指针、返回std::unique_ptr或std::vector。
+ */
+template <typename F>
+typename std::decay<typename std::invoke_result<typename std::decay<F>::type&>::type>::type
+co_offload(F&& fn)
+{
+    typedef typename std::decay<typename std::invoke_result<typename std::decay<F>::type&>::type>::type R;
+    if (!Processor::IsCoroutine())
+        return fn();
+
+    ParkLocal<offload_detail::Call<F, R>> call(ParkOffStack(), std::forward<F>(fn));
+    OffloadPool::getInstance().Submit(call.get());
+    return call->Take();
+}
+
+} // cxk
+
+#endif //GOCOROUTINE_OFFLOAD_H
@@ -0,0 +1,517 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+
+#include "processor.h"
+#include "scheduler.h"
+#include <netio/reactor.h>
+#include <concurrence/park_local.h>
+#include <common/numa.h>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <pthread.h>
+
+namespace cxk
+{
+
+bool Processor::SuspendEntry::IsExpire() const
+{
+    if (!tk_) return true;
+    return tk_->suspendId_.load(std::memory_order_acquire) != id_;
+}
+
+Processor::Processor(Scheduler* scheduler, int id)
+    : scheduler_(scheduler), id_(id), reactor_(Reactor::Create(this)),
+      rand_((uint64_t)id * 0x9E3779B97F4A7C15ull + 1)
+{
+}
+
+Processor::~Processor()
+{
+    // 调度器停止后仍未执行的任务直接释放（生命周期引用 + 队列引用）
+    auto release = [](SList<Task> tasks) {
+        for (auto it = tasks.begin(); it != tasks.end(); ) {
+            Task* tk = &*it;
+            it = tasks.erase(it);   // 释放队列引用
+            tk->DecRef();           // 释放生命周期引用
+        }
+        tasks.stealed();
+    };
+    release(wakeupQueue_.pop_all());
+    for (TaskQueue& q : runQueues_)
+        release(q.pop_all());
+    if (runNext_) {
+        runNext_->DecRef();
+        runNext_ = nullptr;
+    }
+    delete reactor_;
+}
+
+Processor* & Processor::GetCurrentProcessor()
+{
+    // 不内联：协程可能被窃取到其他线程恢复，避免编译器跨切换点缓存TLS地址
+    static thread_local Processor* proc = nullptr;
+    return proc;
+}
+
+Task* Processor::GetCurrentTask()
+{
+    Processor* proc = GetCurrentProcessor();
+    return proc ? proc->runningTask_ : nullptr;
+}
+
+bool Processor::IsCoroutine()
+{
+    return !!GetCurrentTask();
+}
+
+// TaskSwitcher的静态接口与线程局部变量定义在同一编译单元：GetCurrentTask在这里内联，
+// 同步原语经StaticRoutineSyncPolicy取当前切换器只有一次（不内联的）调用
+bool TaskSwitcher::isInRoutine()
+{
+    return !!Processor::GetCurrentTask();
+}
+
+RoutineSwitcherI & TaskSwitcher::clsRef()
+{
+    return Processor::GetCurrentTask()->switcher_;
+}
+
+TaskSwitcher* TaskSwitcher::current()
+{
+    Task* tk = Processor::GetCurrentTask();
+    return tk ? &tk->switcher_ : nullptr;
+}
+
+void Processor::StaticCoYield()
+{
+    Task* tk = GetCurrentTask();
+    if (!tk) return;
+
+    ++tk->yieldCount_;
+    Processor* proc = GetCurrentProcessor();
+    if (Task* next = proc->TakeHandoff(tk)) {
+        // 直接切换到runnext协程，省掉经过调度循环的那一次切换
+        proc->handoffPrev_ = tk;
+        proc->runningTask_ = next;
+        proc->OnSwitchIn(next);
+        tk->ctx_.SwapTo(next->ctx_);
+    } else {
+        tk->SwapOut();
+    }
+
+    // 恢复执行：如果是被其他协程直接切换过来的，替它完成切出后的收尾（可能已在其他线程上）
+    GetCurrentProcessor()->FinishHandoff();
+}
+
+Processor::SuspendEntry Processor::Suspend()
+{
+    Task* tk = GetCurrentTask();
+    assert(tk);
+
+    tk->state_ = TaskState::block;
+    SuspendEntry entry;
+    entry.tk_ = IncursivePtr<Task>(tk);
+    entry.id_ = tk->suspendId_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    return entry;
+}
+
+bool Processor::Wakeup(SuspendEntry const& entry)
+{
+    Task* tk = entry.tk_.get();
+    if (!tk) return false;
+
+    // 唤醒成功后suspendId_变化，后续（包括超时等）重复唤醒都会失败
+    uint64_t id = entry.id_;
+    if (!tk->suspendId_.compare_exchange_strong(id, id + 1,
+                std::memory_order_acq_rel, std::memory_order_relaxed))
+        return false;
+
+    StampReady(tk, id >> 1);
+    tk->proc_->WakeupTask(tk);
+    return true;
+}
+
+void Processor::SleepUntil(TimerWheel::time_point abstime)
+{
+    Task* tk = GetCurrentTask();
+    if (!tk) {
+        std::this_thread::sleep_until(abstime);
+        return;
+    }
+
+    if (abstime <= FastSteadyClock::now()) {
+        StaticCoYield();
+        return;
+    }
+
+    // 共享栈协程切出后栈会被覆盖，时间轮访问的挂起凭证和定时器元素放在堆上
+    struct Sleeper
+    {
+        SuspendEntry entry_;
+        TimerWheel::Element element_;
+    };
+    ParkLocal<Sleeper> sleeper(tk->switcher_.parkOffStack());
+    sleeper->entry_ = Suspend();
+    Sleeper* ps = sleeper.get();
+    GetCurrentProcessor()->timerWheel_.Schedule(ps->element_, abstime, [ps]{ Wakeup(ps->entry_); });
+    StaticCoYield();
+
+    // 回调可能仍在执行（被唤醒后已在其他线程恢复），等待它结束后element才能销毁
+    TimerWheel::Cancel(ps->element_);
+}
+
+void Processor::WakeupTask(Task* tk)
+{
+    // 先判断线程：runningTask_和runNext_只能由所有者访问
+    if (GetCurrentProcessor() == this && runningTask_ && runningTask_ != tk) {
+        Task* old = runNext_;
+        runNext_ = tk;
+        if (!old) return;
+        tk = old;   // 被挤掉的runnext放回唤醒队列
+    }
+    wakeupQueue_.push(tk);
+    NotifyCondition();
+}
+
+Task* Processor::TakeRunNext()
+{
+    Task* tk = runNext_;
+    if (!tk) {
+        runNextStreak_ = 0;
+        return nullptr;
+    }
+
+    runNext_ = nullptr;
+    tk->state_ = TaskState::runnable;
+    stats_.wakes_.Add();
+    if (runNextStreak_ >= kMaxRunNextStreak) {
+        runNextStreak_ = 0;
+        PushRunnable(tk);
+        return nullptr;
+    }
+    ++runNextStreak_;
+    return tk;
+}
+
+Task* Processor::TakeHandoff(Task* tk)
+{
+    Task* next = runNext_;
+    if (!next || tk->state_ == TaskState::done) return nullptr;
+    if (runNextStreak_ >= kMaxRunNextStreak) return nullptr;   // 回到调度循环，由TakeRunNext排到队尾
+    if (tk->ctx_.IsSharedStack() || next->ctx_.IsSharedStack()) return nullptr;    // 共享栈只能在调度栈上换入换出
+    if (scheduler_->IsStop()) return nullptr;
+
+    runNext_ = nullptr;
+    ++runNextStreak_;
+    next->state_ = TaskState::runnable;
+    next->proc_ = this;
+    stats_.wakes_.Add();
+    stats_.handoffs_.Add();
+    return next;
+}
+
+void Processor::FinishHandoff()
+{
+    Task* prev = handoffPrev_;
+    if (!prev) return;
+    handoffPrev_ = nullptr;
+
+    // prev已经完成切出：主动yield的排回运行队列；挂起的由Wakeup重新投递
+    if (prev->probeStack_) prev->SampleStackDepth();
+    if (prev->state_ == TaskState::runnable) {
+        stats_.yields_.Add();
+        StampReady(prev, prev->yieldCount_);
+        PushRunnable(prev);
+    } else {
+        stats_.parks_.Add();
+    }
+}
+
+void Processor::AddTask(Task* tk)
+{
+    PushRunnable(tk);
+    NotifyCondition();
+}
+
+void Processor::AddTasks(SList<Task> && tasks)
+{
+    if (tasks.empty()) return;
+    RunQueue(tasks.begin()->priority_).push(std::move(tasks));
+    NotifyCondition();
+}
+
+SList<Task> Processor::Steal(std::size_t n)
+{
+    if (n == 0) return SList<Task>();
+    for (TaskQueue& q : runQueues_) {
+        SList<Task> tasks = q.pop_back((uint32_t)n);
+        if (!tasks.empty()) return tasks;
+    }
+    return SList<Task>();
+}
+
+Task* Processor::PopRunnable()
+{
+    // 每kFairInterval次先从normal、background队列（轮流）取一次，其余时候严格按优先级
+    std::size_t first = 0;
+    if (++popTick_ % kFairInterval == 0)
+        first = 1 + (popTick_ / kFairInterval) % (kTaskPriorityCount - 1);
+    if (first) {
+        if (Task* tk = runQueues_[first].pop()) return tk;
+    }
+    for (std::size_t i = 0; i < kTaskPriorityCount; ++i) {
+        if (Task* tk = runQueues_[i].pop()) return tk;
+    }
+    return nullptr;
+}
+
+bool Processor::RunnableEmpty()
+{
+    for (TaskQueue& q : runQueues_) {
+        if (!q.emptyUnsafe()) return false;
+    }
+    return true;
+}
+
+void Processor::GatherWakeupTasks()
+{
+    if (wakeupQueue_.emptyUnsafe()) return;
+
+    SList<Task> tasks = wakeupQueue_.pop_all();
+    if (tasks.empty()) return;  // 唯一的元素尚未链接完成，下一轮再取
+    TaskPriority priority = tasks.begin()->priority_;
+    bool mixed = false;
+    for (auto& tk : tasks) {
+        tk.state_ = TaskState::runnable;
+        mixed |= tk.priority_ != priority;
+    }
+    stats_.wakes_.Add(tasks.size());
+    if (!mixed) {
+        RunQueue(priority).push(std::move(tasks));
+        return;
+    }
+
+    // 优先级不同时按优先级拆开，每个运行队列仍只加一次锁
+    SList<Task> split[kTaskPriorityCount];
+    for (auto& tk : tasks)
+        split[(std::size_t)tk.priority_].push_back(&tk);
+    tasks.clear();
+    for (std::size_t i = 0; i < kTaskPriorityCount; ++i)
+        runQueues_[i].push(std::move(split[i]));
+}
+
+SList<Task> Processor::StealMovable(std::size_t n)
+{
+    SList<Task> tasks = Steal(n);
+
+    // 已绑定共享栈的协程只能在原Processor上运行，退回去
+    for (auto it = tasks.begin(); it != tasks.end(); ) {
+        Task* tk = &*it;
+        if (!tk->ctx_.GetSharedStack()) {
+            ++it;
+            continue;
+        }
+        it = tasks.erase(it);   // 释放窃取链表的队列引用，生命周期引用保证tk仍然有效
+        PushRunnable(tk);
+    }
+    return tasks;
+}
+
+bool Processor::StealWork()
+{
+    std::size_t count = scheduler_->ProcessorCount();
+    if (count <= 1) return false;
+
+    // xorshift随机选择起点，避免所有空闲Processor同时窃取同一个目标
+    rand_ ^= rand_ << 13;
+    rand_ ^= rand_ >> 7;
+    rand_ ^= rand_ << 17;
+    std::size_t start = rand_ % count;
+
+    // 按NUMA节点分组时先只窃取同一节点（及不属于任何节点）的Processor，
+    // 连续RemoteStealThreshold()次没有窃取到之后才跨节点
+    for (int pass = 0; pass < 2; ++pass) {
+        bool remote = pass == 1;
+        for (std::size_t i = 0; i < count; ++i) {
+            Processor* victim = scheduler_->GetProcessor((start + i) % count);
+            if (!victim || victim == this) continue;
+            bool local = node_ < 0 || victim->node_ < 0 || victim->node_ == node_;
+            if (local == remote) continue;
+
+            std::size_t size = victim->RunnableSize();
+            if (size == 0) continue;
+
+            SList<Task> tasks = victim->StealMovable((size + 1) / 2);  // 窃取一半
+            if (tasks.empty()) continue;
+
+            stats_.steals_.Add();
+            stats_.stolenTasks_.Add(tasks.size());
+            if (remote) stats_.remoteSteals_.Add();
+            localStealMisses_ = 0;
+            RunQueue(tasks.begin()->priority_).push(std::move(tasks));
+            return true;
+        }
+        if (node_ < 0 || ++localStealMisses_ < Scheduler::RemoteStealThreshold())
+            break;
+    }
+    return false;
+}
+
+void Processor::NotifyCondition()
+{
+    // 与WaitCondition中的fence配对：要么这里看到waiting_，要么对方看到新入队的任务
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!waiting_.load(std::memory_order_relaxed)) return;
+    if (notified_.load(std::memory_order_relaxed) || notified_.exchange(true, std::memory_order_relaxed))
+        return;     // 已有投递者负责唤醒
+
+    std::unique_lock<std::mutex> lock(cvMutex_);
+    if (polling_)
+        reactor_->Notify();
+    else
+        cv_.notify_one();
+}
+
+void Processor::WaitCondition()
+{
+    std::unique_lock<std::mutex> lock(cvMutex_);
+    notified_.store(false, std::memory_order_relaxed);
+    waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (RunnableEmpty() && wakeupQueue_.emptyUnsafe() && !scheduler_->IsStop()) {
+        // 超时唤醒用于兜底：重新尝试窃取其他Processor新产生的任务；有定时器时最多睡到下一个到期tick
+        std::chrono::nanoseconds timeout = std::min<std::chrono::nanoseconds>(
+                std::chrono::milliseconds(10), timerWheel_.NextTimeout());
+
+        // 与Reactor::AddWaiter中的fence配对：要么这里看到等待者，要么对方看到waiting_并唤醒
+        if (reactor_->Waiters() > 0) {
+            polling_ = true;
+            lock.unlock();
+            reactor_->Poll(timeout);
+            lock.lock();
+            polling_ = false;
+        } else {
+            cv_.wait_for(lock, timeout);
+        }
+    }
+    waiting_.store(false, std::memory_order_relaxed);
+}
+
+void Processor::PollIo()
+{
+    if (reactor_->Waiters() > 0)
+        reactor_->Poll(std::chrono::nanoseconds(0));
+}
+
+void Processor::CollectMetrics(CoDebugger::ProcessorMetrics& m) const
+{
+    m.id_ = id_;
+    m.switches_ = stats_.switches_.Load();
+    m.handoffs_ = stats_.handoffs_.Load();
+    m.yields_ = stats_.yields_.Load();
+    m.parks_ = stats_.parks_.Load();
+    m.wakes_ = stats_.wakes_.Load();
+    m.steals_ = stats_.steals_.Load();
+    m.stolenTasks_ = stats_.stolenTasks_.Load();
+    m.remoteSteals_ = stats_.remoteSteals_.Load();
+    m.tasksDone_ = stats_.tasksDone_.Load();
+    m.preempts_ = stats_.preempts_.Load();
+    m.retakenTasks_ = retakenTasks_.Load();
+    m.runQueueDepth_ = 0;
+    for (TaskQueue const& q : runQueues_)
+        m.runQueueDepth_ += q.count_;
+    m.stackBytes_ = (int64_t)(stats_.stackBytesIn_.Load() - stats_.stackBytesOut_.Load());
+    stats_.runnableLatency_.Collect(m.runnableLatency_);
+}
+
+void Processor::Process()
+{
+    GetCurrentProcessor() = this;
+    TimerWheel::Local() = &timerWheel_;
+    if (!cpus_.empty())
+        NumaTopology::PinCurrentThread(cpus_);
+    if (node_ >= 0)     // 之后本线程新建的栈从所在节点分配物理页
+        NumaTopology::SetCurrentNode(node_);
+    if (pthread_getcpuclockid(pthread_self(), &threadClock_) == 0)
+        threadClockReady_.store(true, std::memory_order_release);
+
+    // 忙碌时每调度kPollInterval次派发一次IO事件，避免等待IO的协程饿死
+    static constexpr uint32_t kPollInterval = 64;
+    uint32_t tick = 0;
+
+    while (!scheduler_->IsStop()) {
+        // 每轮调度读一次时钟，本轮内的coarse_now()直接使用
+        TimerWheel::time_point now = FastSteadyClock::UpdateCoarse();
+        if (!timerWheel_.Empty())
+            timerWheel_.Advance(now);
+
+        if (++tick % kPollInterval == 0) {
+            PollIo();
+            BiasedRefOwner::DrainCurrent();
+        }
+
+        // 批量提交的后端（io_uring）每次派发前把积攒的请求交给内核，不必等到下一次PollIo
+        if (reactor_->NeedFlush())
+            reactor_->Flush();
+
+        GatherWakeupTasks();
+
+        runningTask_ = TakeRunNext();
+        if (!runningTask_)
+            runningTask_ = PopRunnable();
+        if (!runningTask_) {
+            PollIo();
+            GatherWakeupTasks();
+            if (!RunnableEmpty()) continue;
+            if (StealWork()) continue;
+            BiasedRefOwner::DrainCurrent();     // 休眠前合并其他线程转交的偏向计数对象
+            WaitCondition();
+            continue;
+        }
+
+        Task* tk = runningTask_;
+        if (!tk->proc_)     // 第一次运行（共享栈此时尚未绑定，容量为0）
+            stats_.stackBytesIn_.Add(tk->ctx_.StackCapacity());
+        tk->proc_ = this;
+        if (tk->ctx_.NeedBindStack())
+            tk->ctx_.BindSharedStack(sharedStacks_.Next());
+        OnSwitchIn(tk);
+        running_.store(true, std::memory_order_relaxed);
+        tk->SwapIn();
+        running_.store(false, std::memory_order_relaxed);
+        tk = runningTask_;  // 期间发生过直接切换时，切回调度循环的是链上最后一个协程
+        runningTask_ = nullptr;
+        if (cpuClock_.task_) cpuClock_.Switch(nullptr);
+        if (tk->probeStack_) tk->SampleStackDepth();
+
+        switch (tk->state_) {
+            case TaskState::runnable:   // 主动yield，排到队尾
+                stats_.yields_.Add();
+                StampReady(tk, tk->yieldCount_);
+                PushRunnable(tk);
+                break;
+
+            case TaskState::block:      // 已挂起，由Wakeup重新投递
+                stats_.parks_.Add();
+                break;
+
+            case TaskState::done:       // 执行完毕，释放生命周期引用（此时已不在协程栈上）
+                if (tk->probeStack_) tk->ReportStackUsage();
+                tk->ctx_.ReleaseSharedStack();
+                stats_.tasksDone_.Add();
+                if (!tk->ctx_.IsSharedStack())
+                    stats_.stackBytesOut_.Add(tk->ctx_.StackCapacity());
+                scheduler_->OnTaskFinished();
+                tk->DecRef();
+                break;
+        }
+    }
+
+    TimerWheel::Local() = nullptr;
+    GetCurrentProcessor() = nullptr;
+}
+
+} // cxk
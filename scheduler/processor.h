@@ -0,0 +1,272 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+
+#ifndef GOCOROUTINE_PROCESSOR_H
+#define GOCOROUTINE_PROCESSOR_H
+
+#pragma once
+#include <utils/utils.h>
+#include <common/thread_safe_queue.h>
+#include <task/task.h>
+#include <concurrence/timer_wheel.h>
+#include <context/shared_stack.h>
+#include "processor_stats.h"
+#include <debug/profiler.h>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+#include <vector>
+
+namespace cxk
+{
+
+class Scheduler;
+class Reactor;
+
+/*
+ * @brief 协程执行器，每个Processor绑定一个工作线程
+ *
+ * 队列划分：
+ *  - runQueues_: 本地运行队列，每个TaskPriority一个。所有者先从高优先级队列头部取任务，
+ *    空闲的其他Processor从最高的非空队列尾部批量窃取；其中的任务保证已经切出（不在任何线程上运行）。
+ *    每kFairInterval次调度先从normal、background队列（轮流）取一次，持续的高优先级负载下低优先级协程仍能推进。
+ *  - wakeupQueue_: 唤醒队列。Wakeup可能发生在被唤醒的任务真正切出之前（mark -> wake -> sleep），
+ *    因此唤醒的任务先放入这里，由所有者在两次调度之间一次取完、按优先级合并到runQueues_，不允许被窃取。
+ *    它是无锁的MPSCQueue：其他线程唤醒本Processor的协程时只有一次exchange，不与所有者取运行队列争用锁。
+ *
+ * 空闲等待：waiting_表示工作线程即将或正在休眠，notified_表示本次休眠已经有人唤醒过，
+ * 投递任务的线程只有看到waiting_且抢到notified_时才需要加锁、通知条件变量或写Reactor的eventfd。
+ *
+ * 共享栈协程第一次运行时绑定到本Processor的共享栈上，此后只在本Processor上运行：
+ * 被窃取时会被退回（见StealWork）。
+ *
+ * runnext：本Processor上运行的协程唤醒的对端（例如无缓冲channel、co_mutex的等待者）放入runNext_，
+ * 当前协程切出时直接SwapTo过去，不经过调度循环，一次切换代替两次。连续执行runnext的次数有上限，
+ * 超过后回到调度循环，排到运行队列尾部，避免相互唤醒的一对协程饿死定时器、IO和其他任务。
+ */
+class Processor
+{
+public:
+    typedef TSQueue<Task> TaskQueue;
+    typedef MPSCQueue<Task> TaskInbox;
+
+    /// @brief 挂起凭证，由Suspend返回，传给Wakeup唤醒协程
+    struct SuspendEntry
+    {
+        IncursivePtr<Task> tk_;
+        uint64_t id_ = 0;
+
+        explicit operator bool() const { return !!tk_; }
+
+        friend bool operator==(SuspendEntry const& lhs, SuspendEntry const& rhs) {
+            return lhs.tk_.get() == rhs.tk_.get() && lhs.id_ == rhs.id_;
+        }
+
+        /// @brief 是否已经被唤醒（或者根本没有挂起）
+        bool IsExpire() const;
+    };
+
+    Processor(Scheduler* scheduler, int id);
+    ~Processor();
+
+    Processor(Processor const&) = delete;
+    Processor& operator=(Processor const&) = delete;
+
+    /// @brief 工作线程入口，直到Scheduler停止才返回
+    void Process();
+
+    /// @brief 投递一个可运行的新任务（任意线程），按它的优先级放入运行队列
+    void AddTask(Task* tk);
+
+    /// @brief 批量投递可运行的新任务（任意线程），整个链表只加一次锁；链表中的任务优先级必须相同
+    void AddTasks(SList<Task> && tasks);
+
+    /// @brief 从最高的非空运行队列尾部窃取最多n个任务（由其他Processor调用），返回的任务优先级相同
+    SList<Task> Steal(std::size_t n);
+
+    /// @brief 同Steal，但已绑定共享栈的协程留在本Processor上（只能在这里运行）
+    SList<Task> StealMovable(std::size_t n);
+
+    /// @brief 各优先级运行队列的总长度（无锁读取，近似值）
+    ALWAYS_INLINE std::size_t RunnableSize() {
+        std::size_t size = 0;
+        for (TaskQueue const& q : runQueues_)
+            size += q.count_;
+        return size;
+    }
+
+    /// @brief 是否处于空闲等待状态
+    ALWAYS_INLINE bool IsWaiting() const {
+        return waiting_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief 如果处于空闲等待状态且本次休眠尚未被唤醒过，则唤醒工作线程
+    void NotifyCondition();
+
+    ALWAYS_INLINE int Id() const { return id_; }
+
+    /// @brief 所属的NUMA节点下标（见NumaTopology），-1表示不按节点分组
+    ALWAYS_INLINE int Node() const { return node_; }
+
+    /// @brief 当前线程的Processor，不在工作线程中返回nullptr
+    static Processor* & GetCurrentProcessor();
+
+    /// @brief 当前正在运行的协程，不在协程中返回nullptr
+    static Task* GetCurrentTask();
+
+    /// @brief 当前是否在协程中
+    static bool IsCoroutine();
+
+    /// @brief 协程主动让出执行权（保持可运行状态，排到运行队列尾部）
+    static void StaticCoYield();
+
+    /// @brief 安全点：当前协程已经运行超过时间片（Sysmon标记了当前Processor）时让出
+    ALWAYS_INLINE static void CheckPreempt() {
+        Processor* proc = GetCurrentProcessor();
+        if (proc && proc->preempt_.load(std::memory_order_relaxed) && proc->runningTask_) {
+            proc->stats_.preempts_.Add();
+            StaticCoYield();
+        }
+    }
+
+    /// @brief Sysmon是否认为本Processor上的协程运行超时（新任务优先投递到其他Processor）
+    ALWAYS_INLINE bool IsPreempting() const {
+        return preempt_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 把当前协程标记为挂起，但不立即切出
+     * 调用者随后调用StaticCoYield()真正切出；Wakeup可以发生在切出之前或之后
+     */
+    static SuspendEntry Suspend();
+
+    /// @brief 唤醒挂起的协程，同一个SuspendEntry只有一次唤醒会成功
+    static bool Wakeup(SuspendEntry const& entry);
+
+    /// @brief 休眠到abstime：协程中挂起当前协程（由当前Processor的时间轮唤醒），否则阻塞当前线程
+    static void SleepUntil(TimerWheel::time_point abstime);
+
+    /// @brief 本Processor的时间轮，由工作线程在调度循环中驱动
+    ALWAYS_INLINE TimerWheel& GetTimerWheel() { return timerWheel_; }
+
+    /// @brief 本Processor的IO多路复用器，由工作线程在调度循环中驱动
+    ALWAYS_INLINE Reactor* GetReactor() { return reactor_; }
+
+    /// @brief 不经过调度循环、直接切换到runnext协程的次数
+    ALWAYS_INLINE uint64_t HandoffCount() const {
+        return stats_.handoffs_.Load();
+    }
+
+    /// @brief 读取本Processor的运行时统计（任意线程，无锁）
+    void CollectMetrics(CoDebugger::ProcessorMetrics& m) const;
+
+private:
+    friend class Scheduler;
+    friend class Sysmon;
+
+    /// 把唤醒队列按优先级合并到运行队列
+    void GatherWakeupTasks();
+
+    ALWAYS_INLINE TaskQueue& RunQueue(TaskPriority priority) {
+        return runQueues_[(std::size_t)priority];
+    }
+
+    /// 任务排到它的优先级的运行队列尾部
+    ALWAYS_INLINE void PushRunnable(Task* tk) {
+        RunQueue(tk->priority_).push(tk);
+    }
+
+    /// 按优先级取下一个运行的任务（见kFairInterval）
+    Task* PopRunnable();
+
+    /// 运行队列是否都为空（无锁读取）
+    bool RunnableEmpty();
+
+    /// 从其他Processor窃取一批任务
+    bool StealWork();
+
+    /// 无任务时休眠等待：有协程等待IO时阻塞在Reactor上，否则阻塞在条件变量上
+    void WaitCondition();
+
+    /// 有协程等待IO时非阻塞地派发一次IO事件
+    void PollIo();
+
+    /// 挂起后被唤醒的任务放入唤醒队列（本Processor上的协程唤醒的放入runNext_）
+    void WakeupTask(Task* tk);
+
+    /// 调度循环取出runnext任务，连续次数超过上限时把它排到运行队列尾部
+    Task* TakeRunNext();
+
+    /// 当前协程tk切出时，取出可以直接切换过去的runnext任务
+    Task* TakeHandoff(Task* tk);
+
+    /// 被直接切换过来后，完成上一个协程切出后的收尾（排回运行队列等）
+    void FinishHandoff();
+
+    /// 任务变为可运行：seq的低位为0时记录时刻，用于统计运行队列等待时间
+    ALWAYS_INLINE static void StampReady(Task* tk, uint64_t seq) {
+        tk->readyTick_ = (seq & ProcessorStats::kLatencySampleMask) ? 0 : FastSteadyClock::Ticks();
+    }
+
+    /// 即将切入tk：统计切换次数和运行队列等待时间，开启协程分析时结算上一个协程的运行时间
+    ALWAYS_INLINE void OnSwitchIn(Task* tk) {
+        stats_.switches_.Add();
+        if (preempt_.load(std::memory_order_relaxed))
+            preempt_.store(false, std::memory_order_relaxed);
+        if (Profiler::IsEnabled() || cpuClock_.task_)
+            cpuClock_.Switch(tk);
+        if (tk->readyTick_) {
+            uint64_t now = FastSteadyClock::Ticks();
+            stats_.runnableLatency_.Record(now > tk->readyTick_ ? now - tk->readyTick_ : 0);
+            tk->readyTick_ = 0;
+        }
+    }
+
+    static constexpr uint32_t kMaxRunNextStreak = 16;   ///< 连续执行runnext的次数上限
+    static constexpr uint32_t kFairInterval = 61;       ///< 每隔多少次调度先从低优先级队列取一次
+
+    Scheduler* scheduler_;
+    int id_;
+    Task* runningTask_ = nullptr;
+
+    TaskQueue runQueues_[kTaskPriorityCount];   ///< 按TaskPriority下标
+    TaskInbox wakeupQueue_;
+    uint32_t popTick_ = 0;      ///< PopRunnable的调用次数（仅所有者访问）
+
+    // runnext，仅所有者访问
+    Task* runNext_ = nullptr;           ///< 下一个运行的任务（已被唤醒，不持有队列引用）
+    uint32_t runNextStreak_ = 0;        ///< 连续执行runnext的次数
+    Task* handoffPrev_ = nullptr;       ///< 直接切换时切出的协程，由被切换过去的协程收尾
+
+    TimerWheel timerWheel_;
+    Reactor* reactor_;
+    SharedStackGroup sharedStacks_;   ///< 共享栈协程第一次在本Processor上运行时绑定（仅所有者访问）
+
+    std::mutex cvMutex_;
+    std::condition_variable cv_;
+    atomic_t<bool> waiting_{false};
+    atomic_t<bool> notified_{false};    ///< 本次休眠已有投递者唤醒，其余投递者不必再通知
+    bool polling_ = false;    ///< 空闲时阻塞在Reactor::Poll上，由cvMutex_保护
+
+    uint64_t rand_;   ///< 选择窃取目标的随机数种子（仅所有者访问）
+
+    // 放置（Scheduler启动工作线程之前设置）
+    int node_ = -1;                 ///< 所属的NUMA节点下标，-1表示不按节点分组
+    std::vector<int> cpus_;         ///< 工作线程绑定的CPU，为空表示不绑定
+    uint32_t localStealMisses_ = 0; ///< 连续没有从同一节点窃取到任务的次数（仅所有者访问）
+
+    ProcessorStats stats_;   ///< 运行时统计（仅所有者写入）
+
+    // Sysmon观测：切入次数即stats_.switches_
+    atomic_t<bool> running_{false};         ///< 是否正在运行协程（所有者写入）
+    atomic_t<bool> preempt_{false};         ///< 当前协程运行超过时间片（Sysmon置位，下一次切入时清除）
+    StatCounter retakenTasks_;              ///< 被Sysmon转移到其他Processor的任务数量（仅Sysmon写入）
+    clockid_t threadClock_ = 0;             ///< 工作线程的CPU时钟，用于区分忙循环和阻塞在系统调用中
+    atomic_t<bool> threadClockReady_{false};
+    Profiler::CpuClock cpuClock_;   ///< 协程分析的计时状态（仅所有者访问）
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_PROCESSOR_H
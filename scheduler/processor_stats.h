@@ -0,0 +1,100 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_PROCESSOR_STATS_H
+#define GOCOROUTINE_PROCESSOR_STATS_H
+
+#pragma once
+#include <utils/utils.h>
+#include <common/clock.h>
+#include <debug/debugger.h>
+#include <cstdint>
+
+namespace cxk
+{
+
+/*
+ * @brief 单一写者计数器
+ * 只由所属的工作线程写入，写入是一次relaxed load + store，不需要原子RMW（没有lock前缀）；
+ * 其他线程随时可以relaxed读取，得到某个时刻的值。
+ */
+class StatCounter
+{
+public:
+    ALWAYS_INLINE void Add(uint64_t n = 1) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    ALWAYS_INLINE uint64_t Load() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    atomic_t<uint64_t> value_{0};
+};
+
+/*
+ * @brief 运行队列等待时间直方图（单一写者）
+ * 记录时把FastSteadyClock::Ticks()的间隔换算为纳秒，第i个桶为[2^(i-1), 2^i)纳秒，
+ * 桶边界固定，便于exporter跨多次采集累加。时钟尚未校准时丢弃样本。
+ */
+class LatencyStat
+{
+public:
+    static constexpr int kBuckets = 32;     ///< 最后一个桶没有上界（>= 2^30ns，约1s）
+
+    ALWAYS_INLINE void Record(uint64_t ticks) {
+        double ticksPerNs = FastSteadyClock::TicksPerNanosecond();
+        if (ticksPerNs <= 0) return;
+        uint64_t ns = (uint64_t)((double)ticks / ticksPerNs);
+        int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+        if (bucket >= kBuckets) bucket = kBuckets - 1;
+        buckets_[bucket].Add();
+        sumNs_.Add(ns);
+    }
+
+    void Collect(CoDebugger::LatencyHistogram& out) const {
+        out.boundsNs_.resize(kBuckets - 1);
+        out.counts_.resize(kBuckets);
+        out.count_ = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            if (i < kBuckets - 1) out.boundsNs_[i] = (double)(1ull << i);
+            out.counts_[i] = buckets_[i].Load();
+            out.count_ += out.counts_[i];
+        }
+        out.sumNs_ = (double)sumNs_.Load();
+    }
+
+private:
+    StatCounter buckets_[kBuckets];
+    StatCounter sumNs_;
+};
+
+/*
+ * @brief 一个Processor的运行时统计
+ * 所有字段只由所属的工作线程写入；独占缓存行，避免与其他Processor的统计或调度状态伪共享。
+ */
+struct alignas(64) ProcessorStats
+{
+    /// 运行队列等待时间按1/(kLatencySampleMask+1)抽样，避免每次调度都读两次时钟
+    static constexpr uint64_t kLatencySampleMask = 7;
+
+    StatCounter switches_;
+    StatCounter handoffs_;
+    StatCounter yields_;
+    StatCounter parks_;
+    StatCounter wakes_;
+    StatCounter steals_;
+    StatCounter stolenTasks_;
+    StatCounter remoteSteals_;      ///< 从其他NUMA节点的Processor窃取成功的次数
+    StatCounter tasksDone_;
+    StatCounter preempts_;          ///< 在安全点响应Sysmon让出的次数
+    StatCounter stackBytesIn_;      ///< 开始运行的协程的私有栈字节数
+    StatCounter stackBytesOut_;     ///< 执行完毕的协程的私有栈字节数
+    LatencyStat runnableLatency_;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_PROCESSOR_STATS_H
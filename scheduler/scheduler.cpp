@@ -0,0 +1,293 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+
+#include "scheduler.h"
+#include <common/numa.h>
+
+namespace cxk
+{
+
+Scheduler& Scheduler::getInstance()
+{
+    // 不析构：进程退出时工作线程可能仍在运行协程
+    static Scheduler* obj = new Scheduler;
+    return *obj;
+}
+
+Scheduler::Scheduler()
+{
+}
+
+Scheduler::~Scheduler()
+{
+    Stop();
+}
+
+bool& Scheduler::PinWorkers()
+{
+    static bool obj = false;
+    return obj;
+}
+
+bool& Scheduler::NumaAware()
+{
+    static bool obj = false;
+    return obj;
+}
+
+uint32_t& Scheduler::RemoteStealThreshold()
+{
+    static uint32_t obj = 3;
+    return obj;
+}
+
+void Scheduler::Start(int threadCount)
+{
+    std::unique_lock<std::mutex> lock(startMtx_);
+    if (started_.load(std::memory_order_relaxed)) return;
+
+    if (threadCount <= 0) {
+        threadCount = (int)std::thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+    }
+
+    // TSC时钟校准线程（重复启动时直接返回），时间轮通过FastSteadyClock读取时间；
+    // 第一次读取时钟时也会自动启动，这里提前开始校准
+    FastSteadyClock::StartCalibration();
+
+    // 先创建全部Processor再发布数量，工作线程窃取时可以无锁遍历processors_；
+    // 为备用Processor预留容量，Sysmon追加时不会重新分配
+    processors_.reserve(threadCount + Sysmon::MaxSpareProcessors());
+    for (int i = 0; i < threadCount; ++i) {
+        processors_.push_back(new Processor(this, i));
+    }
+    PlaceProcessors(threadCount);
+    processorCount_.store(processors_.size(), std::memory_order_release);
+    started_.store(true, std::memory_order_release);
+
+    threads_.reserve(threadCount + Sysmon::MaxSpareProcessors());
+    for (int i = 0; i < threadCount; ++i) {
+        Processor* proc = processors_[i];
+        threads_.emplace_back([proc]{ proc->Process(); });
+    }
+    sysmon_.Start();
+}
+
+void Scheduler::Stop()
+{
+    std::unique_lock<std::mutex> lock(startMtx_);
+    if (stop_.exchange(true)) return;
+
+    sysmon_.Stop();     // 之后不会再追加备用Processor
+    for (auto proc : processors_)
+        proc->NotifyCondition();
+
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+    threads_.clear();
+
+    for (auto proc : processors_)
+        delete proc;
+    processors_.clear();
+    nodeProcessors_.clear();
+    processorCount_.store(0, std::memory_order_release);
+}
+
+bool Scheduler::IsCoroutine()
+{
+    return Processor::IsCoroutine();
+}
+
+void Scheduler::CreateTask(TaskF const& fn, std::size_t stackSize)
+{
+    TaskAttr attr;
+    attr.stackSize_ = stackSize;
+    Spawn(fn, attr, __builtin_return_address(0));
+}
+
+void Scheduler::CreateTask(TaskF const& fn, TaskAttr const& attr)
+{
+    Spawn(fn, attr, __builtin_return_address(0));
+}
+
+void Scheduler::CreateTasks(std::vector<TaskF> const& fns, TaskAttr const& attr)
+{
+    if (fns.empty()) return;
+    if (!started_.load(std::memory_order_acquire)) {
+        Start();
+    }
+
+    const void* site = __builtin_return_address(0);
+    uint64_t id = taskIdSeq_.fetch_add(fns.size(), std::memory_order_relaxed) + 1;
+    SList<Task> tasks;
+    for (TaskF const& fn : fns)
+        tasks.push_back(NewTask(fn, attr, site, id++));     // 链表持有队列引用
+    taskCount_.fetch_add((uint32_t)fns.size(), std::memory_order_relaxed);
+    AddTasks(std::move(tasks), attr.processor_);
+}
+
+void Scheduler::Spawn(TaskF const& fn, TaskAttr const& attr, const void* site)
+{
+    if (!started_.load(std::memory_order_acquire)) {
+        Start();
+    }
+
+    Task* tk = NewTask(fn, attr, site, ++taskIdSeq_);
+    taskCount_.fetch_add(1, std::memory_order_relaxed);
+    AddTask(tk, attr.processor_);
+}
+
+Task* Scheduler::NewTask(TaskF const& fn, TaskAttr const& attr, const void* site, uint64_t id)
+{
+    Task* tk = MakePooledRef<Task>(fn, attr);   // 协程结束后归还对象池
+    tk->id_ = id;
+    tk->site_ = site;
+    uint32_t rate = CoDebugger::getInstance().GetStackProbeRate();
+    if (rate && probeSeq_.fetch_add(1, std::memory_order_relaxed) % rate == 0)
+        tk->StartStackProbe();
+    tk->readyTick_ = FastSteadyClock::Ticks();
+    tk->AddRef();   // 生命周期引用，协程执行完毕后由Processor释放
+    return tk;
+}
+
+Processor* Scheduler::ChooseProcessor(int preferred)
+{
+    std::size_t count = ProcessorCount();
+    if (count == 0) return nullptr;     // 调度器已停止
+
+    if (preferred >= 0 && (std::size_t)preferred < count)
+        return processors_[preferred];
+
+    // 协程（或工作线程）中创建：放入本地队列，局部性最好
+    Processor* proc = Processor::GetCurrentProcessor();
+    if (proc && proc->scheduler_ == this)
+        return proc;
+
+    // 按节点分组时投递到创建线程所在节点，栈的物理页也在该节点上
+    if (nodeProcessors_.size() > 1) {
+        std::size_t node = (std::size_t)NumaTopology::CurrentNode();
+        if (node < nodeProcessors_.size() && !nodeProcessors_[node].empty()) {
+            std::vector<Processor*> const& procs = nodeProcessors_[node];
+            return PickProcessor(procs.data(), procs.size());
+        }
+    }
+    return PickProcessor(processors_.data(), count);
+}
+
+void Scheduler::AddTask(Task* tk, int preferred)
+{
+    Processor* proc = ChooseProcessor(preferred);
+    if (!proc) {
+        taskCount_.fetch_sub(1, std::memory_order_relaxed);
+        tk->DecRef();
+        return;
+    }
+
+    proc->AddTask(tk);
+    Processor* current = Processor::GetCurrentProcessor();
+    if (current && current->scheduler_ == this) {
+        // 放入本地队列时唤醒空闲Processor窃取；协程中创建协程是Sysmon的安全点
+        if (proc == current && proc->Id() != preferred)
+            WakeupIdleProcessor(proc);
+        Processor::CheckPreempt();
+    }
+}
+
+void Scheduler::AddTasks(SList<Task> && tasks, int preferred)
+{
+    std::size_t n = tasks.size();
+    Processor* proc = ChooseProcessor(preferred);
+    if (!proc) {
+        for (auto it = tasks.begin(); it != tasks.end(); ) {
+            Task* tk = &*it;
+            it = tasks.erase(it);   // 释放队列引用
+            tk->DecRef();           // 释放生命周期引用
+        }
+        taskCount_.fetch_sub((uint32_t)n, std::memory_order_relaxed);
+        return;
+    }
+
+    proc->AddTasks(std::move(tasks));
+    Processor* current = Processor::GetCurrentProcessor();
+    bool local = current && current->scheduler_ == this;
+
+    // 空闲的Processor各窃取一部分（指定了Processor时不分散）：
+    // 本地投递时当前Processor正忙，否则目标Processor已被AddTasks唤醒
+    if (proc->Id() != preferred)
+        WakeupIdleProcessor(proc, proc == current ? n : n - 1);
+    if (local)
+        Processor::CheckPreempt();
+}
+
+Processor* Scheduler::PickProcessor(Processor* const* candidates, std::size_t count)
+{
+    // 跳过当前协程运行超时的Processor，都超时时按原顺序投递
+    std::size_t idx = dispatchIdx_.fetch_add(1, std::memory_order_relaxed) % count;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!candidates[(idx + i) % count]->IsPreempting())
+            return candidates[(idx + i) % count];
+    }
+    return candidates[idx];
+}
+
+void Scheduler::PlaceProcessors(int count)
+{
+    if (!PinWorkers() && !NumaAware()) return;
+
+    NumaTopology& topo = NumaTopology::getInstance();
+    NumaTopology::Active() = NumaAware();
+    if (NumaAware())
+        nodeProcessors_.resize(topo.NodeCount());
+
+    // CPU按节点分组排列，第i个Processor对应第i*cpus/count个CPU：
+    // 各节点分到的Processor数量与它的CPU数量成比例，编号相邻的Processor在同一节点上
+    std::vector<int> const& cpus = topo.Cpus();
+    for (int i = 0; i < count; ++i) {
+        Processor* proc = processors_[i];
+        int cpu = cpus[(std::size_t)i * cpus.size() / count];
+        if (NumaAware()) {
+            proc->node_ = topo.NodeOfCpu(cpu);
+            nodeProcessors_[proc->node_].push_back(proc);
+        }
+        if (PinWorkers())
+            proc->cpus_.assign(1, cpu);
+        else
+            proc->cpus_ = topo.NodeCpus(proc->node_);
+    }
+}
+
+void Scheduler::WakeupIdleProcessor(Processor* except, std::size_t n)
+{
+    // 按节点分组时优先唤醒同一节点的：其他节点的Processor要连续多次窃取失败后才会跨节点
+    std::size_t count = ProcessorCount();
+    for (int pass = 0; pass < 2 && n > 0; ++pass) {
+        for (std::size_t i = 0; i < count && n > 0; ++i) {
+            Processor* proc = processors_[i];
+            if (except->node_ >= 0 && (proc->node_ == except->node_) != (pass == 0)) continue;
+            if (proc != except && proc->IsWaiting()) {
+                proc->NotifyCondition();
+                --n;
+            }
+        }
+        if (except->node_ < 0) break;
+    }
+}
+
+Processor* Scheduler::AddSpareProcessor()
+{
+    // 只由Sysmon线程调用；Stop先停止Sysmon再回收线程，因此这里不需要加锁
+    if (IsStop() || spareCount_.load(std::memory_order_relaxed) >= Sysmon::MaxSpareProcessors())
+        return nullptr;
+    if (processors_.size() >= processors_.capacity()) return nullptr;
+
+    Processor* proc = new Processor(this, (int)processors_.size());
+    processors_.push_back(proc);
+    processorCount_.store(processors_.size(), std::memory_order_release);
+    spareCount_.fetch_add(1, std::memory_order_relaxed);
+    threads_.emplace_back([proc]{ proc->Process(); });
+    return proc;
+}
+
+} // cxk
@@ -0,0 +1,182 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+
+#ifndef GOCOROUTINE_SCHEDULER_H
+#define GOCOROUTINE_SCHEDULER_H
+
+#pragma once
+#include <utils/utils.h>
+#include <task/task.h>
+#include "processor.h"
+#include "sysmon.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+namespace cxk
+{
+
+/*
+ * @brief 多线程协程调度器
+ * 启动N个工作线程，每个线程运行一个Processor。
+ *  - 协程中创建的新协程放入当前Processor的运行队列（局部性最好），并唤醒一个空闲Processor来窃取；
+ *  - 非协程线程创建的新协程轮询分配到各个Processor；TaskAttr::processor_指定了Processor时直接投递到它；
+ *  - CreateTasks批量创建：全部协程组成一个链表，目标运行队列只加一次锁，再唤醒空闲Processor来窃取；
+ *  - 每个Processor按TaskPriority分成多个运行队列，延迟敏感的协程不会排在批量任务之后；
+ *  - 空闲的Processor随机选择其他Processor，从其运行队列尾部批量窃取一半任务；
+ *  - NumaAware()时Processor按NUMA节点分组：工作线程绑定到所在节点的CPU上，栈从所在节点分配物理页，
+ *    非协程线程创建的协程投递到创建线程所在节点，窃取先在节点内进行，连续多次失败后才跨节点；
+ *  - Sysmon监控长时间不让出的Processor，转移它的运行队列，必要时新建备用Processor（见Sysmon）。
+ */
+class Scheduler
+{
+public:
+    static Scheduler& getInstance();
+
+    /**
+     * @brief 启动调度器（非阻塞），重复调用无效
+     * @param threadCount 工作线程数量，0表示std::thread::hardware_concurrency()
+     */
+    void Start(int threadCount = 0);
+
+    /// @brief 停止调度器并等待所有工作线程退出，未执行完的协程将被丢弃
+    void Stop();
+
+    ALWAYS_INLINE bool IsStop() const {
+        return stop_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 创建协程，调度器未启动时自动以默认参数启动
+     * @param fn 协程函数
+     * @param stackSize 栈大小，0表示StackPool::DefaultStackSize()
+     */
+    void CreateTask(TaskF const& fn, std::size_t stackSize = 0);
+
+    /**
+     * @brief 按属性创建协程（例如使用共享栈），调度器未启动时自动以默认参数启动
+     * @param fn 协程函数
+     * @param attr 协程属性，见TaskAttr
+     */
+    void CreateTask(TaskF const& fn, TaskAttr const& attr);
+
+    /**
+     * @brief 批量创建协程，调度器未启动时自动以默认参数启动
+     * 全部协程先组成一个链表，再一次投递到同一个Processor（与CreateTask的选择规则相同），
+     * 运行队列只加一次锁，随后唤醒空闲的Processor来窃取。一次扇出几十上百个子协程时代替逐个CreateTask。
+     * @param fns 协程函数，每个创建一个协程
+     * @param attr 所有协程共用的属性，见TaskAttr
+     */
+    void CreateTasks(std::vector<TaskF> const& fns, TaskAttr const& attr = TaskAttr());
+
+    /// @brief 当前未执行完毕的协程数量
+    ALWAYS_INLINE uint32_t TaskCount() const {
+        return taskCount_.load(std::memory_order_relaxed);
+    }
+
+    ALWAYS_INLINE std::size_t ProcessorCount() const {
+        return processorCount_.load(std::memory_order_acquire);
+    }
+
+    ALWAYS_INLINE Processor* GetProcessor(std::size_t index) {
+        return index < ProcessorCount() ? processors_[index] : nullptr;
+    }
+
+    /// @brief Sysmon新建的备用Processor数量（包含在ProcessorCount()中）
+    ALWAYS_INLINE std::size_t SpareProcessorCount() const {
+        return spareCount_.load(std::memory_order_relaxed);
+    }
+
+    ALWAYS_INLINE Sysmon& GetSysmon() { return sysmon_; }
+
+    /// @brief 当前是否在协程中
+    static bool IsCoroutine();
+
+    /// @brief 把每个工作线程绑定到一个CPU上（按节点分组顺序分配）；Start之前设置
+    static bool& PinWorkers();
+
+    /// @brief 按NUMA节点放置Processor、分配栈和窃取（见NumaTopology）；Start之前设置
+    static bool& NumaAware();
+
+    /// @brief 连续多少次没有从同一节点窃取到任务后才从其他节点窃取；Start之前设置
+    static uint32_t& RemoteStealThreshold();
+
+    Scheduler(Scheduler const&) = delete;
+    Scheduler& operator=(Scheduler const&) = delete;
+
+private:
+    friend class Processor;
+    friend class Sysmon;
+
+    Scheduler();
+    ~Scheduler();
+
+    /// 创建协程，site为CreateTask的调用地址（栈使用量按它聚合）
+    void Spawn(TaskF const& fn, TaskAttr const& attr, const void* site);
+
+    /// 构造任务并持有生命周期引用，尚未计入TaskCount()
+    Task* NewTask(TaskF const& fn, TaskAttr const& attr, const void* site, uint64_t id);
+
+    /// 选择新任务的Processor：首选的、当前的、创建线程所在节点的，或轮询；已停止时返回nullptr
+    Processor* ChooseProcessor(int preferred);
+
+    /// 把新任务放到合适的Processor上
+    void AddTask(Task* tk, int preferred);
+
+    /// 把一批优先级相同的新任务放到同一个Processor上
+    void AddTasks(SList<Task> && tasks, int preferred);
+
+    /// 按PinWorkers()/NumaAware()设置前count个Processor的节点和绑定的CPU
+    void PlaceProcessors(int count);
+
+    /// 从count个候选中轮询选择一个，跳过当前协程运行超时的Processor
+    Processor* PickProcessor(Processor* const* candidates, std::size_t count);
+
+    /// 唤醒最多n个空闲的Processor，让它们来窃取任务
+    void WakeupIdleProcessor(Processor* except, std::size_t n = 1);
+
+    /// Sysmon调用：所有Processor都阻塞时新建一个备用Processor，达到上限或已停止时返回nullptr
+    Processor* AddSpareProcessor();
+
+    /// Processor回调：协程执行完毕
+    ALWAYS_INLINE void OnTaskFinished() {
+        taskCount_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::mutex startMtx_;
+    std::vector<Processor*> processors_;
+    std::vector<std::thread> threads_;
+    std::vector<std::vector<Processor*>> nodeProcessors_;   ///< NumaAware()时每个节点上的Processor（不含备用）
+    atomic_t<std::size_t> processorCount_{0};
+    atomic_t<bool> started_{false};
+    atomic_t<bool> stop_{false};
+    atomic_t<uint32_t> taskCount_{0};
+    atomic_t<uint64_t> taskIdSeq_{0};
+    atomic_t<std::size_t> dispatchIdx_{0};  ///< 非协程线程创建任务时的轮询下标
+    atomic_t<uint32_t> probeSeq_{0};        ///< 栈使用量采样计数
+    atomic_t<std::size_t> spareCount_{0};
+    Sysmon sysmon_{this};
+};
+
+/// @brief 休眠一段时间：协程中只挂起当前协程，不阻塞工作线程；否则阻塞当前线程
+template <typename Rep, typename Period>
+inline void co_sleep(std::chrono::duration<Rep, Period> const& duration)
+{
+    Processor::SleepUntil(FastSteadyClock::now() +
+            std::chrono::duration_cast<TimerWheel::time_point::duration>(duration));
+}
+
+/**
+ * @brief 安全点：当前协程已经运行超过Sysmon::TimeSlice()时让出，否则只有一次load
+ * 长时间计算、不调用任何IO或同步原语的循环中定期调用，避免饿死同一工作线程上的其他协程
+ */
+ALWAYS_INLINE void co_yield_if_preempted()
+{
+    Processor::CheckPreempt();
+}
+
+} // cxk
+
+#endif //GOCOROUTINE_SCHEDULER_H
@@ -0,0 +1,171 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#include "sysmon.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <ctime>
+
+namespace cxk
+{
+
+namespace
+{
+
+int64_t NowNs()
+{
+    return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            FastSteadyClock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+std::chrono::microseconds& Sysmon::TimeSlice()
+{
+    static std::chrono::microseconds obj(10000);
+    return obj;
+}
+
+std::size_t& Sysmon::MaxSpareProcessors()
+{
+    static std::size_t obj = 4;
+    return obj;
+}
+
+Sysmon::Sysmon(Scheduler* scheduler)
+    : scheduler_(scheduler)
+{
+}
+
+Sysmon::~Sysmon()
+{
+    Stop();
+}
+
+void Sysmon::Start()
+{
+    if (TimeSlice().count() <= 0 || thread_.joinable()) return;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        stop_ = false;
+    }
+    thread_ = std::thread(&Sysmon::Run, this);
+}
+
+void Sysmon::Stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void Sysmon::Run()
+{
+    // 有协程在运行时每半个时间片检查一次；全部空闲时逐渐放慢，最多20ms检查一次
+    std::chrono::microseconds base = std::max<std::chrono::microseconds>(
+            TimeSlice() / 2, std::chrono::microseconds(100));
+    std::chrono::microseconds idle = std::max<std::chrono::microseconds>(base, std::chrono::milliseconds(20));
+    std::chrono::microseconds interval = base;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!stop_) {
+        cv_.wait_for(lock, interval);
+        if (stop_) break;
+        lock.unlock();
+        bool busy = Scan();
+        lock.lock();
+        interval = busy ? base : std::min(interval * 2, idle);
+    }
+}
+
+bool Sysmon::Scan()
+{
+    int64_t slice = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(TimeSlice()).count();
+    int64_t now = NowNs();
+    std::size_t count = scheduler_->ProcessorCount();
+    if (observes_.size() < count) observes_.resize(count);
+
+    bool busy = false;
+    std::vector<std::pair<Processor*, bool>> stuck;
+    for (std::size_t i = 0; i < count; ++i) {
+        Processor* proc = scheduler_->GetProcessor(i);
+        if (!proc) continue;
+
+        Observe& o = observes_[i];
+        uint64_t switches = proc->stats_.switches_.Load();
+        bool running = proc->running_.load(std::memory_order_relaxed);
+        busy = busy || running;
+        if (!running || switches != o.switches_) {
+            o.switches_ = switches;
+            o.sinceNs_ = now;
+            o.cpuNs_ = -1;
+            o.stuck_ = false;
+            continue;
+        }
+        if (now - o.sinceNs_ < slice) continue;
+
+        // 距上次读取，线程CPU时间的增长不到经过时间的一半：阻塞在系统调用（或缺页等）中
+        int64_t cpu = ThreadCpuNs(proc);
+        bool blocked = o.cpuNs_ >= 0 && cpu >= 0 && (cpu - o.cpuNs_) * 2 < now - o.checkNs_;
+        o.cpuNs_ = cpu;
+        o.checkNs_ = now;
+        if (!o.stuck_) {
+            o.stuck_ = true;
+            proc->preempt_.store(true, std::memory_order_relaxed);
+            preemptRequests_.Add();
+        }
+        if (blocked) blocked_.Add();
+        stuck.emplace_back(proc, blocked);
+    }
+
+    for (auto const& s : stuck)
+        Retake(s.first, s.second);
+    return busy;
+}
+
+void Sysmon::Retake(Processor* victim, bool blocked)
+{
+    std::size_t size = victim->RunnableSize();
+    if (size == 0) return;
+
+    std::vector<Processor*> targets;
+    std::size_t count = scheduler_->ProcessorCount();
+    for (std::size_t i = 0; i < count && i < observes_.size(); ++i) {
+        Processor* proc = scheduler_->GetProcessor(i);
+        if (proc && proc != victim && !observes_[i].stuck_)
+            targets.push_back(proc);
+    }
+    if (targets.empty()) {
+        // 忙循环的Processor之间转移没有意义；阻塞时新建备用Processor，它会从卡住的Processor窃取后续任务
+        if (!blocked) return;
+        Processor* spare = scheduler_->AddSpareProcessor();
+        if (!spare) return;
+        targets.push_back(spare);
+    }
+
+    // 队列短的优先
+    std::sort(targets.begin(), targets.end(), [](Processor* a, Processor* b) {
+        return a->RunnableSize() < b->RunnableSize();
+    });
+    std::size_t per = (size + targets.size() - 1) / targets.size();
+    for (Processor* target : targets) {
+        SList<Task> tasks = victim->StealMovable(per);
+        if (tasks.empty()) break;
+        victim->retakenTasks_.Add(tasks.size());
+        target->AddTasks(std::move(tasks));
+    }
+}
+
+int64_t Sysmon::ThreadCpuNs(Processor* proc)
+{
+    if (!proc->threadClockReady_.load(std::memory_order_acquire)) return -1;
+    struct timespec ts;
+    if (clock_gettime(proc->threadClock_, &ts) != 0) return -1;
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+} // cxk
@@ -0,0 +1,100 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_SYSMON_H
+#define GOCOROUTINE_SYSMON_H
+
+#pragma once
+#include <utils/utils.h>
+#include "processor_stats.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cxk
+{
+
+class Scheduler;
+class Processor;
+
+/*
+ * @brief 调度监控线程（类似Go的sysmon），由Scheduler::Start启动
+ *
+ * 周期性地用FastSteadyClock检查每个Processor：切入次数（ProcessorStats::switches_）在一个时间片
+ * （TimeSlice()）内没有变化、并且正在运行协程的Processor，说明当前协程长时间没有让出。
+ * 比较工作线程的CPU时间区分两种情况：
+ *  - 忙循环：标记该Processor（Processor::CheckPreempt在下一个安全点让出），新任务优先投递到其他Processor，
+ *    运行队列中的任务转移给没有卡住的Processor；
+ *  - 阻塞在系统调用中（CPU时间几乎不增长）：同样转移运行队列；所有Processor都卡住时，
+ *    新建一个备用Processor（最多MaxSpareProcessors()个，运行到Scheduler::Stop）接手。
+ *
+ * 协程切换只能发生在协程自己调用的切换点上，信号处理函数中切换是不安全的（可能持有锁、在malloc中等），
+ * 因此只能在安全点让出：hook的IO调用、在协程中CreateTask，以及co_yield_if_preempted()
+ * （长时间计算的循环中调用，未被标记时只有一次load）。
+ * 唤醒队列中的任务和共享栈协程不会被转移（见Processor），需要等卡住的协程让出。
+ */
+class Sysmon
+{
+public:
+    /// @brief 时间片长度，0表示不启动Sysmon；Scheduler::Start之前设置
+    static std::chrono::microseconds& TimeSlice();
+
+    /// @brief 阻塞在系统调用中时最多新建的备用Processor数量；Scheduler::Start之前设置
+    static std::size_t& MaxSpareProcessors();
+
+    explicit Sysmon(Scheduler* scheduler);
+    ~Sysmon();
+
+    void Start();
+    void Stop();
+
+    /// @brief 标记运行超时的次数
+    ALWAYS_INLINE uint64_t PreemptRequests() const { return preemptRequests_.Load(); }
+
+    /// @brief 发现阻塞在系统调用中的次数
+    ALWAYS_INLINE uint64_t BlockedDetections() const { return blocked_.Load(); }
+
+    Sysmon(Sysmon const&) = delete;
+    Sysmon& operator=(Sysmon const&) = delete;
+
+private:
+    /// 一个Processor的观测状态（仅Sysmon线程访问）
+    struct Observe
+    {
+        uint64_t switches_ = 0;     ///< 上次看到的切入次数
+        int64_t sinceNs_ = 0;       ///< 第一次看到该切入次数的时刻
+        int64_t checkNs_ = 0;       ///< 上次读取CPU时间的时刻
+        int64_t cpuNs_ = -1;        ///< 上次读取的线程CPU时间，-1表示未读取
+        bool stuck_ = false;        ///< 本次切入已经超时
+    };
+
+    void Run();
+
+    /// 检查所有Processor，返回是否有Processor正在运行协程
+    bool Scan();
+
+    /// 把victim运行队列中可以转移的任务分给没有卡住的Processor，都卡住时（blocked）新建备用Processor
+    void Retake(Processor* victim, bool blocked);
+
+    static int64_t ThreadCpuNs(Processor* proc);
+
+    Scheduler* scheduler_;
+    std::vector<Observe> observes_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+
+    // 仅Sysmon线程写入
+    StatCounter preemptRequests_;
+    StatCounter blocked_;
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_SYSMON_H
@@ -3,7 +3,123 @@
 //
 
 #include "task.h"
+#include <scheduler/processor.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
 
 namespace cxk
 {
-} // cxk
\ No newline at end of file
+
+const char* GetTaskStateName(TaskState state)
+{
+    switch (state) {
+        case TaskState::runnable:
+            return "Runnable";
+        case TaskState::block:
+            return "Block";
+        case TaskState::done:
+            return "Done";
+    }
+    return "Unknown";
+}
+
+const char* GetTaskPriorityName(TaskPriority priority)
+{
+    switch (priority) {
+        case TaskPriority::high:
+            return "High";
+        case TaskPriority::normal:
+            return "Normal";
+        case TaskPriority::background:
+            return "Background";
+    }
+    return "Unknown";
+}
+
+Task::Task(TaskF const& fn, TaskAttr const& attr)
+    : ctx_(&Task::StaticRun, (intptr_t)this, (uint32_t)attr.stackSize_, attr.sharedStack_),
+      fn_(fn), priority_(attr.priority_), switcher_(this, attr.sharedStack_), siteName_(attr.site_)
+{
+    if (attr.label_) debugInfo_ = attr.label_;
+}
+
+Task::~Task()
+{
+    this->UnregisterDebugger();
+    assert(!this->prev);
+    assert(!this->next);
+}
+
+void Task::Run()
+{
+    try {
+        fn_();
+    } catch (std::exception const& e) {
+        eptr_ = std::current_exception();
+        spdlog::error("task({}) has uncaught exception: {}", DebugInfo(), e.what());
+    } catch (...) {
+        eptr_ = std::current_exception();
+        spdlog::error("task({}) has uncaught exception", DebugInfo());
+    }
+
+    fn_ = TaskF();  // 在协程栈上释放用户函数捕获的资源
+    cls_.Reset();   // 协程本地变量同样在协程中析构
+    state_ = TaskState::done;
+    Processor::StaticCoYield();  // 切出后不会再被调度
+}
+
+void Task::StartStackProbe()
+{
+    probeStack_ = true;
+    ctx_.FillStackPattern();
+}
+
+void Task::ReportStackUsage()
+{
+    // 私有栈扫描花纹得到精确的最大深度；共享栈只有切换点的深度
+    std::size_t used = std::max(ctx_.ScanStackUsage(), maxSwitchDepth_);
+    CoDebugger::getInstance().RecordStackUsage(site_, siteName_, used, ctx_.StackCapacity());
+}
+
+void FCONTEXT_CALL Task::StaticRun(intptr_t vp)
+{
+    Task* tk = (Task*)vp;
+    tk->Run();
+}
+
+void TaskSwitcher::mark()
+{
+    Processor::SuspendEntry entry = Processor::Suspend();
+    suspendId_ = entry.id_;
+}
+
+void TaskSwitcher::sleep()
+{
+    Processor::StaticCoYield();
+}
+
+bool TaskSwitcher::wake()
+{
+    // 挂起期间协程不会结束，tk_一定有效
+    Processor::SuspendEntry entry;
+    entry.tk_ = IncursivePtr<Task>(tk_);
+    entry.id_ = suspendId_;
+    return Processor::Wakeup(entry);
+}
+
+/// 注册协程切换器：协程中使用TaskSwitcher，否则回退到PThreadSwitcher
+void routine_sync_init_callback()
+{
+    RoutineSyncPolicy::RegisterSwitcher<TaskSwitcher>(1);
+}
+
+const char* Task::DebugInfo()
+{
+    debugInfoCache_ = "id:" + std::to_string(id_);
+    if (!debugInfo_.empty()) {
+        debugInfoCache_ += ", info:" + debugInfo_;
+    }
+    return debugInfoCache_.c_str();
+}
+
+} // cxk
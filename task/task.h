@@ -5,12 +5,142 @@
 #ifndef GOCOROUTINE_TASK_H
 #define GOCOROUTINE_TASK_H
 
+#include <utils/utils.h>
+#include <common/thread_safe_queue.h>
+#include <common/smart_ptr.h>
+#include <common/anys.h>
+#include <context/context.h>
+#include <debug/debugger.h>
+#include <task/task_switcher.h>
+#include <functional>
+#include <exception>
+#include <string>
+
 namespace cxk
 {
 
-class Task
+class Processor;
+struct ProfileEntry;
+
+/// @brief 协程状态
+enum class TaskState
+{
+    runnable,   ///< 可运行（在运行队列中，或正在运行）
+    block,      ///< 阻塞（已挂起，等待Processor::Wakeup）
+    done,       ///< 执行完毕
+};
+
+const char* GetTaskStateName(TaskState state);
+
+/*
+ * @brief 调度优先级：每个Processor为每个优先级各有一个运行队列，调度时先取高优先级的
+ * 为避免饿死，每隔固定轮数先从normal或background队列取一次（见Processor::PopRunnable）
+ */
+enum class TaskPriority : uint8_t
 {
+    high,           ///< 延迟敏感的协程（如请求处理的关键路径），排在批量任务之前运行
+    normal,
+    background,     ///< 批量或后台任务，只在没有更高优先级协程时运行
+};
+
+static constexpr std::size_t kTaskPriorityCount = 3;
+
+const char* GetTaskPriorityName(TaskPriority priority);
+
+typedef std::function<void()> TaskF;
+
+/*
+ * @brief 创建协程时的属性
+ *
+ * 共享栈（sharedStack_）适合大量长期空闲的协程（如挂在read上的连接）：不分配私有栈，
+ * 运行在所属Processor的共享栈上，切出期间只保存实际用到的那部分栈。代价是：
+ *  - 换入时如果共享栈被其他协程占用，需要两次与栈深度成正比的内存拷贝；
+ *  - 第一次运行后固定在该Processor上，不会被其他Processor窃取；
+ *  - 挂起期间栈上的对象会被覆盖，不能把栈上对象的地址交给其他协程或线程在挂起期间访问
+ *    （库内的同步原语和IO已经把等待者放在堆上，见ParkLocal）。
+ */
+struct TaskAttr
+{
+    std::size_t stackSize_ = 0;     ///< 私有栈大小，0表示StackPool::DefaultStackSize()；共享栈时忽略
+    bool sharedStack_ = false;      ///< 是否使用共享栈
+    const char* site_ = nullptr;    ///< 创建位置名称（静态字符串），栈使用量按它聚合；为空时使用CreateTask的调用地址
+    TaskPriority priority_ = TaskPriority::normal;  ///< 调度优先级
+    int processor_ = -1;            ///< 首选的Processor下标（见Scheduler::GetProcessor），-1或超出范围时由调度器选择；之后仍可能被窃取
+    const char* label_ = nullptr;   ///< 调试标签，相当于协程开始时调用SetCurrentTaskDebugInfo（协程分析按它聚合）
+};
+
+struct Task;
+
+/// @brief 协程本地变量的Anys分组（见co_local）
+struct TaskGroup {};
+typedef Anys<TaskGroup> TaskAnys;
+
+/*
+ * @brief 协程任务
+ * 同时作为TSQueue/SList的侵入式节点和引用计数对象：
+ *  - 创建时由Scheduler持有一个"生命周期"引用，任务执行完毕后由所在Processor释放；
+ *  - 进入TSQueue时队列额外持有一个引用，pop时释放；
+ *  - 挂起时SuspendEntry持有一个引用，保证唤醒者访问时对象仍然有效。
+ */
+struct Task : public TSQueueHook, public RefObject, public CoDebugger::DebuggerBase<Task>
+{
+    TaskState state_ = TaskState::runnable;
+    uint64_t id_ = 0;                   ///< 协程ID，从1开始
+    Processor* proc_ = nullptr;         ///< 最近一次运行它的Processor
+    Context ctx_;                       ///< 协程上下文（持有私有栈，或绑定一块共享栈）
+    TaskF fn_;                          ///< 协程函数
+    std::exception_ptr eptr_;           ///< 协程函数抛出的异常
+    atomic_t<uint64_t> suspendId_{0};   ///< 挂起序号，保证一次挂起只会被唤醒一次
+    uint64_t yieldCount_ = 0;           ///< 切出次数
+    TaskPriority priority_;             ///< 调度优先级，TaskAttr::priority_
+    uint64_t readyTick_ = 0;            ///< 抽样：变为可运行的时刻（FastSteadyClock::Ticks()），0表示本次不统计
+    std::string debugInfo_;             ///< 用户自定义调试信息
+    TaskSwitcher switcher_;             ///< 同步原语（rutex等）挂起/唤醒当前协程使用的切换器
+    TaskAnys cls_{TaskAnys::lazy_t()};  ///< 协程本地变量，第一次访问时才在运行它的工作线程上分配和构造（NUMA分组时位于该线程的节点）
+
+    // 栈使用量采样（见CoDebugger::SetStackProbeRate）
+    const void* site_ = nullptr;        ///< 创建位置：CreateTask的调用地址
+    const char* siteName_ = nullptr;    ///< 创建位置名称，TaskAttr::site_
+    bool probeStack_ = false;           ///< 是否采样本协程
+    std::size_t maxSwitchDepth_ = 0;    ///< 切出时观察到的最大栈深度
+
+    ProfileEntry* profEntry_ = nullptr; ///< 协程分析的统计项，开启分析后第一次切入时按标签查找（见Profiler）
+
+    Task(TaskF const& fn, TaskAttr const& attr);
+    ~Task() override;
+
+    ALWAYS_INLINE void SwapIn() {
+        ctx_.SwapIn();
+    }
+
+    ALWAYS_INLINE void SwapOut() {
+        ctx_.SwapOut();
+    }
+
+    /// @brief 开始采样栈使用量，第一次运行之前调用（私有栈用花纹填充）
+    void StartStackProbe();
+
+    /// @brief 切出后记录栈深度（在调度栈上调用）
+    ALWAYS_INLINE void SampleStackDepth() {
+        std::size_t depth = ctx_.SwitchDepth();
+        if (depth > maxSwitchDepth_) maxSwitchDepth_ = depth;
+    }
+
+    /// @brief 协程结束后把栈使用量汇报给CoDebugger
+    void ReportStackUsage();
+
+    /// @brief 返回调试信息：协程ID + 用户自定义信息
+    const char* DebugInfo();
+
+    Task(Task const&) = delete;
+    Task& operator=(Task const&) = delete;
+
+private:
+    void Run();
+
+    static void FCONTEXT_CALL StaticRun(intptr_t vp);
 
+    std::string debugInfoCache_;
 };
 
 } // cxk
@@ -0,0 +1,46 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_TASK_SWITCHER_H
+#define GOCOROUTINE_TASK_SWITCHER_H
+
+#pragma once
+#include <concurrence/switcher.h>
+#include <cstdint>
+
+namespace cxk
+{
+
+struct Task;
+
+/*
+ * @brief 协程切换器，RoutineSyncPolicy在协程中返回当前Task持有的实例
+ * mark -> Processor::Suspend, sleep -> 切出协程, wake -> Processor::Wakeup
+ * 单独成头文件，同步原语可以不依赖Task的完整定义而在编译期绑定它（StaticRoutineSyncPolicy）。
+ */
+class TaskSwitcher final : public RoutineSwitcherI
+{
+public:
+    /// @param parkOffStack 协程使用共享栈，挂起期间栈内容会被覆盖
+    explicit TaskSwitcher(Task* tk, bool parkOffStack = false)
+        : RoutineSwitcherI(false, parkOffStack), tk_(tk) {}
+
+    void mark() override;
+    void sleep() override;
+    bool wake() override;
+
+    static bool isInRoutine();
+    static RoutineSwitcherI & clsRef();
+
+    /// @brief 当前协程的切换器，不在协程中返回nullptr
+    static TaskSwitcher* current();
+
+private:
+    Task* tk_;
+    uint64_t suspendId_ = 0;   ///< 最近一次mark得到的挂起序号
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_TASK_SWITCHER_H
@@ -53,4 +53,54 @@ TEST(Anys, Basic)
      ///     anys_group1.get<double>(idx1); ///越界访问
      /// }, std::logic_error);
 
-}
\ No newline at end of file
+}
+struct LazyGroup {};
+
+struct alignas(64) Aligned64
+{
+    char c[3];
+};
+
+static int g_lazyCtor = 0;
+static int g_lazyDtor = 0;
+
+struct LazyCounted
+{
+    int v = 7;
+    LazyCounted() { ++g_lazyCtor; }
+    ~LazyCounted() { ++g_lazyDtor; }
+};
+
+/// 延迟构造：创建时不构造，touch时才构造，只析构构造过的对象；偏移满足各类型的对齐要求
+TEST(Anys, LazyTouch)
+{
+    auto ic = Anys<LazyGroup>::Register<char>();
+    auto ia = Anys<LazyGroup>::Register<Aligned64>();
+    auto il = Anys<LazyGroup>::Register<LazyCounted>();
+    {
+        Anys<LazyGroup> anys{Anys<LazyGroup>::lazy_t()};
+        EXPECT_EQ(g_lazyCtor, 0);
+
+        anys.touch<char>(ic) = 'x';
+        EXPECT_EQ(g_lazyCtor, 0);
+        EXPECT_EQ((uintptr_t)&anys.touch<Aligned64>(ia) % 64, 0u);
+
+        EXPECT_EQ(anys.touch<LazyCounted>(il).v, 7);
+        anys.touch<LazyCounted>(il).v = 8;
+        EXPECT_EQ(anys.touch<LazyCounted>(il).v, 8);
+        EXPECT_EQ(g_lazyCtor, 1);
+        EXPECT_EQ(anys.touch<char>(ic), 'x');
+
+        EXPECT_THROW(anys.touch<char>(il + 1), std::logic_error);
+    }
+    EXPECT_EQ(g_lazyDtor, 1);
+
+    {
+        Anys<LazyGroup> untouched{Anys<LazyGroup>::lazy_t()};
+    }
+    EXPECT_EQ(g_lazyCtor, 1);
+    EXPECT_EQ(g_lazyDtor, 1);
+
+    // 已有实例分配过内存后不允许再注册
+    EXPECT_THROW(Anys<LazyGroup>::Register<int>(), std::logic_error);
+}
@@ -0,0 +1,138 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include <debug/async_log.h>
+#include <scheduler/scheduler.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+/// 收集输出的日志行
+class AsyncLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        AsyncLog::getInstance().Flush();
+        AsyncLog::getInstance().SetSink([this](LogLevel, const char* line, std::size_t len) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            lines_.emplace_back(line, len);
+        });
+    }
+
+    void TearDown() override {
+        AsyncLog::getInstance().SetSink(nullptr);
+        AsyncLog::Level().store(LogLevel::info, std::memory_order_relaxed);
+    }
+
+    std::vector<std::string> Lines() {
+        AsyncLog::getInstance().Flush();
+        std::lock_guard<std::mutex> lock(mtx_);
+        return lines_;
+    }
+
+    std::mutex mtx_;
+    std::vector<std::string> lines_;
+};
+
+/// 格式化在输出时进行：按记录的参数类型输出，类型不符或参数不足时不会越界
+TEST_F(AsyncLogTest, Format) {
+    std::string name = "stack";
+    void* ptr = (void*)0x1000;
+    CO_ASYNC_LOG(LogLevel::info, "%s at %p: %d pages, %5.2f%% used, 0x%x", name, ptr, 3, 12.5, 255u);
+    CO_ASYNC_LOG(LogLevel::warn, "mismatch %s %d missing %d", 42, "text");
+    CO_ASYNC_LOG(LogLevel::error, "long %s", std::string(200, 'a'));
+
+    std::vector<std::string> lines = Lines();
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_NE(lines[0].find("[info]"), std::string::npos);
+    EXPECT_NE(lines[0].find("[co:0]"), std::string::npos);
+    EXPECT_NE(lines[0].find("test_async_log.cpp:"), std::string::npos);
+    EXPECT_NE(lines[0].find("stack at 0x1000: 3 pages, 12.50% used, 0xff"), std::string::npos);
+    EXPECT_NE(lines[1].find("[warn]"), std::string::npos);
+    EXPECT_NE(lines[1].find("mismatch 42 text missing %d"), std::string::npos);
+    EXPECT_NE(lines[2].find("long " + std::string(LogRecord::kTextBytes - 1, 'a')), std::string::npos);
+    EXPECT_EQ(lines[2].find(std::string(LogRecord::kTextBytes, 'a')), std::string::npos);
+}
+
+/// 低于Level()的日志在调用处跳过，参数不求值
+TEST_F(AsyncLogTest, LevelFilter) {
+    int evaluated = 0;
+    auto arg = [&]{ return ++evaluated; };
+    AsyncLog::Level().store(LogLevel::warn, std::memory_order_relaxed);
+    CO_ASYNC_LOG(LogLevel::info, "skipped %d", arg());
+    CO_ASYNC_LOG(LogLevel::warn, "kept %d", arg());
+
+    std::vector<std::string> lines = Lines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("kept 1"), std::string::npos);
+    EXPECT_EQ(evaluated, 1);
+}
+
+/// 协程中写入的日志带协程ID
+TEST_F(AsyncLogTest, CoroutineId) {
+    std::atomic<uint64_t> id{0};
+    Scheduler::getInstance().CreateTask([&]{
+        CO_ASYNC_LOG(LogLevel::info, "in coroutine");
+        id = Processor::GetCurrentTask()->id_;
+    });
+    auto deadline = steady_clock::now() + milliseconds(5000);
+    while (Scheduler::getInstance().TaskCount() != 0 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    ASSERT_NE(id, 0u);
+
+    std::vector<std::string> lines = Lines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("[co:" + std::to_string(id) + "]"), std::string::npos);
+}
+
+/// 队列满时丢弃并计数；写入的记录要么输出、要么计入dropped；线程退出后队列被释放
+TEST_F(AsyncLogTest, DropOnFull) {
+    const int kRecords = 1000;
+    AsyncLog::Stats before = AsyncLog::getInstance().GetStats();
+    std::size_t capacity = AsyncLog::QueueCapacity();
+    AsyncLog::QueueCapacity() = 8;
+    std::thread t([&]{
+        for (int i = 0; i < kRecords; ++i)
+            CO_ASYNC_LOG(LogLevel::info, "record %d", i);
+    });
+    t.join();
+    AsyncLog::QueueCapacity() = capacity;
+
+    std::vector<std::string> lines = Lines();
+    AsyncLog::Stats after = AsyncLog::getInstance().GetStats();
+    EXPECT_GT(after.dropped - before.dropped, 0u);
+    EXPECT_EQ(lines.size() + (after.dropped - before.dropped), (std::size_t)kRecords);
+    EXPECT_EQ(after.written - before.written, lines.size());
+    EXPECT_EQ(after.producers, before.producers);
+}
+
+/// 线程退出之后（其他thread_local对象的析构中）写入的日志同步输出，不再注册新的队列
+TEST_F(AsyncLogTest, LogAfterThreadExit) {
+    struct LateLogger
+    {
+        ~LateLogger() {
+            CO_ASYNC_LOG(LogLevel::info, "late %d", 2);
+        }
+    };
+    AsyncLog::Stats before = AsyncLog::getInstance().GetStats();
+    std::thread([]{
+        // 先于AsyncLog的thread_local构造，因此在它之后析构
+        static thread_local LateLogger late;
+        (void)late;
+        CO_ASYNC_LOG(LogLevel::info, "early %d", 1);
+    }).join();
+
+    std::vector<std::string> lines = Lines();
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("early 1"), std::string::npos);
+    EXPECT_NE(lines[1].find("late 2"), std::string::npos);
+    AsyncLog::Stats after = AsyncLog::getInstance().GetStats();
+    EXPECT_EQ(after.producers, before.producers);
+    EXPECT_EQ(after.written - before.written, 2u);
+}
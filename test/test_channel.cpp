@@ -0,0 +1,293 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <concurrence/channel.h>
+#include <scheduler/scheduler.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+class ChannelTest : public SchedulerSuite<2> {};
+
+/// 缓冲通道：先进先出，满时TryPush失败，空时TryPop失败
+TEST_F(ChannelTest, BufferedTry) {
+    Channel<int> ch(3);
+    EXPECT_EQ(ch.Capacity(), 3u);
+    EXPECT_TRUE(ch.Empty());
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(ch.TryPush(i));
+    EXPECT_FALSE(ch.TryPush(3));
+    EXPECT_EQ(ch.Size(), 3u);
+
+    int v = -1;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(ch.TryPop(v));
+        EXPECT_EQ(v, i);
+    }
+    EXPECT_FALSE(ch.TryPop(v));
+
+    // 环形缓冲区回绕
+    for (int round = 0; round < 10; ++round) {
+        ch << round;
+        ch >> v;
+        EXPECT_EQ(v, round);
+    }
+}
+
+/// 无缓冲通道：没有对端时Try操作失败，发送者与接收者直接交接
+TEST_F(ChannelTest, UnbufferedRendezvous) {
+    Channel<std::string> ch;
+    EXPECT_FALSE(ch.TryPush(std::string("x")));
+    std::string s;
+    EXPECT_FALSE(ch.TryPop(s));
+
+    std::atomic<bool> pushed{false};
+    Scheduler::getInstance().CreateTask([&]{
+        ch.Push(std::string("hello"));
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(milliseconds(20));
+    EXPECT_FALSE(pushed);   // 没有接收者，发送者一直阻塞
+    EXPECT_TRUE(ch.Pop(s));
+    EXPECT_EQ(s, "hello");
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_TRUE(pushed);
+}
+
+/// 超时
+TEST_F(ChannelTest, Timed) {
+    Channel<int> ch(1);
+    int v = 0;
+    auto start = steady_clock::now();
+    EXPECT_FALSE(ch.TimedPop(v, milliseconds(20)));
+    EXPECT_GE(steady_clock::now() - start, milliseconds(20));
+
+    EXPECT_TRUE(ch.TimedPush(1, milliseconds(20)));
+    EXPECT_FALSE(ch.TimedPush(2, milliseconds(20)));
+    EXPECT_TRUE(ch.TimedPop(v, milliseconds(20)));
+    EXPECT_EQ(v, 1);
+
+    std::atomic<int> result{-1};
+    Scheduler::getInstance().CreateTask([&]{
+        int x = 0;
+        result = ch.TimedPop(x, milliseconds(10)) ? 1 : 0;
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(result, 0);
+}
+
+/// 关闭：唤醒所有阻塞者，push失败，pop取完剩余元素后失败
+TEST_F(ChannelTest, Close) {
+    Channel<int> ch;
+    const int kWaiters = 10;
+    std::atomic<int> failed{0};
+    for (int i = 0; i < kWaiters; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            int v;
+            if (!ch.Pop(v)) ++failed;
+        });
+    }
+    std::this_thread::sleep_for(milliseconds(20));
+    ch.Close();
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(failed, kWaiters);
+    EXPECT_TRUE(ch.IsClosed());
+    EXPECT_FALSE(ch.Push(1));
+
+    Channel<int> buffered(2);
+    buffered << 1 << 2;
+    buffered.Close();
+    int v = 0;
+    EXPECT_FALSE(buffered.TryPush(3));
+    EXPECT_TRUE(buffered.Pop(v));
+    EXPECT_EQ(v, 1);
+    EXPECT_TRUE(buffered.Pop(v));
+    EXPECT_EQ(v, 2);
+    EXPECT_FALSE(buffered.Pop(v));
+}
+
+/// 多生产者多消费者：每个元素恰好被接收一次
+TEST_F(ChannelTest, MPMC) {
+    for (std::size_t capacity : {0, 1, 64}) {
+        Channel<int> ch(capacity);
+        const int kProducers = 4, kConsumers = 4, kCount = 2000;
+        std::atomic<long> sum{0};
+        std::atomic<int> received{0};
+        for (int p = 0; p < kProducers; ++p) {
+            Scheduler::getInstance().CreateTask([=]{
+                for (int i = 1; i <= kCount; ++i)
+                    ch << i;
+            });
+        }
+        for (int c = 0; c < kConsumers; ++c) {
+            Scheduler::getInstance().CreateTask([&, ch]{
+                int v;
+                while (ch.Pop(v)) {
+                    sum += v;
+                    if (++received == kProducers * kCount)
+                        ch.Close();
+                }
+            });
+        }
+        ASSERT_TRUE(WaitAllDone(milliseconds(20000))) << "capacity=" << capacity;
+        EXPECT_EQ(received, kProducers * kCount);
+        EXPECT_EQ(sum, (long)kProducers * kCount * (kCount + 1) / 2);
+    }
+}
+
+/// 线程与协程混合收发
+TEST_F(ChannelTest, ThreadAndCoroutine) {
+    Channel<int, std::deque<int>> ch(4);
+    Scheduler::getInstance().CreateTask([=]{
+        for (int i = 0; i < 1000; ++i)
+            ch << i;
+        ch.Close();
+    });
+    int v, expect = 0;
+    while (ch.Pop(v))
+        EXPECT_EQ(v, expect++);
+    EXPECT_EQ(expect, 1000);
+    ASSERT_TRUE(WaitAllDone());
+}
+
+/// select：就绪分支立即完成，非阻塞select没有就绪分支时返回-1
+TEST_F(ChannelTest, SelectReady) {
+    Channel<int> a(1), b(1);
+    int va = 0, vb = 0;
+    EXPECT_EQ(TrySelect({a.CasePop(va), b.CasePop(vb)}), -1);
+
+    b << 7;
+    bool ok = false;
+    EXPECT_EQ(Select({a.CasePop(va), b.CasePop(vb)}, &ok), 1);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(vb, 7);
+
+    int x = 3;
+    EXPECT_EQ(Select({a.CasePush(x), b.CasePop(vb)}), 0);
+    EXPECT_EQ(x, 3);
+    EXPECT_TRUE(a.TryPop(va));
+    EXPECT_EQ(va, 3);
+
+    auto start = steady_clock::now();
+    EXPECT_EQ(Select({a.CasePop(va), b.CasePop(vb)}, milliseconds(20)), -1);
+    EXPECT_GE(steady_clock::now() - start, milliseconds(20));
+
+    a.Close();
+    EXPECT_EQ(Select({a.CasePop(va), b.CasePop(vb)}, &ok), 0);
+    EXPECT_FALSE(ok);
+}
+
+/// select阻塞在多个通道上，每次只完成一个分支
+TEST_F(ChannelTest, SelectBlocking) {
+    Channel<int> a, b, quit;
+    const int kCount = 1000;
+    std::atomic<int> gotA{0}, gotB{0};
+    Scheduler::getInstance().CreateTask([&]{
+        int va, vb, q;
+        for (;;) {
+            int idx = Select({a.CasePop(va), b.CasePop(vb), quit.CasePop(q)});
+            if (idx == 0) ++gotA;
+            else if (idx == 1) ++gotB;
+            else break;
+        }
+    });
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kCount; ++i) a << i;
+    });
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kCount; ++i) b << i;
+    });
+
+    auto deadline = steady_clock::now() + seconds(10);
+    while (gotA + gotB < 2 * kCount && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    quit << 0;
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(gotA, kCount);
+    EXPECT_EQ(gotB, kCount);
+}
+
+/// 分支数超过kInlineCases时select的簿记改为堆上分配，行为不变
+TEST_F(ChannelTest, SelectManyCases) {
+    const int kCases = ChannelImplBase::kInlineCases + 4;
+    std::vector<Channel<int>> chans(kCases);
+    std::vector<int> values(kCases, -1);
+    std::atomic<int> got{-1};
+    Scheduler::getInstance().CreateTask([&]{
+        std::vector<ChannelSelectCase> cases;
+        for (int i = 0; i < kCases; ++i)
+            cases.push_back(chans[i].CasePop(values[i]));
+        got = ChannelImplBase::select(cases.data(), kCases, nullptr, true, nullptr);
+    });
+    std::this_thread::sleep_for(milliseconds(10));
+    chans[kCases - 1] << 42;
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(got, kCases - 1);
+    EXPECT_EQ(values[kCases - 1], 42);
+}
+
+/// 无缓冲通道的请求/响应：被唤醒的对端放入runnext，阻塞时直接切换过去
+TEST_F(ChannelTest, HandoffPingPong) {
+    auto handoffs = []{
+        uint64_t n = 0;
+        for (std::size_t i = 0; i < Scheduler::getInstance().ProcessorCount(); ++i)
+            n += Scheduler::getInstance().GetProcessor(i)->HandoffCount();
+        return n;
+    };
+    uint64_t before = handoffs();
+
+    const int kPairs = 20, kRounds = 1000;
+    std::atomic<int> bad{0};
+    for (int p = 0; p < kPairs; ++p) {
+        Scheduler::getInstance().CreateTask([&]{
+            Channel<int> req, resp;
+            Scheduler::getInstance().CreateTask([=]{
+                int x = 0;
+                while (req.Pop(x))
+                    resp << x + 1;
+            });
+            for (int i = 0; i < kRounds; ++i) {
+                int v = 0;
+                req << i;
+                resp >> v;
+                if (v != i + 1) ++bad;
+            }
+            req.Close();
+        });
+    }
+    ASSERT_TRUE(WaitAllDone(milliseconds(20000)));
+    EXPECT_EQ(bad, 0);
+    EXPECT_GT(handoffs(), before);
+}
+
+/// 相互唤醒的一对协程不会饿死同一个Processor上的其他协程
+TEST_F(ChannelTest, HandoffDoesNotStarve) {
+    std::atomic<bool> stop{false};
+    std::atomic<int> rounds{0};
+    Scheduler::getInstance().CreateTask([&]{
+        Channel<int> a, b;
+        Scheduler::getInstance().CreateTask([=, &stop]{
+            int x = 0;
+            while (a.Pop(x))
+                b << x;
+        });
+        Scheduler::getInstance().CreateTask([&]{ stop = true; });
+        int v = 0;
+        while (!stop) {
+            a << 1;
+            b >> v;
+            ++rounds;
+        }
+        a.Close();
+    });
+    ASSERT_TRUE(WaitAllDone(milliseconds(10000)));
+    EXPECT_TRUE(stop);
+}
@@ -3,9 +3,23 @@
 ///
 #include <common/clock.h>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <algorithm>
 #include <thread>
 #include <vector>
 
+/// 第一次读取时自动启动校准线程，不需要手动调用ThreadRun
+TEST(FastSteadyClock, LazyCalibration) {
+    using namespace cxk;
+    using namespace std::chrono;
+
+    FastSteadyClock::now();
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (FastSteadyClock::TicksPerNanosecond() <= 0 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(5));
+    EXPECT_GT(FastSteadyClock::TicksPerNanosecond(), 0);
+}
+
 
 TEST(FastSteadyClock, CalibrationMechanism) {
     using namespace cxk;
@@ -41,4 +55,74 @@ TEST(FastSteadyClock, CrossPlatformConsistency) {
     auto tp = FastSteadyClock::now();
     auto rep = tp.time_since_epoch().count();
     static_cast<void>(rep); /// 避免未使用变量警告
-}
\ No newline at end of file
+}
+
+/// 多个线程跨越多次检查点更新连续读取，时间不回退，并且与标准时钟的偏差很小
+TEST(FastSteadyClock, MonotonicAcrossCheckpoints) {
+    using namespace cxk;
+    using namespace std::chrono;
+
+    FastSteadyClock::StartCalibration();
+    std::this_thread::sleep_for(milliseconds(50));
+
+    std::atomic<int> backwards{0};
+    std::atomic<long> maxSkewNs{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]{
+            auto deadline = steady_clock::now() + milliseconds(200);
+            auto last = FastSteadyClock::now();
+            while (steady_clock::now() < deadline) {
+                auto s1 = steady_clock::now();
+                auto cur = FastSteadyClock::now();
+                auto s2 = steady_clock::now();
+                if (cur < last) ++backwards;
+                last = cur;
+                if (s2 - s1 > microseconds(20)) continue;   /// 期间被抢占，偏差没有意义
+                long skew = (long)std::max(duration_cast<nanoseconds>(s1 - cur).count(),
+                                           duration_cast<nanoseconds>(cur - s2).count());
+                long prev = maxSkewNs.load();
+                while (skew > prev && !maxSkewNs.compare_exchange_weak(prev, skew)) {}
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(backwards, 0);
+    EXPECT_LT(maxSkewNs, 200000);   /// 200us
+}
+
+/// coarse_now返回当前线程最近一次UpdateCoarse的时间，没有缓存时等同于now
+TEST(FastSteadyClock, CoarseNow) {
+    using namespace cxk;
+    using namespace std::chrono;
+
+    std::thread([]{
+        auto before = FastSteadyClock::now();
+        EXPECT_GE(FastSteadyClock::coarse_now(), before);
+
+        auto cached = FastSteadyClock::UpdateCoarse();
+        std::this_thread::sleep_for(milliseconds(5));
+        EXPECT_EQ(FastSteadyClock::coarse_now(), cached);
+        EXPECT_GT(FastSteadyClock::UpdateCoarse(), cached);
+    }).join();
+}
+
+/// Ticks按TicksPerNanosecond换算后与标准时钟的间隔一致
+TEST(FastSteadyClock, TicksRate) {
+    using namespace cxk;
+    using namespace std::chrono;
+
+    FastSteadyClock::StartCalibration();
+    std::this_thread::sleep_for(milliseconds(50));
+    double perNs = FastSteadyClock::TicksPerNanosecond();
+    ASSERT_GT(perNs, 0);
+
+    uint64_t t0 = FastSteadyClock::Ticks();
+    auto s0 = steady_clock::now();
+    std::this_thread::sleep_for(milliseconds(50));
+    uint64_t t1 = FastSteadyClock::Ticks();
+    auto s1 = steady_clock::now();
+    double ns = (double)(t1 - t0) / perNs;
+    double expected = (double)duration_cast<nanoseconds>(s1 - s0).count();
+    EXPECT_NEAR(ns, expected, expected * 0.01);
+}
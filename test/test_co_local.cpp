@@ -0,0 +1,80 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <concurrence/co_local.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace cxk;
+using namespace std::chrono;
+
+static std::atomic<int> g_ctor{0};
+static std::atomic<int> g_dtor{0};
+
+struct RequestContext
+{
+    std::string traceId_;
+    int depth_ = 0;
+    RequestContext() { ++g_ctor; }
+    ~RequestContext() { ++g_dtor; }
+};
+
+static co_local<RequestContext> g_ctx;
+static co_local<int> g_counter;
+
+class CoLocalTest : public SchedulerSuite<2> {};
+
+/// 每个协程看到自己的对象，跨切换（包括被窃取到其他线程）保持不变
+TEST_F(CoLocalTest, PerCoroutine) {
+    const int kTasks = 100;
+    std::atomic<int> ok{0};
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&, i]{
+            g_ctx->traceId_ = "req-" + std::to_string(i);
+            g_counter = i;
+            for (int j = 0; j < 10; ++j) {
+                Processor::StaticCoYield();
+                ++g_ctx->depth_;
+            }
+            if (g_ctx->traceId_ == "req-" + std::to_string(i) && *g_counter == i && g_ctx->depth_ == 10)
+                ++ok;
+        });
+    }
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(ok, kTasks);
+}
+
+/// 不访问的协程不构造；访问过的在协程结束时析构
+TEST_F(CoLocalTest, LazyConstruct) {
+    int ctor = g_ctor, dtor = g_dtor;
+    for (int i = 0; i < 50; ++i)
+        Scheduler::getInstance().CreateTask([]{ *g_counter += 1; });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(g_ctor, ctor);
+
+    std::atomic<bool> constructed{false};
+    Scheduler::getInstance().CreateTask([&]{
+        g_ctx->depth_ = 1;
+        constructed = g_ctor == ctor + 1;
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_TRUE(constructed);
+    EXPECT_EQ(g_dtor, dtor + 1);
+}
+
+/// 协程外访问的是当前线程的对象，与协程互不影响
+TEST_F(CoLocalTest, ThreadFallback) {
+    g_counter = 42;
+    std::atomic<int> seen{-1};
+    Scheduler::getInstance().CreateTask([&]{ seen = *g_counter; });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(seen, 0);
+    EXPECT_EQ(*g_counter, 42);
+
+    std::thread([]{ EXPECT_EQ(*g_counter, 0); }).join();
+}
@@ -0,0 +1,237 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <concurrence/co_mutex.h>
+#include <concurrence/co_condition_variable.h>
+#include <concurrence/co_shared_mutex.h>
+#include <concurrence/co_wait_group.h>
+#include <scheduler/scheduler.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+class CoSyncTest : public SchedulerSuite<2> {};
+
+/// 协程与线程混合竞争；持锁期间切出协程不会阻塞工作线程
+TEST_F(CoSyncTest, MutexMixed) {
+    co_mutex mtx;
+    int64_t counter = 0;
+    const int kRoutines = 100;
+    const int kThreads = 2;
+    const int kLoops = 200;
+    std::atomic<int> others{0};
+
+    for (int i = 0; i < kRoutines; ++i) {
+        Scheduler::getInstance().CreateTask([&, i]{
+            for (int j = 0; j < kLoops; ++j) {
+                std::lock_guard<co_mutex> lock(mtx);
+                ++counter;
+                if (j % 50 == 0 && i % 10 == 0)
+                    co_sleep(milliseconds(1));
+            }
+        });
+    }
+    for (int i = 0; i < 50; ++i)
+        Scheduler::getInstance().CreateTask([&]{ ++others; });
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&]{
+            for (int j = 0; j < kLoops; ++j) {
+                std::lock_guard<co_mutex> lock(mtx);
+                ++counter;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(counter, (int64_t)(kRoutines + kThreads) * kLoops);
+    EXPECT_EQ(others, 50);
+    EXPECT_FALSE(mtx.is_lock());
+}
+
+TEST_F(CoSyncTest, MutexTryAndTimeout) {
+    co_mutex mtx;
+    EXPECT_TRUE(mtx.try_lock());
+    EXPECT_FALSE(mtx.try_lock());
+
+    std::atomic<int> result{-1};
+    std::atomic<int64_t> elapsedMs{0};
+    Scheduler::getInstance().CreateTask([&]{
+        auto start = steady_clock::now();
+        result = mtx.try_lock_for(milliseconds(30)) ? 1 : 0;
+        elapsedMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    });
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(result, 0);
+    EXPECT_GE(elapsedMs, 25);
+
+    // 超时等待期间解锁可以拿到锁
+    Scheduler::getInstance().CreateTask([&]{
+        result = mtx.try_lock_for(seconds(5)) ? 1 : 0;
+        if (result) mtx.unlock();
+    });
+    std::this_thread::sleep_for(milliseconds(20));
+    mtx.unlock();
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(result, 1);
+
+    EXPECT_THROW(mtx.unlock(), std::system_error);
+}
+
+/// 生产者（线程）/消费者（协程）
+TEST_F(CoSyncTest, ConditionVariable) {
+    co_mutex mtx;
+    co_condition_variable cv;
+    std::deque<int> queue;
+    bool closed = false;
+    const int kItems = 2000;
+    const int kConsumers = 8;
+    std::atomic<int64_t> sum{0};
+
+    for (int c = 0; c < kConsumers; ++c) {
+        Scheduler::getInstance().CreateTask([&]{
+            std::unique_lock<co_mutex> lock(mtx);
+            for (;;) {
+                cv.wait(lock, [&]{ return !queue.empty() || closed; });
+                if (queue.empty()) return;
+                sum += queue.front();
+                queue.pop_front();
+            }
+        });
+    }
+
+    for (int i = 1; i <= kItems; ++i) {
+        {
+            std::lock_guard<co_mutex> lock(mtx);
+            queue.push_back(i);
+        }
+        cv.notify_one();
+    }
+    {
+        std::lock_guard<co_mutex> lock(mtx);
+        closed = true;
+    }
+    cv.notify_all();
+
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(sum, (int64_t)kItems * (kItems + 1) / 2);
+
+    // 超时
+    std::unique_lock<co_mutex> lock(mtx);
+    EXPECT_EQ(cv.wait_for(lock, milliseconds(10)), std::cv_status::timeout);
+    EXPECT_FALSE(cv.wait_for(lock, milliseconds(10), []{ return false; }));
+    EXPECT_TRUE(lock.owns_lock());
+
+    // 配合std::mutex使用
+    std::mutex smtx;
+    std::unique_lock<std::mutex> slock(smtx);
+    EXPECT_EQ(cv.wait_for(slock, milliseconds(5)), std::cv_status::timeout);
+}
+
+/// 读者可以并发，写者独占
+TEST_F(CoSyncTest, SharedMutex) {
+    co_shared_mutex smtx;
+    std::atomic<int> readers{0}, maxReaders{0};
+    std::atomic<bool> writing{false};
+    std::atomic<int> violations{0};
+    int64_t value = 0;
+    const int kReaders = 40;
+    const int kWriters = 10;
+    const int kLoops = 100;
+
+    for (int i = 0; i < kReaders; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            for (int j = 0; j < kLoops; ++j) {
+                std::shared_lock<co_shared_mutex> lock(smtx);
+                int r = ++readers;
+                int m = maxReaders.load();
+                while (r > m && !maxReaders.compare_exchange_weak(m, r)) ;
+                if (writing) ++violations;
+                if (j % 20 == 0) Processor::StaticCoYield();
+                --readers;
+            }
+        });
+    }
+    for (int i = 0; i < kWriters; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            for (int j = 0; j < kLoops; ++j) {
+                std::unique_lock<co_shared_mutex> lock(smtx);
+                if (writing.exchange(true) || readers != 0) ++violations;
+                ++value;
+                if (j % 20 == 0) Processor::StaticCoYield();
+                writing = false;
+            }
+        });
+    }
+    std::thread writer([&]{
+        for (int j = 0; j < kLoops; ++j) {
+            std::unique_lock<co_shared_mutex> lock(smtx);
+            if (writing.exchange(true) || readers != 0) ++violations;
+            ++value;
+            writing = false;
+        }
+    });
+    writer.join();
+
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(violations, 0);
+    EXPECT_EQ(value, (int64_t)(kWriters + 1) * kLoops);
+    EXPECT_GE(maxReaders, 1);
+
+    EXPECT_TRUE(smtx.try_lock_shared());
+    EXPECT_TRUE(smtx.try_lock_shared());
+    EXPECT_FALSE(smtx.try_lock());
+    smtx.unlock_shared();
+    smtx.unlock_shared();
+    EXPECT_TRUE(smtx.try_lock());
+    EXPECT_FALSE(smtx.try_lock_shared());
+    smtx.unlock();
+}
+
+TEST_F(CoSyncTest, WaitGroup) {
+    const int kTasks = 200;
+    co_wait_group wg;
+    std::atomic<int> done{0};
+    wg.Add(kTasks);
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&, i]{
+            if (i % 20 == 0) co_sleep(milliseconds(2));
+            ++done;
+            wg.Done();
+        });
+    }
+    wg.Wait();  // 线程中等待
+    EXPECT_EQ(done, kTasks);
+    EXPECT_EQ(wg.Count(), 0);
+
+    // 协程中等待
+    co_wait_group inner(3);
+    std::atomic<bool> waited{false};
+    Scheduler::getInstance().CreateTask([&]{
+        inner.Wait();
+        waited = true;
+    });
+    for (int i = 0; i < 3; ++i) {
+        std::this_thread::sleep_for(milliseconds(2));
+        EXPECT_FALSE(waited);
+        Scheduler::getInstance().CreateTask([&]{ inner.Done(); });
+    }
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_TRUE(waited);
+
+    co_wait_group pending(1);
+    EXPECT_FALSE(pending.WaitFor(milliseconds(10)));
+    pending.Done();
+    EXPECT_TRUE(pending.WaitFor(milliseconds(10)));
+    EXPECT_THROW(pending.Done(), std::system_error);
+}
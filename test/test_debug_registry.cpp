@@ -0,0 +1,135 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include <debug/debug_registry.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+
+struct Tracked
+{
+    typedef DebugRegistry<Tracked> Registry;
+
+    explicit Tracked(int id) : id_(id) { Registry::Register(&node_, this); }
+    ~Tracked() { Registry::Unregister(&node_); }
+
+    int id_;
+    Registry::Node node_;
+};
+
+/// 登记、遍历、注销（包括重复注销）
+TEST(DebugRegistryTest, RegisterUnregister) {
+    std::vector<std::unique_ptr<Tracked>> objs;
+    for (int i = 0; i < 10; ++i)
+        objs.emplace_back(new Tracked(i));
+    EXPECT_EQ(Tracked::Registry::Size(), 10u);
+
+    std::set<int> seen;
+    std::size_t n = Tracked::Registry::ForEach([&](Tracked* t){ seen.insert(t->id_); });
+    EXPECT_EQ(n, 10u);
+    EXPECT_EQ(seen.size(), 10u);
+
+    // 提前注销后析构时不再重复摘除
+    Tracked::Registry::Unregister(&objs[3]->node_);
+    Tracked::Registry::Unregister(&objs[3]->node_);
+    EXPECT_EQ(Tracked::Registry::Size(), 9u);
+    seen.clear();
+    Tracked::Registry::ForEach([&](Tracked* t){ seen.insert(t->id_); });
+    EXPECT_EQ(seen.count(3), 0u);
+
+    objs.clear();
+    EXPECT_EQ(Tracked::Registry::Size(), 0u);
+    EXPECT_EQ(Tracked::Registry::ForEach([](Tracked*){}), 0u);
+}
+
+/// 在其他线程创建的对象可以在当前线程析构
+TEST(DebugRegistryTest, CrossThreadDestroy) {
+    const int kThreads = 8;
+    const int kPerThread = 100;
+    std::vector<std::unique_ptr<Tracked>> objs(kThreads * kPerThread);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t]{
+            for (int i = 0; i < kPerThread; ++i)
+                objs[t * kPerThread + i].reset(new Tracked(t * kPerThread + i));
+        });
+    }
+    for (auto& th : threads) th.join();
+    EXPECT_EQ(Tracked::Registry::Size(), (std::size_t)kThreads * kPerThread);
+
+    objs.clear();
+    EXPECT_EQ(Tracked::Registry::Size(), 0u);
+}
+
+/// 遍历期间新登记的对象不在本次遍历的结果中
+TEST(DebugRegistryTest, SnapshotSkipsNewer) {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool create = false, created = false;
+    std::unique_ptr<Tracked> late;
+
+    // 工作线程先登记一次，固定它的分片（与当前线程不同）
+    std::thread worker([&]{
+        { Tracked warmup(-1); }
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&]{ return create; });
+        late.reset(new Tracked(100));
+        created = true;
+        cv.notify_all();
+    });
+
+    std::vector<std::unique_ptr<Tracked>> objs;
+    for (int i = 0; i < 5; ++i)
+        objs.emplace_back(new Tracked(i));
+
+    bool first = true;
+    std::set<int> seen;
+    std::size_t n = Tracked::Registry::ForEach([&](Tracked* t){
+        seen.insert(t->id_);
+        if (!first) return;
+        first = false;
+        std::unique_lock<std::mutex> lock(mtx);
+        create = true;
+        cv.notify_all();
+        cv.wait(lock, [&]{ return created; });
+    });
+    worker.join();
+
+    EXPECT_EQ(n, 5u);
+    EXPECT_EQ(seen.count(100), 0u);
+    EXPECT_EQ(Tracked::Registry::Size(), 6u);
+    EXPECT_EQ(Tracked::Registry::ForEach([](Tracked*){}), 6u);
+}
+
+/// 并发创建、析构与遍历
+TEST(DebugRegistryTest, ConcurrentChurn) {
+    const int kThreads = 4;
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t]{
+            std::vector<std::unique_ptr<Tracked>> objs;
+            for (int i = 0; !stop; ++i) {
+                objs.emplace_back(new Tracked(t));
+                if (objs.size() > 64) objs.erase(objs.begin(), objs.begin() + 32);
+            }
+        });
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        Tracked::Registry::ForEach([&](Tracked* t){
+            EXPECT_GE(t->id_, 0);
+            EXPECT_LT(t->id_, kThreads);
+        });
+    }
+    stop = true;
+    for (auto& th : threads) th.join();
+    EXPECT_EQ(Tracked::Registry::Size(), 0u);
+}
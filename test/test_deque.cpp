@@ -0,0 +1,105 @@
+///
+/// Created by cxk_zjq on 25-6-2.
+///
+#include <gtest/gtest.h>
+#include <common/deque.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+using namespace cxk;
+
+/// 单线程：所有者端LIFO，窃取端FIFO
+TEST(WorkStealingDeque, SingleThread) {
+    WorkStealingDeque<int> dq(4);
+    int v = 0;
+    EXPECT_FALSE(dq.Pop(v));
+    EXPECT_FALSE(dq.Steal(v));
+
+    for (int i = 0; i < 4; ++i) dq.Push(i);
+    EXPECT_EQ(dq.Size(), 4u);
+
+    EXPECT_TRUE(dq.Pop(v));
+    EXPECT_EQ(v, 3);
+    EXPECT_TRUE(dq.Steal(v));
+    EXPECT_EQ(v, 0);
+    EXPECT_TRUE(dq.Pop(v));
+    EXPECT_EQ(v, 2);
+    EXPECT_TRUE(dq.Pop(v));
+    EXPECT_EQ(v, 1);
+    EXPECT_FALSE(dq.Pop(v));
+    EXPECT_TRUE(dq.Empty());
+}
+
+/// 扩容：写满后容量翻倍，元素顺序不变
+TEST(WorkStealingDeque, Grow) {
+    WorkStealingDeque<int> dq(2);
+    const int kCount = 1000;
+    for (int i = 0; i < kCount; ++i) dq.Push(i);
+    EXPECT_GE(dq.Capacity(), (std::size_t)kCount);
+    EXPECT_EQ(dq.Size(), (std::size_t)kCount);
+
+    int v = 0;
+    for (int i = 0; i < kCount; ++i) {
+        EXPECT_TRUE(dq.Steal(v));
+        EXPECT_EQ(v, i);
+    }
+    EXPECT_TRUE(dq.Empty());
+}
+
+/// 批量窃取
+TEST(WorkStealingDeque, StealBatch) {
+    WorkStealingDeque<int> dq;
+    for (int i = 0; i < 10; ++i) dq.Push(i);
+    int out[8];
+    EXPECT_EQ(dq.StealBatch(out, 8), 8u);
+    for (int i = 0; i < 8; ++i) EXPECT_EQ(out[i], i);
+    EXPECT_EQ(dq.StealBatch(out, 8), 2u);
+    EXPECT_EQ(dq.StealBatch(out, 8), 0u);
+}
+
+/// 并发：所有者一边Push一边Pop，多个窃取者同时Steal，每个元素恰好被消费一次
+TEST(WorkStealingDeque, ConcurrentOwnerAndThieves) {
+    const int kCount = 200000;
+    const int kThieves = 4;
+    WorkStealingDeque<int> dq(16);
+    std::vector<std::atomic<int>> seen(kCount);
+    for (auto& s : seen) s = 0;
+    std::atomic<int> consumed{0};
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < kThieves; ++i) {
+        thieves.emplace_back([&]{
+            int v;
+            while (!done.load(std::memory_order_acquire)) {
+                if (dq.Steal(v)) {
+                    ++seen[v];
+                    ++consumed;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    int v;
+    for (int i = 0; i < kCount; ++i) {
+        dq.Push(i);
+        if (i % 3 == 0 && dq.Pop(v)) {
+            ++seen[v];
+            ++consumed;
+        }
+    }
+    while (dq.Pop(v)) {
+        ++seen[v];
+        ++consumed;
+    }
+    while (consumed.load() < kCount) std::this_thread::yield();
+    done = true;
+    for (auto& t : thieves) t.join();
+
+    EXPECT_EQ(consumed.load(), kCount);
+    for (int i = 0; i < kCount; ++i)
+        ASSERT_EQ(seen[i].load(), 1) << "item " << i;
+}
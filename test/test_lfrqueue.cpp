@@ -168,4 +168,146 @@ TEST(LockFreeRingQueueTest, NotifyMechanism) {
     /// 空队列Pop，notify应为false（未改变满状态）
     res = queue.Pop(val);
     EXPECT_FALSE(res.notify);
-}
\ No newline at end of file
+}
+
+/// 三种并发策略共用的单线程语义测试
+template <typename Policy>
+class LockFreeRingQueuePolicyTest : public ::testing::Test {};
+
+typedef ::testing::Types<RingQueueMPMC, RingQueueMPSC, RingQueueSPSC> RingQueuePolicies;
+TYPED_TEST_SUITE(LockFreeRingQueuePolicyTest, RingQueuePolicies);
+
+TYPED_TEST(LockFreeRingQueuePolicyTest, PushPopNotify) {
+    LockFreeRingQueue<int, std::size_t, TypeParam> queue(4); /// 实际可用3
+    EXPECT_EQ(queue.capacity(), 3u);
+
+    EXPECT_TRUE(queue.Push(1).notify);   /// 从空变非空
+    EXPECT_FALSE(queue.Push(2).notify);
+    EXPECT_TRUE(queue.Push(3).success);
+    EXPECT_FALSE(queue.Push(4).success); /// 已满
+
+    int val;
+    auto res = queue.Pop(val);
+    EXPECT_TRUE(res.success);
+    EXPECT_TRUE(res.notify);             /// 从满变非满
+    EXPECT_EQ(val, 1);
+    res = queue.Pop(val);
+    EXPECT_FALSE(res.notify);
+    EXPECT_EQ(val, 2);
+    EXPECT_TRUE(queue.Pop(val).success);
+    EXPECT_EQ(val, 3);
+    EXPECT_FALSE(queue.Pop(val).success);
+}
+
+/// 批量操作：部分成功、回绕、notify
+TYPED_TEST(LockFreeRingQueuePolicyTest, Batch) {
+    LockFreeRingQueue<std::string, std::size_t, TypeParam> queue(8); /// 实际可用7
+    std::vector<std::string> in = {"a", "b", "c", "d", "e"};
+    std::vector<std::string> out(8);
+
+    for (int round = 0; round < 5; ++round) { /// 多轮以覆盖下标回绕
+        auto res = queue.PushBatch(in.begin(), in.size());
+        EXPECT_EQ(res.count, 5u);
+        EXPECT_TRUE(res.notify);
+
+        res = queue.PushBatch(in.begin(), in.size()); /// 只剩2个空位
+        EXPECT_EQ(res.count, 2u);
+        EXPECT_FALSE(res.notify);
+        EXPECT_FALSE(queue.Push("x").success);
+
+        res = queue.PopBatch(out.begin(), 3);
+        EXPECT_EQ(res.count, 3u);
+        EXPECT_TRUE(res.notify);
+        EXPECT_EQ(out[0], "a");
+        EXPECT_EQ(out[2], "c");
+
+        res = queue.PopBatch(out.begin(), out.size());
+        EXPECT_EQ(res.count, 4u);
+        EXPECT_FALSE(res.notify);
+        EXPECT_EQ(out[0], "d");
+        EXPECT_EQ(out[1], "e");
+        EXPECT_EQ(out[2], "a");
+        EXPECT_EQ(out[3], "b");
+
+        EXPECT_EQ(queue.PopBatch(out.begin(), out.size()).count, 0u);
+    }
+
+    /// 析构时销毁回绕后残留的元素
+    queue.PushBatch(in.begin(), in.size());
+}
+
+/// 对每个生产者而言元素保持先进先出，消费到的总和正确
+template <typename Policy>
+static void RunOrderedStress(int producers, int consumers, bool batch) {
+    const int kElements = 20000;
+    LockFreeRingQueue<long, std::size_t, Policy> queue(64);
+    std::atomic<int> consumed{0};
+    std::atomic<long> sum{0};
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]{
+            long buf[8];
+            for (int i = 0; i < kElements;) {
+                if (batch) {
+                    int n = std::min(8, kElements - i);
+                    for (int k = 0; k < n; ++k)
+                        buf[k] = (long)p << 32 | (i + k);
+                    std::size_t done = 0;
+                    while (done < (std::size_t)n) {
+                        done += queue.PushBatch(buf + done, n - done).count;
+                        if (done < (std::size_t)n) std::this_thread::yield();
+                    }
+                    i += n;
+                } else if (queue.Push((long)p << 32 | i).success) {
+                    ++i;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&]{
+            std::vector<long> last(producers, -1);
+            long buf[8];
+            while (consumed < producers * kElements) {
+                std::size_t n = batch ? queue.PopBatch(buf, 8).count : (queue.Pop(buf[0]).success ? 1 : 0);
+                if (n == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (std::size_t k = 0; k < n; ++k) {
+                    int p = (int)(buf[k] >> 32);
+                    long i = buf[k] & 0xffffffff;
+                    if (consumers == 1) {
+                        EXPECT_EQ(i, last[p] + 1);
+                    }
+                    last[p] = i;
+                    sum += i;
+                }
+                consumed += (int)n;
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(consumed, producers * kElements);
+    EXPECT_EQ(sum, (long)producers * kElements * (kElements - 1) / 2);
+}
+
+TEST(LockFreeRingQueueTest, SPSCConcurrency) {
+    RunOrderedStress<RingQueueSPSC>(1, 1, false);
+    RunOrderedStress<RingQueueSPSC>(1, 1, true);
+}
+
+TEST(LockFreeRingQueueTest, MPSCConcurrency) {
+    RunOrderedStress<RingQueueMPSC>(4, 1, false);
+    RunOrderedStress<RingQueueMPSC>(4, 1, true);
+}
+
+TEST(LockFreeRingQueueTest, MPMCBatchConcurrency) {
+    RunOrderedStress<RingQueueMPMC>(2, 2, false);
+    RunOrderedStress<RingQueueMPMC>(2, 2, true);
+}
@@ -0,0 +1,154 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <concurrence/channel.h>
+#include <debug/debugger.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace cxk;
+using namespace std::chrono;
+
+class MetricsTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        StartScheduler(2, true);
+    }
+};
+
+/// 切换、让出、挂起、唤醒、完成的计数与实际发生的次数一致
+TEST_F(MetricsTest, Counters) {
+    const int kTasks = 50;
+    const int kYields = 10;
+    auto before = CoDebugger::getInstance().GetMetrics().total_;
+
+    Channel<int> ch;
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            for (int j = 0; j < kYields; ++j)
+                Processor::StaticCoYield();
+            ch << 1;
+        });
+        Scheduler::getInstance().CreateTask([&]{
+            int v = 0;
+            ch >> v;
+        });
+    }
+    ASSERT_TRUE(WaitAllDone());
+
+    auto m = CoDebugger::getInstance().GetMetrics();
+    ASSERT_EQ(m.processors_.size(), 2u);
+    auto const& after = m.total_;
+    EXPECT_EQ(after.tasksDone_ - before.tasksDone_, 2u * kTasks);
+    EXPECT_GE(after.yields_ - before.yields_, (uint64_t)kTasks * kYields);
+    EXPECT_GE(after.switches_ - before.switches_, (uint64_t)kTasks * (kYields + 2));
+    // 每次挂起都对应一次唤醒
+    EXPECT_EQ(after.parks_ - before.parks_, after.wakes_ - before.wakes_);
+    EXPECT_EQ(after.runQueueDepth_, 0u);
+    EXPECT_EQ(m.taskCount_, 0u);
+    EXPECT_NE(m.timestampNs_, 0u);
+}
+
+/// 运行队列等待时间按固定的2的幂纳秒分桶
+TEST_F(MetricsTest, RunnableLatency) {
+    for (int i = 0; i < 200; ++i)
+        Scheduler::getInstance().CreateTask([]{
+            for (int j = 0; j < 8; ++j) Processor::StaticCoYield();
+        });
+    ASSERT_TRUE(WaitAllDone());
+
+    auto const& h = CoDebugger::getInstance().GetMetrics().total_.runnableLatency_;
+    ASSERT_EQ(h.counts_.size(), h.boundsNs_.size() + 1);
+    EXPECT_EQ(h.boundsNs_[0], 1.0);
+    EXPECT_EQ(h.boundsNs_[10], 1024.0);
+    // 新协程全部记录，重新排队的按1/8抽样
+    EXPECT_GE(h.count_, 200u * 2);
+    uint64_t sum = 0;
+    for (uint64_t c : h.counts_) sum += c;
+    EXPECT_EQ(sum, h.count_);
+    EXPECT_GT(h.sumNs_, 0);
+}
+
+/// 已经开始运行、尚未结束的协程的私有栈字节数
+TEST_F(MetricsTest, StackBytes) {
+    const int kTasks = 20;
+    int64_t before = CoDebugger::getInstance().GetMetrics().total_.stackBytes_;
+
+    Channel<int> ch(kTasks);
+    std::atomic<int> parked{0};
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            ++parked;
+            int v = 0;
+            ch >> v;
+        });
+    }
+    auto deadline = steady_clock::now() + seconds(10);
+    while (parked < kTasks && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    ASSERT_EQ(parked, kTasks);
+
+    int64_t during = CoDebugger::getInstance().GetMetrics().total_.stackBytes_;
+    EXPECT_EQ(during - before, (int64_t)kTasks * (int64_t)StackPool::DefaultStackSize());
+
+    for (int i = 0; i < kTasks; ++i) ch << i;
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(CoDebugger::getInstance().GetMetrics().total_.stackBytes_, before);
+}
+
+/// Prometheus文本格式
+TEST_F(MetricsTest, PrometheusText) {
+    Scheduler::getInstance().CreateTask([]{ Processor::StaticCoYield(); });
+    ASSERT_TRUE(WaitAllDone());
+
+    std::string text = CoDebugger::getInstance().GetMetricsText();
+    EXPECT_NE(text.find("# TYPE gocoroutine_switches_total counter"), std::string::npos);
+    EXPECT_NE(text.find("gocoroutine_switches_total{processor=\"0\"} "), std::string::npos);
+    EXPECT_NE(text.find("gocoroutine_switches_total{processor=\"1\"} "), std::string::npos);
+    EXPECT_NE(text.find("# TYPE gocoroutine_runnable_latency_seconds histogram"), std::string::npos);
+    EXPECT_NE(text.find("gocoroutine_runnable_latency_seconds_bucket{processor=\"0\",le=\"+Inf\"} "), std::string::npos);
+    EXPECT_NE(text.find("gocoroutine_runnable_latency_seconds_count{processor=\"0\"} "), std::string::npos);
+    EXPECT_NE(text.find("gocoroutine_tasks 0\n"), std::string::npos);
+    EXPECT_NE(text.find("gocoroutine_stack_pool_mapped_bytes "), std::string::npos);
+
+    // 累积桶单调不减，+Inf桶等于_count
+    auto value = [&](std::string const& key, std::size_t from) {
+        std::size_t pos = text.find(key, from);
+        return pos == std::string::npos ? -1.0 : std::stod(text.substr(pos + key.size()));
+    };
+    std::string prefix = "gocoroutine_runnable_latency_seconds_bucket{processor=\"0\",le=\"";
+    double last = 0;
+    for (std::size_t pos = text.find(prefix); pos != std::string::npos; pos = text.find(prefix, pos + 1)) {
+        double v = value("} ", pos);
+        EXPECT_GE(v, last);
+        last = v;
+    }
+    EXPECT_EQ(last, value("gocoroutine_runnable_latency_seconds_count{processor=\"0\"} ", 0));
+}
+
+/// 当前协程的ID、切出次数和调试信息
+TEST_F(MetricsTest, CurrentTaskInfo) {
+    EXPECT_EQ(CoDebugger::getInstance().GetCurrentTaskID(), 0u);
+
+    std::atomic<bool> ok{false};
+    Scheduler::getInstance().CreateTask([&]{
+        auto& dbg = CoDebugger::getInstance();
+        unsigned long id = dbg.GetCurrentTaskID();
+        unsigned long yields = dbg.GetCurrentTaskYieldCount();
+        Processor::StaticCoYield();
+        Processor::StaticCoYield();
+        dbg.SetCurrentTaskDebugInfo("worker");
+        std::string info = dbg.GetCurrentTaskDebugInfo();
+        ok = id != 0 && dbg.GetCurrentTaskYieldCount() == yields + 2
+             && info == "id:" + std::to_string(id) + ", info:worker";
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(CoDebugger::getInstance().TaskCount(), 0);
+    EXPECT_NE(CoDebugger::getInstance().GetAllInfo().find("processor"), std::string::npos);
+}
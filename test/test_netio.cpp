@@ -0,0 +1,245 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <netio/hook.h>
+#include <scheduler/scheduler.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace cxk;
+using namespace std::chrono;
+
+static ssize_t ReadFull(int fd, char* buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = co_read(fd, buf + got, n - got);
+        if (r <= 0) return r;
+        got += r;
+    }
+    return (ssize_t)got;
+}
+
+class NetIoTest : public SchedulerSuite<2> {};
+
+/// socketpair两端的协程互相收发：读不到数据时挂起，不阻塞工作线程
+TEST_F(NetIoTest, SocketPairPingPong) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    const int kRounds = 1000;
+    std::atomic<int> pongs{0}, ran{0};
+
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kRounds; ++i) {
+            int v = -1;
+            ASSERT_EQ(ReadFull(fds[1], (char*)&v, sizeof(v)), (ssize_t)sizeof(v));
+            ASSERT_EQ(v, i);
+            ++v;
+            ASSERT_EQ(co_write(fds[1], &v, sizeof(v)), (ssize_t)sizeof(v));
+        }
+    });
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kRounds; ++i) {
+            ASSERT_EQ(co_write(fds[0], &i, sizeof(i)), (ssize_t)sizeof(i));
+            int v = -1;
+            ASSERT_EQ(ReadFull(fds[0], (char*)&v, sizeof(v)), (ssize_t)sizeof(v));
+            ASSERT_EQ(v, i + 1);
+            ++pongs;
+        }
+    });
+    for (int i = 0; i < 100; ++i)
+        Scheduler::getInstance().CreateTask([&]{ ++ran; });
+
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(pongs, kRounds);
+    EXPECT_EQ(ran, 100);
+    co_close(fds[0]);
+    co_close(fds[1]);
+}
+
+/// TCP回显：co_accept/co_connect/co_send/co_recv，多个连接并发
+TEST_F(NetIoTest, TcpEcho) {
+    int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(listenFd, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ASSERT_EQ(::bind(listenFd, (sockaddr*)&addr, sizeof(addr)), 0);
+    ASSERT_EQ(::listen(listenFd, 128), 0);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(::getsockname(listenFd, (sockaddr*)&addr, &len), 0);
+
+    const int kClients = 50;
+    const int kMessages = 20;
+    std::atomic<int> echoed{0};
+
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kClients; ++i) {
+            int fd = co_accept(listenFd, nullptr, nullptr);
+            ASSERT_GE(fd, 0);
+            Scheduler::getInstance().CreateTask([fd]{
+                char buf[256];
+                for (;;) {
+                    ssize_t n = co_recv(fd, buf, sizeof(buf), 0);
+                    if (n <= 0) break;
+                    ASSERT_EQ(co_send(fd, buf, n, 0), n);
+                }
+                co_close(fd);
+            });
+        }
+    });
+
+    for (int c = 0; c < kClients; ++c) {
+        Scheduler::getInstance().CreateTask([&, c]{
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            ASSERT_GE(fd, 0);
+            ASSERT_EQ(co_connect(fd, (sockaddr*)&addr, sizeof(addr)), 0);
+            for (int i = 0; i < kMessages; ++i) {
+                std::string msg = std::to_string(c) + ":" + std::to_string(i);
+                ASSERT_EQ(co_send(fd, msg.data(), msg.size(), 0), (ssize_t)msg.size());
+                std::string reply(msg.size(), '\0');
+                ASSERT_EQ(ReadFull(fd, &reply[0], reply.size()), (ssize_t)reply.size());
+                ASSERT_EQ(reply, msg);
+                ++echoed;
+            }
+            co_close(fd);
+        });
+    }
+
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(echoed, kClients * kMessages);
+    co_close(listenFd);
+}
+
+/// 连接被拒绝时co_connect返回错误
+TEST_F(NetIoTest, ConnectRefused) {
+    // 绑定但不监听的端口会拒绝连接
+    int holder = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(::bind(holder, (sockaddr*)&addr, sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(::getsockname(holder, (sockaddr*)&addr, &len), 0);
+
+    std::atomic<int> err{0};
+    Scheduler::getInstance().CreateTask([&]{
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (co_connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+            err = errno;
+        co_close(fd);
+    });
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(err, ECONNREFUSED);
+    ::close(holder);
+}
+
+/// SO_RCVTIMEO在协程中生效：超时返回-1，errno为EAGAIN
+TEST_F(NetIoTest, RecvTimeout) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    timeval tv = {0, 50 * 1000};
+    ASSERT_EQ(co_setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)), 0);
+
+    std::atomic<int> err{0};
+    std::atomic<int64_t> elapsedMs{0};
+    Scheduler::getInstance().CreateTask([&]{
+        char c;
+        auto start = steady_clock::now();
+        ssize_t n = co_read(fds[0], &c, 1);
+        elapsedMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+        if (n < 0) err = errno;
+    });
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(err, EAGAIN);
+    EXPECT_GE(elapsedMs, 45);
+    EXPECT_LT(elapsedMs, 2000);
+    co_close(fds[0]);
+    co_close(fds[1]);
+}
+
+/// co_wait_fd：超时返回0，就绪返回1
+TEST_F(NetIoTest, WaitFd) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::atomic<int> first{-2}, second{-2};
+    Scheduler::getInstance().CreateTask([&]{
+        first = co_wait_fd(fds[0], POLLIN, 20);
+        second = co_wait_fd(fds[0], POLLIN, 5000);
+    });
+    while (first == -2)
+        std::this_thread::sleep_for(milliseconds(1));
+    EXPECT_EQ(first, 0);
+    ASSERT_EQ(::write(fds[1], "x", 1), 1);
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(second, 1);
+    co_close(fds[0]);
+    co_close(fds[1]);
+}
+
+/// 已被协程托管（O_NONBLOCK）的fd在普通线程中仍然是阻塞语义
+TEST_F(NetIoTest, ThreadBlockingOnManagedFd) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    Scheduler::getInstance().CreateTask([&]{
+        char c;
+        EXPECT_EQ(co_wait_fd(fds[0], POLLIN, 0), 0);    // 托管fds[0]
+        EXPECT_EQ(co_read(fds[1], &c, 0), 0);           // 托管fds[1]
+    });
+    ASSERT_TRUE(WaitAllDone());
+    ASSERT_TRUE(::fcntl(fds[0], F_GETFL) & O_NONBLOCK);
+
+    std::thread writer([&]{
+        std::this_thread::sleep_for(milliseconds(20));
+        ASSERT_EQ(co_write(fds[1], "y", 1), 1);
+    });
+    char c = 0;
+    EXPECT_EQ(co_read(fds[0], &c, 1), 1);
+    EXPECT_EQ(c, 'y');
+    writer.join();
+
+    // 用户自己设置的O_NONBLOCK保持非阻塞语义
+    int fds2[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds2), 0);
+    std::atomic<int> err{0};
+    Scheduler::getInstance().CreateTask([&]{
+        char b;
+        if (co_read(fds2[0], &b, 1) < 0) err = errno;
+    });
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(err, EAGAIN);
+
+    co_close(fds[0]);
+    co_close(fds[1]);
+    co_close(fds2[0]);
+    co_close(fds2[1]);
+}
+
+/// co_close唤醒挂起在该fd上的协程
+TEST_F(NetIoTest, CloseWakesReader) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::atomic<bool> reading{false};
+    std::atomic<ssize_t> result{1};
+    Scheduler::getInstance().CreateTask([&]{
+        char c;
+        reading = true;
+        result = co_read(fds[0], &c, 1);
+    });
+    while (!reading)
+        std::this_thread::sleep_for(milliseconds(1));
+    std::this_thread::sleep_for(milliseconds(20));
+    co_close(fds[0]);
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(result, -1);
+    co_close(fds[1]);
+}
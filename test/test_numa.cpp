@@ -0,0 +1,96 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <common/numa.h>
+#include <scheduler/scheduler.h>
+#include <context/stack_pool.h>
+#include <debug/debugger.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace cxk;
+using namespace std::chrono;
+
+TEST(NumaTopologyTest, ParseCpuList) {
+    EXPECT_EQ(NumaTopology::ParseCpuList("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(NumaTopology::ParseCpuList("5"), (std::vector<int>{5}));
+    EXPECT_EQ(NumaTopology::ParseCpuList("2,0-1,1"), (std::vector<int>{0, 1, 2}));
+    EXPECT_TRUE(NumaTopology::ParseCpuList("").empty());
+}
+
+/// 每个允许运行的CPU恰好属于一个节点
+TEST(NumaTopologyTest, Consistent) {
+    NumaTopology& topo = NumaTopology::getInstance();
+    ASSERT_GE(topo.NodeCount(), 1u);
+    std::size_t total = 0;
+    for (std::size_t node = 0; node < topo.NodeCount(); ++node) {
+        EXPECT_FALSE(topo.NodeCpus(node).empty());
+        for (int cpu : topo.NodeCpus(node))
+            EXPECT_EQ(topo.NodeOfCpu(cpu), (int)node);
+        total += topo.NodeCpus(node).size();
+    }
+    EXPECT_EQ(topo.Cpus().size(), total);
+}
+
+class NumaSchedulerTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        Scheduler::PinWorkers() = true;
+        Scheduler::NumaAware() = true;
+        StartScheduler(2);
+    }
+};
+
+/// 工作线程绑定到一个CPU上，并记录所在节点；栈从所在节点分配
+TEST_F(NumaSchedulerTest, PinnedWorkers) {
+    NumaTopology& topo = NumaTopology::getInstance();
+    EXPECT_TRUE(NumaTopology::Active());
+
+    std::atomic<int> checked{0};
+    for (int i = 0; i < 8; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            Processor* proc = Processor::GetCurrentProcessor();
+            ASSERT_NE(proc, nullptr);
+            ASSERT_GE(proc->Node(), 0);
+            EXPECT_EQ(NumaTopology::CurrentNode(), proc->Node());
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(set), &set), 0);
+            EXPECT_EQ(CPU_COUNT(&set), 1);
+            int cpu = sched_getcpu();
+            EXPECT_TRUE(CPU_ISSET(cpu, &set));
+            EXPECT_EQ(topo.NodeOfCpu(cpu), proc->Node());
+
+            StackBlock* block = StackPool::getInstance().Allocate(0);
+            EXPECT_EQ(block->node_, proc->Node());
+            StackPool::getInstance().Free(block);
+            ++checked;
+        });
+    }
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(checked, 8);
+}
+
+/// 一个Processor上创建的大量协程仍被其他Processor窃取执行完毕
+TEST_F(NumaSchedulerTest, StealWithinNode) {
+    std::atomic<int> done{0};
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < 200; ++i)
+            Scheduler::getInstance().CreateTask([&]{
+                std::this_thread::sleep_for(microseconds(50));
+                ++done;
+            });
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(done, 200);
+
+    std::string text = CoDebugger::getInstance().GetMetricsText();
+    EXPECT_NE(text.find("gocoroutine_remote_steals_total"), std::string::npos);
+}
@@ -0,0 +1,180 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include <common/object_pool.h>
+#include <common/smart_ptr.h>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+
+template <int N>
+struct PoolObject
+{
+    explicit PoolObject(int v = 0) : value_(v) {}
+    int value_;
+    char pad_[N];
+};
+
+#if GOCOROUTINE_POOL_PASSTHROUGH
+# define SKIP_IF_PASSTHROUGH() GTEST_SKIP() << "ObjectPool uses operator new under AddressSanitizer"
+#else
+# define SKIP_IF_PASSTHROUGH()
+#endif
+
+/// 同一线程释放后再分配，复用刚释放的对象
+TEST(ObjectPoolTest, ReuseLocal) {
+    SKIP_IF_PASSTHROUGH();
+    typedef ObjectPool<PoolObject<40>> Pool;
+    PoolObject<40>* a = Pool::New(1);
+    EXPECT_EQ(a->value_, 1);
+    EXPECT_EQ((uintptr_t)a % alignof(PoolObject<40>), 0u);
+    Pool::Delete(a);
+    PoolObject<40>* b = Pool::New(2);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(b->value_, 2);
+    Pool::Delete(b);
+}
+
+/// 在其他线程释放的对象回到分配它的线程
+TEST(ObjectPoolTest, CrossThreadFree) {
+    SKIP_IF_PASSTHROUGH();
+    typedef ObjectPool<PoolObject<56>> Pool;
+    std::vector<PoolObject<56>*> objs;
+    for (int i = 0; i < 100; ++i)
+        objs.push_back(Pool::New(i));
+    std::set<PoolObject<56>*> addrs(objs.begin(), objs.end());
+
+    std::thread t([&]{
+        for (auto* obj : objs) Pool::Delete(obj);
+    });
+    t.join();
+
+    std::size_t slabs = Pool::SlabCount();
+    for (int i = 0; i < 100; ++i) {
+        PoolObject<56>* obj = Pool::New(i);
+        EXPECT_EQ(addrs.count(obj), 1u);
+        objs[i] = obj;
+    }
+    EXPECT_EQ(Pool::SlabCount(), slabs);
+    for (auto* obj : objs) Pool::Delete(obj);
+}
+
+/// 线程退出后它的缓存由新线程接管，不再申请新的slab
+TEST(ObjectPoolTest, ThreadExitAdopt) {
+    SKIP_IF_PASSTHROUGH();
+    typedef ObjectPool<PoolObject<120>> Pool;
+    std::thread([]{
+        std::vector<PoolObject<120>*> objs;
+        for (int i = 0; i < 200; ++i) objs.push_back(Pool::New(i));
+        for (auto* obj : objs) Pool::Delete(obj);
+    }).join();
+
+    std::size_t slabs = Pool::SlabCount();
+    EXPECT_GT(slabs, 0u);
+    std::thread([]{
+        std::vector<PoolObject<120>*> objs;
+        for (int i = 0; i < 200; ++i) objs.push_back(Pool::New(i));
+        for (auto* obj : objs) Pool::Delete(obj);
+    }).join();
+    EXPECT_EQ(Pool::SlabCount(), slabs);
+}
+
+/// 线程退出后（其他thread_local对象的析构中）仍可分配和释放，不再接管新的缓存
+TEST(ObjectPoolTest, AllocateAfterThreadExit) {
+    SKIP_IF_PASSTHROUGH();
+    typedef ObjectPool<PoolObject<88>> Pool;
+    static std::atomic<int> late{0};
+    struct LateUser
+    {
+        ~LateUser() {
+            PoolObject<88>* obj = Pool::New(7);
+            if (obj->value_ == 7) ++late;
+            Pool::Delete(obj);
+        }
+    };
+
+    for (int i = 0; i < 8; ++i) {
+        std::thread([i]{
+            // 先于对象池的ExitGuard构造，因此在它之后析构
+            static thread_local LateUser user;
+            (void)user;
+            Pool::Delete(Pool::New(i));
+        }).join();
+    }
+    EXPECT_EQ(late.load(), 8);
+    // 第一个线程的slab（之后的线程接管它的缓存）加上退出后共用的一个
+    EXPECT_LE(Pool::SlabCount(), 2u);
+}
+
+/// 一个线程分配、多个线程释放，对象不重复也不丢失
+TEST(ObjectPoolTest, ProducerConsumers) {
+    typedef ObjectPool<PoolObject<24>> Pool;
+    const int kConsumers = 3;
+    const int kRounds = 20000;
+    std::atomic<PoolObject<24>*> slots[kConsumers];
+    for (auto& s : slots) s = nullptr;
+    std::atomic<bool> stop{false};
+    std::atomic<long> freed{0};
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < kConsumers; ++c) {
+        consumers.emplace_back([&, c]{
+            for (;;) {
+                PoolObject<24>* obj = slots[c].exchange(nullptr);
+                if (obj) {
+                    EXPECT_EQ(obj->value_, c);
+                    Pool::Delete(obj);
+                    ++freed;
+                } else if (stop) {
+                    break;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < kRounds; ++i) {
+        int c = i % kConsumers;
+        PoolObject<24>* obj = Pool::New(c);
+        PoolObject<24>* expected = nullptr;
+        while (!slots[c].compare_exchange_weak(expected, obj)) {
+            expected = nullptr;
+            std::this_thread::yield();
+        }
+    }
+    stop = true;
+    for (auto& t : consumers) t.join();
+    EXPECT_EQ(freed, kRounds);
+}
+
+/// MakePooledRef：引用计数归零时通过删除器归还对象池
+TEST(ObjectPoolTest, PooledRefObject) {
+    static std::atomic<int> destroyed{0};
+    struct MyClass : public RefObject
+    {
+        ~MyClass() override { ++destroyed; }
+    };
+
+    destroyed = 0;
+    MyClass* raw = nullptr;
+    {
+        IncursivePtr<MyClass> ptr(MakePooledRef<MyClass>());
+        raw = ptr.get();
+        IncursivePtr<MyClass> copy(ptr);
+        EXPECT_EQ(ptr.UseCount(), 2);
+    }
+    EXPECT_EQ(destroyed, 1);
+
+    IncursivePtr<MyClass> again(MakePooledRef<MyClass>());
+#if !GOCOROUTINE_POOL_PASSTHROUGH
+    EXPECT_EQ(again.get(), raw);
+#endif
+    (void)raw;
+    again.reset();
+    EXPECT_EQ(destroyed, 2);
+}
@@ -0,0 +1,123 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <scheduler/offload.h>
+#include <debug/debugger.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace cxk;
+using namespace std::chrono;
+
+class OffloadTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        OffloadPool::MaxThreads() = 4;
+        OffloadPool::IdleTimeout() = milliseconds(100);
+        OffloadPool::QueueCapacity() = 4;
+        StartScheduler(1);
+    }
+};
+
+/// 返回值、void和异常都回到调用者协程
+TEST_F(OffloadTest, ResultAndException) {
+    std::atomic<int> done{0};
+    std::thread::id caller, worker;
+    Scheduler::getInstance().CreateTask([&]{
+        caller = std::this_thread::get_id();
+        int v = co_offload([&]{ worker = std::this_thread::get_id(); return 42; });
+        EXPECT_EQ(v, 42);
+
+        auto s = std::make_unique<std::string>("moved");
+        std::string r = co_offload([s = std::move(s)]{ return *s + "!"; });
+        EXPECT_EQ(r, "moved!");
+
+        bool ran = false;
+        co_offload([&]{ ran = true; });
+        EXPECT_TRUE(ran);
+
+        EXPECT_THROW(co_offload([]() -> int { throw std::runtime_error("offload"); }), std::runtime_error);
+        ++done;
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(done, 1);
+    EXPECT_NE(caller, worker);
+}
+
+/// 阻塞调用期间，同一Processor上的其他协程继续运行
+TEST_F(OffloadTest, WorkerKeepsRunning) {
+    std::atomic<bool> finished{false};
+    std::atomic<int> ticks{0};
+    Scheduler::getInstance().CreateTask([&]{
+        co_offload([]{ std::this_thread::sleep_for(milliseconds(200)); });
+        finished = true;
+    });
+    Scheduler::getInstance().CreateTask([&]{
+        while (!finished) {
+            ++ticks;
+            Processor::StaticCoYield();
+        }
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_GT(ticks, 100);
+}
+
+/// 并发的阻塞调用扩容到MaxThreads个线程并行执行，队列满时让出重试；空闲后线程退出
+TEST_F(OffloadTest, ElasticThreads) {
+    const int kCalls = 16;
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    uint64_t completed = OffloadPool::getInstance().GetStats().completed;
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            co_offload([&]{
+                int n = ++running;
+                int p = peak.load();
+                while (n > p && !peak.compare_exchange_weak(p, n)) {}
+                std::this_thread::sleep_for(milliseconds(50));
+                --running;
+            });
+        });
+    }
+    ASSERT_TRUE(WaitAllDone());
+    auto elapsed = steady_clock::now() - start;
+
+    OffloadPool::Stats stats = OffloadPool::getInstance().GetStats();
+    EXPECT_EQ(stats.completed - completed, (uint64_t)kCalls);
+    EXPECT_EQ(stats.queueDepth, 0u);
+    EXPECT_GT(stats.queueFull, 0u);
+    EXPECT_LE(peak, 4);
+    EXPECT_GE(peak, 2);
+    EXPECT_LT(elapsed, milliseconds(50 * kCalls));
+
+    std::string text = CoDebugger::getInstance().GetMetricsText();
+    EXPECT_NE(text.find("gocoroutine_offload_queue_depth 0"), std::string::npos);
+
+    auto deadline = steady_clock::now() + milliseconds(2000);
+    while (OffloadPool::getInstance().GetStats().threads != 0 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(10));
+    EXPECT_EQ(OffloadPool::getInstance().GetStats().threads, 0u);
+
+    // 线程全部退出后再次提交
+    std::atomic<int> again{0};
+    Scheduler::getInstance().CreateTask([&]{ again = co_offload([]{ return 7; }); });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(again, 7);
+}
+
+/// 不在协程中时直接在当前线程执行
+TEST_F(OffloadTest, InlineOutsideCoroutine) {
+    std::thread::id id;
+    int v = co_offload([&]{ id = std::this_thread::get_id(); return 5; });
+    EXPECT_EQ(v, 5);
+    EXPECT_EQ(id, std::this_thread::get_id());
+}
@@ -0,0 +1,137 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <debug/debugger.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/time.h>
+
+using namespace cxk;
+using namespace std::chrono;
+
+/// 在协程中忙等ms个1毫秒的时间片，每个时间片之后让出一次
+__attribute__((noinline)) static void SpinFor(milliseconds ms) {
+    for (int i = 0; i < (int)ms.count(); ++i) {
+        auto slice = steady_clock::now() + milliseconds(1);
+        while (steady_clock::now() < slice) {}
+        Processor::StaticCoYield();
+    }
+}
+
+static CoDebugger::RoutineProfile Find(std::vector<CoDebugger::RoutineProfile> const& profile, std::string const& label) {
+    auto it = std::find_if(profile.begin(), profile.end(),
+                           [&](CoDebugger::RoutineProfile const& p){ return p.label_ == label; });
+    return it == profile.end() ? CoDebugger::RoutineProfile() : *it;
+}
+
+class ProfilerTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        StartScheduler(2, true);
+    }
+
+    void TearDown() override {
+        CoDebugger::getInstance().StopProfiler();
+        CoDebugger::getInstance().ResetProfile();
+    }
+};
+
+/// 运行时间按TaskAttr::site_和SetCurrentTaskDebugInfo的标签统计
+TEST_F(ProfilerTest, CpuTimeByLabel) {
+    auto& dbg = CoDebugger::getInstance();
+    ASSERT_TRUE(dbg.StartProfiler(0));
+    EXPECT_FALSE(dbg.StartProfiler(0));
+
+    TaskAttr busy;
+    busy.site_ = "profiler_busy";
+    for (int i = 0; i < 2; ++i)
+        Scheduler::getInstance().CreateTask([]{ SpinFor(milliseconds(40)); }, busy);
+
+    TaskAttr idle;
+    idle.site_ = "profiler_idle";
+    Scheduler::getInstance().CreateTask([]{
+        for (int i = 0; i < 20; ++i) {
+            Processor::SleepUntil(steady_clock::now() + milliseconds(2));
+        }
+    }, idle);
+
+    Scheduler::getInstance().CreateTask([]{
+        CoDebugger::getInstance().SetCurrentTaskDebugInfo("profiler_labeled");
+        SpinFor(milliseconds(20));
+    });
+    ASSERT_TRUE(WaitAllDone());
+    dbg.StopProfiler();
+
+    auto profile = dbg.GetProfile();
+    auto b = Find(profile, "profiler_busy");
+    auto i = Find(profile, "profiler_idle");
+    auto l = Find(profile, "profiler_labeled");
+    EXPECT_GE(b.cpuNs_, 2 * 40 * 1000000ull);    // 运行时间不少于忙等时间（线程被抢占时会更多）
+    EXPECT_GE(b.switches_, 2u * 40);
+    EXPECT_GE(i.switches_, 20u);
+    EXPECT_LT(i.cpuNs_, b.cpuNs_ / 4);
+    EXPECT_GE(l.cpuNs_, 20 * 1000000ull);
+    ASSERT_FALSE(profile.empty());
+    EXPECT_EQ(profile.front().label_, "profiler_busy");
+
+    // 停止后不再计时
+    Scheduler::getInstance().CreateTask([]{ SpinFor(milliseconds(5)); }, busy);
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(Find(dbg.GetProfile(), "profiler_busy").switches_, b.switches_);
+
+    dbg.ResetProfile();
+    EXPECT_EQ(Find(dbg.GetProfile(), "profiler_busy").switches_, 0u);
+}
+
+/// SIGPROF采样输出folded stack，根节点为协程标签
+TEST_F(ProfilerTest, FoldedStacks) {
+    auto& dbg = CoDebugger::getInstance();
+    ASSERT_TRUE(dbg.StartProfiler(1000));
+
+    TaskAttr attr;
+    attr.site_ = "profiler_sampled";
+    Scheduler::getInstance().CreateTask([]{ SpinFor(milliseconds(300)); }, attr);
+    ASSERT_TRUE(WaitAllDone());
+    dbg.StopProfiler();
+
+    std::string folded = dbg.GetProfileFolded();
+    uint64_t total = 0;
+    std::istringstream in(folded);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::size_t sp = line.rfind(' ');
+        ASSERT_NE(sp, std::string::npos) << line;
+        uint64_t count = std::stoull(line.substr(sp + 1));
+        EXPECT_GT(count, 0u);
+        if (line.compare(0, 17, "profiler_sampled;") == 0)
+            total += count;
+    }
+    EXPECT_GT(total, 0u) << folded;
+    EXPECT_EQ(Find(dbg.GetProfile(), "profiler_sampled").samples_, total);
+}
+
+/// hz为1时采样间隔正好1秒（tv_usec必须小于1000000），超出范围的hz直接拒绝
+TEST_F(ProfilerTest, HzRange) {
+    auto& dbg = CoDebugger::getInstance();
+    EXPECT_FALSE(dbg.StartProfiler(-1));
+    EXPECT_FALSE(dbg.StartProfiler(2000000));
+
+    ASSERT_TRUE(dbg.StartProfiler(1));
+    struct itimerval tv = {};
+    ASSERT_EQ(getitimer(ITIMER_PROF, &tv), 0);
+    EXPECT_EQ(tv.it_interval.tv_sec, 1);
+    EXPECT_EQ(tv.it_interval.tv_usec, 0);
+    dbg.StopProfiler();
+
+    ASSERT_TRUE(dbg.StartProfiler(3));
+    ASSERT_EQ(getitimer(ITIMER_PROF, &tv), 0);
+    EXPECT_EQ(tv.it_interval.tv_sec, 0);
+    EXPECT_EQ(tv.it_interval.tv_usec, 333333);
+}
@@ -0,0 +1,214 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <concurrence/rutex.h>
+#include <scheduler/scheduler.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+typedef RutexBase::rutex_wait_return wait_return;
+
+class RutexTest : public SchedulerSuite<2> {};
+
+/// 值不等于expected时立即返回ewouldblock；没有等待者时wake返回0
+TEST_F(RutexTest, FastPath) {
+    Rutex<int> rutex;
+    rutex.value()->store(1);
+    EXPECT_EQ(rutex.wait(0), RutexBase::rutex_wait_return_ewouldblock);
+    EXPECT_EQ(rutex.wait(0, milliseconds(10)), RutexBase::rutex_wait_return_ewouldblock);
+    EXPECT_EQ(rutex.wake_one(), 0);
+    EXPECT_EQ(rutex.wake_all(), 0);
+    EXPECT_EQ(rutex.waiter_count(), 0);
+}
+
+/// 线程中等待超时
+TEST_F(RutexTest, ThreadTimeout) {
+    Rutex<int> rutex;
+    auto start = steady_clock::now();
+    EXPECT_EQ(rutex.wait(0, milliseconds(20)), RutexBase::rutex_wait_return_etimeout);
+    EXPECT_GE(steady_clock::now() - start, milliseconds(20));
+    EXPECT_EQ(rutex.waiter_count(), 0);
+}
+
+/// 线程等待，另一个线程唤醒
+TEST_F(RutexTest, ThreadWaitWake) {
+    Rutex<int> rutex;
+    std::atomic<bool> done{false};
+    std::thread t([&]{
+        while (rutex.value()->load() == 0) {
+            rutex.wait(0);
+        }
+        done = true;
+    });
+
+    while (rutex.waiter_count() == 0) std::this_thread::yield();
+    rutex.value()->store(1);
+    EXPECT_EQ(rutex.wake_one(), 1);
+    t.join();
+    EXPECT_TRUE(done);
+}
+
+/// 协程等待不阻塞工作线程：等待期间同一调度器上的其他协程照常运行
+TEST_F(RutexTest, CoroutineWaitWake) {
+    Rutex<int> rutex;
+    const int kWaiters = 100;
+    std::atomic<int> woken{0}, ran{0};
+    for (int i = 0; i < kWaiters; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            while (rutex.value()->load() == 0)
+                rutex.wait(0);
+            ++woken;
+        });
+    }
+    for (int i = 0; i < kWaiters; ++i) {
+        Scheduler::getInstance().CreateTask([&]{ ++ran; });
+    }
+
+    auto deadline = steady_clock::now() + seconds(5);
+    while ((rutex.waiter_count() < kWaiters || ran < kWaiters) && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    EXPECT_EQ(ran, kWaiters);
+    EXPECT_EQ(woken, 0);
+
+    rutex.value()->store(1);
+    int n = rutex.wake_all();
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(woken, kWaiters);
+    EXPECT_LE(n, kWaiters);
+}
+
+/// 协程中等待超时
+TEST_F(RutexTest, CoroutineTimeout) {
+    Rutex<int> rutex;
+    std::atomic<int> result{-1};
+    Scheduler::getInstance().CreateTask([&]{
+        result = rutex.wait(0, milliseconds(10));
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(result, RutexBase::rutex_wait_return_etimeout);
+    EXPECT_EQ(rutex.waiter_count(), 0);
+}
+
+/// 唤醒与超时竞争：每次等待恰好返回一次，最终计数正确
+TEST_F(RutexTest, WakeTimeoutRace) {
+    Rutex<int> rutex;
+    const int kTasks = 200;
+    std::atomic<int> finished{0};
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            rutex.wait(0, microseconds(100));
+            ++finished;
+        });
+    }
+    auto deadline = steady_clock::now() + seconds(5);
+    while (finished < kTasks && steady_clock::now() < deadline)
+        rutex.wake_one();
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(finished, kTasks);
+    EXPECT_EQ(rutex.waiter_count(), 0);
+}
+
+/// 引用外部原子变量
+TEST_F(RutexTest, ReferenceValue) {
+    std::atomic<long> v{5};
+    Rutex<long, true> rutex;
+    rutex.ref(&v);
+    EXPECT_EQ(rutex.wait(4), RutexBase::rutex_wait_return_ewouldblock);
+    EXPECT_EQ(rutex.wait(5, milliseconds(1)), RutexBase::rutex_wait_return_etimeout);
+}
+
+/// 编译期策略与运行期注册的策略选择相同的切换器
+TEST_F(RutexTest, SyncPolicyDispatch) {
+    EXPECT_TRUE(DefaultSyncPolicy::IsInPThread());
+    EXPECT_TRUE(RoutineSyncPolicy::IsInPThread());
+    EXPECT_TRUE(DefaultSyncPolicy::ClsRef().isPThread());
+    EXPECT_EQ(&DefaultSyncPolicy::ClsRef(), &RoutineSyncPolicy::ClsRef());
+
+    std::atomic<int> checks{0};
+    Scheduler::getInstance().CreateTask([&]{
+        if (DefaultSyncPolicy::IsInPThread() || RoutineSyncPolicy::IsInPThread()) return;
+        RoutineSwitcherI & sw = DefaultSyncPolicy::ClsRef();
+        if (sw.isPThread() || &sw != TaskSwitcher::current()) return;
+        if (&sw != &RoutineSyncPolicy::ClsRef()) return;
+        ++checks;
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(checks, 1);
+}
+
+/// 使用运行期分派策略的rutex：协程等待，线程唤醒
+TEST_F(RutexTest, DynamicPolicy) {
+    Rutex<int, false, RoutineSyncPolicy> rutex;
+    std::atomic<int> woken{0};
+    const int kTasks = 20;
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            while (rutex.value()->load() == 0)
+                rutex.wait(0);
+            ++woken;
+        });
+    }
+    std::this_thread::sleep_for(milliseconds(10));
+    rutex.value()->store(1);
+    rutex.wake_all();
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(woken, kTasks);
+}
+
+/// PThreadSwitcher: mark -> wake -> sleep直接返回；同一次mark只有一次wake成功
+TEST_F(RutexTest, PThreadSwitcherProtocol) {
+    PThreadSwitcher sw;
+    EXPECT_FALSE(sw.wake());    // 未mark
+
+    sw.mark();
+    EXPECT_TRUE(sw.wake());
+    EXPECT_FALSE(sw.wake());
+    auto start = steady_clock::now();
+    sw.sleep();
+    EXPECT_LT(steady_clock::now() - start, seconds(1));
+
+    // 对方已经进入futex等待
+    sw.mark();
+    std::atomic<bool> slept{false};
+    std::thread t([&]{
+        sw.sleep();
+        slept = true;
+    });
+    std::this_thread::sleep_for(milliseconds(20));
+    EXPECT_FALSE(slept);
+    EXPECT_TRUE(sw.wake());
+    t.join();
+    EXPECT_TRUE(slept);
+    EXPECT_FALSE(sw.wake());
+}
+
+/// 两个线程通过rutex反复交替唤醒
+TEST_F(RutexTest, ThreadPingPong) {
+    Rutex<int> rutex;
+    const int kRounds = 20000;
+    std::thread t([&]{
+        for (int i = 0; i < kRounds; ++i) {
+            int expected = 2 * i + 1;
+            while (rutex.value()->load() != expected)
+                rutex.wait(expected - 1);
+            rutex.value()->store(expected + 1);
+            rutex.wake_all();
+        }
+    });
+    for (int i = 0; i < kRounds; ++i) {
+        int expected = 2 * i;
+        while (rutex.value()->load() != expected)
+            rutex.wait(expected - 1);
+        rutex.value()->store(expected + 1);
+        rutex.wake_all();
+    }
+    t.join();
+    EXPECT_EQ(rutex.value()->load(), 2 * kRounds);
+}
@@ -0,0 +1,113 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace cxk;
+
+class SchedulerTest : public SchedulerSuite<4> {};
+
+/// 基础功能：协程被执行且计数归零
+TEST_F(SchedulerTest, RunTasks) {
+    std::atomic<int> count{0};
+    const int kTasks = 1000;
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            EXPECT_TRUE(Scheduler::IsCoroutine());
+            ++count;
+        });
+    }
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(count, kTasks);
+    EXPECT_FALSE(Scheduler::IsCoroutine());
+}
+
+/// 协程中yield与嵌套创建
+TEST_F(SchedulerTest, YieldAndNestedCreate) {
+    std::atomic<int> count{0};
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < 100; ++i) {
+            Scheduler::getInstance().CreateTask([&]{
+                for (int j = 0; j < 10; ++j)
+                    Processor::StaticCoYield();
+                ++count;
+            });
+        }
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(count, 100);
+}
+
+/// 本地创建的大量任务会被空闲Processor窃取到多个线程执行
+TEST_F(SchedulerTest, WorkStealing) {
+    std::mutex mtx;
+    std::set<std::thread::id> threads;
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < 2000; ++i) {
+            Scheduler::getInstance().CreateTask([&]{
+                auto start = std::chrono::steady_clock::now();
+                while (std::chrono::steady_clock::now() - start < std::chrono::microseconds(50));
+                std::unique_lock<std::mutex> lock(mtx);
+                threads.insert(std::this_thread::get_id());
+            });
+        }
+    });
+    ASSERT_TRUE(WaitAllDone());
+    if (std::thread::hardware_concurrency() > 1) {
+        EXPECT_GT(threads.size(), 1u);
+    }
+}
+
+/// 挂起与唤醒：先mark后wake再切出、以及重复唤醒只成功一次
+TEST_F(SchedulerTest, SuspendAndWakeup) {
+    std::atomic<int> resumed{0};
+    std::mutex mtx;
+    std::vector<Processor::SuspendEntry> entries;
+
+    const int kTasks = 50;
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            auto entry = Processor::Suspend();
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                entries.push_back(entry);
+            }
+            Processor::StaticCoYield();
+            ++resumed;
+        });
+    }
+
+    int woken = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (woken < kTasks && std::chrono::steady_clock::now() < deadline) {
+        std::vector<Processor::SuspendEntry> batch;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            batch.swap(entries);
+        }
+        for (auto& entry : batch) {
+            EXPECT_TRUE(Processor::Wakeup(entry));
+            EXPECT_FALSE(Processor::Wakeup(entry));
+            EXPECT_TRUE(entry.IsExpire());
+            ++woken;
+        }
+    }
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(resumed, kTasks);
+}
+
+/// 协程抛出的异常不会影响调度器
+TEST_F(SchedulerTest, TaskException) {
+    std::atomic<int> count{0};
+    Scheduler::getInstance().CreateTask([&]{ throw std::runtime_error("task error"); });
+    Scheduler::getInstance().CreateTask([&]{ ++count; });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(count, 1);
+}
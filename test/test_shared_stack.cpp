@@ -0,0 +1,245 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <concurrence/channel.h>
+#include <concurrence/co_mutex.h>
+#include <concurrence/co_condition_variable.h>
+#include <netio/hook.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+static TaskAttr SharedAttr() {
+    TaskAttr attr;
+    attr.sharedStack_ = true;
+    return attr;
+}
+
+/// 在栈上填充与seed相关的内容
+static void Fill(char* buf, std::size_t n, int seed) {
+    for (std::size_t i = 0; i < n; ++i)
+        buf[i] = (char)(seed * 31 + i);
+}
+
+static bool Check(char const* buf, std::size_t n, int seed) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (buf[i] != (char)(seed * 31 + i)) return false;
+    return true;
+}
+
+/// 递归占用一段栈，每层都切出，返回时校验本层的栈内容
+static int DeepYield(int depth, int seed) {
+    char local[256];
+    Fill(local, sizeof(local), seed + depth);
+    Processor::StaticCoYield();
+    int ok = depth > 0 ? DeepYield(depth - 1, seed) : 1;
+    return ok && Check(local, sizeof(local), seed + depth);
+}
+
+class SharedStackTest : public SchedulerSuite<4> {};
+
+/// 大量共享栈协程交替切出，各自的栈内容（包括多层调用栈）在切回后保持不变
+TEST_F(SharedStackTest, PreserveStackAcrossSwitches) {
+    const int kTasks = 500;
+    std::atomic<int> ok{0};
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&ok, i]{
+            char buf[1024];
+            Fill(buf, sizeof(buf), i);
+            for (int j = 0; j < 5; ++j)
+                Processor::StaticCoYield();
+            if (DeepYield(8 + i % 8, i) && Check(buf, sizeof(buf), i))
+                ++ok;
+        }, SharedAttr());
+    }
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(ok, kTasks);
+}
+
+/// 第一次运行后固定在同一个Processor上
+TEST_F(SharedStackTest, PinnedToProcessor) {
+    const int kTasks = 200;
+    std::atomic<int> moved{0}, done{0};
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            Processor* proc = Processor::GetCurrentProcessor();
+            for (int j = 0; j < 20; ++j) {
+                if (j % 2) co_sleep(microseconds(100));
+                else Processor::StaticCoYield();
+                if (Processor::GetCurrentProcessor() != proc) ++moved;
+            }
+            ++done;
+        }, SharedAttr());
+    }
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(done, kTasks);
+    EXPECT_EQ(moved, 0);
+}
+
+/// 挂起在channel、select、co_mutex、条件变量上时栈被其他协程覆盖，唤醒和值交接仍然正确
+TEST_F(SharedStackTest, BlockingPrimitives) {
+    const int kPairs = 100;
+    const int kRounds = 50;
+    Channel<std::vector<int>> ch;          // 无缓冲：发送者与接收者直接交接
+    Channel<int> timeoutCh;
+    co_mutex mtx;
+    co_condition_variable cv;
+    int turn = 0;
+    std::atomic<long> sum{0};
+    std::atomic<int> bad{0};
+
+    for (int p = 0; p < kPairs; ++p) {
+        Scheduler::getInstance().CreateTask([&, p]{
+            char guard[512];
+            Fill(guard, sizeof(guard), p);
+            for (int r = 0; r < kRounds; ++r) {
+                std::vector<int> v(4, p * kRounds + r);
+                if (r % 2) ch << v;
+                else {
+                    int idx = Select({ch.CasePush(v)});
+                    if (idx != 0) ++bad;
+                }
+            }
+            if (!Check(guard, sizeof(guard), p)) ++bad;
+        }, SharedAttr());
+
+        Scheduler::getInstance().CreateTask([&, p]{
+            char guard[512];
+            Fill(guard, sizeof(guard), p + 7);
+            for (int r = 0; r < kRounds; ++r) {
+                std::vector<int> v;
+                ch >> v;
+                if (v.size() != 4) ++bad;
+                else sum += v[0];
+
+                // 超时等待：定时器在挂起期间访问等待者
+                int x = 0;
+                if (Select({timeoutCh.CasePop(x)}, microseconds(50)) != -1) ++bad;
+
+                std::unique_lock<co_mutex> lock(mtx);
+                ++turn;
+                cv.notify_all();
+            }
+            if (!Check(guard, sizeof(guard), p + 7)) ++bad;
+        }, SharedAttr());
+    }
+
+    // 条件变量等待者
+    std::atomic<bool> seen{false};
+    Scheduler::getInstance().CreateTask([&]{
+        std::unique_lock<co_mutex> lock(mtx);
+        cv.wait(lock, [&]{ return turn == kPairs * kRounds; });
+        seen = true;
+    }, SharedAttr());
+
+    ASSERT_TRUE(WaitAllDone(milliseconds(30000)));
+    long n = (long)kPairs * kRounds;
+    EXPECT_EQ(sum, n * (n - 1) / 2);
+    EXPECT_EQ(bad, 0);
+    EXPECT_TRUE(seen);
+}
+
+/// 挂起在socket读上，读到栈上的缓冲区
+TEST_F(SharedStackTest, SocketRead) {
+    const int kConns = 64;
+    std::vector<int> peers;
+    std::atomic<int> ok{0};
+    for (int i = 0; i < kConns; ++i) {
+        int sv[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+        peers.push_back(sv[1]);
+        int fd = sv[0];
+        Scheduler::getInstance().CreateTask([&ok, fd, i]{
+            char buf[128];
+            std::size_t got = 0;
+            while (got < sizeof(buf)) {
+                ssize_t r = co_read(fd, buf + got, sizeof(buf) - got);
+                if (r <= 0) break;
+                got += r;
+            }
+            if (got == sizeof(buf) && Check(buf, sizeof(buf), i)) ++ok;
+            co_close(fd);
+        }, SharedAttr());
+    }
+
+    std::this_thread::sleep_for(milliseconds(20));   // 让所有协程挂起在read上
+    for (int i = 0; i < kConns; ++i) {
+        char buf[128];
+        Fill(buf, sizeof(buf), i);
+        ASSERT_EQ(::write(peers[i], buf, 64), 64);
+    }
+    std::this_thread::sleep_for(milliseconds(5));
+    for (int i = 0; i < kConns; ++i) {
+        char buf[128];
+        Fill(buf, sizeof(buf), i);
+        ASSERT_EQ(::write(peers[i], buf + 64, 64), 64);
+    }
+
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(ok, kConns);
+    for (int fd : peers) ::close(fd);
+}
+
+/// 空闲的共享栈协程不占用私有栈，保存的栈内容按实际使用量分配
+TEST_F(SharedStackTest, IdleMemory) {
+    const int kTasks = 2000;
+    Channel<int> ch(kTasks);
+    std::atomic<int> parked{0}, done{0};
+
+    // 确保共享栈已经分配，不计入下面的统计
+    for (int i = 0; i < 32; ++i)
+        Scheduler::getInstance().CreateTask([]{}, SharedAttr());
+    ASSERT_TRUE(WaitAllDone());
+
+    std::size_t before = StackPool::getInstance().GetStats().mappedBytes;
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            ++parked;
+            int v = 0;
+            ch >> v;
+            ++done;
+        }, SharedAttr());
+    }
+
+    auto deadline = steady_clock::now() + seconds(10);
+    while (parked < kTasks && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    ASSERT_EQ(parked, kTasks);
+
+    std::size_t after = StackPool::getInstance().GetStats().mappedBytes;
+    EXPECT_LT(after - before, (std::size_t)kTasks * StackPool::DefaultStackSize() / 100);
+
+    for (int i = 0; i < kTasks; ++i)
+        ch << i;
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(done, kTasks);
+}
+
+/// 共享栈协程与私有栈协程混合运行
+TEST_F(SharedStackTest, MixedWithPrivateStacks) {
+    const int kTasks = 200;
+    Channel<int> ch(16);
+    std::atomic<long> sum{0};
+    for (int i = 0; i < kTasks; ++i) {
+        Scheduler::getInstance().CreateTask([&, i]{
+            ch << i;
+        }, SharedAttr());
+        Scheduler::getInstance().CreateTask([&]{
+            int v = 0;
+            ch >> v;
+            sum += v;
+        });
+    }
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(sum, (long)kTasks * (kTasks - 1) / 2);
+}
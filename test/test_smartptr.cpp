@@ -182,4 +182,136 @@ TEST(SmartPtrTest, MultiThreadReferenceCount) {
     t2.join();
 
     EXPECT_EQ(ptr.UseCount(), 1);  // 最终计数应回到初始值1
-}
\ No newline at end of file
+}
+
+/// 偏向计数：创建线程上的拷贝/释放
+TEST(SmartPtrTest, BiasedSameThread) {
+    static std::atomic<int> destroyed{0};
+    class MyClass : public cxk::BiasedRefObject {
+    public:
+        ~MyClass() { ++destroyed; }
+    };
+
+    destroyed = 0;
+    cxk::IncursivePtr<MyClass> ptr1(new MyClass());
+    EXPECT_EQ(ptr1.UseCount(), 1);
+    {
+        cxk::IncursivePtr<MyClass> ptr2(ptr1);
+        cxk::IncursivePtr<MyClass> ptr3 = ptr2;
+        EXPECT_EQ(ptr1.UseCount(), 3);
+    }
+    EXPECT_EQ(ptr1.UseCount(), 1);
+    EXPECT_FALSE(cxk::WeakPtr<MyClass>(ptr1));     // 偏向模式不支持弱引用
+    ptr1.reset();
+    EXPECT_EQ(destroyed, 1);
+}
+
+/// 引用转移到其他线程后释放：由所有者合并后释放对象
+TEST(SmartPtrTest, BiasedCrossThread) {
+    static std::atomic<int> destroyed{0};
+    class MyClass : public cxk::BiasedRefObject {
+    public:
+        ~MyClass() { ++destroyed; }
+    };
+
+    destroyed = 0;
+    cxk::IncursivePtr<MyClass> ptr(new MyClass());
+    cxk::IncursivePtr<MyClass> moved(ptr);
+    std::thread t([p = std::move(moved)]() mutable { p.reset(); });
+    t.join();
+    EXPECT_EQ(destroyed, 0);
+
+    // 另一次引用在其他线程获取和释放，不需要所有者参与
+    std::thread t2([&ptr]{ cxk::IncursivePtr<MyClass> p(ptr); });
+    t2.join();
+
+    ptr.reset();
+    EXPECT_EQ(destroyed, 0);    // 转交的引用仍在所有者的队列中
+    cxk::BiasedRefOwner::DrainCurrent();
+    EXPECT_EQ(destroyed, 1);
+}
+
+/// 所有者线程退出后，最后一个引用在其他线程释放
+TEST(SmartPtrTest, BiasedOwnerExit) {
+    static std::atomic<int> destroyed{0};
+    class MyClass : public cxk::BiasedRefObject {
+    public:
+        ~MyClass() { ++destroyed; }
+    };
+
+    destroyed = 0;
+    cxk::IncursivePtr<MyClass> out;
+    std::thread t([&out]{
+        cxk::IncursivePtr<MyClass> ptr(new MyClass());
+        out = ptr;
+    });
+    t.join();
+    EXPECT_EQ(out.UseCount(), 1);
+    out.reset();
+    EXPECT_EQ(destroyed, 1);
+}
+
+/// 所有者和其他线程并发增减引用，对象只释放一次
+TEST(SmartPtrTest, BiasedMultiThread) {
+    static std::atomic<int> destroyed{0};
+    class MyClass : public cxk::BiasedRefObject {
+    public:
+        ~MyClass() { ++destroyed; }
+    };
+
+    destroyed = 0;
+    for (int round = 0; round < 20; ++round) {
+        cxk::IncursivePtr<MyClass> ptr(new MyClass());
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; ++i) {
+            cxk::IncursivePtr<MyClass> copy(ptr);
+            threads.emplace_back([copy, &stop]() mutable {
+                while (!stop) {
+                    cxk::IncursivePtr<MyClass> p(copy);
+                    std::this_thread::yield();
+                }
+                copy.reset();
+            });
+        }
+        for (int i = 0; i < 1000; ++i) {
+            cxk::IncursivePtr<MyClass> p(ptr);
+            cxk::BiasedRefOwner::DrainCurrent();
+        }
+        stop = true;
+        for (auto& t : threads) t.join();
+        threads.clear();
+        ptr.reset();
+        cxk::BiasedRefOwner::DrainCurrent();
+        EXPECT_EQ(destroyed, round + 1);
+    }
+}
+
+/// MakeSharedRef：对象与弱引用计数在同一块内存中
+TEST(SmartPtrTest, MakeSharedRefWeak) {
+    static std::atomic<int> destroyed{0};
+    class MyClass : public cxk::SharedRefWrapper {
+    public:
+        explicit MyClass(int v) : value_(v) {}
+        ~MyClass() { ++destroyed; }
+        int value_;
+    };
+
+    destroyed = 0;
+    cxk::IncursivePtr<MyClass> strong(cxk::MakeSharedRef<MyClass>(7));
+    EXPECT_EQ(strong->value_, 7);
+    cxk::WeakPtr<MyClass> weak(strong);
+    EXPECT_EQ(weak.UseCount(), 1);
+    EXPECT_EQ(weak.Lock()->value_, 7);
+
+    strong.reset();
+    EXPECT_EQ(destroyed, 1);
+    EXPECT_FALSE(weak);
+    EXPECT_FALSE(weak.Lock());
+    weak.reset();       // 释放内存块
+
+    // 没有弱引用时强引用归零即释放
+    cxk::IncursivePtr<MyClass> other(cxk::MakeSharedRef<MyClass>(1));
+    other.reset();
+    EXPECT_EQ(destroyed, 2);
+}
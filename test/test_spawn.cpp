@@ -0,0 +1,159 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <debug/debugger.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+/// 在指定的Processor上不断yield，使它的运行队列一直非空、不会去窃取其他Processor的任务
+static void KeepBusy(int processor, std::atomic<bool>& stop) {
+    TaskAttr attr;
+    attr.processor_ = processor;
+    Scheduler::getInstance().CreateTask([&stop]{
+        while (!stop) Processor::StaticCoYield();
+    }, attr);
+}
+
+class SpawnTest : public SchedulerSuite<2> {};
+
+/// 批量创建：每个函数各创建一个协程，ID连续，调试标签和栈大小按属性设置
+TEST_F(SpawnTest, CreateTasks) {
+    const int kTasks = 200;
+    std::mutex mtx;
+    std::vector<uint64_t> ids;
+    std::atomic<int> labeled{0};
+
+    TaskAttr attr;
+    attr.label_ = "fan-out";
+    attr.stackSize_ = 256 * 1024;
+    std::vector<TaskF> fns;
+    for (int i = 0; i < kTasks; ++i) {
+        fns.push_back([&]{
+            std::string info = CoDebugger::getInstance().GetCurrentTaskDebugInfo();
+            if (info.find("fan-out") != std::string::npos) ++labeled;
+            std::lock_guard<std::mutex> lock(mtx);
+            ids.push_back(Processor::GetCurrentTask()->id_);
+        });
+    }
+    Scheduler::getInstance().CreateTasks(fns, attr);
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(labeled, kTasks);
+
+    ASSERT_EQ(ids.size(), (std::size_t)kTasks);
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(ids.back() - ids.front(), (uint64_t)kTasks - 1);
+
+    // 协程中批量创建：投递到当前Processor，空闲的Processor窃取
+    std::atomic<int> done{0};
+    Scheduler::getInstance().CreateTask([&]{
+        std::vector<TaskF> children(kTasks, [&]{
+            std::this_thread::sleep_for(microseconds(20));
+            ++done;
+        });
+        Scheduler::getInstance().CreateTasks(children);
+    });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(done, kTasks);
+}
+
+/// 指定Processor时直接投递到它
+TEST_F(SpawnTest, PreferredProcessor) {
+    std::atomic<bool> stop{false};
+    KeepBusy(0, stop);
+
+    std::atomic<int> onTarget{0};
+    TaskAttr attr;
+    attr.processor_ = 1;
+    for (int i = 0; i < 100; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            if (Processor::GetCurrentProcessor()->Id() == 1) ++onTarget;
+        }, attr);
+    }
+    auto deadline = steady_clock::now() + milliseconds(5000);
+    while (Scheduler::getInstance().TaskCount() > 1 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    stop = true;
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(onTarget, 100);
+}
+
+/// 同一Processor上按优先级运行：高优先级先于normal先于background（允许一次防饿死的轮转）
+TEST_F(SpawnTest, PriorityOrder) {
+    std::atomic<bool> stop{false};
+    KeepBusy(1, stop);
+
+    std::mutex mtx;
+    std::vector<TaskPriority> order;
+    TaskAttr spawner;
+    spawner.processor_ = 0;
+    Scheduler::getInstance().CreateTask([&]{
+        for (TaskPriority priority : {TaskPriority::background, TaskPriority::normal, TaskPriority::high}) {
+            TaskAttr attr;
+            attr.processor_ = 0;
+            attr.priority_ = priority;
+            std::vector<TaskF> fns(5, [&, priority]{
+                std::lock_guard<std::mutex> lock(mtx);
+                order.push_back(priority);
+            });
+            Scheduler::getInstance().CreateTasks(fns, attr);
+        }
+    }, spawner);
+
+    auto deadline = steady_clock::now() + milliseconds(5000);
+    while (Scheduler::getInstance().TaskCount() > 1 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    stop = true;
+    ASSERT_TRUE(WaitAllDone());
+
+    ASSERT_EQ(order.size(), 15u);
+    int descents = 0;
+    for (std::size_t i = 1; i < order.size(); ++i)
+        if (order[i] < order[i - 1]) ++descents;
+    EXPECT_LE(descents, 1);
+}
+
+/// 持续的高优先级负载下，background协程仍然能运行
+TEST_F(SpawnTest, BackgroundNotStarved) {
+    std::atomic<bool> stop{false};
+    KeepBusy(1, stop);
+
+    std::atomic<bool> ran{false};
+    std::atomic<bool> gaveUp{false};
+    TaskAttr high;
+    high.processor_ = 0;
+    high.priority_ = TaskPriority::high;
+    Scheduler::getInstance().CreateTask([&]{
+        auto deadline = steady_clock::now() + milliseconds(2000);
+        while (!ran) {
+            if (steady_clock::now() > deadline) {
+                gaveUp = true;
+                break;
+            }
+            Processor::StaticCoYield();
+        }
+    }, high);
+
+    TaskAttr background;
+    background.processor_ = 0;
+    background.priority_ = TaskPriority::background;
+    Scheduler::getInstance().CreateTask([&]{ ran = true; }, background);
+
+    auto deadline = steady_clock::now() + milliseconds(5000);
+    while (Scheduler::getInstance().TaskCount() > 1 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    stop = true;
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_TRUE(ran);
+    EXPECT_FALSE(gaveUp);
+}
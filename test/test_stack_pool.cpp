@@ -0,0 +1,177 @@
+//
+// Created by cxk_zjq on 25-6-2.
+//
+#include <gtest/gtest.h>
+#include <context/context.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+
+/// 从/proc/self/maps读取addr所在映射的权限
+static std::string MappingPerms(void* addr) {
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        uintptr_t begin = 0, end = 0;
+        char perms[5] = {0};
+        if (sscanf(line.c_str(), "%lx-%lx %4s", &begin, &end, perms) != 3) continue;
+        if ((uintptr_t)addr >= begin && (uintptr_t)addr < end) return perms;
+    }
+    return "";
+}
+
+/// 从/proc/self/smaps读取addr所在映射的一个字段（如"Rss:"、"VmFlags:"），返回该行冒号之后的内容
+static std::string SmapsField(void* addr, std::string const& field) {
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+    while (std::getline(smaps, line)) {
+        uintptr_t begin = 0, end = 0;
+        if (sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2 && line.find('-') < 16) {
+            inside = (uintptr_t)addr >= begin && (uintptr_t)addr < end;
+            continue;
+        }
+        if (inside && line.compare(0, field.size(), field) == 0)
+            return line.substr(field.size());
+    }
+    return "";
+}
+
+/// 尺寸等级映射：向上取整到2的幂，超过最大等级返回-1
+TEST(StackPool, SizeClass) {
+    EXPECT_EQ(StackPool::SizeClass(1), 0);
+    EXPECT_EQ(StackPool::SizeClass(StackPool::kMinClassSize), 0);
+    EXPECT_EQ(StackPool::SizeClass(StackPool::kMinClassSize + 1), 1);
+    EXPECT_EQ(StackPool::SizeClass(128 * 1024), 4);
+    EXPECT_EQ(StackPool::SizeClass(StackPool::ClassSize(StackPool::kSizeClasses - 1)), StackPool::kSizeClasses - 1);
+    EXPECT_EQ(StackPool::SizeClass(StackPool::ClassSize(StackPool::kSizeClasses - 1) + 1), -1);
+}
+
+/// 线程缓存命中：释放后再次分配同尺寸应拿回同一个栈
+TEST(StackPool, ReuseFromThreadCache) {
+    auto& pool = StackPool::getInstance();
+    StackBlock* b1 = pool.Allocate(64 * 1024);
+    ASSERT_NE(b1, nullptr);
+    EXPECT_GE(b1->stackSize_, 64u * 1024);
+    EXPECT_EQ((uintptr_t)b1->stack_ % getpagesize(), 0u); /// 页对齐
+    b1->stack_[0] = 1;
+    b1->stack_[b1->stackSize_ - 1] = 1;  /// 整个可用区可读写
+
+    pool.Free(b1);
+    StackBlock* b2 = pool.Allocate(64 * 1024);
+    EXPECT_EQ(b1, b2);
+    pool.Free(b2);
+}
+
+/// 保护页只在创建时设置，复用时保持
+TEST(StackPool, GuardPageKeptAcrossReuse) {
+    int& protect = StackTraits::GetProtectStackPageSize();
+    int old = protect;
+    protect = 1;
+
+    auto& pool = StackPool::getInstance();
+    StackBlock* b = pool.Allocate(StackPool::ClassSize(StackPool::kSizeClasses - 2)); /// 选一个其他用例不用的等级
+    EXPECT_EQ(b->guardPages_, 1);
+    EXPECT_EQ(b->stack_, b->mapBase_ + getpagesize());
+    pool.Free(b);
+
+    protect = old;
+    StackBlock* b2 = pool.Allocate(StackPool::ClassSize(StackPool::kSizeClasses - 2));
+    EXPECT_EQ(b, b2);
+    EXPECT_EQ(b2->guardPages_, 1);
+    EXPECT_EQ(MappingPerms(b2->mapBase_), "---p");  /// 保护页仍然不可访问
+    EXPECT_EQ(MappingPerms(b2->stack_), "rw-p");
+    pool.Free(b2);
+}
+
+/// 超过线程缓存上限的栈会溢出到全局链表并被其他线程复用
+TEST(StackPool, OverflowToGlobal) {
+    auto& pool = StackPool::getInstance();
+    const std::size_t size = 32 * 1024;
+    const std::size_t n = StackPool::ThreadCacheCount() * 2;
+
+    std::vector<StackBlock*> blocks;
+    for (std::size_t i = 0; i < n; ++i)
+        blocks.push_back(pool.Allocate(size));
+    for (auto b : blocks)
+        pool.Free(b);
+
+    auto before = pool.GetStats();
+    EXPECT_GE(before.cachedBytes, size);
+
+    StackBlock* fromOther = nullptr;
+    std::thread t([&]{ fromOther = pool.Allocate(size); pool.Free(fromOther); });
+    t.join();
+
+    bool found = false;
+    for (auto b : blocks)
+        found = found || (b == fromOther);
+    EXPECT_TRUE(found);
+}
+
+/// 高水位：超过后归还的栈被madvise，且仍可复用
+TEST(StackPool, HighWaterMark) {
+    auto& pool = StackPool::getInstance();
+    std::size_t& highWater = StackPool::HighWaterBytes();
+    std::size_t& cacheCount = StackPool::ThreadCacheCount();
+    std::size_t oldHighWater = highWater, oldCacheCount = cacheCount;
+    highWater = 0;
+    cacheCount = 0;  /// 关闭线程缓存，直接进入全局链表
+
+    StackBlock* b = pool.Allocate(16 * 1024);
+    b->stack_[0] = 42;
+    pool.Free(b);
+    EXPECT_FALSE(b->resident_);
+
+    StackBlock* b2 = pool.Allocate(16 * 1024);
+    EXPECT_EQ(b, b2);
+    EXPECT_EQ(b2->stack_[0], 0);  /// MADV_DONTNEED之后匿名页重新补零
+    pool.Free(b2);
+
+    highWater = oldHighWater;
+    cacheCount = oldCacheCount;
+    pool.Trim();
+    EXPECT_EQ(pool.GetStats().cachedBytes, 0u);
+}
+
+/// 栈以MAP_NORESERVE映射，物理页在第一次访问时才分配
+TEST(StackPool, LazyCommit) {
+    auto& pool = StackPool::getInstance();
+    StackBlock* b = pool.Allocate(StackPool::ClassSize(StackPool::kSizeClasses - 3)); /// 选一个其他用例不用的等级
+    EXPECT_NE(SmapsField(b->stack_, "VmFlags:").find(" nr"), std::string::npos);
+    EXPECT_EQ(std::stoul(SmapsField(b->stack_, "Rss:")), 0u);
+
+    b->stack_[b->stackSize_ - 1] = 1;  /// 只碰栈顶一页
+    EXPECT_LE(std::stoul(SmapsField(b->stack_, "Rss:")) * 1024, (unsigned long)getpagesize() * 16);
+    pool.Free(b);
+}
+
+/// 进程退出时静态对象析构之后，线程缓存的析构仍会把栈归还到池中
+TEST(StackPool, FreeAfterExit) {
+    ::testing::GTEST_FLAG(death_test_style) = "threadsafe";  /// 子进程重新执行，StackPool在atexit注册之后才构造
+    EXPECT_EXIT({
+        static std::atomic<bool> ready{false};
+        static std::atomic<bool> release{false};
+        static std::thread* worker = nullptr;
+        atexit([]{   /// 先于StackPool注册，因此在其静态析构（如果有）之后运行
+            release = true;
+            worker->join();
+        });
+        worker = new std::thread([]{
+            auto& pool = StackPool::getInstance();
+            pool.Free(pool.Allocate(64 * 1024));  /// 线程退出时由ThreadCache归还
+            ready = true;
+            while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            pool.Free(pool.Allocate(64 * 1024));
+        });
+        while (!ready) std::this_thread::yield();  /// StackPool构造完成后再退出
+        exit(0);
+    }, ::testing::ExitedWithCode(0), "");
+}
@@ -0,0 +1,107 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <debug/debugger.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using namespace cxk;
+using namespace std::chrono;
+
+/// 递归占用约depth KB的栈，yieldAtBottom时在最深处切出一次
+static int __attribute__((noinline)) UseStack(int depth, bool yieldAtBottom) {
+    volatile char buf[1024];
+    memset((char*)buf, depth, sizeof(buf));
+    if (depth <= 1) {
+        if (yieldAtBottom) Processor::StaticCoYield();
+        return buf[0];
+    }
+    return UseStack(depth - 1, yieldAtBottom) + buf[sizeof(buf) - 1];
+}
+
+static CoDebugger::StackUsage const* FindSite(std::vector<CoDebugger::StackUsage> const& usages, std::string const& site) {
+    for (auto const& u : usages)
+        if (u.site_ == site) return &u;
+    return nullptr;
+}
+
+class StackProbeTest : public SchedulerSuite<2> {
+protected:
+    void SetUp() override {
+        CoDebugger::getInstance().ResetStackUsage();
+    }
+
+    void TearDown() override {
+        CoDebugger::getInstance().SetStackProbeRate(0);
+    }
+};
+
+/// 私有栈：花纹扫描得到的最大使用量按创建位置聚合
+TEST_F(StackProbeTest, PrivateStackHighWater) {
+    CoDebugger::getInstance().SetStackProbeRate(1);
+    TaskAttr shallow, deep;
+    shallow.site_ = "shallow";
+    deep.site_ = "deep";
+    for (int i = 0; i < 10; ++i) {
+        Scheduler::getInstance().CreateTask([]{ UseStack(1, false); }, shallow);
+        Scheduler::getInstance().CreateTask([]{ UseStack(32, false); }, deep);
+    }
+    ASSERT_TRUE(WaitAllDone());
+
+    auto usages = CoDebugger::getInstance().GetStackUsage();
+    auto s = FindSite(usages, "shallow");
+    auto d = FindSite(usages, "deep");
+    ASSERT_TRUE(s && d);
+    EXPECT_EQ(s->samples_, 10u);
+    EXPECT_EQ(d->samples_, 10u);
+    EXPECT_LT(s->maxBytes_, 8u * 1024);
+    EXPECT_GE(d->maxBytes_, 32u * 1024);
+    EXPECT_LT(d->maxBytes_, d->stackSize_);
+    EXPECT_EQ(d->stackSize_, StackPool::DefaultStackSize());
+
+    std::string info = CoDebugger::getInstance().GetStackUsageInfo();
+    EXPECT_NE(info.find("deep"), std::string::npos);
+    EXPECT_NE(info.find("shallow"), std::string::npos);
+}
+
+/// 共享栈：记录切出时的栈深度
+TEST_F(StackProbeTest, SharedStackSwitchDepth) {
+    CoDebugger::getInstance().SetStackProbeRate(1);
+    TaskAttr attr;
+    attr.sharedStack_ = true;
+    attr.site_ = "shared";
+    for (int i = 0; i < 4; ++i)
+        Scheduler::getInstance().CreateTask([]{ UseStack(16, true); }, attr);
+    ASSERT_TRUE(WaitAllDone());
+
+    auto usages = CoDebugger::getInstance().GetStackUsage();
+    auto u = FindSite(usages, "shared");
+    ASSERT_TRUE(u);
+    EXPECT_EQ(u->samples_, 4u);
+    EXPECT_GE(u->maxBytes_, 16u * 1024);
+}
+
+/// 按比例采样；没有指定名称时按CreateTask的调用地址聚合
+TEST_F(StackProbeTest, SampleRateAndCallerSite) {
+    CoDebugger::getInstance().SetStackProbeRate(4);
+    for (int i = 0; i < 40; ++i)
+        Scheduler::getInstance().CreateTask([]{ UseStack(2, false); });
+    ASSERT_TRUE(WaitAllDone());
+
+    auto usages = CoDebugger::getInstance().GetStackUsage();
+    ASSERT_EQ(usages.size(), 1u);
+    EXPECT_EQ(usages[0].samples_, 10u);
+    EXPECT_GE(usages[0].maxBytes_, 2u * 1024);
+    EXPECT_FALSE(usages[0].site_.empty());
+
+    // 关闭后不再采样
+    CoDebugger::getInstance().SetStackProbeRate(0);
+    Scheduler::getInstance().CreateTask([]{ UseStack(2, false); });
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_EQ(CoDebugger::getInstance().GetStackUsage()[0].samples_, 10u);
+}
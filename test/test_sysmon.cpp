@@ -0,0 +1,84 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <scheduler/scheduler.h>
+#include <debug/debugger.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace cxk;
+using namespace std::chrono;
+
+static bool WaitFor(std::atomic<int> const& value, int expected, milliseconds timeout) {
+    auto deadline = steady_clock::now() + timeout;
+    while (value.load() < expected) {
+        if (steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    return true;
+}
+
+class SysmonTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        Sysmon::TimeSlice() = milliseconds(10);
+        Sysmon::MaxSpareProcessors() = 2;
+        StartScheduler(2, true);
+    }
+};
+
+/// 忙循环的协程在安全点让出，同一Processor上排队的协程不会被饿死
+TEST_F(SysmonTest, PreemptAtSafePoint) {
+    std::atomic<int> started{0};
+    std::atomic<int> children{0};
+    std::atomic<bool> stop{false};
+    uint64_t before = CoDebugger::getInstance().GetMetrics().total_.preempts_;
+
+    // 每个Processor上一个忙循环，子协程放在它的本地队列里，其他Processor也在忙，无法窃取
+    for (int i = 0; i < 2; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            ++started;
+            auto deadline = steady_clock::now() + milliseconds(3000);
+            while (started < 2 && steady_clock::now() < deadline) co_yield_if_preempted();
+            Scheduler::getInstance().CreateTask([&]{ ++children; });
+            while (!stop && steady_clock::now() < deadline) co_yield_if_preempted();
+        });
+    }
+
+    EXPECT_TRUE(WaitFor(children, 2, milliseconds(2000)));
+    stop = true;
+    ASSERT_TRUE(WaitAllDone());
+    EXPECT_GT(CoDebugger::getInstance().GetMetrics().total_.preempts_, before);
+    EXPECT_GT(Scheduler::getInstance().GetSysmon().PreemptRequests(), 0u);
+}
+
+/// 所有Processor都阻塞在系统调用中时，排队的协程由备用Processor执行
+TEST_F(SysmonTest, SpareForBlockedProcessors) {
+    std::atomic<int> blocked{0};
+    std::atomic<int> children{0};
+    std::size_t processors = Scheduler::getInstance().ProcessorCount();
+    std::size_t count = processors - Scheduler::getInstance().SpareProcessorCount();
+
+    // 新建的协程轮询分配，每个Processor一个阻塞的协程（不经过hook的sleep）
+    for (std::size_t i = 0; i < processors; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            ++blocked;
+            std::this_thread::sleep_for(milliseconds(600));
+        });
+    }
+    ASSERT_TRUE(WaitFor(blocked, (int)processors, milliseconds(1000)));
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < 4; ++i)
+        Scheduler::getInstance().CreateTask([&]{ ++children; });
+    EXPECT_TRUE(WaitFor(children, 4, milliseconds(400)));
+    EXPECT_LT(steady_clock::now() - start, milliseconds(400));
+    ASSERT_TRUE(WaitAllDone());
+
+    EXPECT_GT(Scheduler::getInstance().GetSysmon().BlockedDetections(), 0u);
+    EXPECT_GE(Scheduler::getInstance().ProcessorCount(), count + 1);
+    EXPECT_LE(Scheduler::getInstance().SpareProcessorCount(), Sysmon::MaxSpareProcessors());
+}
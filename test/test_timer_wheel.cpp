@@ -0,0 +1,143 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include <concurrence/timer_wheel.h>
+#include <scheduler/scheduler.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+typedef TimerWheel::time_point wheel_time_point;
+
+/// 随机到期时间（覆盖所有层），分步推进：不会提前触发，到期后一个tick内一定触发
+TEST(TimerWheelTest, FireNotEarlyNotLate) {
+    TimerWheel wheel;
+    const int kTimers = 2000;
+    std::vector<TimerWheel::Element> elements(kTimers);
+    std::vector<wheel_time_point> deadlines(kTimers);
+    std::vector<int> fired(kTimers, 0);
+
+    std::mt19937_64 rng(42);
+    wheel_time_point base = FastSteadyClock::now();
+    for (int i = 0; i < kTimers; ++i) {
+        int64_t ms;
+        switch (i % 4) {
+            case 0: ms = rng() % 256; break;
+            case 1: ms = rng() % 16384; break;
+            case 2: ms = rng() % (1 << 20); break;
+            default: ms = rng() % ((int64_t)1 << 23); break;
+        }
+        deadlines[i] = base + milliseconds(ms) + microseconds(rng() % 1000);
+        wheel.Schedule(elements[i], deadlines[i], [&fired, i]{ ++fired[i]; });
+    }
+    EXPECT_EQ(wheel.Size(), (std::size_t)kTimers);
+
+    wheel_time_point now = base;
+    wheel_time_point end = base + milliseconds((int64_t)1 << 23) + seconds(1);
+    while (now < end) {
+        now += milliseconds(1 + rng() % 5000);
+        wheel.Advance(now);
+        for (int i = 0; i < kTimers; ++i) {
+            if (fired[i]) {
+                ASSERT_LE(deadlines[i], now) << "timer " << i << " fired early";
+            } else {
+                ASSERT_GT(deadlines[i] + milliseconds(1), now) << "timer " << i << " fired late";
+            }
+        }
+    }
+
+    for (int i = 0; i < kTimers; ++i)
+        EXPECT_EQ(fired[i], 1);
+    EXPECT_TRUE(wheel.Empty());
+}
+
+/// 超出时间轮跨度的定时器逐层下沉，最终按时触发
+TEST(TimerWheelTest, BeyondRange) {
+    TimerWheel wheel;
+    TimerWheel::Element element;
+    bool fired = false;
+    wheel_time_point base = FastSteadyClock::now();
+    wheel_time_point deadline = base + hours(30);
+    wheel.Schedule(element, deadline, [&]{ fired = true; });
+
+    wheel.Advance(deadline - milliseconds(1));
+    EXPECT_FALSE(fired);
+    wheel.Advance(deadline + milliseconds(1));
+    EXPECT_TRUE(fired);
+}
+
+/// 取消未触发的定时器；触发后取消返回false
+TEST(TimerWheelTest, Cancel) {
+    TimerWheel wheel;
+    TimerWheel::Element a, b;
+    int fired = 0;
+    wheel_time_point base = FastSteadyClock::now();
+    wheel.Schedule(a, base + milliseconds(10), [&]{ ++fired; });
+    wheel.Schedule(b, base + seconds(100), [&]{ ++fired; });
+
+    EXPECT_TRUE(TimerWheel::Cancel(b));
+    EXPECT_EQ(wheel.Size(), 1u);
+    wheel.Advance(base + seconds(200));
+    EXPECT_EQ(fired, 1);
+    EXPECT_FALSE(TimerWheel::Cancel(a));
+    EXPECT_FALSE(TimerWheel::Cancel(b));
+
+    TimerWheel::Element never;
+    EXPECT_FALSE(TimerWheel::Cancel(never));
+
+    // 取消后可以再次使用
+    wheel.Schedule(b, base + seconds(300), [&]{ fired += 10; });
+    wheel.Advance(base + seconds(301));
+    EXPECT_EQ(fired, 11);
+}
+
+/// 下一次需要推进的时间
+TEST(TimerWheelTest, NextTimeout) {
+    TimerWheel wheel;
+    EXPECT_EQ(wheel.NextTimeout(), nanoseconds::max());
+
+    TimerWheel::Element element;
+    wheel.Schedule(element, FastSteadyClock::now() + milliseconds(50), []{});
+    nanoseconds timeout = wheel.NextTimeout();
+    EXPECT_GT(timeout, milliseconds(40));
+    EXPECT_LE(timeout, milliseconds(52));
+    TimerWheel::Cancel(element);
+}
+
+/// co_sleep只挂起协程，不阻塞工作线程
+TEST(TimerWheelTest, CoSleep) {
+    Scheduler::getInstance().Start(2);
+    const int kSleepers = 100;
+    std::atomic<int> woken{0}, ran{0};
+    auto start = steady_clock::now();
+    for (int i = 0; i < kSleepers; ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            co_sleep(milliseconds(30));
+            ++woken;
+        });
+    }
+    for (int i = 0; i < kSleepers; ++i) {
+        Scheduler::getInstance().CreateTask([&]{ ++ran; });
+    }
+
+    while (ran < kSleepers && steady_clock::now() - start < seconds(5))
+        std::this_thread::sleep_for(milliseconds(1));
+    EXPECT_EQ(ran, kSleepers);
+
+    auto deadline = steady_clock::now() + seconds(5);
+    while (Scheduler::getInstance().TaskCount() != 0 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    EXPECT_EQ(woken, kSleepers);
+    EXPECT_GE(steady_clock::now() - start, milliseconds(30));
+
+    // 线程中退化为普通休眠
+    start = steady_clock::now();
+    co_sleep(milliseconds(10));
+    EXPECT_GE(steady_clock::now() - start, milliseconds(10));
+}
@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <common/smart_ptr.h>
 #include <thread>
+#include <vector>
 #include <concurrentqueue/concurrentqueue.h>
 
 using namespace cxk;
@@ -211,6 +212,70 @@ TEST(TSQueue, ThreadSafety) {
     EXPECT_TRUE(queue.empty()); // 验证所有元素都被消费
 }
 
+TEST(MPSCQueue, PushPopAll) {
+    cxk::MPSCQueue<TestElement> queue;
+    EXPECT_TRUE(queue.emptyUnsafe());
+    EXPECT_TRUE(queue.pop_all().empty());
+
+    std::vector<std::shared_ptr<TestElement>> elems;
+    for (int i = 0; i < 3; ++i)
+        elems.push_back(MakeSharedWrapper<TestElement>(i));
+
+    // 取出后可以再次入队，链表按入队顺序排列
+    for (int round = 0; round < 2; ++round) {
+        for (auto& e : elems)
+            queue.push(e.get());
+        EXPECT_FALSE(queue.emptyUnsafe());
+
+        SList<TestElement> list = queue.pop_all();
+        EXPECT_TRUE(queue.emptyUnsafe());
+        ASSERT_EQ(list.size(), 3u);
+        int expect = 0;
+        for (auto& e : list)
+            EXPECT_EQ(e.value, expect++);
+        list.clear();
+    }
+}
+
+TEST(MPSCQueue, MultiProducer) {
+    cxk::MPSCQueue<TestElement> queue;
+    const int kThreadCount = 4;
+    const int kElementsPerThread = 20000;
+
+    std::vector<std::shared_ptr<TestElement>> elems;
+    for (int i = 0; i < kThreadCount * kElementsPerThread; ++i)
+        elems.push_back(MakeSharedWrapper<TestElement>(i));
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < kThreadCount; ++i) {
+        producers.emplace_back([&, i]() {
+            for (int j = 0; j < kElementsPerThread; ++j)
+                queue.push(elems[i * kElementsPerThread + j].get());
+        });
+    }
+
+    // 唯一的消费者：每个元素恰好取到一次，同一生产者的元素保持入队顺序
+    std::vector<int> last(kThreadCount, -1);
+    int received = 0;
+    bool ordered = true;
+    while (received < kThreadCount * kElementsPerThread) {
+        SList<TestElement> list = queue.pop_all();
+        for (auto& e : list) {
+            int producer = e.value / kElementsPerThread;
+            ordered &= e.value > last[producer];
+            last[producer] = e.value;
+            ++received;
+        }
+        list.clear();
+    }
+
+    for (auto& t : producers) t.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(received, kThreadCount * kElementsPerThread);
+    EXPECT_TRUE(queue.emptyUnsafe());
+    EXPECT_TRUE(queue.pop_all().empty());
+}
+
 // 模板化性能测试函数
 template <typename QueueType>
 struct QueuePerformanceTester {
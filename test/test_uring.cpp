@@ -0,0 +1,267 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+#include <gtest/gtest.h>
+#include "test_util.h"
+#include <netio/hook.h>
+#include <netio/reactor.h>
+#include <netio/uring_reactor.h>
+#include <scheduler/scheduler.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cxk;
+using namespace std::chrono;
+
+static int MakeTempFile() {
+    char path[] = "/tmp/gocoroutine_uring_XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd >= 0) ::unlink(path);
+    return fd;
+}
+
+class UringTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        Reactor::SetBackend(Reactor::kUring);
+        StartScheduler(2);
+    }
+
+    void SetUp() override {
+        if (!UringReactor::Available())
+            GTEST_SKIP() << "io_uring is not available";
+    }
+};
+
+TEST_F(UringTest, BackendSelected) {
+    Scheduler& scheduler = Scheduler::getInstance();
+    ASSERT_GT(scheduler.ProcessorCount(), 0u);
+    for (std::size_t i = 0; i < scheduler.ProcessorCount(); ++i)
+        EXPECT_EQ(scheduler.GetProcessor(i)->GetReactor()->GetBackend(), Reactor::kUring);
+}
+
+/// 就绪通知走IORING_OP_POLL_ADD：co_read/co_write语义与epoll后端一致
+TEST_F(UringTest, ReadinessPingPong) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    const int kRounds = 500;
+    std::atomic<int> pongs{0};
+
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kRounds; ++i) {
+            int v = -1;
+            ASSERT_EQ(co_read(fds[1], &v, sizeof(v)), (ssize_t)sizeof(v));
+            ASSERT_EQ(v, i);
+            ASSERT_EQ(co_write(fds[1], &v, sizeof(v)), (ssize_t)sizeof(v));
+        }
+    });
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kRounds; ++i) {
+            ASSERT_EQ(co_write(fds[0], &i, sizeof(i)), (ssize_t)sizeof(i));
+            int v = -1;
+            ASSERT_EQ(co_read(fds[0], &v, sizeof(v)), (ssize_t)sizeof(v));
+            ASSERT_EQ(v, i);
+            ++pongs;
+        }
+    });
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(pongs, kRounds);
+
+    // co_close移除挂起的POLL_ADD并唤醒等待者，对端随即读到EOF
+    std::atomic<ssize_t> result{1};
+    std::atomic<bool> reading{false};
+    Scheduler::getInstance().CreateTask([&]{
+        char c;
+        reading = true;
+        result = co_read(fds[0], &c, 1);
+    });
+    while (!reading)
+        std::this_thread::sleep_for(milliseconds(1));
+    std::this_thread::sleep_for(milliseconds(20));
+    co_close(fds[0]);
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(result, -1);
+
+    char c;
+    EXPECT_EQ(::read(fds[1], &c, 1), 0);
+    co_close(fds[1]);
+}
+
+/// 完成式读写普通文件：多个协程按偏移并发写入后读回
+TEST_F(UringTest, FileReadWrite) {
+    int fd = MakeTempFile();
+    ASSERT_GE(fd, 0);
+    const int kBlocks = 64;
+    const int kBlockSize = 512;
+
+    for (int i = 0; i < kBlocks; ++i) {
+        Scheduler::getInstance().CreateTask([=]{
+            std::string block(kBlockSize, (char)('a' + i % 26));
+            ASSERT_EQ(co_uring_write(fd, block.data(), block.size(), (off_t)i * kBlockSize), kBlockSize);
+        });
+    }
+    ASSERT_TRUE(WaitAllDone());
+
+    std::atomic<int> verified{0};
+    for (int i = 0; i < kBlocks; ++i) {
+        Scheduler::getInstance().CreateTask([&, i]{
+            std::string block(kBlockSize, '\0');
+            ASSERT_EQ(co_uring_read(fd, &block[0], block.size(), (off_t)i * kBlockSize), kBlockSize);
+            ASSERT_EQ(block, std::string(kBlockSize, (char)('a' + i % 26)));
+            ++verified;
+        });
+    }
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(verified, kBlocks);
+    ::close(fd);
+}
+
+/// 阻塞的pipe：读请求挂在内核中，期间工作线程继续执行其他协程
+TEST_F(UringTest, PendingReadDoesNotBlockWorker) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    std::atomic<int> ran{0};
+    std::atomic<ssize_t> got{-2};
+    char buf[16] = {};
+
+    Scheduler::getInstance().CreateTask([&]{
+        got = co_uring_read(fds[0], buf, sizeof(buf));
+    });
+    for (int i = 0; i < 100; ++i)
+        Scheduler::getInstance().CreateTask([&]{ ++ran; });
+
+    auto deadline = steady_clock::now() + seconds(5);
+    while (ran < 100 && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(1));
+    EXPECT_EQ(ran, 100);
+    EXPECT_EQ(got, -2);
+
+    ASSERT_EQ(::write(fds[1], "hello", 5), 5);
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(got, 5);
+    EXPECT_EQ(std::string(buf, 5), "hello");
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+/// 忙碌的Processor不进入空闲也不用等到下一次收割：SQE在下一次派发之前交给内核
+TEST_F(UringTest, BusyProcessorSubmitsPromptly) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    const int kRounds = 8;
+    const auto kSlice = milliseconds(2);    /// 每次派发占用的时间，kPollInterval次派发约128ms
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> sentNs{0};
+    std::vector<int64_t> latencies;
+
+    /// 阻塞读线程：内核执行写请求后立即返回，不依赖Processor收割完成事件
+    std::thread reader([&]{
+        char c;
+        for (int i = 0; i < kRounds; ++i) {
+            if (::read(fds[0], &c, 1) != 1) break;
+            int64_t now = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+            latencies.push_back(now - sentNs.load());
+        }
+    });
+
+    /// 所有Processor上都有忙碌的协程，始终不会空闲
+    for (std::size_t i = 0; i < 4 * Scheduler::getInstance().ProcessorCount(); ++i) {
+        Scheduler::getInstance().CreateTask([&]{
+            while (!stop) {
+                auto end = steady_clock::now() + kSlice;
+                while (steady_clock::now() < end) {}
+                Processor::StaticCoYield();
+            }
+        });
+    }
+    Scheduler::getInstance().CreateTask([&]{
+        for (int i = 0; i < kRounds; ++i) {
+            sentNs = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+            ASSERT_EQ(co_uring_write(fds[1], "x", 1), 1);
+        }
+        stop = true;
+    });
+
+    reader.join();
+    stop = true;
+    EXPECT_TRUE(WaitAllDone());
+    ASSERT_EQ((int)latencies.size(), kRounds);
+    std::sort(latencies.begin(), latencies.end());
+    EXPECT_LT(latencies[kRounds / 2], duration_cast<nanoseconds>(milliseconds(20)).count());
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+/// SO_RCVTIMEO：超时后取消请求，返回EAGAIN
+TEST_F(UringTest, ReadTimeoutCancels) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    timeval tv = {0, 30 * 1000};
+    ASSERT_EQ(co_setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)), 0);
+
+    std::atomic<int> err{0};
+    std::atomic<int64_t> elapsedMs{0};
+    Scheduler::getInstance().CreateTask([&]{
+        char c;
+        auto start = steady_clock::now();
+        if (co_uring_read(fds[0], &c, 1) < 0) err = errno;
+        elapsedMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    });
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_EQ(err, EAGAIN);
+    EXPECT_GE(elapsedMs, 25);
+    EXPECT_LT(elapsedMs, 2000);
+
+    // 被取消的请求不会再消耗之后写入的数据
+    ASSERT_EQ(::write(fds[1], "z", 1), 1);
+    char c = 0;
+    EXPECT_EQ(::read(fds[0], &c, 1), 1);
+    EXPECT_EQ(c, 'z');
+    co_close(fds[0]);
+    co_close(fds[1]);
+}
+
+/// 固定缓冲区与固定文件
+TEST_F(UringTest, RegisteredBuffersAndFiles) {
+    static char arena[4096];
+    iovec iov = {arena, sizeof(arena)};
+    ASSERT_EQ(co_uring_register_buffers(&iov, 1), 0);
+
+    int fd = MakeTempFile();
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(co_uring_register_files(&fd, 1), 0);
+
+    std::atomic<bool> ok{false};
+    Scheduler::getInstance().CreateTask([&]{
+        UringIoOptions opt;
+        opt.bufIndex = 0;
+        memcpy(arena, "fixed-buffer", 12);
+        ASSERT_EQ(co_uring_write(fd, arena, 12, 0, &opt), 12);
+
+        UringIoOptions fileOpt;
+        fileOpt.fixedFile = true;
+        char out[12] = {};
+        ASSERT_EQ(co_uring_read(0, out, sizeof(out), 0, &fileOpt), 12);
+        ASSERT_EQ(std::string(out, 12), "fixed-buffer");
+        ok = true;
+    });
+    EXPECT_TRUE(WaitAllDone());
+    EXPECT_TRUE(ok);
+
+    // 协程外不支持固定文件
+    UringIoOptions fileOpt;
+    fileOpt.fixedFile = true;
+    char c;
+    EXPECT_EQ(co_uring_read(0, &c, 1, 0, &fileOpt), -1);
+    EXPECT_EQ(errno, ENOTSUP);
+    ::close(fd);
+}
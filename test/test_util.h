@@ -0,0 +1,66 @@
+//
+// Created by cxk_zjq on 25-6-3.
+//
+
+#ifndef GOCOROUTINE_TEST_UTIL_H
+#define GOCOROUTINE_TEST_UTIL_H
+
+#pragma once
+#include <gtest/gtest.h>
+#include <common/clock.h>
+#include <scheduler/scheduler.h>
+#include <chrono>
+#include <thread>
+
+/*
+ * @brief 需要运行协程的测试共用的部分
+ * Scheduler只能Start一次，每个测试可执行文件在测试套件的SetUpTestSuite中启动，之后所有用例共用这些工作线程。
+ */
+
+namespace cxk
+{
+
+/// @brief 等待所有协程执行完毕，超时返回false
+inline bool WaitAllDone(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000))
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (Scheduler::getInstance().TaskCount() != 0) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// @brief 等待FastSteadyClock校准完成，之后TSC计数才能换算为时间（等待时间、CPU采样等统计依赖它）
+inline void WaitClockCalibrated(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000))
+{
+    FastSteadyClock::StartCalibration();
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (FastSteadyClock::TicksPerNanosecond() == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/// @brief 启动调度器；calibrate为true时等待时钟校准完成再返回
+inline void StartScheduler(int threads, bool calibrate = false)
+{
+    Scheduler::getInstance().Start(threads);
+    if (calibrate) WaitClockCalibrated();
+}
+
+/*
+ * @brief 启动Threads个工作线程的测试夹具，各测试套件从它派生
+ * 需要在Start之前设置选项（Sysmon、NUMA、后端等）的套件定义自己的SetUpTestSuite，设置后调用StartScheduler。
+ */
+template <int Threads>
+class SchedulerSuite : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        StartScheduler(Threads);
+    }
+};
+
+} // cxk
+
+#endif //GOCOROUTINE_TEST_UTIL_H
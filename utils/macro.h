@@ -26,6 +26,15 @@
 
 # define ALWAYS_INLINE __attribute__ ((always_inline)) inline  /// 强制内联宏定义
 
+/// 自旋等待时提示CPU降低功耗、让出超线程资源
+#if defined(__x86_64__) || defined(__i386__)
+# define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+# define CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else
+# define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
 
 /*
  * 日志级别宏定义，并发调试宏定义